@@ -0,0 +1,613 @@
+#include "BVH.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+#include "ThreadPool.h"
+
+using namespace rez;
+
+namespace {
+    const uint32_t BINS = 16;
+    const uint32_t LEAF_SIZE = 4;           // nodes this small are always leaves
+    const uint32_t MAX_LEAF = 16;           // nodes larger than this are always split
+    const uint32_t MAX_DEPTH = 100;         // keeps the traversal stacks bounded
+    const uint32_t PARALLEL_SPLIT = 16384;  // larger subtrees are built as tasks
+    const float INF = std::numeric_limits<float>::infinity();
+
+    struct Box {
+        float lo[3] = { INF, INF, INF };
+        float hi[3] = { -INF, -INF, -INF };
+
+        void grow(const float* _lo, const float* _hi)
+        {
+            for (int a = 0; a < 3; a++) {
+                lo[a] = std::min(lo[a], _lo[a]);
+                hi[a] = std::max(hi[a], _hi[a]);
+            }
+        }
+
+        float area() const
+        {
+            const float dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+            return dx < 0 ? 0 : dx * dy + dy * dz + dz * dx;
+        }
+    };
+
+    // Top down build. The node array is sized for the worst case up front, so
+    // tasks can claim pairs of children with one atomic add.
+    struct Builder {
+        std::vector<BVHNode>& nodes;
+        std::vector<uint32_t>& order;
+        const std::vector<float>& bounds;   // lo xyz, hi xyz per triangle
+        const std::vector<float>& centre;   // xyz per triangle
+        std::atomic<uint32_t> used{ 1 };
+
+        void split(uint32_t _node, uint32_t _begin, uint32_t _end, uint32_t _depth, TaskGroup* _group)
+        {
+            BVHNode& node = nodes[_node];
+            Box box, centres;
+            for (uint32_t i = _begin; i < _end; i++) {
+                const uint32_t t = order[i];
+                box.grow(&bounds[6 * size_t(t)], &bounds[6 * size_t(t) + 3]);
+                centres.grow(&centre[3 * size_t(t)], &centre[3 * size_t(t)]);
+            }
+            std::copy(box.lo, box.lo + 3, node.lo);
+            std::copy(box.hi, box.hi + 3, node.hi);
+            const uint32_t count = _end - _begin;
+            if (count <= LEAF_SIZE || _depth >= MAX_DEPTH) {
+                node.first = _begin;
+                node.count = count;
+                return;
+            }
+
+            // surface area heuristic over BINS buckets of the centres per axis
+            int best_axis = -1;
+            uint32_t best_bin = 0;
+            float best_cost = INF;
+            for (int a = 0; a < 3; a++) {
+                const float extent = centres.hi[a] - centres.lo[a];
+                if (!(extent > 0))
+                    continue;
+                const float scale = BINS / extent;
+                Box bins[BINS];
+                uint32_t counts[BINS] = {};
+                for (uint32_t i = _begin; i < _end; i++) {
+                    const uint32_t t = order[i];
+                    const auto b = std::min(BINS - 1, uint32_t((centre[3 * size_t(t) + a] - centres.lo[a]) * scale));
+                    bins[b].grow(&bounds[6 * size_t(t)], &bounds[6 * size_t(t) + 3]);
+                    counts[b]++;
+                }
+                float right_area[BINS];
+                uint32_t right_count[BINS];
+                Box right;
+                uint32_t n = 0;
+                for (uint32_t b = BINS - 1; b > 0; b--) {
+                    right.grow(bins[b].lo, bins[b].hi);
+                    n += counts[b];
+                    right_area[b] = right.area();
+                    right_count[b] = n;
+                }
+                Box left;
+                n = 0;
+                for (uint32_t b = 0; b + 1 < BINS; b++) {
+                    left.grow(bins[b].lo, bins[b].hi);
+                    n += counts[b];
+                    if (n == 0 || right_count[b + 1] == 0)
+                        continue;
+                    const float cost = left.area() * n + right_area[b + 1] * right_count[b + 1];
+                    if (cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = a;
+                        best_bin = b;
+                    }
+                }
+            }
+
+            // a split pays off when it beats testing every triangle, counting one
+            // triangle test for the traversal step
+            const float leaf_cost = box.area() * count;
+            if (count <= MAX_LEAF && (best_axis < 0 || best_cost + box.area() >= leaf_cost)) {
+                node.first = _begin;
+                node.count = count;
+                return;
+            }
+
+            uint32_t mid = _begin + count / 2;
+            if (best_axis >= 0) {
+                const float lo = centres.lo[best_axis];
+                const float scale = BINS / (centres.hi[best_axis] - lo);
+                auto it = std::partition(order.begin() + _begin, order.begin() + _end, [&](uint32_t t) {
+                    return std::min(BINS - 1, uint32_t((centre[3 * size_t(t) + best_axis] - lo) * scale)) <= best_bin;
+                });
+                mid = static_cast<uint32_t>(it - order.begin());
+            }
+
+            const uint32_t left = used.fetch_add(2);
+            node.first = left;
+            node.count = 0;
+            if (_group && count > PARALLEL_SPLIT)
+                _group->run([=, this] { split(left, _begin, mid, _depth + 1, _group); });
+            else
+                split(left, _begin, mid, _depth + 1, _group);
+            split(left + 1, mid, _end, _depth + 1, _group);
+        }
+    };
+
+    struct Ray {
+        float o[3], d[3], inv[3];
+
+        Ray(const Point3d& _origin, const Vector3f& _direction)
+        {
+            for (int a = 0; a < 3; a++) {
+                o[a] = _origin.coords[a];
+                d[a] = _direction.coords[a];
+                // a huge finite slope keeps 0 * inf out of the slab test
+                inv[a] = 1.0f / (d[a] != 0 ? d[a] : std::copysign(1e-30f, d[a]));
+            }
+        }
+    };
+
+    // distance along the ray to where it enters the box, INF if it misses before _t_max
+    inline float enter(const BVHNode& _node, const Ray& _ray, float _t_max)
+    {
+        float t0 = 0, t1 = _t_max;
+        for (int a = 0; a < 3; a++) {
+            float near = (_node.lo[a] - _ray.o[a]) * _ray.inv[a];
+            float far = (_node.hi[a] - _ray.o[a]) * _ray.inv[a];
+            if (near > far)
+                std::swap(near, far);
+            t0 = std::max(t0, near);
+            t1 = std::min(t1, far);
+        }
+        return t0 <= t1 ? t0 : INF;
+    }
+
+    // Moller Trumbore, true for a hit with 0 < t < _t that then becomes the hit distance
+    inline bool hitTriangle(const float* _tri, const Ray& _ray, float& _t, float& _u, float& _v)
+    {
+        const float* v0 = _tri;
+        const float* e1 = _tri + 3;
+        const float* e2 = _tri + 6;
+        const float p[3] = { _ray.d[1] * e2[2] - _ray.d[2] * e2[1], _ray.d[2] * e2[0] - _ray.d[0] * e2[2],
+                             _ray.d[0] * e2[1] - _ray.d[1] * e2[0] };
+        const float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+        if (det == 0)
+            return false;
+        const float inv = 1.0f / det;
+        const float s[3] = { _ray.o[0] - v0[0], _ray.o[1] - v0[1], _ray.o[2] - v0[2] };
+        const float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+        if (u < 0 || u > 1)
+            return false;
+        const float q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+        const float v = (_ray.d[0] * q[0] + _ray.d[1] * q[1] + _ray.d[2] * q[2]) * inv;
+        if (v < 0 || u + v > 1)
+            return false;
+        const float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+        if (!(t > 0 && t < _t))
+            return false;
+        _t = t;
+        _u = u;
+        _v = v;
+        return true;
+    }
+
+    inline float distance2(const BVHNode& _node, const float* _p)
+    {
+        float d2 = 0;
+        for (int a = 0; a < 3; a++) {
+            const float d = std::max({ _node.lo[a] - _p[a], 0.0f, _p[a] - _node.hi[a] });
+            d2 += d * d;
+        }
+        return d2;
+    }
+
+    inline float dot(const float* _a, const float* _b) { return _a[0] * _b[0] + _a[1] * _b[1] + _a[2] * _b[2]; }
+
+    // closest point of triangle a, a + e1, a + e2 to _p by its Voronoi regions (Ericson)
+    void closestOnTriangle(const float* _tri, const float* _p, float* _out)
+    {
+        const float* a = _tri;
+        const float* ab = _tri + 3;
+        const float* ac = _tri + 6;
+        auto point = [&](float v, float w) {
+            for (int k = 0; k < 3; k++)
+                _out[k] = a[k] + ab[k] * v + ac[k] * w;
+        };
+        const float ap[3] = { _p[0] - a[0], _p[1] - a[1], _p[2] - a[2] };
+        const float d1 = dot(ab, ap), d2 = dot(ac, ap);
+        if (d1 <= 0 && d2 <= 0)
+            return point(0, 0);
+        const float bp[3] = { ap[0] - ab[0], ap[1] - ab[1], ap[2] - ab[2] };
+        const float d3 = dot(ab, bp), d4 = dot(ac, bp);
+        if (d3 >= 0 && d4 <= d3)
+            return point(1, 0);
+        const float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0 && d1 >= 0 && d3 <= 0)
+            return point(d1 / (d1 - d3), 0);
+        const float cp[3] = { ap[0] - ac[0], ap[1] - ac[1], ap[2] - ac[2] };
+        const float d5 = dot(ab, cp), d6 = dot(ac, cp);
+        if (d6 >= 0 && d5 <= d6)
+            return point(0, 1);
+        const float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0 && d2 >= 0 && d6 <= 0)
+            return point(0, d2 / (d2 - d6));
+        const float va = d3 * d6 - d5 * d4;
+        if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+            const float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+            return point(1 - w, w);
+        }
+        const float denom = 1 / (va + vb + vc);
+        return point(vb * denom, vc * denom);
+    }
+
+    // separating axis test of a triangle against a box given by centre and half size
+    bool triangleMeetsBox(const float* _tri, const float* _centre, const float* _half)
+    {
+        float v[3][3];
+        for (int k = 0; k < 3; k++) {
+            v[0][k] = _tri[k] - _centre[k];
+            v[1][k] = v[0][k] + _tri[3 + k];
+            v[2][k] = v[0][k] + _tri[6 + k];
+        }
+        auto separates = [&](const float* axis) {
+            const float p0 = dot(v[0], axis), p1 = dot(v[1], axis), p2 = dot(v[2], axis);
+            const float r = _half[0] * std::fabs(axis[0]) + _half[1] * std::fabs(axis[1]) + _half[2] * std::fabs(axis[2]);
+            return std::min({ p0, p1, p2 }) > r || std::max({ p0, p1, p2 }) < -r;
+        };
+        const float edges[3][3] = { { v[1][0] - v[0][0], v[1][1] - v[0][1], v[1][2] - v[0][2] },
+                                    { v[2][0] - v[1][0], v[2][1] - v[1][1], v[2][2] - v[1][2] },
+                                    { v[0][0] - v[2][0], v[0][1] - v[2][1], v[0][2] - v[2][2] } };
+        for (int k = 0; k < 3; k++) {
+            const float axis[3] = { k == 0 ? 1.0f : 0.0f, k == 1 ? 1.0f : 0.0f, k == 2 ? 1.0f : 0.0f };
+            if (separates(axis))
+                return false;
+        }
+        const float normal[3] = { edges[0][1] * edges[1][2] - edges[0][2] * edges[1][1],
+                                  edges[0][2] * edges[1][0] - edges[0][0] * edges[1][2],
+                                  edges[0][0] * edges[1][1] - edges[0][1] * edges[1][0] };
+        if (separates(normal))
+            return false;
+        for (const auto& e : edges) {
+            const float axes[3][3] = { { 0, -e[2], e[1] }, { e[2], 0, -e[0] }, { -e[1], e[0], 0 } };
+            for (const auto& axis : axes)
+                if (separates(axis))
+                    return false;
+        }
+        return true;
+    }
+
+    struct Entry {
+        uint32_t node;
+        float distance;
+    };
+}
+
+rez::BVH::BVH(const std::vector<Point3d>& _points, const std::vector<uint32_t>& _triangles, unsigned _threads)
+{
+    build(_points, _triangles, _threads);
+}
+
+rez::BVH::BVH(std::vector<Face>& _faces, unsigned _threads)
+{
+    std::unordered_map<const Point3d*, uint32_t> index;
+    std::vector<const Point3d*> from;
+    std::vector<Point3d> points;
+    std::vector<uint32_t> triangles;
+    std::vector<uint32_t> ids;
+    for (auto& face : _faces) {
+        if (face.vertices.size() < 3)
+            continue;
+        ids.clear();
+        for (auto* vertex : face.vertices) {
+            auto added = index.emplace(vertex->point, static_cast<uint32_t>(points.size()));
+            if (added.second) {
+                points.push_back(*vertex->point);
+                from.push_back(vertex->point);
+            }
+            ids.push_back(added.first->second);
+        }
+        for (size_t k = 1; k + 1 < ids.size(); k++)
+            triangles.insert(triangles.end(), { ids[0], ids[k], ids[k + 1] });
+    }
+    build(points, triangles, _threads);
+    sources = std::move(from);
+}
+
+rez::BVH::BVH(Polyhedron& _polyhedron, unsigned _threads) : BVH(_polyhedron.getFaces(), _threads)
+{
+}
+
+void rez::BVH::build(const std::vector<Point3d>& _points, const std::vector<uint32_t>& _triangles, unsigned _threads)
+{
+    vertices.resize(3 * _points.size());
+    for (size_t i = 0; i < _points.size(); i++)
+        for (int a = 0; a < 3; a++)
+            vertices[3 * i + a] = _points[i].coords[a];
+    indices.assign(_triangles.begin(), _triangles.end() - _triangles.size() % 3);
+    sources.clear();
+    nodes.clear();
+
+    const auto n = static_cast<uint32_t>(indices.size() / 3);
+    order.resize(n);
+    std::iota(order.begin(), order.end(), 0);
+    if (n == 0) {
+        tri.clear();
+        return;
+    }
+
+    std::vector<float> bounds(6 * size_t(n)), centre(3 * size_t(n));
+    for (size_t t = 0; t < n; t++) {
+        for (int a = 0; a < 3; a++) {
+            const float p = vertices[3 * size_t(indices[3 * t]) + a];
+            const float q = vertices[3 * size_t(indices[3 * t + 1]) + a];
+            const float r = vertices[3 * size_t(indices[3 * t + 2]) + a];
+            bounds[6 * t + a] = std::min({ p, q, r });
+            bounds[6 * t + 3 + a] = std::max({ p, q, r });
+            centre[3 * t + a] = (bounds[6 * t + a] + bounds[6 * t + 3 + a]) / 2;
+        }
+    }
+
+    nodes.resize(2 * size_t(n) - 1);
+    Builder builder{ nodes, order, bounds, centre };
+    ThreadPool& pool = ThreadPool::global();
+    if (_threads == 1 || pool.size() < 2 || n <= PARALLEL_SPLIT) {
+        builder.split(0, 0, n, 0, nullptr);
+    }
+    else {
+        TaskGroup group(pool);
+        builder.split(0, 0, n, 0, &group);
+        group.wait();
+    }
+    nodes.resize(builder.used);
+    loadTriangles();
+}
+
+void rez::BVH::loadTriangles()
+{
+    tri.resize(9 * order.size());
+    for (size_t s = 0; s < order.size(); s++) {
+        const uint32_t* v = &indices[3 * size_t(order[s])];
+        float* out = &tri[9 * s];
+        for (int a = 0; a < 3; a++) {
+            out[a] = vertices[3 * size_t(v[0]) + a];
+            out[3 + a] = vertices[3 * size_t(v[1]) + a] - out[a];
+            out[6 + a] = vertices[3 * size_t(v[2]) + a] - out[a];
+        }
+    }
+}
+
+// children always come after their parent, so one backwards pass sees them first
+void rez::BVH::refitNodes()
+{
+    for (size_t i = nodes.size(); i-- > 0;) {
+        BVHNode& node = nodes[i];
+        Box box;
+        if (node.count) {
+            for (uint32_t s = node.first; s < node.first + node.count; s++) {
+                const uint32_t* v = &indices[3 * size_t(order[s])];
+                for (int k = 0; k < 3; k++)
+                    box.grow(&vertices[3 * size_t(v[k])], &vertices[3 * size_t(v[k])]);
+            }
+        }
+        else {
+            box.grow(nodes[node.first].lo, nodes[node.first].hi);
+            box.grow(nodes[node.first + 1].lo, nodes[node.first + 1].hi);
+        }
+        std::copy(box.lo, box.lo + 3, node.lo);
+        std::copy(box.hi, box.hi + 3, node.hi);
+    }
+}
+
+void rez::BVH::refit(const std::vector<Point3d>& _points)
+{
+    if (3 * _points.size() != vertices.size())
+        return;
+    for (size_t i = 0; i < _points.size(); i++)
+        for (int a = 0; a < 3; a++)
+            vertices[3 * i + a] = _points[i].coords[a];
+    loadTriangles();
+    refitNodes();
+}
+
+void rez::BVH::refit()
+{
+    if (sources.empty())
+        return;
+    for (size_t i = 0; i < sources.size(); i++)
+        for (int a = 0; a < 3; a++)
+            vertices[3 * i + a] = sources[i]->coords[a];
+    loadTriangles();
+    refitNodes();
+}
+
+bool rez::BVH::intersect(const Point3d& _origin, const Vector3f& _direction, BVHHit& _hit, float _t_max) const
+{
+    if (nodes.empty())
+        return false;
+    const Ray ray(_origin, _direction);
+    float best = _t_max;
+    bool found = false;
+    Entry stack[MAX_DEPTH + 2];
+    int top = 0;
+    if (enter(nodes[0], ray, best) == INF)
+        return false;
+    stack[top++] = { 0, 0 };
+    while (top > 0) {
+        const Entry entry = stack[--top];
+        if (entry.distance >= best)
+            continue;
+        const BVHNode& node = nodes[entry.node];
+        if (node.count) {
+            for (uint32_t s = node.first; s < node.first + node.count; s++) {
+                if (hitTriangle(&tri[9 * size_t(s)], ray, best, _hit.u, _hit.v)) {
+                    _hit.t = best;
+                    _hit.triangle = order[s];
+                    found = true;
+                }
+            }
+            continue;
+        }
+        // the nearer child goes on top of the stack
+        Entry near{ node.first, enter(nodes[node.first], ray, best) };
+        Entry far{ node.first + 1, enter(nodes[node.first + 1], ray, best) };
+        if (far.distance < near.distance)
+            std::swap(near, far);
+        if (far.distance != INF)
+            stack[top++] = far;
+        if (near.distance != INF)
+            stack[top++] = near;
+    }
+    return found;
+}
+
+bool rez::BVH::occluded(const Point3d& _origin, const Vector3f& _direction, float _t_max) const
+{
+    if (nodes.empty())
+        return false;
+    const Ray ray(_origin, _direction);
+    float t = _t_max, u, v;
+    uint32_t stack[MAX_DEPTH + 2];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BVHNode& node = nodes[stack[--top]];
+        if (enter(node, ray, _t_max) == INF)
+            continue;
+        if (node.count) {
+            for (uint32_t s = node.first; s < node.first + node.count; s++)
+                if (hitTriangle(&tri[9 * size_t(s)], ray, t, u, v))
+                    return true;
+            continue;
+        }
+        stack[top++] = node.first + 1;
+        stack[top++] = node.first;
+    }
+    return false;
+}
+
+void rez::BVH::intersect(const std::vector<Point3d>& _origins, const std::vector<Vector3f>& _directions,
+                         std::vector<BVHHit>& _hits, unsigned _threads) const
+{
+    const size_t n = std::min(_origins.size(), _directions.size());
+    _hits.assign(n, BVHHit());
+    ThreadPool& pool = ThreadPool::global();
+    const size_t tasks = _threads ? _threads : pool.size();
+
+    // rays are handed out in chunks, neighbouring rays tend to share nodes
+    const size_t CHUNK = 256;
+    std::atomic<size_t> cursor{ 0 };
+    auto work = [&] {
+        for (size_t first = cursor.fetch_add(CHUNK); first < n; first = cursor.fetch_add(CHUNK))
+            for (size_t i = first; i < std::min(n, first + CHUNK); i++)
+                intersect(_origins[i], _directions[i], _hits[i]);
+    };
+    if (tasks < 2 || n <= CHUNK) {
+        work();
+        return;
+    }
+    TaskGroup group(pool);
+    for (size_t t = 0; t < tasks; t++)
+        group.run(work);
+    group.wait();
+}
+
+bool rez::BVH::isInside(const Point3d& _point) const
+{
+    if (nodes.empty())
+        return false;
+    // a direction no mesh built from axis aligned or diagonal parts lines up with
+    const Ray ray(_point, Vector3f(0.5773503f, 0.6172134f, 0.5345225f));
+    uint32_t crossings = 0;
+    uint32_t stack[MAX_DEPTH + 2];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BVHNode& node = nodes[stack[--top]];
+        if (enter(node, ray, INF) == INF)
+            continue;
+        if (node.count) {
+            for (uint32_t s = node.first; s < node.first + node.count; s++) {
+                float t = INF, u, v;
+                if (hitTriangle(&tri[9 * size_t(s)], ray, t, u, v))
+                    crossings++;
+            }
+            continue;
+        }
+        stack[top++] = node.first + 1;
+        stack[top++] = node.first;
+    }
+    return crossings % 2 == 1;
+}
+
+uint32_t rez::BVH::closestPoint(const Point3d& _point, Point3d& _closest) const
+{
+    if (nodes.empty())
+        return NONE;
+    const float p[3] = { _point.coords[0], _point.coords[1], _point.coords[2] };
+    float best = INF, candidate[3], closest[3] = { 0, 0, 0 };
+    uint32_t triangle = NONE;
+    Entry stack[MAX_DEPTH + 2];
+    int top = 0;
+    stack[top++] = { 0, distance2(nodes[0], p) };
+    while (top > 0) {
+        const Entry entry = stack[--top];
+        if (entry.distance >= best)
+            continue;
+        const BVHNode& node = nodes[entry.node];
+        if (node.count) {
+            for (uint32_t s = node.first; s < node.first + node.count; s++) {
+                closestOnTriangle(&tri[9 * size_t(s)], p, candidate);
+                const float d[3] = { candidate[0] - p[0], candidate[1] - p[1], candidate[2] - p[2] };
+                const float d2 = dot(d, d);
+                if (d2 < best) {
+                    best = d2;
+                    triangle = order[s];
+                    std::copy(candidate, candidate + 3, closest);
+                }
+            }
+            continue;
+        }
+        Entry near{ node.first, distance2(nodes[node.first], p) };
+        Entry far{ node.first + 1, distance2(nodes[node.first + 1], p) };
+        if (far.distance < near.distance)
+            std::swap(near, far);
+        if (far.distance < best)
+            stack[top++] = far;
+        if (near.distance < best)
+            stack[top++] = near;
+    }
+    _closest = Point3d(closest[0], closest[1], closest[2]);
+    return triangle;
+}
+
+void rez::BVH::overlapping(const AABB3d& _box, std::vector<uint32_t>& _triangles) const
+{
+    if (nodes.empty())
+        return;
+    float lo[3], hi[3], centre[3], half[3];
+    for (int a = 0; a < 3; a++) {
+        lo[a] = _box.min.coords[a];
+        hi[a] = _box.max.coords[a];
+        centre[a] = (lo[a] + hi[a]) / 2;
+        half[a] = (hi[a] - lo[a]) / 2;
+    }
+    uint32_t stack[MAX_DEPTH + 2];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BVHNode& node = nodes[stack[--top]];
+        if (node.lo[0] > hi[0] || node.hi[0] < lo[0] || node.lo[1] > hi[1] || node.hi[1] < lo[1]
+            || node.lo[2] > hi[2] || node.hi[2] < lo[2])
+            continue;
+        if (node.count) {
+            for (uint32_t s = node.first; s < node.first + node.count; s++)
+                if (triangleMeetsBox(&tri[9 * size_t(s)], centre, half))
+                    _triangles.push_back(order[s]);
+            continue;
+        }
+        stack[top++] = node.first + 1;
+        stack[top++] = node.first;
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef PHYSICSFORMULA_BVH_H
+#define PHYSICSFORMULA_BVH_H
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "Point.h"
+#include "Vector.h"
+#include "Polyhedron.h"
+
+namespace rez
+{
+    // axis aligned box in 3D, the query volume of BVH::overlapping
+    struct AABB3d {
+        Point3d min;
+        Point3d max;
+    };
+
+    // closest hit along a ray, triangle is BVH::NONE for a miss. The hit point is
+    // origin + t * direction, u and v are its barycentric coordinates towards the
+    // second and third vertex.
+    struct BVHHit {
+        float t = std::numeric_limits<float>::infinity();
+        float u = 0, v = 0;
+        uint32_t triangle = 0xFFFFFFFFu;
+    };
+
+    // node of the flattened tree, 32 bytes
+    struct BVHNode {
+        float lo[3];
+        uint32_t first;     // left child of an inner node, first triangle slot of a leaf
+        float hi[3];
+        uint32_t count;     // triangles in a leaf, 0 for an inner node
+    };
+
+    // Bounding volume hierarchy over a triangle mesh.
+    //
+    // Built top down with the surface area heuristic evaluated over binned
+    // centroids, large subtrees are built on the global thread pool. The tree is a
+    // flat array of 32 byte nodes with the two children of a node next to each
+    // other, the leaves refer to runs of triangles that are stored in leaf order
+    // as one vertex and two edges, ready for the ray test. Moving geometry keeps
+    // the tree and only refits the boxes.
+    class BVH {
+    public:
+        static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+    private:
+        std::vector<BVHNode> nodes;
+        std::vector<uint32_t> order;            // triangle of every leaf slot
+        std::vector<float> tri;                 // v0, v1 - v0, v2 - v0 per leaf slot
+        std::vector<float> vertices;            // x y z per vertex
+        std::vector<uint32_t> indices;          // three vertices per triangle
+        std::vector<const Point3d*> sources;    // face vertices read by refit(), empty for index meshes
+
+        void loadTriangles();
+        void refitNodes();
+
+    public:
+        BVH() {}
+
+        // _triangles holds three indices into _points per triangle
+        BVH(const std::vector<Point3d>& _points, const std::vector<uint32_t>& _triangles, unsigned _threads = 0);
+
+        // Faces with more than three vertices are split into fans. The vertices are
+        // read through their pointers, refit() picks up points that moved.
+        explicit BVH(std::vector<Face>& _faces, unsigned _threads = 0);
+
+        explicit BVH(Polyhedron& _polyhedron, unsigned _threads = 0);
+
+        /**
+         * @brief builds the tree from scratch
+         * @param _threads 1 builds on the calling thread, 0 uses the global pool
+         */
+        void build(const std::vector<Point3d>& _points, const std::vector<uint32_t>& _triangles, unsigned _threads = 0);
+
+        // Moves the vertices to _points, same count and order as given to build
+        void refit(const std::vector<Point3d>& _points);
+
+        // Rereads the face vertices of a tree built from faces
+        void refit();
+
+        size_t size() const { return indices.size() / 3; }
+
+        size_t nodeCount() const { return nodes.size(); }
+
+        // closest hit with 0 < t < _t_max, false on a miss
+        bool intersect(const Point3d& _origin, const Vector3f& _direction, BVHHit& _hit,
+                       float _t_max = std::numeric_limits<float>::infinity()) const;
+
+        // true if any triangle is hit with 0 < t < _t_max
+        bool occluded(const Point3d& _origin, const Vector3f& _direction,
+                      float _t_max = std::numeric_limits<float>::infinity()) const;
+
+        // closest hits of a batch of rays on the global thread pool
+        void intersect(const std::vector<Point3d>& _origins, const std::vector<Vector3f>& _directions,
+                       std::vector<BVHHit>& _hits, unsigned _threads = 0) const;
+
+        // Point containment by the parity of crossings along a ray, the mesh has to be closed
+        bool isInside(const Point3d& _point) const;
+
+        /**
+         * @brief the point of the mesh closest to _point
+         * @return the triangle it lies on, NONE for an empty tree
+         */
+        uint32_t closestPoint(const Point3d& _point, Point3d& _closest) const;
+
+        // every triangle meeting _box, exact triangle box tests
+        void overlapping(const AABB3d& _box, std::vector<uint32_t>& _triangles) const;
+    };
+}
+#endif //PHYSICSFORMULA_BVH_H
@@ -0,0 +1,661 @@
+#include "BinarySpacePartition.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include "ThreadPool.h"
+
+using namespace rez;
+
+namespace {
+    const uint32_t NONE = 0xFFFFFFFFu;
+    const size_t CANDIDATES = 16;           // split planes scored per node
+    const size_t SPLIT_WEIGHT = 8;          // cost of a cut fragment against one of imbalance
+    const size_t PARALLEL_SPLIT = 1024;     // smaller subtrees are not worth a task
+    const double EPS = 1e-9;                // relative to the extent of the input
+
+    enum class Side { ON, FRONT, BACK, SPANNING };
+
+    Side side(double _min, double _max, double _eps)
+    {
+        if (_min >= -_eps && _max <= _eps)
+            return Side::ON;
+        if (_min >= -_eps)
+            return Side::FRONT;
+        if (_max <= _eps)
+            return Side::BACK;
+        return Side::SPANNING;
+    }
+
+    // segments as x1 y1 x2 y2, the front of a segment's own line is on its left
+    struct Segments {
+        static constexpr size_t DIM = DIM2;
+
+        struct Set {
+            std::vector<double> c;
+            std::vector<uint32_t> src;
+        };
+
+        static size_t size(const Set& _set) { return _set.src.size(); }
+
+        static void push(Set& _set, const double* _a, const double* _b, uint32_t _src)
+        {
+            _set.c.insert(_set.c.end(), { _a[0], _a[1], _b[0], _b[1] });
+            _set.src.push_back(_src);
+        }
+
+        static void append(Set& _dst, const Set& _set, size_t _i)
+        {
+            push(_dst, &_set.c[4 * _i], &_set.c[4 * _i + 2], _set.src[_i]);
+        }
+
+        static void plane(const Set& _set, size_t _i, double* _normal, double& _offset)
+        {
+            const double* s = &_set.c[4 * _i];
+            const double nx = s[1] - s[3], ny = s[2] - s[0];
+            const double length = std::sqrt(nx * nx + ny * ny);
+            _normal[0] = length > 0 ? nx / length : 1;
+            _normal[1] = length > 0 ? ny / length : 0;
+            _offset = -(_normal[0] * s[0] + _normal[1] * s[1]);
+        }
+
+        static Side classify(const Set& _set, size_t _i, const double* _normal, double _offset, double _eps)
+        {
+            const double* s = &_set.c[4 * _i];
+            const double d1 = _normal[0] * s[0] + _normal[1] * s[1] + _offset;
+            const double d2 = _normal[0] * s[2] + _normal[1] * s[3] + _offset;
+            return side(std::min(d1, d2), std::max(d1, d2), _eps);
+        }
+
+        static void split(const Set& _set, size_t _i, const double* _normal, double _offset,
+                          Set& _front, Set& _back)
+        {
+            const double* s = &_set.c[4 * _i];
+            const double d1 = _normal[0] * s[0] + _normal[1] * s[1] + _offset;
+            const double d2 = _normal[0] * s[2] + _normal[1] * s[3] + _offset;
+            const double t = d1 / (d1 - d2);
+            const double m[2] = { s[0] + t * (s[2] - s[0]), s[1] + t * (s[3] - s[1]) };
+            push(d1 > 0 ? _front : _back, s, m, _set.src[_i]);
+            push(d1 > 0 ? _back : _front, m, s + 2, _set.src[_i]);
+        }
+    };
+
+    // convex planar polygons, vertex runs of c delimited by start
+    struct Polygons {
+        static constexpr size_t DIM = DIM3;
+
+        struct Set {
+            std::vector<double> c;
+            std::vector<uint32_t> start{ 0 };
+            std::vector<uint32_t> src;
+        };
+
+        static size_t size(const Set& _set) { return _set.src.size(); }
+
+        static void close(Set& _set, uint32_t _src)
+        {
+            _set.start.push_back(uint32_t(_set.c.size() / 3));
+            _set.src.push_back(_src);
+        }
+
+        static void append(Set& _dst, const Set& _set, size_t _i)
+        {
+            _dst.c.insert(_dst.c.end(), _set.c.begin() + 3 * size_t(_set.start[_i]),
+                          _set.c.begin() + 3 * size_t(_set.start[_i + 1]));
+            close(_dst, _set.src[_i]);
+        }
+
+        // Newell's normal, robust for slightly non planar input, its length is
+        // twice the area
+        static double newell(const Set& _set, size_t _i, double* _normal, double* _centre)
+        {
+            const double* v = &_set.c[3 * size_t(_set.start[_i])];
+            const size_t n = _set.start[_i + 1] - _set.start[_i];
+            std::fill(_normal, _normal + 3, 0.0);
+            std::fill(_centre, _centre + 3, 0.0);
+            for (size_t j = 0, k = n - 1; j < n; k = j++) {
+                const double* a = v + 3 * k;
+                const double* b = v + 3 * j;
+                _normal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+                _normal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+                _normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+                for (int c = 0; c < 3; c++)
+                    _centre[c] += b[c] / double(n);
+            }
+            return std::sqrt(_normal[0] * _normal[0] + _normal[1] * _normal[1] + _normal[2] * _normal[2]);
+        }
+
+        static void plane(const Set& _set, size_t _i, double* _normal, double& _offset)
+        {
+            double centre[3];
+            const double length = newell(_set, _i, _normal, centre);
+            for (int c = 0; c < 3; c++)
+                _normal[c] = length > 0 ? _normal[c] / length : c == 0;
+            _offset = -(_normal[0] * centre[0] + _normal[1] * centre[1] + _normal[2] * centre[2]);
+        }
+
+        static Side classify(const Set& _set, size_t _i, const double* _normal, double _offset, double _eps)
+        {
+            double lo = std::numeric_limits<double>::infinity(), hi = -lo;
+            for (uint32_t j = _set.start[_i]; j < _set.start[_i + 1]; j++) {
+                const double* p = &_set.c[3 * size_t(j)];
+                const double d = _normal[0] * p[0] + _normal[1] * p[1] + _normal[2] * p[2] + _offset;
+                lo = std::min(lo, d);
+                hi = std::max(hi, d);
+            }
+            return side(lo, hi, _eps);
+        }
+
+        // Sutherland-Hodgman against the plane, only called for spanning polygons
+        static void split(const Set& _set, size_t _i, const double* _normal, double _offset,
+                          Set& _front, Set& _back)
+        {
+            const uint32_t first = _set.start[_i], end = _set.start[_i + 1];
+            auto distance = [&](uint32_t _j) {
+                const double* p = &_set.c[3 * size_t(_j)];
+                return _normal[0] * p[0] + _normal[1] * p[1] + _normal[2] * p[2] + _offset;
+            };
+            uint32_t k = end - 1;
+            double dk = distance(k);
+            for (uint32_t j = first; j < end; k = j++) {
+                const double dj = distance(j);
+                const double* a = &_set.c[3 * size_t(k)];
+                const double* b = &_set.c[3 * size_t(j)];
+                if ((dk > 0 && dj < 0) || (dk < 0 && dj > 0)) {
+                    const double t = dk / (dk - dj);
+                    const double m[3] = { a[0] + t * (b[0] - a[0]), a[1] + t * (b[1] - a[1]), a[2] + t * (b[2] - a[2]) };
+                    _front.c.insert(_front.c.end(), m, m + 3);
+                    _back.c.insert(_back.c.end(), m, m + 3);
+                }
+                if (dj >= 0)
+                    _front.c.insert(_front.c.end(), b, b + 3);
+                if (dj <= 0)
+                    _back.c.insert(_back.c.end(), b, b + 3);
+                dk = dj;
+            }
+            close(_front, _set.src[_i]);
+            close(_back, _set.src[_i]);
+        }
+    };
+
+    // Builds the subtree of every work item into an output of its own, an item
+    // is taken from a stack so the depth of the tree never reaches the call stack.
+    template<class Geo>
+    struct Builder {
+        using Set = typename Geo::Set;
+        using Node = BSPNode<Geo::DIM>;
+
+        struct Output {
+            std::vector<Node> nodes;
+            Set on;                         // fragments in the plane of their node
+        };
+
+        struct Work {
+            uint32_t parent;
+            bool front;
+            uint32_t depth;
+            Set set;
+        };
+
+        double eps;
+
+        static void link(std::vector<Node>& _nodes, uint32_t _parent, bool _front, uint32_t _child)
+        {
+            if (_parent == NONE)
+                return;
+            if (_front)
+                _nodes[_parent].front = _child;
+            else
+                _nodes[_parent].back = _child;
+        }
+
+        // the cheapest plane of an evenly spread sample of the fragments
+        size_t choose(const Set& _set, double* _normal, double& _offset) const
+        {
+            const size_t n = Geo::size(_set);
+            const size_t candidates = std::min(n, CANDIDATES);
+            size_t best = 0, best_cost = std::numeric_limits<size_t>::max();
+            for (size_t k = 0; k < candidates; k++) {
+                const size_t c = k * n / candidates;
+                double normal[Geo::DIM], offset;
+                Geo::plane(_set, c, normal, offset);
+                size_t splits = 0, front = 0, back = 0;
+                for (size_t i = 0; i < n && SPLIT_WEIGHT * splits < best_cost; i++) {
+                    switch (Geo::classify(_set, i, normal, offset, eps)) {
+                        case Side::FRONT: front++; break;
+                        case Side::BACK: back++; break;
+                        case Side::SPANNING: splits++; break;
+                        default: break;
+                    }
+                }
+                const size_t cost = SPLIT_WEIGHT * splits + (front > back ? front - back : back - front);
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best = c;
+                    std::copy(normal, normal + Geo::DIM, _normal);
+                    _offset = offset;
+                }
+            }
+            return best;
+        }
+
+        // Items at _cut depth or below with enough fragments go to _deferred
+        // instead when that is given.
+        void run(Output& _out, std::vector<Work>& _stack, std::vector<Work>* _deferred, uint32_t _cut) const
+        {
+            while (!_stack.empty()) {
+                Work work = std::move(_stack.back());
+                _stack.pop_back();
+                const size_t n = Geo::size(work.set);
+                if (_deferred && work.depth >= _cut && n >= PARALLEL_SPLIT) {
+                    _deferred->push_back(std::move(work));
+                    continue;
+                }
+
+                const uint32_t index = uint32_t(_out.nodes.size());
+                link(_out.nodes, work.parent, work.front, index);
+                Node node{};
+                node.front = node.back = NONE;
+                node.first = uint32_t(Geo::size(_out.on));
+                if (n == 0) {
+                    _out.nodes.push_back(node);
+                    continue;
+                }
+
+                const size_t chosen = choose(work.set, node.normal, node.offset);
+                Work front{ index, true, work.depth + 1, {} }, back{ index, false, work.depth + 1, {} };
+                for (size_t i = 0; i < n; i++) {
+                    const Side s = i == chosen ? Side::ON : Geo::classify(work.set, i, node.normal, node.offset, eps);
+                    switch (s) {
+                        case Side::ON:
+                            Geo::append(_out.on, work.set, i);
+                            node.count++;
+                            break;
+                        case Side::FRONT:
+                            Geo::append(front.set, work.set, i);
+                            break;
+                        case Side::BACK:
+                            Geo::append(back.set, work.set, i);
+                            break;
+                        default:
+                            Geo::split(work.set, i, node.normal, node.offset, front.set, back.set);
+                            break;
+                    }
+                }
+                _out.nodes.push_back(node);
+                work.set = Set();
+                _stack.push_back(std::move(back));
+                _stack.push_back(std::move(front));
+            }
+        }
+
+        // Builds the top of the tree on the calling thread down to a depth with
+        // a few subtrees per task, then the large subtrees below it as tasks and
+        // appends their nodes and fragments.
+        void build(Set&& _input, unsigned _threads, std::vector<Node>& _nodes, Set& _on) const
+        {
+            Output out;
+            std::vector<Work> stack;
+            stack.push_back({ NONE, true, 0, std::move(_input) });
+
+            ThreadPool& pool = ThreadPool::global();
+            const unsigned tasks = _threads ? _threads : unsigned(pool.size());
+            if (tasks < 2 || Geo::size(stack.back().set) < 2 * PARALLEL_SPLIT) {
+                run(out, stack, nullptr, 0);
+            }
+            else {
+                uint32_t cut = 0;
+                while ((1u << cut) < 4 * tasks)
+                    cut++;
+                std::vector<Work> deferred;
+                run(out, stack, &deferred, cut);
+
+                std::vector<Output> parts(deferred.size());
+                std::vector<std::pair<uint32_t, bool>> parents(deferred.size());
+                {
+                    TaskGroup group(pool);
+                    for (size_t j = 0; j < deferred.size(); j++) {
+                        parents[j] = { deferred[j].parent, deferred[j].front };
+                        group.run([&, j]() {
+                            std::vector<Work> local;
+                            local.push_back({ NONE, true, 0, std::move(deferred[j].set) });
+                            run(parts[j], local, nullptr, 0);
+                        });
+                    }
+                    group.wait();
+                }
+
+                for (size_t j = 0; j < parts.size(); j++) {
+                    const uint32_t base = uint32_t(out.nodes.size());
+                    const uint32_t first = uint32_t(Geo::size(out.on));
+                    link(out.nodes, parents[j].first, parents[j].second, base);
+                    for (Node node : parts[j].nodes) {
+                        if (node.front != NONE) {
+                            node.front += base;
+                            node.back += base;
+                        }
+                        node.first += first;
+                        out.nodes.push_back(node);
+                    }
+                    for (size_t i = 0; i < Geo::size(parts[j].on); i++)
+                        Geo::append(out.on, parts[j].on, i);
+                    parts[j] = Output();
+                }
+            }
+            _nodes = std::move(out.nodes);
+            _on = std::move(out.on);
+        }
+    };
+
+    double scene_extent(const std::vector<double>& _coords)
+    {
+        double largest = 0;
+        for (double c : _coords)
+            largest = std::max(largest, std::fabs(c));
+        return largest > 0 ? largest : 1;
+    }
+
+    template<size_t _dim>
+    double distance(const BSPNode<_dim>& _node, const double* _point)
+    {
+        double d = _node.offset;
+        for (size_t a = 0; a < _dim; a++)
+            d += _node.normal[a] * _point[a];
+        return d;
+    }
+
+    template<size_t _dim>
+    uint32_t locate_leaf(const std::vector<BSPNode<_dim>>& _nodes, const double* _point)
+    {
+        if (_nodes.empty())
+            return NONE;
+        uint32_t node = 0;
+        while (_nodes[node].front != NONE)
+            node = distance(_nodes[node], _point) >= 0 ? _nodes[node].front : _nodes[node].back;
+        return node;
+    }
+
+    // near subtree, the fragments in the plane, then the far subtree
+    template<size_t _dim>
+    void front_to_back(const std::vector<BSPNode<_dim>>& _nodes, const double* _eye, std::vector<uint32_t>& _fragments)
+    {
+        _fragments.clear();
+        if (_nodes.empty())
+            return;
+        std::vector<std::pair<uint32_t, bool>> stack{ { 0, false } };
+        while (!stack.empty()) {
+            const auto [index, emit] = stack.back();
+            stack.pop_back();
+            const BSPNode<_dim>& node = _nodes[index];
+            if (emit) {
+                for (uint32_t i = 0; i < node.count; i++)
+                    _fragments.push_back(node.first + i);
+                continue;
+            }
+            if (node.front == NONE)
+                continue;
+            const bool front = distance(node, _eye) >= 0;
+            stack.push_back({ front ? node.back : node.front, false });
+            stack.push_back({ index, true });
+            stack.push_back({ front ? node.front : node.back, false });
+        }
+    }
+
+    // Walks the cells along the ray near to far, _hit(node, t) tests the fragments
+    // of a node the ray crosses at t and lowers _best on a hit. Cells starting
+    // beyond the best hit so far are skipped.
+    template<size_t _dim, class Hit>
+    void ray_walk(const std::vector<BSPNode<_dim>>& _nodes, const double* _origin, const double* _direction,
+                  double& _best, Hit _hit)
+    {
+        if (_nodes.empty())
+            return;
+        struct Item {
+            uint32_t node;
+            double t_min, t_max;
+        };
+        std::vector<Item> stack{ { 0, 0, std::numeric_limits<double>::infinity() } };
+        while (!stack.empty()) {
+            const Item item = stack.back();
+            stack.pop_back();
+            if (item.t_min > _best)
+                continue;
+            const BSPNode<_dim>& node = _nodes[item.node];
+            if (node.front == NONE)
+                continue;
+
+            const double d = distance(node, _origin);
+            double dn = 0;
+            for (size_t a = 0; a < _dim; a++)
+                dn += node.normal[a] * _direction[a];
+            const bool front = d > 0 || (d == 0 && dn > 0);
+            const uint32_t near = front ? node.front : node.back;
+            const uint32_t far = front ? node.back : node.front;
+            if (dn == 0) {
+                stack.push_back({ near, item.t_min, item.t_max });
+                continue;
+            }
+            const double t = -d / dn;
+            if (t <= 0 || t >= item.t_max) {
+                stack.push_back({ near, item.t_min, item.t_max });
+            }
+            else if (t < item.t_min) {
+                stack.push_back({ far, item.t_min, item.t_max });
+            }
+            else {
+                stack.push_back({ far, t, item.t_max });
+                if (node.count)
+                    _hit(item.node, t);
+                stack.push_back({ near, item.t_min, t });
+            }
+        }
+    }
+}
+
+rez::BSP2DSegments::BSP2DSegments(const std::vector<Segment2d>& _segment_list, unsigned _threads)
+{
+    build(_segment_list, _threads);
+}
+
+void rez::BSP2DSegments::build(const std::vector<Segment2d>& _segment_list, unsigned _threads)
+{
+    Segments::Set input;
+    input.c.reserve(4 * _segment_list.size());
+    input.src.reserve(_segment_list.size());
+    for (size_t i = 0; i < _segment_list.size(); i++) {
+        const Segment2d& s = _segment_list[i];
+        const double a[2] = { s.p1[X_], s.p1[Y_] }, b[2] = { s.p2[X_], s.p2[Y_] };
+        if (a[0] != b[0] || a[1] != b[1])
+            Segments::push(input, a, b, uint32_t(i));
+    }
+
+    Builder<Segments> builder{ EPS * scene_extent(input.c) };
+    Segments::Set on;
+    builder.build(std::move(input), _threads, nodes, on);
+    coords = std::move(on.c);
+    source = std::move(on.src);
+}
+
+Segment2d rez::BSP2DSegments::fragment(size_t _index) const
+{
+    Point2d p1(float(coords[4 * _index]), float(coords[4 * _index + 1]));
+    Point2d p2(float(coords[4 * _index + 2]), float(coords[4 * _index + 3]));
+    return Segment2d(p1, p2);
+}
+
+uint32_t rez::BSP2DSegments::locate(const Point2d& _point) const
+{
+    const double p[2] = { _point[X_], _point[Y_] };
+    return locate_leaf(nodes, p);
+}
+
+void rez::BSP2DSegments::frontToBack(const Point2d& _eye, std::vector<uint32_t>& _fragments) const
+{
+    const double eye[2] = { _eye[X_], _eye[Y_] };
+    front_to_back(nodes, eye, _fragments);
+}
+
+bool rez::BSP2DSegments::intersect(const Point2d& _origin, const Vector2f& _direction, float& _t,
+                                   uint32_t& _segment) const
+{
+    const double o[2] = { _origin[X_], _origin[Y_] };
+    const double d[2] = { _direction[X_], _direction[Y_] };
+    double best = std::numeric_limits<double>::infinity();
+    uint32_t hit = NONE;
+    ray_walk(nodes, o, d, best, [&](uint32_t _node, double _t_plane) {
+        if (_t_plane >= best)
+            return;
+        const double q[2] = { o[0] + _t_plane * d[0], o[1] + _t_plane * d[1] };
+        const BSPNode<DIM2>& node = nodes[_node];
+        for (uint32_t f = node.first; f < node.first + node.count; f++) {
+            const double* s = &coords[4 * size_t(f)];
+            const double ex = s[2] - s[0], ey = s[3] - s[1];
+            const double u = ((q[0] - s[0]) * ex + (q[1] - s[1]) * ey) / (ex * ex + ey * ey);
+            if (u >= -EPS && u <= 1 + EPS) {
+                best = _t_plane;
+                hit = source[f];
+                return;
+            }
+        }
+    });
+    if (hit == NONE)
+        return false;
+    _t = float(best);
+    _segment = hit;
+    return true;
+}
+
+void rez::BSP2DSegments::printNode(uint32_t _node, int _depth)
+{
+    const BSPNode<DIM2>& node = nodes[_node];
+    if (node.front == NONE)
+        return;
+
+    printNode(node.front, _depth + 1);
+
+    for (uint32_t f = node.first; f < node.first + node.count; f++) {
+        const double* s = &coords[4 * size_t(f)];
+        std::cout << std::string(_depth, ' ') << "< (" << s[0] << "," << s[1] << ") - ("
+                  << s[2] << "," << s[3] << ")\n";
+    }
+
+    printNode(node.back, _depth + 1);
+}
+
+void rez::BSP2DSegments::print()
+{
+    if (!nodes.empty())
+        printNode(0, 0);
+}
+
+rez::BSP3DPolygons::BSP3DPolygons(const std::vector<std::vector<Point3d>>& _polygons, unsigned _threads)
+{
+    build(_polygons, _threads);
+}
+
+rez::BSP3DPolygons::BSP3DPolygons(std::vector<Face>& _faces, unsigned _threads)
+{
+    std::vector<std::vector<Point3d>> polygons(_faces.size());
+    for (size_t i = 0; i < _faces.size(); i++)
+        for (Vertex3d* vertex : _faces[i].vertices)
+            polygons[i].push_back(*vertex->point);
+    build(polygons, _threads);
+}
+
+void rez::BSP3DPolygons::build(const std::vector<std::vector<Point3d>>& _polygons, unsigned _threads)
+{
+    Polygons::Set input;
+    for (size_t i = 0; i < _polygons.size(); i++) {
+        if (_polygons[i].size() < 3)
+            continue;
+        for (const Point3d& p : _polygons[i])
+            input.c.insert(input.c.end(), { p[X_], p[Y_], p[Z_] });
+        Polygons::close(input, uint32_t(i));
+
+        // drop polygons without area, they give no plane
+        double normal[3], centre[3];
+        if (!(Polygons::newell(input, input.src.size() - 1, normal, centre) > 0)) {
+            input.c.resize(3 * size_t(input.start[input.src.size() - 1]));
+            input.start.pop_back();
+            input.src.pop_back();
+        }
+    }
+
+    Builder<Polygons> builder{ EPS * scene_extent(input.c) };
+    Polygons::Set on;
+    builder.build(std::move(input), _threads, nodes, on);
+    coords = std::move(on.c);
+    start = std::move(on.start);
+    source = std::move(on.src);
+}
+
+std::vector<Point3d> rez::BSP3DPolygons::fragment(size_t _index) const
+{
+    std::vector<Point3d> polygon;
+    for (uint32_t j = start[_index]; j < start[_index + 1]; j++)
+        polygon.push_back(Point3d(float(coords[3 * size_t(j)]), float(coords[3 * size_t(j) + 1]),
+                                  float(coords[3 * size_t(j) + 2])));
+    return polygon;
+}
+
+uint32_t rez::BSP3DPolygons::locate(const Point3d& _point) const
+{
+    const double p[3] = { _point[X_], _point[Y_], _point[Z_] };
+    return locate_leaf(nodes, p);
+}
+
+void rez::BSP3DPolygons::frontToBack(const Point3d& _eye, std::vector<uint32_t>& _fragments) const
+{
+    const double eye[3] = { _eye[X_], _eye[Y_], _eye[Z_] };
+    front_to_back(nodes, eye, _fragments);
+}
+
+// _point lies in the plane of the fragment, test it against every edge with
+// either winding since the fragment may face away from its node
+bool rez::BSP3DPolygons::contains(uint32_t _fragment, const double* _normal, const double* _point) const
+{
+    const uint32_t first = start[_fragment], end = start[_fragment + 1];
+    bool positive = false, negative = false;
+    for (uint32_t j = first, k = end - 1; j < end; k = j++) {
+        const double* a = &coords[3 * size_t(k)];
+        const double* b = &coords[3 * size_t(j)];
+        const double e[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const double w[3] = { _point[0] - a[0], _point[1] - a[1], _point[2] - a[2] };
+        const double s = _normal[0] * (e[1] * w[2] - e[2] * w[1])
+                       + _normal[1] * (e[2] * w[0] - e[0] * w[2])
+                       + _normal[2] * (e[0] * w[1] - e[1] * w[0]);
+        const double tolerance = EPS * (e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+        positive |= s > tolerance;
+        negative |= s < -tolerance;
+        if (positive && negative)
+            return false;
+    }
+    return true;
+}
+
+bool rez::BSP3DPolygons::intersect(const Point3d& _origin, const Vector3f& _direction, float& _t,
+                                   uint32_t& _polygon) const
+{
+    const double o[3] = { _origin[X_], _origin[Y_], _origin[Z_] };
+    const double d[3] = { _direction[X_], _direction[Y_], _direction[Z_] };
+    double best = std::numeric_limits<double>::infinity();
+    uint32_t hit = NONE;
+    ray_walk(nodes, o, d, best, [&](uint32_t _node, double _t_plane) {
+        if (_t_plane >= best)
+            return;
+        const double q[3] = { o[0] + _t_plane * d[0], o[1] + _t_plane * d[1], o[2] + _t_plane * d[2] };
+        const BSPNode<DIM3>& node = nodes[_node];
+        for (uint32_t f = node.first; f < node.first + node.count; f++) {
+            if (contains(f, node.normal, q)) {
+                best = _t_plane;
+                hit = source[f];
+                return;
+            }
+        }
+    });
+    if (hit == NONE)
+        return false;
+    _t = float(best);
+    _polygon = hit;
+    return true;
+}
@@ -8,321 +8,116 @@
 
 #include "Core.h"
 #include "Vector.h"
-#include "Line.h"
 #include "Point.h"
-#include "GeoUtils.h"
-#include "Intersection.h"
+#include "Segment.h"
+#include "Polyhedron.h"
 
+#include <cstdint>
 #include <vector>
-#include <algorithm>
-#include <iostream>
 
 namespace rez {
-#define MIN_ELEMENTS_PER_PARTITION  4
-
-    enum class SEG_TYPES {
-        POSITIVE,
-        NEGATIVE,
-        INTERSECT
+    // Node of a BSP tree in _dim dimensions. An inner node splits space at the
+    // hyperplane normal . x + offset = 0, the front is where that is positive, and
+    // holds the pieces of input lying in the hyperplane. A leaf is one convex cell
+    // of the partition, its children are NONE.
+    template<size_t _dim>
+    struct BSPNode {
+        double normal[_dim];
+        double offset;
+        uint32_t front, back;
+        uint32_t first, count;      // run of fragments lying in the hyperplane
     };
 
-    //TODO : Remove this class asap
-    class BSP2D {
-        struct BSP2DNode {
-            BSP2DNode* neg = nullptr;
-            BSP2DNode* pos = nullptr;
-            rez::Line2dStd split_line;
-            std::vector<rez::Point2d> points_list;
+    // Auto partition of a 2D segment scene.
+    //
+    // Split lines are taken from the segments themselves. At every node a fixed,
+    // evenly spread sample of them is scored by the segments each would cut and
+    // by how uneven the two sides would be, so the same scene always gives the
+    // same tree. Nodes and the cut segments (fragments) live in two contiguous
+    // arrays, the top levels of the tree are built as tasks on the global pool.
+    class BSP2DSegments {
+    public:
+        static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+    private:
+        std::vector<BSPNode<DIM2>> nodes;
+        std::vector<double> coords;             // x1 y1 x2 y2 per fragment
+        std::vector<uint32_t> source;           // input segment of every fragment
 
-            BSP2DNode(std::vector<rez::Point2d> _points) : points_list(_points) {
-            }
+        void printNode(uint32_t _node, int _depth);
 
-            BSP2DNode(rez::Line2dStd _line,
-                      BSP2DNode* _neg = nullptr, BSP2DNode* _pos = nullptr)
-                    : split_line(_line), neg(_neg), pos(_pos) {
-            }
+    public:
+        BSP2DSegments() {}
 
-            BSP2DNode(std::vector<rez::Point2d> _points, rez::Line2dStd _line,
-                      BSP2DNode* _neg = nullptr, BSP2DNode* _pos = nullptr)
-                    : points_list(_points), split_line(_line), neg(_neg), pos(_pos)
-            {}
-        };
+        explicit BSP2DSegments(const std::vector<Segment2d>& _segment_list, unsigned _threads = 0);
 
-        BSP2DNode* root = nullptr;
+        /**
+         * @brief builds the tree from scratch
+         * @param _threads 1 builds on the calling thread, 0 uses the global pool
+         */
+        void build(const std::vector<Segment2d>& _segment_list, unsigned _threads = 0);
 
-        rez::Line2dStd getSplitLine(std::vector<rez::Point2d>& _points_list, rez::Line2dStd* _prev_line);
+        size_t nodeCount() const { return nodes.size(); }
 
-        bool isALeaf(BSP2DNode* _node);
+        size_t fragmentCount() const { return source.size(); }
 
-        BSP2DNode* constructBSP2D(std::vector<rez::Point2d>& _points_list, rez::Line2dStd* _prev_line);
+        Segment2d fragment(size_t _index) const;
 
-        void getSplitLineList(BSP2DNode* _node, std::vector<rez::Line2dStd>& _points_list);
+        // index of the input segment fragment _index was cut from
+        uint32_t sourceOf(size_t _index) const { return source[_index]; }
 
-    public:
-        BSP2D(std::vector<rez::Point2d>& _points_list) {
-            root = constructBSP2D(_points_list, nullptr);
-        }
+        // the leaf (cell) containing _point, points on a split line go to its front
+        uint32_t locate(const Point2d& _point) const;
 
-        void getSplitLines(std::vector<rez::Line2dStd>& _lines_list);
+        // fragments ordered front to back as seen from _eye, reverse it to paint
+        void frontToBack(const Point2d& _eye, std::vector<uint32_t>& _fragments) const;
+
+        /**
+         * @brief first segment hit by the ray _origin + t * _direction, t > 0
+         * @return false on a miss, else _t and the input segment that was hit
+         */
+        bool intersect(const Point2d& _origin, const Vector2f& _direction, float& _t, uint32_t& _segment) const;
+
+        void print();
     };
 
-#endif //PHYSICSFORMULA_BINARYSPACEPARTITION_H
+    // Auto partition of a set of convex planar polygons in 3D, built the same way
+    // as BSP2DSegments with split planes taken from the polygons.
+    class BSP3DPolygons {
+    public:
+        static constexpr uint32_t NONE = 0xFFFFFFFFu;
 
-    bool BSP2D::isALeaf(BSP2DNode* _node)
-    {
-        if (_node && (_node->neg || _node->pos))
-            return false;
-        return true;
-    }
-
-    rez::Line2dStd BSP2D::getSplitLine(std::vector<rez::Point2d>& _points_list, rez::Line2dStd* _prev_line)
-    {
-        const uint32_t size = _points_list.size();
-        std::sort(_points_list.begin(), _points_list.end());
-        rez::Point2d p1, p2;
-        rez::Line2dStd line;
-
-        if (!_prev_line) {
-            p1.assign(X_, (_points_list[0][X_] + _points_list[1][X_]) / 2);
-            p1.assign(Y_, (_points_list[0][Y_] + _points_list[1][Y_]) / 2);
-            p2.assign(X_, (_points_list[size - 1][X_] + _points_list[size - 2][X_]) / 2);
-            p2.assign(Y_, (_points_list[size - 1][Y_] + _points_list[size - 2][Y_]) / 2);
-            line = rez::Line2dStd(p1, p2, true);
-        }
-        else if (false) {
-
-            float nxy = 0.0, x_sum = 0.0, y_sum = 0.0, n_x_sqr_sum = 0.0;
-
-            for (const auto& point : _points_list)
-            {
-                nxy += point[X_] * point[Y_];
-                x_sum += point[X_];
-                y_sum += point[Y_];
-                n_x_sqr_sum += x_sum * x_sum;
-            }
-
-            nxy *= size;
-            n_x_sqr_sum *= size;
-
-            auto slope = (nxy - (x_sum) * (y_sum)) / (n_x_sqr_sum - x_sum * x_sum);
-            auto intercept = (size * y_sum - slope * x_sum) / size;
-
-            srand((unsigned)time(0));
-            auto s = rand() % 50;
-            s /= 25.0;
-            p2.assign(X_, -slope * s);
-            p2.assign(Y_, 1 + s);
-
-            line = rez::Line2dStd(p1, p2, false);
-        }
-        else {
-            float x_sum = 0.0, y_sum = 0.0;
-            for (const auto& point : _points_list)
-            {
-                x_sum += point[X_];
-                y_sum += point[Y_];
-            }
-            p1.assign(X_, x_sum / size);
-            p1.assign(Y_, y_sum / size);
-
-            p2.assign(X_, -_prev_line->getDir()[Y_] + 0.2);
-            p2.assign(Y_, _prev_line->getDir()[X_] + 0.2);
-
-            line = rez::Line2dStd(p1, p2, false);
-        }
-
-        Vector2f normal(-line.getDir()[Y_], line.getDir()[X_]);
-        auto d = dotProduct(normal, p2);
-        line.setD(d);
-        return line;
-    }
-
-    BSP2D::BSP2DNode* BSP2D::constructBSP2D(std::vector<rez::Point2d>& _points_list,
-                                            rez::Line2dStd* _prev_line)
-    {
-        const uint32_t size = _points_list.size();
-        if (size <= MIN_ELEMENTS_PER_PARTITION) {
-
-            return new BSP2DNode(_points_list);
-        }
-        rez::Line2dStd split_line = getSplitLine(_points_list, _prev_line);
-
-        std::vector<rez::Point2d> pos_vec;
-        std::vector<rez::Point2d> neg_vec;
-
-        std::copy_if(_points_list.begin(), _points_list.end(),
-                     std::back_inserter(neg_vec),
-                     [&](const rez::Point2d& point)
-                     {
-                         return rez::left(split_line, point);
-                     });
-
-        std::copy_if(_points_list.begin(), _points_list.end(),
-                     std::back_inserter(pos_vec),
-                     [&](const rez::Point2d& point)
-                     {
-                         return !rez::left(split_line, point);
-                     });
-
-        auto left = constructBSP2D(neg_vec, &split_line);
-        auto right = constructBSP2D(pos_vec, &split_line);
-
-        return new BSP2DNode(split_line, left, right);
-    }
-
-    void BSP2D::getSplitLineList(BSP2DNode* _node, std::vector<rez::Line2dStd>& _lines_list)
-    {
-        if (!isALeaf(_node)) {
-            _lines_list.push_back(_node->split_line);
-            getSplitLineList(_node->neg, _lines_list);
-            getSplitLineList(_node->pos, _lines_list);
-        }
-    }
-
-    void BSP2D::getSplitLines(std::vector<rez::Line2dStd>& _lines_list) {
-        getSplitLineList(root, _lines_list);
-    }
+    private:
+        std::vector<BSPNode<DIM3>> nodes;
+        std::vector<double> coords;             // x y z per fragment vertex
+        std::vector<uint32_t> start;            // first vertex of every fragment, one past the last at the end
+        std::vector<uint32_t> source;           // input polygon of every fragment
 
-    class BSP2DSegments {
-        struct BSP2DSegNode {
-            BSP2DSegNode* neg = nullptr;
-            BSP2DSegNode* pos = nullptr;
-            rez::Line2d split_line;
-            rez::Segment2d segment;
+        bool contains(uint32_t _fragment, const double* _normal, const double* _point) const;
 
-            BSP2DSegNode(rez::Segment2d _segment) : segment(_segment) {
-            }
+    public:
+        BSP3DPolygons() {}
 
-            BSP2DSegNode(rez::Line2d _line,
-                         BSP2DSegNode* _neg = nullptr, BSP2DSegNode* _pos = nullptr)
-                    : split_line(_line), neg(_neg), pos(_pos) {
-            }
+        explicit BSP3DPolygons(const std::vector<std::vector<Point3d>>& _polygons, unsigned _threads = 0);
 
-            BSP2DSegNode(rez::Segment2d _segment, rez::Line2d _line,
-                         BSP2DSegNode* _neg = nullptr, BSP2DSegNode* _pos = nullptr)
-                    : segment(_segment), split_line(_line), neg(_neg), pos(_pos)
-            {}
-        };
+        explicit BSP3DPolygons(std::vector<Face>& _faces, unsigned _threads = 0);
 
-        BSP2DSegNode* constructBSP2D(std::vector<rez::Segment2d>& _seg_list);
-        rez::Line2d getSplitLine(std::vector<rez::Segment2d>& _seg_list, int& _index);
-        SEG_TYPES classifySegmenetToLine(rez::Segment2d& _seg, rez::Line2d& _line, rez::Segment2d& _pos_seg,
-                                         rez::Segment2d& _neg_seg);
+        // _polygons must be convex and planar, see BSP2DSegments::build
+        void build(const std::vector<std::vector<Point3d>>& _polygons, unsigned _threads = 0);
 
-        BSP2DSegNode* root;
+        size_t nodeCount() const { return nodes.size(); }
 
-        void printNode(BSP2DSegNode*, int depth);
+        size_t fragmentCount() const { return source.size(); }
 
-    public:
-        BSP2DSegments(std::vector<rez::Segment2d>& _segment_list) {
-            root = constructBSP2D(_segment_list);
-        }
+        std::vector<Point3d> fragment(size_t _index) const;
 
-        void print();
-    };
+        uint32_t sourceOf(size_t _index) const { return source[_index]; }
 
-    BSP2DSegments::BSP2DSegNode* rez::BSP2DSegments::constructBSP2D(std::vector<rez::Segment2d>& _seg_list)
-    {
-        int size = _seg_list.size();
-        if (size > 1) {
-            int split_seg_index = -1;
-            std::vector<rez::Segment2d> pos_list, neg_list;
-            rez::Segment2d pos_seg, neg_seg;
-            rez::Line2d split_line = getSplitLine(_seg_list, split_seg_index);
-
-            for (size_t i = 0; i < size; i++) {
-                if (i != split_seg_index) {
-                    switch (classifySegmenetToLine(_seg_list[i], split_line, pos_seg, neg_seg))
-                    {
-                        case SEG_TYPES::INTERSECT:
-                            pos_list.push_back(pos_seg);
-                            neg_list.push_back(neg_seg);
-                            break;
-                        case SEG_TYPES::POSITIVE:
-                            pos_list.push_back(pos_seg);
-                            break;
-                        default:
-                            neg_list.push_back(pos_seg);
-                            break;
-                    }
-                }
-            }
-
-            BSP2DSegNode* left = constructBSP2D(pos_list);
-            BSP2DSegNode* right = constructBSP2D(neg_list);
-            return new BSP2DSegNode(_seg_list[split_seg_index], split_line, left, right);
-        }
-    }
-
-    inline rez::Line2d BSP2DSegments::getSplitLine(std::vector<rez::Segment2d>& _seg_list, int& _index)
-    {
-        int min_intersections = INT_MAX;
-        Line2d min_intersect_line;
-
-        for (size_t i = 0; i < _seg_list.size(); i++) {
-            auto seg = _seg_list[i];
-            Vector2f dir = seg.p2 - seg.p1;
-            Line2d line(seg.p1, dir);
-            int this_intersections = 0;
-
-            for (size_t j = 0; j < _seg_list.size(); j++) {
-                if (i != j)
-                    if (rez::intersect(line, _seg_list[j]))
-                        this_intersections++;
-            }
-
-            if (this_intersections < min_intersections) {
-                min_intersect_line = line;
-                _index = i;
-            }
-        }
-        return min_intersect_line;
-    }
-
-    inline SEG_TYPES BSP2DSegments::classifySegmenetToLine(rez::Segment2d& _seg, rez::Line2d& _line,
-                                                           rez::Segment2d& _pos_seg, rez::Segment2d& _neg_seg)
-    {
-        rez::Point2d intersect_point;
-        bool is_intersect = rez::intersect(_line, _seg, intersect_point);
-        if (is_intersect) {
-            if (left(_line, _seg.p1)) {
-                _pos_seg.p1 = _seg.p1;
-                _pos_seg.p2 = intersect_point;
-                _neg_seg.p1 = intersect_point;
-                _neg_seg.p2 = _seg.p2;
-            }
-            else {
-                _pos_seg.p1 = _seg.p2;
-                _pos_seg.p2 = intersect_point;
-                _neg_seg.p1 = intersect_point;
-                _neg_seg.p2 = _seg.p1;
-            }
-            return SEG_TYPES::INTERSECT;
-        }
-        else if (left(_line, _seg.p1)) {
-            return SEG_TYPES::POSITIVE;
-        }
-
-        return SEG_TYPES::NEGATIVE;
-    }
-
-    void BSP2DSegments::printNode(BSP2DSegNode* _node, int depth) {
-        if (!_node)
-            return;
-
-        printNode(_node->pos, depth + 1);
-
-        int space = 0;
-        while (space < depth)
-            std::cout << " ";
-        std::cout << "< (" << _node->segment.p1[X_] << "," << _node->segment.p1[Y_] << ") - ("
-                  << _node->segment.p2[X_] << "," << _node->segment.p2[Y_] << ")\n";
-
-        printNode(_node->neg, depth + 1);
-    }
-
-    void BSP2DSegments::print() {
-        printNode(root, 0);
-    }
-}
+        uint32_t locate(const Point3d& _point) const;
+
+        void frontToBack(const Point3d& _eye, std::vector<uint32_t>& _fragments) const;
 
+        bool intersect(const Point3d& _origin, const Vector3f& _direction, float& _t, uint32_t& _polygon) const;
+    };
+}
+#endif //PHYSICSFORMULA_BINARYSPACEPARTITION_H
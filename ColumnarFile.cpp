@@ -0,0 +1,269 @@
+#include "ColumnarFile.h"
+#include <cstring>
+#include <fstream>
+
+using namespace rez;
+using namespace rez::columnar_detail;
+
+namespace {
+    // longest literal or repeat run of one control byte
+    constexpr size_t RUN = 128;
+
+    // rows values of _width bytes starting at column _first of a row major block,
+    // one buffer per column of the group
+    template<typename Word>
+    void gatherColumns(const char* _data, uint64_t _rows, uint64_t _cols, uint64_t _first,
+                       std::vector<std::vector<char>>& _buffers)
+    {
+        const size_t group = _buffers.size();
+        for (uint64_t i = 0; i < _rows; i++) {
+            const char* row = _data + (i * _cols + _first) * sizeof(Word);
+            for (size_t k = 0; k < group; k++)
+                std::memcpy(_buffers[k].data() + i * sizeof(Word), row + k * sizeof(Word), sizeof(Word));
+        }
+    }
+
+    bool writePadding(std::ofstream& _out, uint64_t& _position)
+    {
+        static const char zeros[ALIGNMENT] = {};
+        const uint64_t padded = alignUp(_position);
+        _out.write(zeros, std::streamsize(padded - _position));
+        _position = padded;
+        return bool(_out);
+    }
+}
+
+// Values are first split into byte planes, byte 0 of every value, then byte 1
+// and so on, so the exponent and high mantissa bytes of similar numbers end up
+// next to each other. The planes are then packed with PackBits: a control byte
+// c < 128 is followed by c + 1 literal bytes, c >= 128 repeats the next byte
+// c - 125 times.
+std::vector<char> rez::columnar_detail::shuffleRleEncode(const char* _source, size_t _count, size_t _width)
+{
+    const size_t bytes = _count * _width;
+    std::vector<unsigned char> planes(bytes);
+    for (size_t i = 0; i < _count; i++)
+        for (size_t b = 0; b < _width; b++)
+            planes[b * _count + i] = static_cast<unsigned char>(_source[i * _width + b]);
+
+    std::vector<char> packed;
+    packed.reserve(bytes / 4 + 16);
+    size_t i = 0;
+    while (i < bytes) {
+        size_t repeat = 1;
+        while (i + repeat < bytes && repeat < RUN + 2 && planes[i + repeat] == planes[i])
+            repeat++;
+        if (repeat >= 3) {
+            packed.push_back(static_cast<char>(repeat + 125));
+            packed.push_back(static_cast<char>(planes[i]));
+            i += repeat;
+            continue;
+        }
+        // literals up to the next run of three
+        size_t literal = 0;
+        while (i + literal < bytes && literal < RUN) {
+            const size_t k = i + literal;
+            if (k + 2 < bytes && planes[k] == planes[k + 1] && planes[k] == planes[k + 2])
+                break;
+            literal++;
+        }
+        packed.push_back(static_cast<char>(literal - 1));
+        packed.insert(packed.end(), planes.begin() + i, planes.begin() + i + literal);
+        i += literal;
+        if (packed.size() >= bytes)
+            return {};
+    }
+    if (packed.size() >= bytes)
+        return {};
+    return packed;
+}
+
+bool rez::columnar_detail::shuffleRleDecode(const char* _source, size_t _bytes, char* _target, size_t _count,
+                                            size_t _width)
+{
+    const size_t bytes = _count * _width;
+    std::vector<char> planes(bytes);
+    size_t in = 0, out = 0;
+    while (in < _bytes) {
+        const auto control = static_cast<unsigned char>(_source[in++]);
+        if (control < 128) {
+            const size_t literal = size_t(control) + 1;
+            if (in + literal > _bytes || out + literal > bytes)
+                return false;
+            std::memcpy(planes.data() + out, _source + in, literal);
+            in += literal;
+            out += literal;
+        } else {
+            const size_t repeat = size_t(control) - 125;
+            if (in >= _bytes || out + repeat > bytes)
+                return false;
+            std::memset(planes.data() + out, _source[in++], repeat);
+            out += repeat;
+        }
+    }
+    if (out != bytes)
+        return false;
+    for (size_t i = 0; i < _count; i++)
+        for (size_t b = 0; b < _width; b++)
+            _target[i * _width + b] = planes[b * _count + i];
+    return true;
+}
+
+// Header, directory and names go first with the directory left blank, the
+// columns follow one by one and the directory is filled in once their stored
+// sizes are known. Columns are gathered a cache line of values at a time, so
+// the row major source is read once.
+bool rez::columnar_detail::writeColumns(const std::string& _path, ColumnType _type, const char* _data,
+                                        uint64_t _rows, uint64_t _cols, const std::vector<std::string>& _names,
+                                        ColumnCompression _compression)
+{
+    std::ofstream out(_path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    const size_t width = columnTypeSize(_type);
+
+    Header header {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = ENDIAN_MARK;
+    header.type = uint32_t(_type);
+    header.rows = _rows;
+    header.cols = _cols;
+    for (const auto& name : _names)
+        header.namesBytes += name.size();
+
+    std::vector<ColumnEntry> entries(_cols, ColumnEntry {});
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), std::streamsize(entries.size() * sizeof(ColumnEntry)));
+    for (const auto& name : _names)
+        out.write(name.data(), std::streamsize(name.size()));
+    uint64_t position = sizeof(Header) + _cols * sizeof(ColumnEntry) + header.namesBytes;
+
+    const uint64_t group = ALIGNMENT / width;
+    std::vector<std::vector<char>> buffers;
+    for (uint64_t first = 0; first < _cols; first += group) {
+        buffers.assign(size_t(std::min(group, _cols - first)), std::vector<char>(size_t(_rows * width)));
+        if (width == 4)
+            gatherColumns<uint32_t>(_data, _rows, _cols, first, buffers);
+        else
+            gatherColumns<uint64_t>(_data, _rows, _cols, first, buffers);
+
+        for (size_t k = 0; k < buffers.size(); k++) {
+            if (!writePadding(out, position))
+                return false;
+            ColumnEntry& entry = entries[first + k];
+            entry.offset = position;
+            entry.nameLength = _names.empty() ? 0 : uint32_t(_names[first + k].size());
+            std::vector<char> packed;
+            if (_compression == ColumnCompression::ShuffleRle)
+                packed = shuffleRleEncode(buffers[k].data(), size_t(_rows), width);
+            const std::vector<char>& stored = packed.empty() ? buffers[k] : packed;
+            entry.compression = uint32_t(packed.empty() ? ColumnCompression::None : _compression);
+            entry.bytes = stored.size();
+            out.write(stored.data(), std::streamsize(stored.size()));
+            position += stored.size();
+        }
+    }
+    // the file ends on an aligned boundary too, so the last column can be read
+    // a full cache line at a time
+    if (!writePadding(out, position))
+        return false;
+
+    out.seekp(std::streamoff(sizeof(Header)));
+    out.write(reinterpret_cast<const char*>(entries.data()), std::streamsize(entries.size() * sizeof(ColumnEntry)));
+    out.close();
+    return !out.fail();
+}
+
+bool rez::ColumnarFile::open(const std::string& _path)
+{
+    close();
+    if (!file.open(_path) || file.fileSize() < sizeof(Header) || !file.map(0, SIZE_MAX, false)) {
+        close();
+        return false;
+    }
+    const char* base = file.data();
+    const uint64_t length = file.size();
+
+    Header header;
+    std::memcpy(&header, base, sizeof(header));
+    const bool known = header.type >= uint32_t(ColumnType::Int32) && header.type <= uint32_t(ColumnType::Float64);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+        || header.byteOrder != ENDIAN_MARK || !known || header.rows > uint64_t(INT32_MAX)
+        || header.cols > uint64_t(INT32_MAX)
+        || header.cols > (length - sizeof(Header)) / sizeof(ColumnEntry)
+        || header.namesBytes > length - sizeof(Header) - header.cols * sizeof(ColumnEntry)) {
+        close();
+        return false;
+    }
+    elementType = ColumnType(header.type);
+    const uint64_t plain = header.rows * columnTypeSize(elementType);
+
+    entries.resize(size_t(header.cols));
+    if (!entries.empty())
+        std::memcpy(entries.data(), base + sizeof(Header), entries.size() * sizeof(ColumnEntry));
+    const char* name = base + sizeof(Header) + entries.size() * sizeof(ColumnEntry);
+    uint64_t nameBytes = 0;
+    for (const auto& entry : entries) {
+        nameBytes += entry.nameLength;
+        const bool stored = entry.compression == uint32_t(ColumnCompression::None)
+                            ? entry.bytes == plain && entry.offset % ALIGNMENT == 0
+                            : entry.compression == uint32_t(ColumnCompression::ShuffleRle);
+        if (!stored || entry.offset > length || entry.bytes > length - entry.offset || nameBytes > header.namesBytes) {
+            close();
+            return false;
+        }
+    }
+    if (nameBytes != 0 && nameBytes != header.namesBytes) {
+        close();
+        return false;
+    }
+
+    rowCount = int(header.rows);
+    colCount = int(header.cols);
+    columns.resize(entries.size());
+    for (size_t j = 0; j < entries.size(); j++) {
+        const ColumnEntry& entry = entries[j];
+        if (nameBytes) {
+            names.emplace_back(name, entry.nameLength);
+            name += entry.nameLength;
+        }
+        if (entry.compression == uint32_t(ColumnCompression::None)) {
+            columns[j] = base + entry.offset;
+            continue;
+        }
+        decoded.emplace_back(size_t(plain));
+        if (!shuffleRleDecode(base + entry.offset, size_t(entry.bytes), decoded.back().data(), size_t(header.rows),
+                              columnTypeSize(elementType))) {
+            close();
+            return false;
+        }
+        columns[j] = decoded.back().data();
+    }
+    return true;
+}
+
+void rez::ColumnarFile::close()
+{
+    file.close();
+    elementType = ColumnType::Float64;
+    rowCount = 0;
+    colCount = 0;
+    names.clear();
+    entries.clear();
+    columns.clear();
+    decoded.clear();
+}
+
+int rez::ColumnarFile::columnIndex(const std::string& _name) const
+{
+    for (size_t j = 0; j < names.size(); j++)
+        if (names[j] == _name)
+            return int(j);
+    return -1;
+}
+
+ColumnCompression rez::ColumnarFile::compression(int _col) const
+{
+    return ColumnCompression(entries[_col].compression);
+}
@@ -0,0 +1,285 @@
+#ifndef PHYSICSFORMULA_COLUMNARFILE_H
+#define PHYSICSFORMULA_COLUMNARFILE_H
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "MappedFile.h"
+#include "MatrixND.h"
+
+namespace rez
+{
+    // element type of the columns, one per file
+    enum class ColumnType : uint32_t {
+        Int32 = 1,
+        Int64 = 2,
+        Float32 = 3,
+        Float64 = 4
+    };
+
+    // None keeps a column in place in the file. ShuffleRle groups the bytes of
+    // the values by significance and run length encodes them, which pays off on
+    // constant, repeated or low precision columns. A column that does not get
+    // smaller is stored uncompressed.
+    enum class ColumnCompression : uint32_t {
+        None = 0,
+        ShuffleRle = 1
+    };
+
+    template<typename T>
+    constexpr ColumnType columnTypeOf()
+    {
+        static_assert(std::is_arithmetic_v<T> && (sizeof(T) == 4 || sizeof(T) == 8),
+                      "columns hold 32 or 64 bit integers or floats");
+        if constexpr (std::is_floating_point_v<T>)
+            return sizeof(T) == 4 ? ColumnType::Float32 : ColumnType::Float64;
+        else
+            return sizeof(T) == 4 ? ColumnType::Int32 : ColumnType::Int64;
+    }
+
+    inline size_t columnTypeSize(ColumnType _type)
+    {
+        return _type == ColumnType::Int32 || _type == ColumnType::Float32 ? 4 : 8;
+    }
+
+    namespace columnar_detail {
+        constexpr char MAGIC[8] = { 'R', 'E', 'Z', 'C', 'O', 'L', 0, 0 };
+        constexpr uint32_t VERSION = 1;
+        constexpr uint32_t ENDIAN_MARK = 0x01020304u;
+        constexpr uint64_t ALIGNMENT = 64;
+
+        // first 64 bytes of the file, followed by one ColumnEntry per column,
+        // the column names back to back and the columns, each on a 64 byte
+        // boundary. All fields are stored in the byte order of the writer.
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t byteOrder;
+            uint32_t type;
+            uint32_t reserved;
+            uint64_t rows;
+            uint64_t cols;
+            uint64_t namesBytes;
+            uint64_t padding[2];
+        };
+        static_assert(sizeof(Header) == 64);
+
+        struct ColumnEntry {
+            uint64_t offset;        // from the start of the file
+            uint64_t bytes;         // stored, compressed or not
+            uint32_t compression;
+            uint32_t nameLength;
+        };
+        static_assert(sizeof(ColumnEntry) == 24);
+
+        inline uint64_t alignUp(uint64_t _value)
+        {
+            return (_value + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        }
+
+        // _count values of _width bytes, empty when the encoding is not smaller
+        std::vector<char> shuffleRleEncode(const char* _source, size_t _count, size_t _width);
+
+        // false when _source does not decode to exactly _count values
+        bool shuffleRleDecode(const char* _source, size_t _bytes, char* _target, size_t _count, size_t _width);
+
+        bool writeColumns(const std::string& _path, ColumnType _type, const char* _data, uint64_t _rows,
+                          uint64_t _cols, const std::vector<std::string>& _names, ColumnCompression _compression);
+    }
+
+    // one column of a ColumnarFile, rows contiguous values
+    template<typename T>
+    struct ColumnSpan {
+        const T* values = nullptr;
+        size_t length = 0;
+
+        const T& operator[](size_t _i) const { return values[_i]; }
+
+        const T* begin() const { return values; }
+
+        const T* end() const { return values + length; }
+
+        size_t size() const { return length; }
+
+        bool empty() const { return length == 0; }
+    };
+
+    // Zero copy rows x cols view of a ColumnarFile, column major. Stays valid
+    // as long as the file it came from stays open.
+    template<typename T>
+    class ColumnarView {
+        std::vector<const T*> columns;
+        int rowCount = 0;
+
+    public:
+        ColumnarView() {}
+
+        ColumnarView(std::vector<const T*> _columns, int _rows) : columns(std::move(_columns)), rowCount(_rows) {}
+
+        const T& operator()(int _row, int _col) const { return columns[_col][_row]; }
+
+        ColumnSpan<T> col(int _col) const { return { columns[_col], size_t(rowCount) }; }
+
+        int rows() const { return rowCount; }
+
+        int cols() const { return static_cast<int>(columns.size()); }
+
+        bool empty() const { return columns.empty(); }
+    };
+
+    // Reader of the binary columnar format written by writeColumnar.
+    //
+    // Opening maps the file and only reads the header and the column
+    // directory, uncompressed columns are used in place and their pages are
+    // read on first touch, so opening costs the same for any file size.
+    // Compressed columns are expanded into memory when the file is opened.
+    class ColumnarFile {
+        MappedFile file;
+        ColumnType elementType = ColumnType::Float64;
+        int rowCount = 0;
+        int colCount = 0;
+        std::vector<std::string> names;
+        std::vector<columnar_detail::ColumnEntry> entries;
+        std::vector<const char*> columns;           // start of every column, in the file or in decoded
+        std::vector<std::vector<char>> decoded;     // expanded compressed columns
+
+    public:
+        ColumnarFile() {}
+
+        explicit ColumnarFile(const std::string& _path) { open(_path); }
+
+        // false if the file is missing, truncated or not in the format
+        bool open(const std::string& _path);
+
+        void close();
+
+        bool isOpen() const { return file.isOpen(); }
+
+        int rows() const { return rowCount; }
+
+        int cols() const { return colCount; }
+
+        ColumnType type() const { return elementType; }
+
+        const std::vector<std::string>& columnNames() const { return names; }
+
+        // index of the column called _name, -1 if there is none
+        int columnIndex(const std::string& _name) const;
+
+        ColumnCompression compression(int _col) const;
+
+        // raw values of column _col, columnTypeSize(type()) bytes each
+        const void* columnData(int _col) const { return columns[_col]; }
+
+        // column _col without a copy, empty when T is not the stored type
+        template<typename T>
+        ColumnSpan<T> column(int _col) const;
+
+        // all columns without a copy, empty when T is not the stored type
+        template<typename T>
+        ColumnarView<T> view() const;
+
+        // copy into a row major MatrixND, converting from the stored type
+        template<typename T>
+        MatrixND<T> toMatrix() const;
+    };
+
+    /**
+     * @brief writes a row major rows x cols block as a columnar file
+     * @param _names one per column or empty
+     * @return false if the file cannot be written
+     */
+    template<typename T>
+    bool writeColumnar(const std::string& _path, const T* _data, int _rows, int _cols,
+                       const std::vector<std::string>& _names = {},
+                       ColumnCompression _compression = ColumnCompression::None)
+    {
+        if (_rows < 0 || _cols < 0 || (!_names.empty() && int(_names.size()) != _cols))
+            return false;
+        return columnar_detail::writeColumns(_path, columnTypeOf<T>(), reinterpret_cast<const char*>(_data),
+                                             uint64_t(_rows), uint64_t(_cols), _names, _compression);
+    }
+
+    template<typename T>
+    bool writeColumnar(const std::string& _path, const MatrixND<T>& _data,
+                       const std::vector<std::string>& _names = {},
+                       ColumnCompression _compression = ColumnCompression::None)
+    {
+        return writeColumnar(_path, _data.data.data(), _data.rows, _data.cols, _names, _compression);
+    }
+
+    // a single column
+    template<typename T>
+    bool writeColumnar(const std::string& _path, const std::vector<T>& _data, const std::string& _name = "",
+                       ColumnCompression _compression = ColumnCompression::None)
+    {
+        std::vector<std::string> columnName;
+        if (!_name.empty())
+            columnName.push_back(_name);
+        return writeColumnar(_path, _data.data(), static_cast<int>(_data.size()), 1, columnName, _compression);
+    }
+
+//*****************************************************************************
+// ColumnarFile templates
+//*****************************************************************************
+    template<typename T>
+    ColumnSpan<T> ColumnarFile::column(int _col) const
+    {
+        if (columnTypeOf<T>() != elementType || _col < 0 || _col >= colCount)
+            return {};
+        return { reinterpret_cast<const T*>(columns[_col]), size_t(rowCount) };
+    }
+
+    template<typename T>
+    ColumnarView<T> ColumnarFile::view() const
+    {
+        if (columnTypeOf<T>() != elementType || !isOpen())
+            return {};
+        std::vector<const T*> starts(colCount);
+        for (int j = 0; j < colCount; j++)
+            starts[j] = reinterpret_cast<const T*>(columns[j]);
+        return ColumnarView<T>(std::move(starts), rowCount);
+    }
+
+    namespace columnar_detail {
+        // transposes blocks of rows so every column is read sequentially
+        template<typename S, typename T>
+        void gatherRows(const std::vector<const char*>& _columns, int _rows, MatrixND<T>& _out)
+        {
+            constexpr int BLOCK = 256;
+            const int cols = static_cast<int>(_columns.size());
+            for (int first = 0; first < _rows; first += BLOCK) {
+                const int last = std::min(_rows, first + BLOCK);
+                for (int j = 0; j < cols; j++) {
+                    const S* source = reinterpret_cast<const S*>(_columns[j]);
+                    T* target = _out.data.data() + size_t(first) * cols + j;
+                    for (int i = first; i < last; i++, target += cols)
+                        *target = static_cast<T>(source[i]);
+                }
+            }
+        }
+    }
+
+    template<typename T>
+    MatrixND<T> ColumnarFile::toMatrix() const
+    {
+        MatrixND<T> out(rowCount, colCount);
+        switch (elementType) {
+        case ColumnType::Int32:
+            columnar_detail::gatherRows<int32_t>(columns, rowCount, out);
+            break;
+        case ColumnType::Int64:
+            columnar_detail::gatherRows<int64_t>(columns, rowCount, out);
+            break;
+        case ColumnType::Float32:
+            columnar_detail::gatherRows<float>(columns, rowCount, out);
+            break;
+        case ColumnType::Float64:
+            columnar_detail::gatherRows<double>(columns, rowCount, out);
+            break;
+        }
+        return out;
+    }
+}
+#endif //PHYSICSFORMULA_COLUMNARFILE_H
@@ -163,9 +163,9 @@ namespace constants {
 
 
     constexpr auto G = 6.67408e-11;
-    long double _g = 9.80665; // acceleration due to gravity at sea level
-    long double Ga = 9.81;
-    void set_Ga(long double g) { Ga = g; }
+    inline long double _g = 9.80665; // acceleration due to gravity at sea level
+    inline long double Ga = 9.81;
+    inline void set_Ga(long double g) { Ga = g; }
 }
 
 /// <summary>
@@ -4,11 +4,18 @@
 
 #include "Convexhull.h"
 #include "GeoUtils.h"
+#include "Kernel.h"
 #include "Distance.h"
 #include "Inclusion.h"
+#include "ThreadPool.h"
 
 #include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
 #include <list>
+#include <memory>
+#include <unordered_map>
 
 using namespace rez;
 
@@ -74,6 +81,7 @@ void rez::convexhull2DGiftwrapping(std::vector<Point2d>& _points, std::vector<Po
 
 
 
+template<class Kernel>
 void rez::convexhull2DModifiedGrahams(std::vector<Point2d>& _points,
                                       std::vector<Point2d>& _convex)
 {
@@ -95,7 +103,7 @@ void rez::convexhull2DModifiedGrahams(std::vector<Point2d>& _points,
     {
         index = l_upper.size();
         const auto& next_point = _points[i];
-        while (l_upper.size() > 1 && left(l_upper[index - 2], l_upper[index - 1], next_point))
+        while (l_upper.size() > 1 && Kernel::orientation2d(l_upper[index - 2], l_upper[index - 1], next_point) > 0)
         {
             l_upper.pop_back();
             index = l_upper.size();
@@ -116,7 +124,7 @@ void rez::convexhull2DModifiedGrahams(std::vector<Point2d>& _points,
         index = l_lower.size();
         const auto& next_point = _points[i];
 
-        while (l_lower.size() > 1 && left(l_lower[index - 2], l_lower[index - 1], next_point))
+        while (l_lower.size() > 1 && Kernel::orientation2d(l_lower[index - 2], l_lower[index - 1], next_point) > 0)
         {
             l_lower.pop_back();
             index = l_lower.size();
@@ -133,6 +141,9 @@ void rez::convexhull2DModifiedGrahams(std::vector<Point2d>& _points,
     _convex.insert(_convex.end(), l_lower.begin(), l_lower.end());
 }
 
+template void rez::convexhull2DModifiedGrahams<FilteredKernel>(std::vector<Point2d>&, std::vector<Point2d>&);
+template void rez::convexhull2DModifiedGrahams<InexactKernel>(std::vector<Point2d>&, std::vector<Point2d>&);
+
 void rez::convexhull2DIncremental(std::vector<Point3d>& _points, std::vector<Point3d>& _convex)
 {
     //Sort the points left to right order
@@ -207,6 +218,46 @@ void rez::convexhull2DIncremental(std::vector<Point3d>& _points, std::vector<Poi
     }
 }
 
+// Hull of the vertices of two hulls. Both are small, so their vertices are
+// sorted again and swept with the monotone chain, lower chain left to right
+// then upper chain back, keeping strict left turns only.
+static void mergeHulls(Polygon& _left, Polygon& _right, Polygon& _results)
+{
+    std::vector<Point3d> points = _left.getPoints();
+    std::vector<Point3d> right_points = _right.getPoints();
+    points.insert(points.end(), right_points.begin(), right_points.end());
+    std::sort(points.begin(), points.end(), [](const Point3d& a, const Point3d& b) {
+        return a[X_] < b[X_] || (a[X_] == b[X_] && a[Y_] < b[Y_]);
+    });
+    if (points.size() < 2)
+    {
+        _results = Polygon(points);
+        return;
+    }
+
+    std::vector<Point3d> hull;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        const size_t chain_start = hull.size();
+        for (size_t k = 0; k < points.size(); k++)
+        {
+            const Point3d& point = pass == 0 ? points[k] : points[points.size() - 1 - k];
+            while (hull.size() >= chain_start + 2)
+            {
+                const Point3d& a = hull[hull.size() - 2];
+                const Point3d& b = hull.back();
+                if (orientation2dExact(a[X_], a[Y_], b[X_], b[Y_], point[X_], point[Y_]) > 0)
+                    break;
+                hull.pop_back();
+            }
+            hull.push_back(point);
+        }
+        // the last point of a chain starts the other one
+        hull.pop_back();
+    }
+    _results = Polygon(hull);
+}
+
 template<typename Iterator>
 void getHull(Iterator first, Iterator last, Polygon& _results)
 {
@@ -226,7 +277,7 @@ void getHull(Iterator first, Iterator last, Polygon& _results)
         getHull(first, mid_point, left_poly);
         getHull(mid_point, last, right_poly);
 
-        merge(left_poly, right_poly, _results);
+        mergeHulls(left_poly, right_poly, _results);
     }
 }
 
@@ -604,6 +655,620 @@ void rez::convexhull3D(std::vector<Point3d>& _points, std::vector<Face*>& faces)
     }
 }
 
-void rez::convexhull3DQuickhull(std::vector<Point3d>& _points, Polygon& _results)
+// Run _work(begin, end) over [0, _count) in chunks on the shared pool
+template<typename Work>
+static void parallelChunks(size_t _count, size_t _min_chunk, Work _work)
+{
+    ThreadPool& pool = ThreadPool::global();
+    const size_t chunks = std::max<size_t>(1, std::min<size_t>(4 * pool.size(), _count / _min_chunk));
+    if (chunks == 1) {
+        _work(size_t(0), _count, size_t(0));
+        return;
+    }
+    const size_t step = (_count + chunks - 1) / chunks;
+    TaskGroup group(pool);
+    for (size_t c = 0; c < chunks; c++) {
+        const size_t first = c * step;
+        const size_t last = std::min(_count, first + step);
+        if (first < last)
+            group.run([=, &_work] { _work(first, last, c); });
+    }
+    group.wait();
+}
+
+//*****************************************************************************
+// Parallel 2D quickhull
+//*****************************************************************************
+
+// Hull points strictly left of the directed edge [a b], kept as a tree so the
+// tasks never have to synchronize, the in order walk gives the chain from a to b.
+struct HullChain2D {
+    long apex = -1;
+    std::unique_ptr<HullChain2D> left, right;
+};
+
+static const size_t QUICKHULL_TASK_CUTOFF = 1 << 14;
+
+// fewer points than this are assigned to the new 3D faces on the calling thread
+static const size_t QUICKHULL3D_PARALLEL_MIN = 1 << 15;
+
+static Point2d soaPoint(const Points2dSoA& _soa, size_t _i)
+{
+    return Point2d(static_cast<float>(_soa.x[_i]), static_cast<float>(_soa.y[_i]));
+}
+
+static void quickhullChain(const Points2dSoA& _soa, size_t _a, size_t _b, long _farthest,
+                           std::vector<uint32_t> _candidates, HullChain2D& _chain, TaskGroup& _group)
+{
+    if (_farthest < 0)
+        return;
+    _chain.apex = _farthest;
+    const Point2d a = soaPoint(_soa, _a), b = soaPoint(_soa, _b), f = soaPoint(_soa, _farthest);
+
+    std::vector<uint32_t> s1, s2;
+    const long f1 = leftOfBatch(a, f, _soa, _candidates, s1);
+    const long f2 = leftOfBatch(f, b, _soa, _candidates, s2);
+    _candidates = std::vector<uint32_t>();
+
+    _chain.left = std::make_unique<HullChain2D>();
+    _chain.right = std::make_unique<HullChain2D>();
+    HullChain2D& left_chain = *_chain.left;
+    HullChain2D& right_chain = *_chain.right;
+    const size_t apex = static_cast<size_t>(_farthest);
+
+    if (s1.size() > QUICKHULL_TASK_CUTOFF)
+        _group.run([&_soa, &_group, &left_chain, _a, apex, f1, s1 = std::move(s1)]() mutable {
+            quickhullChain(_soa, _a, apex, f1, std::move(s1), left_chain, _group);
+        });
+    else
+        quickhullChain(_soa, _a, apex, f1, std::move(s1), left_chain, _group);
+    quickhullChain(_soa, apex, _b, f2, std::move(s2), right_chain, _group);
+}
+
+static void collectChain(const HullChain2D& _root, std::vector<size_t>& _indices)
+{
+    std::vector<const HullChain2D*> stack;
+    const HullChain2D* node = &_root;
+    while (node || !stack.empty()) {
+        while (node && node->apex >= 0) {
+            stack.push_back(node);
+            node = node->left.get();
+        }
+        if (stack.empty())
+            break;
+        node = stack.back();
+        stack.pop_back();
+        _indices.push_back(static_cast<size_t>(node->apex));
+        node = node->right.get();
+    }
+}
+
+void rez::convexhull2DQuickhullParallel(const std::vector<Point2d>& _points, std::vector<Point2d>& _convex)
+{
+    _convex.clear();
+    const size_t n = _points.size();
+    if (n == 0)
+        return;
+
+    Points2dSoA soa;
+    soa.x.resize(n);
+    soa.y.resize(n);
+    ThreadPool& pool = ThreadPool::global();
+    std::vector<std::pair<size_t, size_t>> extremes(4 * pool.size() + 1, { 0, 0 });
+
+    // Step 1 : SoA copy and the lexicographic leftmost / rightmost points
+    auto lexLess = [&](size_t i, size_t j) {
+        return soa.x[i] < soa.x[j] || (soa.x[i] == soa.x[j] && soa.y[i] < soa.y[j]);
+    };
+    parallelChunks(n, 1 << 16, [&](size_t first, size_t last, size_t c) {
+        for (size_t i = first; i < last; i++) {
+            soa.x[i] = _points[i][X_];
+            soa.y[i] = _points[i][Y_];
+        }
+        size_t lo = first, hi = first;
+        for (size_t i = first + 1; i < last; i++) {
+            if (lexLess(i, lo)) lo = i;
+            if (lexLess(hi, i)) hi = i;
+        }
+        extremes[c] = { lo, hi };
+    });
+    size_t a = extremes[0].first, b = extremes[0].second;
+    for (auto& e : extremes) {
+        if (lexLess(e.first, a)) a = e.first;
+        if (lexLess(b, e.second)) b = e.second;
+    }
+    _convex.push_back(_points[a]);
+    if (soa.x[a] == soa.x[b] && soa.y[a] == soa.y[b])
+        return;
+
+    // Step 2 : split into the points above and below [a b] with the batched predicate
+    std::vector<int8_t> signs(n);
+    orientation2dBatch(_points[a], _points[b], soa, signs.data(), pool.size());
+    std::vector<std::vector<uint32_t>> upper_parts(extremes.size()), lower_parts(extremes.size());
+    parallelChunks(n, 1 << 16, [&](size_t first, size_t last, size_t c) {
+        for (size_t i = first; i < last; i++) {
+            if (signs[i] > 0)
+                upper_parts[c].push_back(static_cast<uint32_t>(i));
+            else if (signs[i] < 0)
+                lower_parts[c].push_back(static_cast<uint32_t>(i));
+        }
+    });
+    signs = std::vector<int8_t>();
+    auto concat = [](std::vector<std::vector<uint32_t>>& _parts) {
+        std::vector<uint32_t> all;
+        size_t total = 0;
+        for (auto& p : _parts) total += p.size();
+        all.reserve(total);
+        for (auto& p : _parts) {
+            all.insert(all.end(), p.begin(), p.end());
+            p = std::vector<uint32_t>();
+        }
+        return all;
+    };
+    std::vector<uint32_t> upper = concat(upper_parts), lower = concat(lower_parts);
+
+    // ties go to the point farthest along [from to], as in leftOfBatch
+    auto farthestOf = [&](size_t _from, size_t _to, const std::vector<uint32_t>& _set) {
+        const double abx = soa.x[_to] - soa.x[_from], aby = soa.y[_to] - soa.y[_from];
+        long best = -1;
+        double best_area = 0.0, best_along = 0.0;
+        for (uint32_t i : _set) {
+            const double dx = soa.x[i] - soa.x[_from], dy = soa.y[i] - soa.y[_from];
+            const double area = abx * dy - dx * aby;
+            const double along = abx * dx + aby * dy;
+            if (best < 0 || area > best_area || (area == best_area && along > best_along)) {
+                best = i;
+                best_area = area;
+                best_along = along;
+            }
+        }
+        return best;
+    };
+
+    // Step 3 : recurse on both sides as tasks
+    HullChain2D upper_chain, lower_chain;
+    {
+        TaskGroup group(pool);
+        const long fu = farthestOf(a, b, upper);
+        const long fl = farthestOf(b, a, lower);
+        group.run([&, fu, upper = std::move(upper)]() mutable {
+            quickhullChain(soa, a, b, fu, std::move(upper), upper_chain, group);
+        });
+        quickhullChain(soa, b, a, fl, std::move(lower), lower_chain, group);
+        group.wait();
+    }
+
+    // chains run clockwise (upper from a to b, lower from b to a), emit counter clockwise
+    std::vector<size_t> order;
+    collectChain(lower_chain, order);
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+        _convex.push_back(_points[*it]);
+    _convex.push_back(_points[b]);
+    order.clear();
+    collectChain(upper_chain, order);
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+        _convex.push_back(_points[*it]);
+
+    // The apexes are picked by rounded areas, so one can still land on the segment
+    // between two others. Keep only strict left turns, judged exactly; _convex[0]
+    // is the leftmost point and always stays.
+    size_t kept = 1;
+    for (size_t i = 1; i < _convex.size(); i++) {
+        while (kept >= 2 && orientation2dExact(_convex[kept - 2], _convex[kept - 1], _convex[i]) <= 0)
+            kept--;
+        _convex[kept++] = _convex[i];
+    }
+    while (kept >= 3 && orientation2dExact(_convex[kept - 2], _convex[kept - 1], _convex[0]) <= 0)
+        kept--;
+    _convex.resize(kept);
+}
+
+//*****************************************************************************
+// Streaming 2D hull
+//*****************************************************************************
+
+bool rez::ConvexhullStream2D::contains(const Point2d& _point) const
+{
+    const size_t h = hull.size();
+    if (h == 0)
+        return false;
+    if (h == 1)
+        return hull[0] == _point;
+    if (h == 2)
+        return orientation2dExact(hull[0], hull[1], _point) == 0
+               && std::min(hull[0][X_], hull[1][X_]) <= _point[X_] && _point[X_] <= std::max(hull[0][X_], hull[1][X_])
+               && std::min(hull[0][Y_], hull[1][Y_]) <= _point[Y_] && _point[Y_] <= std::max(hull[0][Y_], hull[1][Y_]);
+
+    // binary search the fan around hull[0] for the wedge holding the point
+    if (orientation2dExact(hull[0], hull[1], _point) < 0
+        || orientation2dExact(hull[0], hull[h - 1], _point) > 0)
+        return false;
+    size_t lo = 1, hi = h - 1;
+    while (hi - lo > 1) {
+        const size_t mid = (lo + hi) / 2;
+        if (orientation2dExact(hull[0], hull[mid], _point) >= 0)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return orientation2dExact(hull[lo], hull[lo + 1], _point) >= 0;
+}
+
+void rez::ConvexhullStream2D::addPoints(const std::vector<Point2d>& _batch)
+{
+    if (_batch.empty())
+        return;
+    std::vector<std::vector<Point2d>> outside(4 * ThreadPool::global().size() + 1);
+    parallelChunks(_batch.size(), 1 << 14, [&](size_t first, size_t last, size_t c) {
+        for (size_t i = first; i < last; i++)
+            if (!contains(_batch[i]))
+                outside[c].push_back(_batch[i]);
+    });
+    std::vector<Point2d> candidates = hull;
+    for (auto& part : outside)
+        candidates.insert(candidates.end(), part.begin(), part.end());
+    if (candidates.size() == hull.size())
+        return;
+    convexhull2DQuickhullParallel(candidates, hull);
+}
+
+void rez::ConvexhullStream2D::addPoint(const Point2d& _point)
+{
+    addPoints(std::vector<Point2d>{ _point });
+}
+
+//*****************************************************************************
+// 3D quickhull
+//*****************************************************************************
+
+struct QuickhullFace3D {
+    int v[3];
+    int neighbour[3]; // face across the edge v[k] -> v[k + 1]
+    double normal[3];
+    double offset;
+    std::vector<int> outside;
+    int farthest = -1;
+    double farthest_distance = 0;
+    bool alive = true;
+    int visit = 0;
+};
+
+template<class Kernel>
+class Quickhull3D {
+    std::vector<double> p; // x y z interleaved
+    double eps = 0;
+
+    double distance(const QuickhullFace3D& _f, int _i) const
+    {
+        const double* q = &p[3 * _i];
+        return _f.normal[0] * q[0] + _f.normal[1] * q[1] + _f.normal[2] * q[2] - _f.offset;
+    }
+
+    // whether point _i sees face _f, decided by the kernel; distance() only ranks
+    // the points that do
+    bool above(const QuickhullFace3D& _f, int _i) const
+    {
+        const double* a = &p[3 * _f.v[0]];
+        const double* b = &p[3 * _f.v[1]];
+        const double* c = &p[3 * _f.v[2]];
+        const double* q = &p[3 * _i];
+        return Kernel::orientation3d(a[0], a[1], a[2], b[0], b[1], b[2], c[0], c[1], c[2], q[0], q[1], q[2]) > 0;
+    }
+
+    void makePlane(QuickhullFace3D& _f) const
+    {
+        const double* a = &p[3 * _f.v[0]];
+        const double* b = &p[3 * _f.v[1]];
+        const double* c = &p[3 * _f.v[2]];
+        const double u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const double w[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        double n[3] = { u[1] * w[2] - u[2] * w[1], u[2] * w[0] - u[0] * w[2], u[0] * w[1] - u[1] * w[0] };
+        const double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len > 0)
+            for (double& x : n)
+                x /= len;
+        std::copy(n, n + 3, _f.normal);
+        _f.offset = n[0] * a[0] + n[1] * a[1] + n[2] * a[2];
+    }
+
+    void addOutside(QuickhullFace3D& _f, int _i)
+    {
+        const double d = distance(_f, _i);
+        _f.outside.push_back(_i);
+        if (_f.farthest < 0 || d > _f.farthest_distance) {
+            _f.farthest_distance = d;
+            _f.farthest = _i;
+        }
+    }
+
+    // Assign the point to the first face it is above, false when it is inside all of them
+    bool assign(const std::vector<int>& _candidates, int _i)
+    {
+        for (int fi : _candidates)
+            if (above(faces[fi], _i)) {
+                addOutside(faces[fi], _i);
+                return true;
+            }
+        return false;
+    }
+
+    // assign() for every point, in chunks on the pool when there are many. The outside
+    // sets and their farthest points come out the same as with the serial loop.
+    void assignAll(const std::vector<int>& _candidates, const std::vector<int>& _points)
+    {
+        if (_points.size() < QUICKHULL3D_PARALLEL_MIN) {
+            for (int pi : _points)
+                assign(_candidates, pi);
+            return;
+        }
+        const size_t chunks = 4 * ThreadPool::global().size() + 1;
+        std::vector<std::vector<std::vector<int>>> parts(chunks, std::vector<std::vector<int>>(_candidates.size()));
+        parallelChunks(_points.size(), QUICKHULL3D_PARALLEL_MIN / 2, [&](size_t first, size_t last, size_t c) {
+            for (size_t i = first; i < last; i++)
+                for (size_t k = 0; k < _candidates.size(); k++)
+                    if (above(faces[_candidates[k]], _points[i])) {
+                        parts[c][k].push_back(_points[i]);
+                        break;
+                    }
+        });
+        for (size_t k = 0; k < _candidates.size(); k++)
+            for (auto& part : parts)
+                for (int pi : part[k])
+                    addOutside(faces[_candidates[k]], pi);
+    }
+
+    int addFace(int _a, int _b, int _c)
+    {
+        QuickhullFace3D f;
+        f.v[0] = _a; f.v[1] = _b; f.v[2] = _c;
+        f.neighbour[0] = f.neighbour[1] = f.neighbour[2] = -1;
+        makePlane(f);
+        faces.push_back(std::move(f));
+        return static_cast<int>(faces.size()) - 1;
+    }
+
+    static int edgeSlot(const QuickhullFace3D& _f, int _from, int _to)
+    {
+        for (int k = 0; k < 3; k++)
+            if (_f.v[k] == _from && _f.v[(k + 1) % 3] == _to)
+                return k;
+        return -1;
+    }
+
+public:
+    std::vector<QuickhullFace3D> faces;
+
+    explicit Quickhull3D(const std::vector<Point3d>& _points)
+    {
+        p.resize(3 * _points.size());
+        double extent[3] = { 0, 0, 0 };
+        for (size_t i = 0; i < _points.size(); i++)
+            for (int k = 0; k < 3; k++) {
+                p[3 * i + k] = _points[i][k];
+                extent[k] = std::max(extent[k], std::fabs(p[3 * i + k]));
+            }
+        eps = 3 * DBL_EPSILON * (extent[0] + extent[1] + extent[2]);
+    }
+
+    bool build()
+    {
+        const int n = static_cast<int>(p.size() / 3);
+        if (n < 4)
+            return false;
+        auto sq = [&](int i, int j) {
+            double s = 0;
+            for (int k = 0; k < 3; k++)
+                s += (p[3 * i + k] - p[3 * j + k]) * (p[3 * i + k] - p[3 * j + k]);
+            return s;
+        };
+
+        // Step 1 : initial tetrahedron from the extreme points
+        int ext[6] = { 0, 0, 0, 0, 0, 0 };
+        for (int i = 1; i < n; i++)
+            for (int k = 0; k < 3; k++) {
+                if (p[3 * i + k] < p[3 * ext[2 * k] + k]) ext[2 * k] = i;
+                if (p[3 * i + k] > p[3 * ext[2 * k + 1] + k]) ext[2 * k + 1] = i;
+            }
+        int i0 = ext[0], i1 = ext[1];
+        for (int a = 0; a < 6; a++)
+            for (int b = a + 1; b < 6; b++)
+                if (sq(ext[a], ext[b]) > sq(i0, i1)) {
+                    i0 = ext[a];
+                    i1 = ext[b];
+                }
+        int i2 = -1;
+        double best = 0;
+        const double* a = &p[3 * i0];
+        const double ab[3] = { p[3 * i1] - a[0], p[3 * i1 + 1] - a[1], p[3 * i1 + 2] - a[2] };
+        for (int i = 0; i < n; i++) {
+            const double ac[3] = { p[3 * i] - a[0], p[3 * i + 1] - a[1], p[3 * i + 2] - a[2] };
+            const double c[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+            const double d = c[0] * c[0] + c[1] * c[1] + c[2] * c[2];
+            if (d > best) {
+                best = d;
+                i2 = i;
+            }
+        }
+        if (i2 < 0 || std::sqrt(best) <= eps * std::sqrt(sq(i0, i1)))
+            return false;
+        QuickhullFace3D base;
+        base.v[0] = i0; base.v[1] = i1; base.v[2] = i2;
+        makePlane(base);
+        int i3 = -1;
+        best = 0;
+        for (int i = 0; i < n; i++) {
+            const double d = std::fabs(distance(base, i));
+            if (d > best) {
+                best = d;
+                i3 = i;
+            }
+        }
+        if (i3 < 0 || best <= eps)
+            return false;
+        if (distance(base, i3) > 0)
+            std::swap(i1, i2);
+
+        const int f0 = addFace(i0, i1, i2);
+        for (int k = 0; k < 3; k++) {
+            const int from = faces[f0].v[k], to = faces[f0].v[(k + 1) % 3];
+            addFace(to, from, i3);
+        }
+        for (int fi = 0; fi < 4; fi++)
+            for (int k = 0; k < 3; k++)
+                for (int fj = 0; fj < 4; fj++) {
+                    const int slot = edgeSlot(faces[fj], faces[fi].v[(k + 1) % 3], faces[fi].v[k]);
+                    if (fj != fi && slot >= 0)
+                        faces[fi].neighbour[k] = fj;
+                }
+
+        // Step 2 : outside sets, the bulk of the work for large inputs so done in chunks
+        const std::vector<int> initial = { 0, 1, 2, 3 };
+        const size_t chunks = 4 * ThreadPool::global().size() + 1;
+        std::vector<std::vector<std::vector<int>>> parts(chunks, std::vector<std::vector<int>>(4));
+        parallelChunks(static_cast<size_t>(n), 1 << 15, [&](size_t first, size_t last, size_t c) {
+            for (size_t i = first; i < last; i++) {
+                const int pi = static_cast<int>(i);
+                if (pi == i0 || pi == i1 || pi == i2 || pi == i3)
+                    continue;
+                for (int fi = 0; fi < 4; fi++)
+                    if (above(faces[fi], pi)) {
+                        parts[c][fi].push_back(pi);
+                        break;
+                    }
+            }
+        });
+        for (int fi = 0; fi < 4; fi++)
+            for (auto& part : parts)
+                for (int pi : part[fi])
+                    addOutside(faces[fi], pi);
+
+        // Step 3 : repeatedly push the hull out to the farthest outside point
+        std::vector<int> pending = { 0, 1, 2, 3 };
+        std::vector<int> visible, stack, horizon_from, horizon_to, horizon_face, created, orphans;
+        std::unordered_map<int, int> face_from, face_to;
+        int visit = 0;
+        while (!pending.empty()) {
+            const int fi = pending.back();
+            pending.pop_back();
+            if (!faces[fi].alive || faces[fi].outside.empty())
+                continue;
+            const int eye = faces[fi].farthest;
+
+            // faces visible from the eye, they form a connected patch
+            visit++;
+            visible.clear();
+            horizon_from.clear();
+            horizon_to.clear();
+            horizon_face.clear();
+            stack.assign(1, fi);
+            faces[fi].visit = visit;
+            while (!stack.empty()) {
+                const int cur = stack.back();
+                stack.pop_back();
+                visible.push_back(cur);
+                for (int k = 0; k < 3; k++) {
+                    const int nb = faces[cur].neighbour[k];
+                    if (faces[nb].visit == visit)
+                        continue;
+                    if (above(faces[nb], eye)) {
+                        faces[nb].visit = visit;
+                        stack.push_back(nb);
+                    }
+                }
+            }
+            for (int cur : visible)
+                for (int k = 0; k < 3; k++) {
+                    const int nb = faces[cur].neighbour[k];
+                    if (faces[nb].visit != visit) {
+                        horizon_from.push_back(faces[cur].v[k]);
+                        horizon_to.push_back(faces[cur].v[(k + 1) % 3]);
+                        horizon_face.push_back(nb);
+                    }
+                }
+
+            // cone of new faces from every horizon edge to the eye
+            created.clear();
+            face_from.clear();
+            face_to.clear();
+            for (size_t h = 0; h < horizon_from.size(); h++) {
+                const int nf = addFace(horizon_from[h], horizon_to[h], eye);
+                created.push_back(nf);
+                face_from[horizon_from[h]] = nf;
+                face_to[horizon_to[h]] = nf;
+                QuickhullFace3D& outer = faces[horizon_face[h]];
+                faces[nf].neighbour[0] = horizon_face[h];
+                outer.neighbour[edgeSlot(outer, horizon_to[h], horizon_from[h])] = nf;
+            }
+            for (int nf : created) {
+                faces[nf].neighbour[1] = face_from[faces[nf].v[1]];
+                faces[nf].neighbour[2] = face_to[faces[nf].v[0]];
+            }
+
+            // the points the removed faces saw go to the new ones, in parallel
+            // while the outside sets are large
+            orphans.clear();
+            for (int cur : visible) {
+                faces[cur].alive = false;
+                for (int pi : faces[cur].outside)
+                    if (pi != eye)
+                        orphans.push_back(pi);
+                faces[cur].outside = std::vector<int>();
+            }
+            assignAll(created, orphans);
+            for (int nf : created)
+                if (!faces[nf].outside.empty())
+                    pending.push_back(nf);
+        }
+        return true;
+    }
+};
+
+template<class Kernel>
+bool rez::convexhull3DQuickhull(std::vector<Point3d>& _points, std::vector<Face*>& _faces)
 {
-}
\ No newline at end of file
+    Quickhull3D<Kernel> hull(_points);
+    if (!hull.build()) {
+        std::cout << "All the points are coplaner" << std::endl;
+        return false;
+    }
+
+    std::unordered_map<int, Vertex3d*> vertices;
+    auto vertex = [&](int _i) {
+        auto it = vertices.find(_i);
+        if (it != vertices.end())
+            return it->second;
+        Vertex3d* v = new Vertex3d(&_points[_i]);
+        v->processed = true;
+        vertices[_i] = v;
+        return v;
+    };
+
+    std::vector<Face*> created(hull.faces.size(), nullptr);
+    for (size_t fi = 0; fi < hull.faces.size(); fi++) {
+        const QuickhullFace3D& f = hull.faces[fi];
+        if (!f.alive)
+            continue;
+        created[fi] = new Face(vertex(f.v[0]), vertex(f.v[1]), vertex(f.v[2]));
+        _faces.push_back(created[fi]);
+    }
+    // one Edge3d per hull edge, shared by the two faces around it
+    for (size_t fi = 0; fi < hull.faces.size(); fi++) {
+        const QuickhullFace3D& f = hull.faces[fi];
+        if (!f.alive)
+            continue;
+        for (int k = 0; k < 3; k++) {
+            const int from = f.v[k], to = f.v[(k + 1) % 3];
+            if (from > to)
+                continue;
+            Edge3d* edge = new Edge3d(vertices[from], vertices[to]);
+            edge->faces[0] = created[fi];
+            edge->faces[1] = created[f.neighbour[k]];
+            created[fi]->addEdge(edge);
+            created[f.neighbour[k]]->addEdge(edge);
+        }
+    }
+    return true;
+}
+
+template bool rez::convexhull3DQuickhull<FilteredKernel>(std::vector<Point3d>&, std::vector<Face*>&);
+template bool rez::convexhull3DQuickhull<InexactKernel>(std::vector<Point3d>&, std::vector<Face*>&);
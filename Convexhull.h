@@ -11,6 +11,7 @@
 #include "Point.h"
 #include "Polygon.h"
 #include "Polyhedron.h"
+#include "Kernel.h"
 
 namespace rez
 {
@@ -27,6 +28,8 @@ namespace rez
     // Assumptions : (Preprocess the points sets to satisfy following assumptions)
     //				 The points are in XY 2D plane.
     //				 No duplicate points.
+    // Kernel picks the predicates, see Kernel.h
+    template<class Kernel = FilteredKernel>
     void convexhull2DModifiedGrahams(std::vector<Point2d>& _points, std::vector<Point2d>& _convex);
 
     // Compute the points in the convex hull in incremental way. Assume the points are in XY 2D plane.
@@ -48,10 +51,38 @@ namespace rez
     // Assume there are no duplicate points.
     void convexhull3D(std::vector<Point3d>& _points, std::vector<Face*>& faces);
 
-    // Compute the points in the convex hull.
-    // TODO : Have not implemented yet
-    void convexhull3DQuickhull(std::vector<Point3d>& _points, Polygon& _results);
+    // Compute the convex hull in 3D space with quickhull.
+    // _faces receives triangles whose vertices are counter clockwise seen from outside,
+    // the Vertex3d entries point into [_points] so it has to outlive the faces.
+    // Returns false when all the points are coplaner. Whether a point sees a face is
+    // decided by Kernel, the hull topology is consistent with the exact default.
+    template<class Kernel = FilteredKernel>
+    bool convexhull3DQuickhull(std::vector<Point3d>& _points, std::vector<Face*>& _faces);
+
+    // Compute the convex hull using all the cores. Points are classified with the batched
+    // exact orientation predicates and the recursion runs as tasks on the shared thread pool.
+    // _convex receives the hull in counter clockwise order starting from the leftmost point,
+    // points lying on a hull edge are not included. Duplicates are allowed.
+    void convexhull2DQuickhullParallel(const std::vector<Point2d>& _points, std::vector<Point2d>& _convex);
+
+    // Maintains the convex hull of a point stream arriving in batches. Points falling inside
+    // the current hull are discarded right away, so each update only costs a containment test
+    // per new point plus a hull of the survivors and the current hull vertices.
+    class ConvexhullStream2D {
+        std::vector<Point2d> hull; // counter clockwise
+
+    public:
+        void addPoints(const std::vector<Point2d>& _batch);
+
+        void addPoint(const Point2d& _point);
+
+        // True if the point is inside or on the boundary of the current hull
+        bool contains(const Point2d& _point) const;
+
+        const std::vector<Point2d>& getHull() const { return hull; }
 
+        void clear() { hull.clear(); }
+    };
 }
 
 #endif //PHYSICSFORMULA_CONVEXHULL_H
\ No newline at end of file
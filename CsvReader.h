@@ -0,0 +1,340 @@
+#ifndef PHYSICSFORMULA_CSVREADER_H
+#define PHYSICSFORMULA_CSVREADER_H
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "MatrixND.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+/**
+ * @brief numeric CSV files straight into MatrixND.
+ * The file is memory mapped and never copied into strings: the bytes are cut
+ * into line aligned chunks, one parallel pass counts the rows of every chunk,
+ * the matrix is allocated once at its final size and a second parallel pass
+ * parses each chunk with std::from_chars into its own rows.
+ *
+ * read() maps the whole file, next() walks it in windows of a few tens of
+ * megabytes and returns up to maxRows rows at a time, so files larger than
+ * memory can be reduced chunk by chunk.
+ *
+ * The column count comes from the header, or from the first line when there
+ * is none. Blank lines are skipped, fields are trimmed and may be quoted,
+ * missing or unparsable fields become NaN (0 for integral T) and are counted
+ * by invalidFields(), as is every row with more fields than columns.
+ */
+namespace rez {
+    template<typename T>
+    class CsvReader {
+        using R = decomposition_scalar<T>;
+        // below this many bytes per task a file is parsed on one thread
+        static constexpr size_t PARALLEL_MIN = size_t(1) << 20;
+        static constexpr size_t DEFAULT_WINDOW = size_t(64) << 20;
+
+        MappedFile file;
+        char delimiter;
+        bool header;
+        size_t threads;
+        size_t window = DEFAULT_WINDOW;
+        std::vector<std::string> names;
+        int cols = 0;
+        uint64_t bodyStart = 0;     // first byte after the header
+        uint64_t cursor = 0;        // next byte next() reads
+        size_t invalid = 0;
+
+        void readHeader();
+        // rows of the line aligned range [begin, end) into out, resized to fit
+        void parseRegion(const char* begin, const char* end, MatrixND<T>& out);
+        size_t parseLine(const char* first, const char* last, T* row) const;
+        template<typename Body>
+        void parallelFor(size_t count, size_t tasks, Body body) const;
+    public:
+        /**
+         * @param threads 0 parses on the whole global pool, 1 on the calling thread
+         */
+        explicit CsvReader(const std::string& path, char delimiter = ',', bool header = false, size_t threads = 0);
+
+        [[nodiscard]] bool isOpen() const { return file.isOpen(); }
+        [[nodiscard]] int columns() const { return cols; }
+        // empty without a header
+        [[nodiscard]] const std::vector<std::string>& columnNames() const { return names; }
+        // fields of the last read() or next() that were missing or not numbers
+        [[nodiscard]] size_t invalidFields() const { return invalid; }
+
+        // the whole file, false if it could not be opened or mapped
+        bool read(MatrixND<T>& out);
+
+        // the next up to maxRows rows, false once the file is exhausted
+        bool next(MatrixND<T>& chunk, int maxRows);
+        [[nodiscard]] bool atEnd() const { return cursor >= file.fileSize(); }
+        // start next() over from the first row
+        void rewind() { cursor = bodyStart; }
+        // bytes next() maps at a time, grown automatically for longer lines
+        void setWindowSize(size_t bytes) { window = std::max<size_t>(bytes, 4096); }
+    };
+
+//*****************************************************************************
+// helpers
+//*****************************************************************************
+    namespace csv_detail {
+        // f(first, last) for every line of [begin, end) that is not blank,
+        // the line break (\n or \r\n) excluded
+        template<typename F>
+        void forEachLine(const char* begin, const char* end, F f) {
+            while (begin < end) {
+                const char* newline = static_cast<const char*>(std::memchr(begin, '\n', size_t(end - begin)));
+                const char* stop = newline ? newline : end;
+                const char* last = stop;
+                if (last > begin && last[-1] == '\r')
+                    last--;
+                if (last > begin)
+                    f(begin, last);
+                if (!newline)
+                    break;
+                begin = newline + 1;
+            }
+        }
+
+        inline void trim(const char*& first, const char*& last) {
+            while (first < last && (*first == ' ' || *first == '\t'))
+                first++;
+            while (last > first && (last[-1] == ' ' || last[-1] == '\t'))
+                last--;
+            if (last - first >= 2 && *first == '"' && last[-1] == '"') {
+                first++;
+                last--;
+            }
+        }
+
+        // from_chars does not take a leading '+'
+        template<typename R>
+        bool parseNumber(const char* first, const char* last, R& value) {
+            trim(first, last);
+            if (first < last && *first == '+')
+                first++;
+            if (first == last)
+                return false;
+            const auto result = std::from_chars(first, last, value);
+            return result.ec == std::errc() && result.ptr == last;
+        }
+    }
+
+//*****************************************************************************
+// CsvReader
+//*****************************************************************************
+    template<typename T>
+    CsvReader<T>::CsvReader(const std::string& path, char delimiter, bool header, size_t threads)
+            : delimiter(delimiter), header(header), threads(threads) {
+        if (file.open(path))
+            readHeader();
+    }
+
+    // maps the start of the file, growing the window until it holds the first line
+    template<typename T>
+    void CsvReader<T>::readHeader() {
+        size_t span = size_t(1) << 16;
+        for (;;) {
+            if (!file.map(0, span)) {
+                file.close();
+                return;
+            }
+            const char* begin = file.data();
+            const char* end = begin + file.size();
+            const bool whole = file.size() >= file.fileSize();
+            if (end - begin >= 3 && std::memcmp(begin, "\xEF\xBB\xBF", 3) == 0)
+                begin += 3;
+            // the first line that is not blank
+            const char* first = nullptr;
+            const char* last = nullptr;
+            const char* p = begin;
+            while (p < end) {
+                const char* newline = static_cast<const char*>(std::memchr(p, '\n', size_t(end - p)));
+                if (!newline && !whole)
+                    break;
+                const char* stop = newline ? newline : end;
+                const char* q = stop;
+                if (q > p && q[-1] == '\r')
+                    q--;
+                if (q > p) {
+                    first = p;
+                    last = q;
+                    p = newline ? newline + 1 : end;
+                    break;
+                }
+                p = newline ? newline + 1 : end;
+            }
+            if (!first && !whole) {
+                span *= 2;
+                continue;
+            }
+            cols = 0;
+            names.clear();
+            if (first) {
+                const char* f = first;
+                for (;;) {
+                    const char* d = static_cast<const char*>(std::memchr(f, delimiter, size_t(last - f)));
+                    const char* stop = d ? d : last;
+                    if (header) {
+                        const char* a = f;
+                        const char* b = stop;
+                        csv_detail::trim(a, b);
+                        names.emplace_back(a, b);
+                    }
+                    cols++;
+                    if (!d)
+                        break;
+                    f = d + 1;
+                }
+            }
+            bodyStart = header && first ? uint64_t(p - file.data()) : uint64_t(begin - file.data());
+            cursor = bodyStart;
+            file.unmap();
+            return;
+        }
+    }
+
+    template<typename T>
+    template<typename Body>
+    void CsvReader<T>::parallelFor(size_t count, size_t tasks, Body body) const {
+        if (tasks <= 1) {
+            for (size_t k = 0; k < count; k++)
+                body(k);
+            return;
+        }
+        std::atomic<size_t> next{ 0 };
+        TaskGroup group(ThreadPool::global());
+        for (size_t t = 0; t < tasks; t++)
+            group.run([&] {
+                for (size_t k = next++; k < count; k = next++)
+                    body(k);
+            });
+        group.wait();
+    }
+
+    template<typename T>
+    size_t CsvReader<T>::parseLine(const char* first, const char* last, T* row) const {
+        size_t bad = 0;
+        const char* p = first;
+        bool more = false;      // a delimiter follows the last column
+        for (int j = 0; j < cols; j++) {
+            const char* d = p < last ? static_cast<const char*>(std::memchr(p, delimiter, size_t(last - p))) : nullptr;
+            const char* stop = d ? d : last;
+            R value;
+            if (csv_detail::parseNumber(p, stop, value)) {
+                row[j] = fromDecompositionScalar<T>(value);
+            } else {
+                row[j] = std::numeric_limits<T>::has_quiet_NaN ? std::numeric_limits<T>::quiet_NaN() : T(0);
+                bad++;
+            }
+            p = d ? d + 1 : last;
+            more = d != nullptr;
+        }
+        // fields past the last column are dropped and counted once
+        if (more)
+            bad++;
+        return bad;
+    }
+
+    template<typename T>
+    void CsvReader<T>::parseRegion(const char* begin, const char* end, MatrixND<T>& out) {
+        const size_t bytes = size_t(end - begin);
+        const size_t tasks = std::min<size_t>(threads ? threads : ThreadPool::global().size(),
+                                              bytes / PARALLEL_MIN + 1);
+        // a few chunks per task, every boundary just after a line break
+        const size_t chunks = tasks <= 1 ? 1 : 4 * tasks;
+        std::vector<const char*> bounds(chunks + 1, end);
+        bounds[0] = begin;
+        for (size_t k = 1; k < chunks; k++) {
+            const char* p = std::max(begin + bytes * k / chunks, bounds[k - 1]);
+            const char* newline = p < end ? static_cast<const char*>(std::memchr(p, '\n', size_t(end - p))) : nullptr;
+            bounds[k] = newline ? newline + 1 : end;
+        }
+
+        std::vector<size_t> firstRow(chunks + 1, 0);
+        parallelFor(chunks, tasks, [&](size_t k) {
+            size_t rows = 0;
+            csv_detail::forEachLine(bounds[k], bounds[k + 1], [&](const char*, const char*) { rows++; });
+            firstRow[k + 1] = rows;
+        });
+        for (size_t k = 0; k < chunks; k++)
+            firstRow[k + 1] += firstRow[k];
+        const int rows = static_cast<int>(firstRow[chunks]);
+        if (out.rows != rows || out.cols != cols)
+            out = MatrixND<T>(rows, cols);
+
+        std::atomic<size_t> bad{ 0 };
+        parallelFor(chunks, tasks, [&](size_t k) {
+            T* row = out.data.data() + firstRow[k] * size_t(cols);
+            size_t local = 0;
+            csv_detail::forEachLine(bounds[k], bounds[k + 1], [&](const char* first, const char* last) {
+                local += parseLine(first, last, row);
+                row += cols;
+            });
+            bad += local;
+        });
+        invalid = bad;
+    }
+
+    template<typename T>
+    bool CsvReader<T>::read(MatrixND<T>& out) {
+        invalid = 0;
+        if (!file.isOpen() || !file.map(bodyStart)) {
+            out = MatrixND<T>(0, cols);
+            return false;
+        }
+        // nothing after the header, the window is empty
+        if (file.size() == 0) {
+            out = MatrixND<T>(0, cols);
+            return true;
+        }
+        parseRegion(file.data(), file.data() + file.size(), out);
+        file.unmap();
+        return true;
+    }
+
+    template<typename T>
+    bool CsvReader<T>::next(MatrixND<T>& chunk, int maxRows) {
+        invalid = 0;
+        size_t span = window;
+        while (file.isOpen() && cursor < file.fileSize() && maxRows > 0) {
+            if (!file.map(cursor, span))
+                break;
+            const char* begin = file.data();
+            const char* end = begin + file.size();
+            const bool last = cursor + file.size() >= file.fileSize();
+            // up to maxRows complete lines, a partial line waits for the next window
+            const char* stop = begin;
+            int rows = 0;
+            while (stop < end && rows < maxRows) {
+                const char* newline = static_cast<const char*>(std::memchr(stop, '\n', size_t(end - stop)));
+                if (!newline && !last)
+                    break;
+                const char* lineEnd = newline ? newline : end;
+                if (lineEnd > stop && !(lineEnd - stop == 1 && *stop == '\r'))
+                    rows++;
+                stop = newline ? newline + 1 : end;
+            }
+            if (rows == 0 && stop == begin) {
+                // one line longer than the window
+                span *= 2;
+                continue;
+            }
+            cursor += uint64_t(stop - begin);
+            if (rows == 0)
+                continue;
+            parseRegion(begin, stop, chunk);
+            file.unmap();
+            return true;
+        }
+        file.unmap();
+        chunk = MatrixND<T>(0, cols);
+        return false;
+    }
+} // namespace rez
+#endif //PHYSICSFORMULA_CSVREADER_H
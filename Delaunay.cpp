@@ -0,0 +1,740 @@
+#include "Delaunay.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include "GeoUtils.h"
+#include "Kernel.h"
+#include "ThreadPool.h"
+#include "Voronoi.h"
+
+using namespace rez;
+
+// below this many points per strip the parallel mode is not worth its seam pass
+static const size_t PARALLEL_MIN_POINTS_PER_STRIP = 16384;
+
+// Index of the cell (x, y) of a 2^16 x 2^16 grid along the Hilbert curve. The
+// rotation of the remaining sub square is tracked as a swap and a flip of the
+// coordinate bits, which keeps the loop free of branches.
+static uint32_t hilbertIndex(uint32_t x, uint32_t y)
+{
+    uint32_t d = 0, swap = 0, flip = 0;
+    for (int i = 15; i >= 0; i--) {
+        const uint32_t bx = ((x >> i) & 1) ^ flip;
+        const uint32_t by = ((y >> i) & 1) ^ flip;
+        const uint32_t rx = bx ^ ((bx ^ by) & swap);
+        const uint32_t ry = by ^ ((bx ^ by) & swap);
+        d = (d << 2) | ((3 * rx) ^ ry);
+        const uint32_t turn = ry ^ 1;
+        flip ^= rx & turn;
+        swap ^= turn;
+    }
+    return d;
+}
+
+static void circumcentre(double ax, double ay, double bx, double by, double cx, double cy,
+                         double& x, double& y)
+{
+    bx -= ax; by -= ay;
+    cx -= ax; cy -= ay;
+    const double b2 = bx * bx + by * by;
+    const double c2 = cx * cx + cy * cy;
+    const double d = 2 * (bx * cy - by * cx);
+    x = ax + (cy * b2 - by * c2) / d;
+    y = ay + (bx * c2 - cx * b2) / d;
+}
+
+// True when the circumcircle of [a b c] lies strictly between the vertical lines
+// x = _lo and x = _hi. Conservative: badly shaped triangles, whose circle is not
+// known accurately, are never reported inside.
+static bool circleInsideSlab(double ax, double ay, double bx, double by, double cx, double cy,
+                             double _lo, double _hi)
+{
+    const double ab = (bx - ax) * (bx - ax) + (by - ay) * (by - ay);
+    const double bc = (cx - bx) * (cx - bx) + (cy - by) * (cy - by);
+    const double ca = (ax - cx) * (ax - cx) + (ay - cy) * (ay - cy);
+    double x, y;
+    circumcentre(ax, ay, bx, by, cx, cy, x, y);
+    const double r2 = (ax - x) * (ax - x) + (ay - y) * (ay - y);
+    if (!(r2 < 1e6 * std::max(ab, std::max(bc, ca))))
+        return false;
+    const double r = std::sqrt(r2);
+    const double margin = 1e-9 * (std::fabs(x) + r);
+    return x - r > _lo + margin && x + r < _hi - margin;
+}
+
+//*****************************************************************************
+// Mesh primitives
+//*****************************************************************************
+
+template<class Kernel>
+bool BasicDelaunayTriangulation<Kernel>::isGhost(uint32_t _t) const
+{
+    return vertex[3 * _t] == GHOST || vertex[3 * _t + 1] == GHOST || vertex[3 * _t + 2] == GHOST;
+}
+
+template<class Kernel>
+int BasicDelaunayTriangulation<Kernel>::orient(uint32_t _a, uint32_t _b, uint32_t _c) const
+{
+    return Kernel::orientation2d(px[_a], py[_a], px[_b], py[_b], px[_c], py[_c]);
+}
+
+// Whether _p lies inside the circumcircle of triangle _t. A ghost triangle stands
+// for the half plane beyond its hull edge, so it conflicts with the points on the
+// outer side of that edge and with the points inside the edge itself.
+template<class Kernel>
+bool BasicDelaunayTriangulation<Kernel>::conflicts(uint32_t _t, uint32_t _p) const
+{
+    const uint32_t* v = &vertex[3 * _t];
+    uint32_t u, w;
+    if (v[2] == GHOST) { u = v[0]; w = v[1]; }
+    else if (v[0] == GHOST) { u = v[1]; w = v[2]; }
+    else if (v[1] == GHOST) { u = v[2]; w = v[0]; }
+    else {
+        return Kernel::inCircle(px[v[0]], py[v[0]], px[v[1]], py[v[1]], px[v[2]], py[v[2]],
+                                px[_p], py[_p]) > 0;
+    }
+    const int side = orient(u, w, _p);
+    if (side != 0)
+        return side > 0;
+    if (px[u] != px[w])
+        return std::min(px[u], px[w]) < px[_p] && px[_p] < std::max(px[u], px[w]);
+    return std::min(py[u], py[w]) < py[_p] && py[_p] < std::max(py[u], py[w]);
+}
+
+template<class Kernel>
+uint32_t BasicDelaunayTriangulation<Kernel>::newTriangle(uint32_t _a, uint32_t _b, uint32_t _c)
+{
+    const auto t = static_cast<uint32_t>(vertex.size() / 3);
+    vertex.push_back(_a);
+    vertex.push_back(_b);
+    vertex.push_back(_c);
+    twin.insert(twin.end(), 3, GHOST);
+    mark.push_back(0);
+    return t;
+}
+
+template<class Kernel>
+void BasicDelaunayTriangulation<Kernel>::link(uint32_t _e1, uint32_t _e2)
+{
+    twin[_e1] = _e2;
+    twin[_e2] = _e1;
+}
+
+// Outgoing half edge _a -> _b, GHOST when the two points are not joined
+template<class Kernel>
+uint32_t BasicDelaunayTriangulation<Kernel>::findEdge(uint32_t _a, uint32_t _b) const
+{
+    const uint32_t first = vertex_edge[_a];
+    if (first == GHOST)
+        return GHOST;
+    uint32_t e = first;
+    do {
+        if (vertex[next(e)] == _b)
+            return e;
+        e = twin[next(next(e))];
+    } while (e != first);
+    return GHOST;
+}
+
+//*****************************************************************************
+// Insertion
+//*****************************************************************************
+
+// Until three points span a triangle they are parked. The first two are kept
+// distinct, points collinear with them wait for the first one that is not.
+template<class Kernel>
+bool BasicDelaunayTriangulation<Kernel>::start(uint32_t _p)
+{
+    if (!pending.empty() && px[pending[0]] == px[_p] && py[pending[0]] == py[_p])
+        return false;
+    if (pending.size() < 2 || orient(pending[0], pending[1], _p) == 0) {
+        pending.push_back(_p);
+        return true;
+    }
+
+    uint32_t a = pending[0], b = pending[1];
+    if (orient(a, b, _p) < 0)
+        std::swap(a, b);
+
+    const uint32_t t = newTriangle(a, b, _p);
+    const uint32_t g0 = newTriangle(b, a, GHOST);
+    const uint32_t g1 = newTriangle(_p, b, GHOST);
+    const uint32_t g2 = newTriangle(a, _p, GHOST);
+    link(3 * t, 3 * g0);
+    link(3 * t + 1, 3 * g1);
+    link(3 * t + 2, 3 * g2);
+    link(3 * g0 + 1, 3 * g2 + 2);
+    link(3 * g2 + 1, 3 * g1 + 2);
+    link(3 * g1 + 1, 3 * g0 + 2);
+    vertex_edge[a] = 3 * t;
+    vertex_edge[b] = 3 * t + 1;
+    vertex_edge[_p] = 3 * t + 2;
+    last_triangle = t;
+    vertex_count = 3;
+
+    std::vector<uint32_t> collinear(pending.begin() + 2, pending.end());
+    pending.clear();
+    for (uint32_t q : collinear)
+        insertIndex(q);
+    return true;
+}
+
+// Visibility walk from the last triangle made. Stops in the real triangle that
+// contains _p, or in the ghost triangle of a hull edge _p is strictly outside of.
+template<class Kernel>
+uint32_t BasicDelaunayTriangulation<Kernel>::locate(uint32_t _p) const
+{
+    uint32_t t = last_triangle;
+    if (isGhost(t)) {
+        uint32_t e = 3 * t;
+        while (vertex[e] == GHOST || vertex[next(e)] == GHOST)
+            e++;
+        t = twin[e] / 3;
+    }
+    // rotate the first edge tried so the walk cannot cycle on degenerate input
+    uint32_t turn = _p;
+    while (true) {
+        bool moved = false;
+        for (uint32_t i = 0; i < 3; i++) {
+            const uint32_t e = 3 * t + (turn + i) % 3;
+            if (orient(vertex[e], vertex[next(e)], _p) < 0) {
+                t = twin[e] / 3;
+                moved = true;
+                break;
+            }
+        }
+        if (!moved || isGhost(t))
+            return t;
+        turn = turn * 1103515245u + 12345u;
+        turn ^= turn >> 16;
+    }
+}
+
+template<class Kernel>
+bool BasicDelaunayTriangulation<Kernel>::insertIndex(uint32_t _p)
+{
+    if (vertex.empty())
+        return start(_p);
+
+    const uint32_t located = locate(_p);
+    if (!isGhost(located)) {
+        for (uint32_t e = 3 * located; e < 3 * located + 3; e++)
+            if (px[vertex[e]] == px[_p] && py[vertex[e]] == py[_p])
+                return false;
+    }
+
+    // Grow the cavity, every triangle whose circumcircle holds _p. mark == stamp
+    // means in the cavity, stamp + 1 tested and kept.
+    stamp += 2;
+    if (stamp >= 0xFFFFFFF0u) {
+        std::fill(mark.begin(), mark.end(), 0);
+        stamp = 2;
+    }
+    cavity.clear();
+    stack.clear();
+    mark[located] = stamp;
+    stack.push_back(located);
+    while (!stack.empty()) {
+        const uint32_t t = stack.back();
+        stack.pop_back();
+        cavity.push_back(t);
+        for (uint32_t e = 3 * t; e < 3 * t + 3; e++) {
+            const uint32_t o = twin[e] / 3;
+            if (mark[o] == stamp || mark[o] == stamp + 1)
+                continue;
+            if (conflicts(o, _p)) {
+                mark[o] = stamp;
+                stack.push_back(o);
+            }
+            else {
+                mark[o] = stamp + 1;
+            }
+        }
+    }
+
+    boundary.clear();
+    for (uint32_t t : cavity)
+        for (uint32_t e = 3 * t; e < 3 * t + 3; e++)
+            if (mark[twin[e] / 3] != stamp)
+                boundary.push_back({ vertex[e], vertex[next(e)], twin[e] });
+
+    // Fan the cavity boundary to _p. The cavity has two triangles fewer than its
+    // boundary has edges, its slots are reused before new ones are added.
+    if (fan_triangle.size() < px.size() + 1)
+        fan_triangle.resize(px.size() + 1);
+    auto fan = [](uint32_t v) { return v == GHOST ? 0 : v + 1; };
+    for (size_t i = 0; i < boundary.size(); i++) {
+        const BoundaryEdge& edge = boundary[i];
+        uint32_t t;
+        if (i < cavity.size()) {
+            t = cavity[i];
+            vertex[3 * t] = edge.a;
+            vertex[3 * t + 1] = edge.b;
+            vertex[3 * t + 2] = _p;
+        }
+        else {
+            t = newTriangle(edge.a, edge.b, _p);
+        }
+        link(3 * t, edge.outer);
+        fan_triangle[fan(edge.a)] = t;
+        if (edge.a != GHOST)
+            vertex_edge[edge.a] = 3 * t;
+        if (edge.a != GHOST && edge.b != GHOST)
+            last_triangle = t;
+    }
+    for (const BoundaryEdge& edge : boundary) {
+        const uint32_t t = fan_triangle[fan(edge.a)];
+        link(3 * t + 1, 3 * fan_triangle[fan(edge.b)] + 2);
+    }
+    vertex_edge[_p] = 3 * last_triangle + 2;
+    vertex_count++;
+    return true;
+}
+
+template<class Kernel>
+uint32_t BasicDelaunayTriangulation<Kernel>::addSlot(double _x, double _y, uint32_t _index)
+{
+    const auto slot = static_cast<uint32_t>(px.size());
+    px.push_back(_x);
+    py.push_back(_y);
+    vertex_edge.push_back(GHOST);
+    index_of.push_back(_index);
+    if (slot_of_point.size() <= _index)
+        slot_of_point.resize(_index + 1, GHOST);
+    slot_of_point[_index] = slot;
+    return slot;
+}
+
+//*****************************************************************************
+// Driver
+//*****************************************************************************
+
+template<class Kernel>
+BasicDelaunayTriangulation<Kernel>::BasicDelaunayTriangulation(const std::vector<Point2d>& _points)
+{
+    compute(_points);
+}
+
+template<class Kernel>
+void BasicDelaunayTriangulation<Kernel>::clear()
+{
+    px.clear();
+    py.clear();
+    index_of.clear();
+    slot_of_point.clear();
+    vertex.clear();
+    twin.clear();
+    vertex_edge.clear();
+    pending.clear();
+    mark.clear();
+    stamp = 0;
+    last_triangle = 0;
+    vertex_count = 0;
+}
+
+template<class Kernel>
+bool BasicDelaunayTriangulation<Kernel>::compute(const std::vector<Point2d>& _points)
+{
+    clear();
+    insert(_points);
+    return !vertex.empty();
+}
+
+template<class Kernel>
+bool BasicDelaunayTriangulation<Kernel>::insert(const Point2d& _point)
+{
+    return insertIndex(addSlot(_point.coords[X_], _point.coords[Y_], static_cast<uint32_t>(px.size())));
+}
+
+template<class Kernel>
+size_t BasicDelaunayTriangulation<Kernel>::insert(const std::vector<Point2d>& _points)
+{
+    if (_points.empty())
+        return 0;
+    float min_x = _points[0].coords[X_], max_x = min_x;
+    float min_y = _points[0].coords[Y_], max_y = min_y;
+    for (const Point2d& p : _points) {
+        min_x = std::min(min_x, p.coords[X_]);
+        max_x = std::max(max_x, p.coords[X_]);
+        min_y = std::min(min_y, p.coords[Y_]);
+        max_y = std::max(max_y, p.coords[Y_]);
+    }
+    const double scale_x = max_x > min_x ? 65535.0 / (static_cast<double>(max_x) - min_x) : 0.0;
+    const double scale_y = max_y > min_y ? 65535.0 / (static_cast<double>(max_y) - min_y) : 0.0;
+
+    // Hilbert index in the high half, position in _points in the low half,
+    // sorted with two 16 bit radix passes over the Hilbert index
+    const size_t n = _points.size();
+    std::vector<uint64_t> order(n), sorted(n);
+    for (size_t i = 0; i < n; i++) {
+        const auto x = static_cast<uint32_t>((_points[i].coords[X_] - min_x) * scale_x);
+        const auto y = static_cast<uint32_t>((_points[i].coords[Y_] - min_y) * scale_y);
+        order[i] = (static_cast<uint64_t>(hilbertIndex(x, y)) << 32) | i;
+    }
+    for (int shift = 32; shift < 64; shift += 16) {
+        std::vector<size_t> offset(65537, 0);
+        for (uint64_t key : order)
+            offset[((key >> shift) & 0xFFFF) + 1]++;
+        std::partial_sum(offset.begin(), offset.end(), offset.begin());
+        for (uint64_t key : order)
+            sorted[offset[(key >> shift) & 0xFFFF]++] = key;
+        order.swap(sorted);
+    }
+
+    const auto first = static_cast<uint32_t>(px.size());
+    px.reserve(px.size() + n);
+    py.reserve(py.size() + n);
+    for (uint64_t key : order) {
+        const auto i = static_cast<uint32_t>(key);
+        addSlot(_points[i].coords[X_], _points[i].coords[Y_], first + i);
+    }
+
+    vertex.reserve(6 * px.size());
+    twin.reserve(6 * px.size());
+    mark.reserve(2 * px.size());
+    const size_t before = vertex_count;
+    for (auto slot = first; slot < px.size(); slot++)
+        insertIndex(slot);
+    return vertex_count - before;
+}
+
+// Rebuild the half edges and the ghost triangles from a list of real triangles
+template<class Kernel>
+void BasicDelaunayTriangulation<Kernel>::rebuild(const std::vector<uint32_t>& _triangles)
+{
+    vertex = _triangles;
+    twin.assign(vertex.size(), GHOST);
+    mark.assign(vertex.size() / 3, 0);
+    stamp = 0;
+    pending.clear();
+
+    // half edges bucketed by origin, the twin of a -> b is found among b's
+    const size_t n = px.size();
+    std::vector<uint32_t> first(n + 1, 0);
+    for (uint32_t v : vertex)
+        first[v + 1]++;
+    std::partial_sum(first.begin(), first.end(), first.begin());
+    std::vector<uint32_t> bucket(vertex.size());
+    {
+        std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+        for (uint32_t e = 0; e < vertex.size(); e++)
+            bucket[fill[vertex[e]]++] = e;
+    }
+
+    const auto real_edges = static_cast<uint32_t>(vertex.size());
+    std::vector<uint32_t> hull_edges;
+    for (uint32_t e = 0; e < real_edges; e++) {
+        if (twin[e] != GHOST)
+            continue;
+        const uint32_t a = vertex[e], b = vertex[next(e)];
+        for (uint32_t i = first[b]; i < first[b + 1]; i++) {
+            if (vertex[next(bucket[i])] == a) {
+                link(e, bucket[i]);
+                break;
+            }
+        }
+        if (twin[e] == GHOST)
+            hull_edges.push_back(e);
+    }
+
+    if (fan_triangle.size() < n + 1)
+        fan_triangle.resize(n + 1);
+    for (uint32_t e : hull_edges) {
+        const uint32_t g = newTriangle(vertex[next(e)], vertex[e], GHOST);
+        link(e, 3 * g);
+        fan_triangle[vertex[next(e)]] = g;
+    }
+    for (uint32_t e : hull_edges) {
+        const uint32_t g = fan_triangle[vertex[next(e)]];
+        link(3 * g + 1, 3 * fan_triangle[vertex[e]] + 2);
+    }
+
+    std::fill(vertex_edge.begin(), vertex_edge.end(), GHOST);
+    vertex_count = 0;
+    for (uint32_t e = 0; e < real_edges; e++) {
+        if (vertex_edge[vertex[e]] == GHOST)
+            vertex_count++;
+        vertex_edge[vertex[e]] = e;
+    }
+    last_triangle = 0;
+}
+
+template<class Kernel>
+bool BasicDelaunayTriangulation<Kernel>::computeParallel(const std::vector<Point2d>& _points, unsigned _threads)
+{
+    ThreadPool& pool = ThreadPool::global();
+    const unsigned strips = _threads ? _threads : pool.size();
+    if (strips < 2 || _points.size() < strips * PARALLEL_MIN_POINTS_PER_STRIP)
+        return compute(_points);
+
+    clear();
+    for (const Point2d& p : _points)
+        addSlot(p.coords[X_], p.coords[Y_], static_cast<uint32_t>(px.size()));
+    const auto n = static_cast<uint32_t>(px.size());
+
+    // Strips of equal size in (x, y) order. Copies of a pivot are kept on its
+    // left so a duplicated point never ends up on both sides of a seam.
+    std::vector<uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    auto less = [this](uint32_t i, uint32_t j) {
+        return px[i] < px[j] || (px[i] == px[j] && py[i] < py[j]);
+    };
+    std::vector<size_t> cut(strips + 1, 0);
+    cut[strips] = n;
+    for (unsigned s = 1; s < strips; s++) {
+        const size_t target = std::max(cut[s - 1], static_cast<size_t>(n) * s / strips);
+        if (target >= n) {
+            cut[s] = n;
+            continue;
+        }
+        std::nth_element(order.begin() + cut[s - 1], order.begin() + target, order.end(), less);
+        const uint32_t pivot = order[target];
+        auto end = std::partition(order.begin() + target + 1, order.end(), [&](uint32_t i) {
+            return px[i] == px[pivot] && py[i] == py[pivot];
+        });
+        cut[s] = end - order.begin();
+    }
+
+    // Points of other strips lie left of lo or right of hi
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<double> lo(strips, -inf), hi(strips, inf);
+    for (unsigned s = 1; s < strips; s++) {
+        lo[s] = lo[s - 1];
+        for (size_t i = cut[s - 1]; i < cut[s]; i++)
+            lo[s] = std::max(lo[s], px[order[i]]);
+    }
+    for (unsigned s = strips - 1; s-- > 0;) {
+        hi[s] = hi[s + 1];
+        for (size_t i = cut[s + 1]; i < cut[s + 2]; i++)
+            hi[s] = std::min(hi[s], px[order[i]]);
+    }
+
+    // Per strip: the final triangles, the directed edges bounding them (final
+    // triangle on the left) and the vertices that take part in the seam pass.
+    struct Strip {
+        std::vector<uint32_t> final_triangles, seam_edges, band;
+    };
+    std::vector<Strip> results(strips);
+    {
+        TaskGroup group(pool);
+        for (unsigned s = 0; s < strips; s++) {
+            group.run([&, s] {
+                Strip& out = results[s];
+                const uint32_t* ids = order.data() + cut[s];
+                const size_t count = cut[s + 1] - cut[s];
+                std::vector<Point2d> points;
+                points.reserve(count);
+                for (size_t i = 0; i < count; i++)
+                    points.push_back(_points[ids[i]]);
+
+                BasicDelaunayTriangulation part;
+                if (!part.compute(points)) {
+                    out.band.assign(ids, ids + count);
+                    return;
+                }
+                auto global = [&](uint32_t _slot) { return ids[part.index_of[_slot]]; };
+                const auto triangle_count = static_cast<uint32_t>(part.vertex.size() / 3);
+                std::vector<char> final(triangle_count, 0);
+                for (uint32_t t = 0; t < triangle_count; t++) {
+                    if (part.isGhost(t))
+                        continue;
+                    const uint32_t* v = &part.vertex[3 * t];
+                    final[t] = circleInsideSlab(part.px[v[0]], part.py[v[0]], part.px[v[1]], part.py[v[1]],
+                                                part.px[v[2]], part.py[v[2]], lo[s], hi[s]);
+                }
+                std::vector<char> in_band(count, 0);
+                for (uint32_t t = 0; t < triangle_count; t++) {
+                    const uint32_t* v = &part.vertex[3 * t];
+                    if (final[t]) {
+                        for (uint32_t e = 3 * t; e < 3 * t + 3; e++) {
+                            out.final_triangles.push_back(global(part.vertex[e]));
+                            if (!final[part.twin[e] / 3]) {
+                                out.seam_edges.push_back(global(part.vertex[e]));
+                                out.seam_edges.push_back(global(part.vertex[next(e)]));
+                            }
+                        }
+                        continue;
+                    }
+                    for (int k = 0; k < 3; k++)
+                        if (v[k] != GHOST)
+                            in_band[v[k]] = 1;
+                }
+                for (uint32_t slot = 0; slot < count; slot++)
+                    if (in_band[slot])
+                        out.band.push_back(global(slot));
+            });
+        }
+        group.wait();
+    }
+
+    // Triangulate the seam band. Its mesh also covers the regions of the final
+    // triangles, those are flooded from the seam edges and dropped.
+    std::vector<uint32_t> local(n, GHOST);
+    std::vector<Point2d> band_points;
+    std::vector<uint32_t> band_ids;
+    for (const Strip& strip : results) {
+        for (uint32_t id : strip.band) {
+            local[id] = static_cast<uint32_t>(band_ids.size());
+            band_ids.push_back(id);
+            band_points.push_back(_points[id]);
+        }
+    }
+    BasicDelaunayTriangulation seam;
+    if (!seam.compute(band_points))
+        return compute(_points);
+
+    const auto seam_triangles = static_cast<uint32_t>(seam.vertex.size() / 3);
+    std::vector<char> covered(seam_triangles, 0), barrier(seam.vertex.size(), 0);
+    std::vector<uint32_t> flood;
+    for (const Strip& strip : results) {
+        for (size_t i = 0; i < strip.seam_edges.size(); i += 2) {
+            const uint32_t a = local[strip.seam_edges[i]], b = local[strip.seam_edges[i + 1]];
+            const uint32_t e = (a == GHOST || b == GHOST)
+                               ? GHOST : seam.findEdge(seam.slot_of_point[a], seam.slot_of_point[b]);
+            if (e == GHOST)
+                return compute(_points);     // degenerate seam, no consistent stitch
+            barrier[e] = 1;
+            flood.push_back(e / 3);
+        }
+    }
+    while (!flood.empty()) {
+        const uint32_t t = flood.back();
+        flood.pop_back();
+        if (covered[t])
+            continue;
+        covered[t] = 1;
+        for (uint32_t e = 3 * t; e < 3 * t + 3; e++) {
+            const uint32_t o = seam.twin[e] / 3;
+            if (!barrier[e] && !covered[o] && !seam.isGhost(o))
+                flood.push_back(o);
+        }
+    }
+
+    std::vector<uint32_t> all;
+    size_t total = 0;
+    for (const Strip& strip : results)
+        total += strip.final_triangles.size();
+    all.reserve(total + seam.vertex.size());
+    for (const Strip& strip : results)
+        all.insert(all.end(), strip.final_triangles.begin(), strip.final_triangles.end());
+    for (uint32_t t = 0; t < seam_triangles; t++)
+        if (!covered[t] && !seam.isGhost(t))
+            for (uint32_t e = 3 * t; e < 3 * t + 3; e++)
+                all.push_back(band_ids[seam.index_of[seam.vertex[e]]]);
+    rebuild(all);
+    return !vertex.empty();
+}
+
+//*****************************************************************************
+// Output
+//*****************************************************************************
+
+template<class Kernel>
+size_t BasicDelaunayTriangulation<Kernel>::triangleCount() const
+{
+    size_t count = 0;
+    for (uint32_t t = 0; t < vertex.size() / 3; t++)
+        if (!isGhost(t))
+            count++;
+    return count;
+}
+
+template<class Kernel>
+Point2d BasicDelaunayTriangulation<Kernel>::point(size_t _index) const
+{
+    const uint32_t slot = slot_of_point[_index];
+    return Point2d(static_cast<float>(px[slot]), static_cast<float>(py[slot]));
+}
+
+template<class Kernel>
+std::vector<uint32_t> BasicDelaunayTriangulation<Kernel>::triangles() const
+{
+    std::vector<uint32_t> result;
+    result.reserve(vertex.size());
+    for (uint32_t t = 0; t < vertex.size() / 3; t++)
+        if (!isGhost(t))
+            for (uint32_t e = 3 * t; e < 3 * t + 3; e++)
+                result.push_back(index_of[vertex[e]]);
+    return result;
+}
+
+// The ghost triangles form a ring around the hull, it runs clockwise
+template<class Kernel>
+std::vector<uint32_t> BasicDelaunayTriangulation<Kernel>::hull() const
+{
+    std::vector<uint32_t> result;
+    uint32_t first = GHOST;
+    for (uint32_t t = 0; t < vertex.size() / 3 && first == GHOST; t++)
+        if (isGhost(t))
+            first = t;
+    if (first == GHOST)
+        return result;
+    uint32_t t = first;
+    do {
+        uint32_t e = 3 * t;
+        while (vertex[e] == GHOST || vertex[next(e)] == GHOST)
+            e++;
+        result.push_back(index_of[vertex[e]]);
+        t = twin[next(e)] / 3;
+    } while (t != first);
+    std::reverse(result.begin(), result.end());
+    return result;
+}
+
+template<class Kernel>
+Polygon2d BasicDelaunayTriangulation<Kernel>::toDCEL() const
+{
+    std::vector<Point2d> points;
+    points.reserve(px.size());
+    for (size_t i = 0; i < px.size(); i++)
+        points.push_back(point(i));
+    return Polygon2d(points, triangles());
+}
+
+template<class Kernel>
+void BasicDelaunayTriangulation<Kernel>::voronoi(const BoundRectangle& _rect, std::vector<Edge2dSimple>& _edges) const
+{
+    const auto triangle_count = static_cast<uint32_t>(vertex.size() / 3);
+    std::vector<double> centre(2 * triangle_count);
+    for (uint32_t t = 0; t < triangle_count; t++) {
+        if (isGhost(t))
+            continue;
+        const uint32_t* v = &vertex[3 * t];
+        circumcentre(px[v[0]], py[v[0]], px[v[1]], py[v[1]], px[v[2]], py[v[2]],
+                     centre[2 * t], centre[2 * t + 1]);
+    }
+
+    // Each Voronoi edge lies on the bisector of the Delaunay edge a -> b,
+    // parametrized m + t * u with u pointing to the right of a -> b. The left
+    // triangle gives one end, the right one the other or a ray for a hull edge.
+    const double inf = std::numeric_limits<double>::infinity();
+    for (uint32_t t = 0; t < triangle_count; t++) {
+        if (isGhost(t))
+            continue;
+        for (uint32_t e = 3 * t; e < 3 * t + 3; e++) {
+            const uint32_t other = twin[e] / 3;
+            const bool ray = isGhost(other);
+            if (!ray && twin[e] < e)
+                continue;
+            const uint32_t a = vertex[e], b = vertex[next(e)];
+            const double mx = (px[a] + px[b]) / 2, my = (py[a] + py[b]) / 2;
+            const double ux = py[b] - py[a], uy = -(px[b] - px[a]);
+            const double uu = ux * ux + uy * uy;
+            const double t_left = ((centre[2 * t] - mx) * ux + (centre[2 * t + 1] - my) * uy) / uu;
+            const double t_right = ray ? inf
+                                       : ((centre[2 * other] - mx) * ux + (centre[2 * other + 1] - my) * uy) / uu;
+            double t0 = std::min(t_left, t_right), t1 = std::max(t_left, t_right);
+            if (!clipLineToRect(mx, my, ux, uy, t0, t1, _rect))
+                continue;
+            Edge2dSimple edge(Point2d(static_cast<float>(mx + t0 * ux), static_cast<float>(my + t0 * uy)),
+                              Point2d(static_cast<float>(mx + t1 * ux), static_cast<float>(my + t1 * uy)));
+            edge.fp1 = Point2d(static_cast<float>(px[a]), static_cast<float>(py[a]));
+            edge.fp2 = Point2d(static_cast<float>(px[b]), static_cast<float>(py[b]));
+            _edges.push_back(edge);
+        }
+    }
+}
+
+template class rez::BasicDelaunayTriangulation<FilteredKernel>;
+template class rez::BasicDelaunayTriangulation<InexactKernel>;
@@ -0,0 +1,116 @@
+#ifndef PHYSICSFORMULA_DELAUNAY_H
+#define PHYSICSFORMULA_DELAUNAY_H
+#include <cstdint>
+#include <vector>
+#include "Point.h"
+#include "Polygon.h"
+#include "PolygonDCEL.h"
+#include "Bounds.h"
+#include "Kernel.h"
+
+namespace rez
+{
+    // Delaunay triangulation of a point set by incremental Bowyer-Watson insertion.
+    //
+    // Triangles are stored as half edges, three per triangle in counter clockwise
+    // order, with the twin of every half edge. The outside of the convex hull is
+    // covered by ghost triangles sharing a vertex at infinity, so points outside
+    // the hull are inserted like any other point and the hull stays exact. The
+    // orientation and in circle tests come from Kernel, exact with the default
+    // FilteredKernel. Batches are inserted in Hilbert curve order so each point is
+    // located by a short walk from the previous one.
+    template<class Kernel>
+    class BasicDelaunayTriangulation {
+        static constexpr uint32_t GHOST = 0xFFFFFFFFu;
+
+        // Points are stored in the order they were inserted, so the coordinates read
+        // by one insertion sit close together in memory. index_of maps a slot back
+        // to the index the point was given with, slot_of_point the other way.
+        std::vector<double> px, py;
+        std::vector<uint32_t> index_of, slot_of_point;
+        std::vector<uint32_t> vertex;        // origin slot of every half edge
+        std::vector<uint32_t> twin;          // opposite half edge
+        std::vector<uint32_t> vertex_edge;   // one outgoing half edge per point, GHOST if not in the mesh
+        uint32_t last_triangle = 0;
+        size_t vertex_count = 0;             // points that made it into the mesh
+
+        // first two distinct points and the collinear ones waiting for a third
+        std::vector<uint32_t> pending;
+
+        // insertion scratch, kept between insertions
+        std::vector<uint32_t> mark;
+        uint32_t stamp = 0;
+        std::vector<uint32_t> cavity, stack, fan_triangle;
+        struct BoundaryEdge { uint32_t a, b, outer; };
+        std::vector<BoundaryEdge> boundary;
+
+        static uint32_t next(uint32_t _e) { return _e % 3 == 2 ? _e - 2 : _e + 1; }
+
+        bool isGhost(uint32_t _t) const;
+        int orient(uint32_t _a, uint32_t _b, uint32_t _c) const;
+        bool conflicts(uint32_t _t, uint32_t _p) const;
+        uint32_t newTriangle(uint32_t _a, uint32_t _b, uint32_t _c);
+        void link(uint32_t _e1, uint32_t _e2);
+        bool start(uint32_t _p);
+        uint32_t locate(uint32_t _p) const;
+        bool insertIndex(uint32_t _p);
+        uint32_t addSlot(double _x, double _y, uint32_t _index);
+        uint32_t findEdge(uint32_t _a, uint32_t _b) const;
+        void rebuild(const std::vector<uint32_t>& _triangles);
+
+    public:
+        BasicDelaunayTriangulation() {}
+
+        explicit BasicDelaunayTriangulation(const std::vector<Point2d>& _points);
+
+        void clear();
+
+        /**
+         * @brief triangulates _points from scratch
+         * @return false when the points do not span a triangle (fewer than three
+         * distinct points or all of them collinear)
+         */
+        bool compute(const std::vector<Point2d>& _points);
+
+        /**
+         * @brief triangulates _points by splitting them into vertical strips that
+         * are triangulated in parallel. Triangles whose circumcircle stays inside
+         * their strip are final, the band of triangles along the seams is redone
+         * by one sequential pass over its vertices.
+         * @param _threads number of strips, 0 uses the size of the global pool
+         */
+        bool computeParallel(const std::vector<Point2d>& _points, unsigned _threads = 0);
+
+        // Insert one point, false if it duplicates a point already in the mesh
+        bool insert(const Point2d& _point);
+
+        // Insert a batch in Hilbert order, returns how many points were new
+        size_t insert(const std::vector<Point2d>& _points);
+
+        // number of points given so far, duplicates included
+        size_t pointCount() const { return px.size(); }
+
+        size_t triangleCount() const;
+
+        Point2d point(size_t _index) const;
+
+        // three point indices per triangle, counter clockwise
+        std::vector<uint32_t> triangles() const;
+
+        // hull vertex indices in counter clockwise order
+        std::vector<uint32_t> hull() const;
+
+        // The triangulation as a DCEL, one face per triangle plus the unbounded face
+        Polygon2d toDCEL() const;
+
+        /**
+         * @brief emits the dual Voronoi diagram clipped to _rect, one segment per
+         * Delaunay edge joining the circumcentres of its two triangles. Hull edges
+         * give rays leaving the hull. fp1 / fp2 are the two sites of the edge.
+         */
+        void voronoi(const BoundRectangle& _rect, std::vector<Edge2dSimple>& _edges) const;
+    };
+
+    typedef BasicDelaunayTriangulation<FilteredKernel> DelaunayTriangulation;
+}
+#endif //PHYSICSFORMULA_DELAUNAY_H
@@ -7,11 +7,18 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <iterator>
 #include <cstdlib>
+#include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 #include <cmath>
+#include <charconv>
 #include "MatrixND.h"
+#include "CsvReader.h"
+#include "ColumnarFile.h"
 
 /**
  * @class ETL
@@ -41,18 +48,35 @@ public:
     std::vector<std::vector<std::string>> readCSV();
    MatrixND<double> CSVtoMatrix(std::vector<std::vector<std::string>> ds, int rows, int cols);
 
+    // the whole dataset parsed in place from a memory mapped file, without the
+    // string copies of readCSV and CSVtoMatrix. threads 0 uses the whole pool
+    MatrixND<T> readMatrix(size_t threads = 0) const;
+
+    // scale every column to zero mean and unit sample standard deviation,
+    // the last (target) column is left alone unless normalizeTarget
     static MatrixND<T> Normalize(MatrixND<T> data, bool normalizeTarget);
-    //auto Mean(Eigen::MatrixXd data) -> decltype(data.colwise().mean());
-    //auto Std(Eigen::MatrixXd data) -> decltype(((data.array().square().colwise().sum())/(data.rows()-1)).sqrt());
 
     std::tuple<MatrixND<T>,MatrixND<T>,MatrixND<T>,MatrixND<T>>
     TrainTestSplit(MatrixND<T> data, float train_size)const;
 
     void VectorToFile(std::vector<float> vector, std::string filename)const;
     static void EigenToFile(MatrixND<T> data,const std::string& filename);
+
+    // binary columnar copies of a matrix, see ColumnarFile.h. Loading maps the
+    // file instead of parsing it, ColumnarFile itself gives zero copy views
+    static bool EigenToColumnar(const MatrixND<T>& data, const std::string& filename,
+                                const std::vector<std::string>& names = {},
+                                rez::ColumnCompression compression = rez::ColumnCompression::None);
+    static MatrixND<T> ColumnarToEigen(const std::string& filename);
+
+    // the dataset as a columnar file with the header as column names, and back
+    // to csv with every value written exactly
+    bool CSVToColumnar(const std::string& filename,
+                       rez::ColumnCompression compression = rez::ColumnCompression::None,
+                       size_t threads = 0) const;
+    static bool ColumnarToCSV(const std::string& filename, const std::string& csvFile, char separator = ',');
 };
 
-#endif //PHYSICSFORMULA_ETL_H
 template <typename T>
 std::vector<std::vector<std::string>> ETL<T>::readCSV()
 {
@@ -101,36 +125,46 @@ MatrixND<double> ETL<T>::CSVtoMatrix(std::vector<std::vector<std::string>>
     return data;
 }
 template <typename T>
+MatrixND<T> ETL<T>::readMatrix(size_t threads) const
+{
+    rez::CsvReader<T> reader(dataset, delimiter.empty() ? ',' : delimiter[0], header, threads);
+    MatrixND<T> data;
+    reader.read(data);
+    return data;
+}
+template <typename T>
 inline std::tuple<MatrixND<T>,MatrixND<T>,MatrixND<T>,MatrixND<T>>
 ETL<T>::TrainTestSplit(MatrixND<T> data, float train_size)const
 {
 
-    const int rows = static_cast<int>( data.rows());
+    const int rows = data.rows;
     const int train_rows = static_cast<int>( round(train_size*rows));
     const int test_rows = rows - train_rows;
 
     MatrixND<T> train = data.topRows(train_rows);
 
-    MatrixND<T> X_train = train.leftCols(data.cols()-1);
+    MatrixND<T> X_train = train.leftCols(data.cols-1);
     MatrixND<T> y_train = train.rightCols(1);
 
     MatrixND<T> test = data.bottomRows(test_rows);
 
-    MatrixND<T> X_test = test.leftCols(data.cols()-1);
+    MatrixND<T> X_test = test.leftCols(data.cols-1);
     MatrixND<T> y_test = test.rightCols(1);
 
     return std::make_tuple(X_train, y_train, X_test, y_test);
 }
+// column means as a 1 x cols row
 template <typename T>
-inline auto Mean(MatrixND<T> data) -> decltype(data.colwise().mean())
+inline MatrixND<T> Mean(const MatrixND<T>& data)
 {
     return data.colwise().mean();
 }
+// root mean square of every column over rows - 1, the standard deviation
+// of data that is already centered
 template <typename T>
-inline auto Std(MatrixND<T> data) ->
-decltype(((data.array().square().colwise().sum())/(data.rows()-1)).sqrt())
+inline MatrixND<T> Std(const MatrixND<T>& data)
 {
-    return ((data.array().square().colwise().sum())/(data.rows()-1)).sqrt();
+    return (data.array().square().colwise().sum().array() / T(data.rows - 1)).sqrt();
 }
 template <typename T>
 inline MatrixND<T> ETL<T>::Normalize(MatrixND<T> data, bool normalizeTarget)
@@ -139,19 +173,23 @@ inline MatrixND<T> ETL<T>::Normalize(MatrixND<T> data, bool normalizeTarget)
     if(normalizeTarget==true) {
         dataNorm = data;
     } else {
-        dataNorm = data.leftCols(data.cols()-1);
+        dataNorm = data.leftCols(data.cols-1);
     }
 
-    auto mean = dataNorm.colwise().mean();
-    MatrixND<T> scaled_data = dataNorm.rowwise() - mean;
-    auto std = ((scaled_data.array().square().colwise().sum()) /
-                (scaled_data.rows() - 1)).sqrt();
+    // mean and standard deviation of every column in one pass
+    const auto stats = dataNorm.colwise().statistics();
+    const auto deviation = stats.stddev();
+    MatrixND<T> mean(1, dataNorm.cols);
+    MatrixND<T> std(1, dataNorm.cols);
+    for (int j = 0; j < dataNorm.cols; j++) {
+        mean.data[j] = static_cast<T>(stats.mean[j]);
+        std.data[j] = static_cast<T>(deviation[j]);
+    }
 
-    MatrixND<T> norm = scaled_data.array().rowwise()/std;
+    MatrixND<T> norm = (dataNorm.rowwise() - mean).array().rowwise() / std;
 
     if(normalizeTarget==false) {
-        norm.conservativeResize(norm.rows(), norm.cols()+1);
-        norm.col(norm.cols()-1) = data.rightCols(1);
+        norm = norm.concat(data.rightCols(1));
     }
 
     return norm;
@@ -171,4 +209,61 @@ inline void ETL<T>::EigenToFile(MatrixND<T> data,const std::string& filename)
         output_file << data << "\n";
     }
 }
+template <typename T>
+inline bool ETL<T>::EigenToColumnar(const MatrixND<T>& data, const std::string& filename,
+                                    const std::vector<std::string>& names, rez::ColumnCompression compression)
+{
+    return rez::writeColumnar(filename, data, names, compression);
+}
+template <typename T>
+inline MatrixND<T> ETL<T>::ColumnarToEigen(const std::string& filename)
+{
+    rez::ColumnarFile file(filename);
+    return file.toMatrix<T>();
+}
+template <typename T>
+inline bool ETL<T>::CSVToColumnar(const std::string& filename, rez::ColumnCompression compression,
+                                  size_t threads) const
+{
+    rez::CsvReader<T> reader(dataset, delimiter.empty() ? ',' : delimiter[0], header, threads);
+    MatrixND<T> data;
+    if (!reader.read(data))
+        return false;
+    return rez::writeColumnar(filename, data, reader.columnNames(), compression);
+}
+template <typename T>
+inline bool ETL<T>::ColumnarToCSV(const std::string& filename, const std::string& csvFile, char separator)
+{
+    rez::ColumnarFile file(filename);
+    if (!file.isOpen())
+        return false;
+    std::ofstream output_file(csvFile, std::ios::binary);
+    if (!output_file.is_open())
+        return false;
+    const auto& names = file.columnNames();
+    for (size_t j = 0; j < names.size(); j++) {
+        if (j)
+            output_file << separator;
+        output_file << names[j];
+    }
+    if (!names.empty())
+        output_file << '\n';
 
+    // shortest text that parses back to the same value
+    const MatrixND<T> data = file.toMatrix<T>();
+    std::string line;
+    char number[64];
+    for (int i = 0; i < data.rows; i++) {
+        line.clear();
+        for (int j = 0; j < data.cols; j++) {
+            if (j)
+                line += separator;
+            const auto result = std::to_chars(number, number + sizeof(number), data.data[size_t(i) * data.cols + j]);
+            line.append(number, result.ptr);
+        }
+        line += '\n';
+        output_file.write(line.data(), std::streamsize(line.size()));
+    }
+    return bool(output_file);
+}
+#endif //PHYSICSFORMULA_ETL_H
@@ -4,10 +4,19 @@
 
 #include "GeoUtils.h"
 #include <math.h>
+#include <cmath>
+#include <limits>
 #include <set>
 #include <map>
 #include <algorithm>
 #include <list>
+#include <thread>
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define REZ_GEOUTILS_X86 1
+#include <immintrin.h>
+#endif
 
 #include "Intersection.h"
 
@@ -185,23 +194,12 @@ static bool incone(const rez::Vertex2dSimple* v1, const rez::Vertex2dSimple* v2)
              && rez::leftOrBeyond(v2->point, v1->point, v1->prev->point));
 }
 
-bool rez::isDiagonal(const Vertex2dSimple* v1, const Vertex2dSimple* v2, Polygon2dSimple* poly)
+bool rez::isDiagonal(const Vertex2dSimple* v1, const Vertex2dSimple* v2)
 {
     bool prospect = true;
-    std::vector<Vertex2dSimple*> vertices;
-    if (poly)
-        vertices = poly->getVertcies();
-    else {
-        auto vertex_ptr = v1->next;
-        vertices.push_back((Vertex2dSimple*)v1);
-        while (vertex_ptr != v1) {
-            vertices.push_back(vertex_ptr);
-            vertex_ptr = vertex_ptr->next;
-        }
-    }
-
-    Vertex2dSimple* current, * next;
-    current = vertices[0];
+    // every vertex is on the ring through v1, walk it in place
+    const Vertex2dSimple* current, * next;
+    current = v1;
     do {
         next = current->next;
         if (current != v1 && next != v1 && current != v2 && next != v2
@@ -210,7 +208,7 @@ bool rez::isDiagonal(const Vertex2dSimple* v1, const Vertex2dSimple* v2, Polygon
             break;
         }
         current = next;
-    } while (current != vertices[0]);
+    } while (current != v1);
 
     return prospect && incone(v1, v2) && incone(v2, v1);
 }
@@ -372,3 +370,388 @@ bool rez::segmentIsLeft(const Segment2d& base, const Segment2d& compare, const P
 {
     return base.get_x(_point[Y_]) < compare.get_x(_point[Y_]);
 }
+
+rez::Points2dSoA::Points2dSoA(const std::vector<Point2d>& _points)
+{
+    x.resize(_points.size());
+    y.resize(_points.size());
+    for (size_t i = 0; i < _points.size(); i++) {
+        x[i] = _points[i].coords[X_];
+        y[i] = _points[i].coords[Y_];
+    }
+}
+
+// Error bound of the orientation filter, Shewchuk's ccwerrboundA
+static const double ORIENT_ERROR_BOUND = (3.0 + 16.0 * (DBL_EPSILON / 2)) * (DBL_EPSILON / 2);
+
+static inline void twoSum(double a, double b, double& x, double& y)
+{
+    x = a + b;
+    double b_virtual = x - a;
+    double a_virtual = x - b_virtual;
+    y = (a - a_virtual) + (b - b_virtual);
+}
+
+// Sign of ax*by - ax*cy - ay*bx + ay*cx + bx*cy - by*cx evaluated exactly. Every
+// product is split into two doubles and the twelve terms are summed into a non
+// overlapping expansion, whose largest component carries the sign.
+static int orientation2dExpansion(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    const double lhs[6] = { ax, -ax, -ay, ay, bx, -by };
+    const double rhs[6] = { by, cy, bx, cx, cy, cx };
+    double expansion[12];
+    int length = 0;
+    for (int i = 0; i < 6; i++) {
+        const double product = lhs[i] * rhs[i];
+        const double error = std::fma(lhs[i], rhs[i], -product);
+        for (double term : { error, product }) {
+            double q = term;
+            for (int j = 0; j < length; j++)
+                twoSum(q, expansion[j], q, expansion[j]);
+            expansion[length++] = q;
+        }
+    }
+    for (int i = length - 1; i >= 0; i--) {
+        if (expansion[i] > 0.0)
+            return 1;
+        if (expansion[i] < 0.0)
+            return -1;
+    }
+    return 0;
+}
+
+int rez::orientation2dExact(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    const double detleft = (ax - cx) * (by - cy);
+    const double detright = (ay - cy) * (bx - cx);
+    const double det = detleft - detright;
+    const double bound = ORIENT_ERROR_BOUND * (std::fabs(detleft) + std::fabs(detright));
+    if (det > bound)
+        return 1;
+    if (-det > bound)
+        return -1;
+    return orientation2dExpansion(ax, ay, bx, by, cx, cy);
+}
+
+int rez::orientation2dExact(const Point2d& a, const Point2d& b, const Point2d& c)
+{
+    return orientation2dExact(a[X_], a[Y_], b[X_], b[Y_], c[X_], c[Y_]);
+}
+
+// Error bound of the in circle filter, Shewchuk's iccerrboundA
+static const double INCIRCLE_ERROR_BOUND = (10.0 + 96.0 * (DBL_EPSILON / 2)) * (DBL_EPSILON / 2);
+
+// Add _b to the non overlapping expansion _e of _length components, dropping
+// zero components. _e needs room for one more component.
+static void growExpansion(double* _e, int& _length, double _b)
+{
+    double q = _b;
+    int length = 0;
+    for (int i = 0; i < _length; i++) {
+        double h;
+        twoSum(q, _e[i], q, h);
+        if (h != 0.0)
+            _e[length++] = h;
+    }
+    if (q != 0.0)
+        _e[length++] = q;
+    _length = length;
+}
+
+static void addProduct(double* _e, int& _length, double _a, double _b)
+{
+    const double product = _a * _b;
+    growExpansion(_e, _length, std::fma(_a, _b, -product));
+    growExpansion(_e, _length, product);
+}
+
+// The in circle determinant expanded along the lifted column,
+// |a|^2 o(b,c,d) - |b|^2 o(a,c,d) + |c|^2 o(a,b,d) - |d|^2 o(a,b,c) where o is
+// the orientation determinant. Every product of two expansions is accumulated
+// exactly, each of the 2 * 4 * 4 * 12 added terms grows the result by at most
+// one component.
+static int inCircleExpansion(double ax, double ay, double bx, double by, double cx, double cy,
+                             double dx, double dy)
+{
+    const double x[4] = { ax, bx, cx, dx };
+    const double y[4] = { ay, by, cy, dy };
+    double det[2 * 4 * 4 * 12 + 1];
+    int det_length = 0;
+    for (int i = 0; i < 4; i++) {
+        int o[3], k = 0;
+        for (int j = 0; j < 4; j++)
+            if (j != i)
+                o[k++] = j;
+        const double ox[3] = { x[o[0]], x[o[1]], x[o[2]] };
+        const double oy[3] = { y[o[0]], y[o[1]], y[o[2]] };
+        double orient[13];
+        int orient_length = 0;
+        addProduct(orient, orient_length, ox[0], oy[1]);
+        addProduct(orient, orient_length, -ox[0], oy[2]);
+        addProduct(orient, orient_length, -oy[0], ox[1]);
+        addProduct(orient, orient_length, oy[0], ox[2]);
+        addProduct(orient, orient_length, ox[1], oy[2]);
+        addProduct(orient, orient_length, -oy[1], ox[2]);
+
+        double lift[5];
+        int lift_length = 0;
+        addProduct(lift, lift_length, x[i], x[i]);
+        addProduct(lift, lift_length, y[i], y[i]);
+
+        const double sign = (i % 2 == 0) ? 1.0 : -1.0;
+        for (int l = 0; l < lift_length; l++)
+            for (int t = 0; t < orient_length; t++)
+                addProduct(det, det_length, sign * lift[l], orient[t]);
+    }
+    if (det_length == 0)
+        return 0;
+    return det[det_length - 1] > 0.0 ? 1 : -1;
+}
+
+int rez::inCircleExact(double ax, double ay, double bx, double by, double cx, double cy,
+                       double dx, double dy)
+{
+    const double adx = ax - dx, ady = ay - dy;
+    const double bdx = bx - dx, bdy = by - dy;
+    const double cdx = cx - dx, cdy = cy - dy;
+
+    const double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+    const double cdxady = cdx * ady, adxcdy = adx * cdy;
+    const double adxbdy = adx * bdy, bdxady = bdx * ady;
+    const double alift = adx * adx + ady * ady;
+    const double blift = bdx * bdx + bdy * bdy;
+    const double clift = cdx * cdx + cdy * cdy;
+
+    const double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+    const double permanent = (std::fabs(bdxcdy) + std::fabs(cdxbdy)) * alift
+                             + (std::fabs(cdxady) + std::fabs(adxcdy)) * blift
+                             + (std::fabs(adxbdy) + std::fabs(bdxady)) * clift;
+    const double bound = INCIRCLE_ERROR_BOUND * permanent;
+    if (det > bound)
+        return 1;
+    if (-det > bound)
+        return -1;
+    return inCircleExpansion(ax, ay, bx, by, cx, cy, dx, dy);
+}
+
+int rez::inCircleExact(const Point2d& a, const Point2d& b, const Point2d& c, const Point2d& d)
+{
+    return inCircleExact(a[X_], a[Y_], b[X_], b[Y_], c[X_], c[Y_], d[X_], d[Y_]);
+}
+
+// Error bound of the 3D orientation filter, Shewchuk's o3derrboundA
+static const double ORIENT3D_ERROR_BOUND = (7.0 + 56.0 * (DBL_EPSILON / 2)) * (DBL_EPSILON / 2);
+
+// The 4x4 orientation determinant with a column of ones expanded along the z
+// column, sum of (-1)^i z_i o(other three) with o the 2D orientation
+// determinant, accumulated exactly like inCircleExpansion. Positive when d is
+// below the plane.
+static int orientation3dExpansion(const double* x, const double* y, const double* z)
+{
+    double det[4 * 12 * 2 + 1];
+    int det_length = 0;
+    for (int i = 0; i < 4; i++) {
+        int o[3], k = 0;
+        for (int j = 0; j < 4; j++)
+            if (j != i)
+                o[k++] = j;
+        double orient[13];
+        int orient_length = 0;
+        addProduct(orient, orient_length, x[o[0]], y[o[1]]);
+        addProduct(orient, orient_length, -x[o[0]], y[o[2]]);
+        addProduct(orient, orient_length, -y[o[0]], x[o[1]]);
+        addProduct(orient, orient_length, y[o[0]], x[o[2]]);
+        addProduct(orient, orient_length, x[o[1]], y[o[2]]);
+        addProduct(orient, orient_length, -y[o[1]], x[o[2]]);
+
+        const double sign = (i % 2 == 0) ? 1.0 : -1.0;
+        for (int t = 0; t < orient_length; t++)
+            addProduct(det, det_length, sign * z[i], orient[t]);
+    }
+    if (det_length == 0)
+        return 0;
+    return det[det_length - 1] > 0.0 ? 1 : -1;
+}
+
+int rez::orientation3dExact(double ax, double ay, double az, double bx, double by, double bz,
+                            double cx, double cy, double cz, double dx, double dy, double dz)
+{
+    const double adx = ax - dx, ady = ay - dy, adz = az - dz;
+    const double bdx = bx - dx, bdy = by - dy, bdz = bz - dz;
+    const double cdx = cx - dx, cdy = cy - dy, cdz = cz - dz;
+
+    const double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+    const double cdxady = cdx * ady, adxcdy = adx * cdy;
+    const double adxbdy = adx * bdy, bdxady = bdx * ady;
+
+    // positive when d is below the plane, as in Shewchuk's orient3d
+    const double det = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+    const double permanent = (std::fabs(bdxcdy) + std::fabs(cdxbdy)) * std::fabs(adz)
+                             + (std::fabs(cdxady) + std::fabs(adxcdy)) * std::fabs(bdz)
+                             + (std::fabs(adxbdy) + std::fabs(bdxady)) * std::fabs(cdz);
+    const double bound = ORIENT3D_ERROR_BOUND * permanent;
+    if (det > bound)
+        return -1;
+    if (-det > bound)
+        return 1;
+    const double x[4] = { ax, bx, cx, dx };
+    const double y[4] = { ay, by, cy, dy };
+    const double z[4] = { az, bz, cz, dz };
+    return -orientation3dExpansion(x, y, z);
+}
+
+int rez::orientation3dExact(const Point3d& a, const Point3d& b, const Point3d& c, const Point3d& d)
+{
+    return orientation3dExact(a[X_], a[Y_], a[Z_], b[X_], b[Y_], b[Z_], c[X_], c[Y_], c[Z_], d[X_], d[Y_], d[Z_]);
+}
+
+static void orientation2dRangeScalar(double ax, double ay, double bx, double by,
+                                     const double* px, const double* py, int8_t* out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = static_cast<int8_t>(rez::orientation2dExact(ax, ay, bx, by, px[i], py[i]));
+}
+
+#ifdef REZ_GEOUTILS_X86
+// No fma in the target on purpose, a contracted multiply-subtract would not
+// match the rounding the error bound assumes.
+__attribute__((target("avx2")))
+static void orientation2dRangeAvx2(double ax, double ay, double bx, double by,
+                                   const double* px, const double* py, int8_t* out, size_t n)
+{
+    const __m256d vax = _mm256_set1_pd(ax), vay = _mm256_set1_pd(ay);
+    const __m256d vbx = _mm256_set1_pd(bx), vby = _mm256_set1_pd(by);
+    const __m256d bound = _mm256_set1_pd(ORIENT_ERROR_BOUND);
+    const __m256d sign_mask = _mm256_set1_pd(-0.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d x = _mm256_loadu_pd(px + i);
+        const __m256d y = _mm256_loadu_pd(py + i);
+        const __m256d detleft = _mm256_mul_pd(_mm256_sub_pd(vax, x), _mm256_sub_pd(vby, y));
+        const __m256d detright = _mm256_mul_pd(_mm256_sub_pd(vay, y), _mm256_sub_pd(vbx, x));
+        const __m256d det = _mm256_sub_pd(detleft, detright);
+        const __m256d detsum = _mm256_add_pd(_mm256_andnot_pd(sign_mask, detleft),
+                                             _mm256_andnot_pd(sign_mask, detright));
+        const __m256d err = _mm256_mul_pd(bound, detsum);
+        const int positive = _mm256_movemask_pd(_mm256_cmp_pd(det, err, _CMP_GT_OQ));
+        const int negative = _mm256_movemask_pd(
+                _mm256_cmp_pd(det, _mm256_xor_pd(err, sign_mask), _CMP_LT_OQ));
+        for (int lane = 0; lane < 4; lane++) {
+            if (((positive | negative) >> lane) & 1)
+                out[i + lane] = static_cast<int8_t>(((positive >> lane) & 1) - ((negative >> lane) & 1));
+            else
+                out[i + lane] = static_cast<int8_t>(
+                        orientation2dExpansion(ax, ay, bx, by, px[i + lane], py[i + lane]));
+        }
+    }
+    orientation2dRangeScalar(ax, ay, bx, by, px + i, py + i, out + i, n - i);
+}
+#endif
+
+typedef void (*OrientationKernel)(double, double, double, double,
+                                  const double*, const double*, int8_t*, size_t);
+
+static OrientationKernel orientationKernel()
+{
+    static const OrientationKernel kernel = [] {
+#ifdef REZ_GEOUTILS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return static_cast<OrientationKernel>(&orientation2dRangeAvx2);
+#endif
+        return static_cast<OrientationKernel>(&orientation2dRangeScalar);
+    }();
+    return kernel;
+}
+
+void rez::orientation2dBatch(const Point2d& a, const Point2d& b, const Points2dSoA& _points,
+                             int8_t* _out, unsigned _threads)
+{
+    const OrientationKernel kernel = orientationKernel();
+    const double ax = a[X_], ay = a[Y_], bx = b[X_], by = b[Y_];
+    const size_t n = _points.size();
+    // not worth a thread below a few thousand points
+    _threads = static_cast<unsigned>(std::min<size_t>(std::max(1u, _threads), n / 4096 + 1));
+    if (_threads == 1) {
+        kernel(ax, ay, bx, by, _points.x.data(), _points.y.data(), _out, n);
+        return;
+    }
+    std::vector<std::thread> workers;
+    const size_t chunk = (n + _threads - 1) / _threads;
+    for (unsigned t = 0; t < _threads; t++) {
+        const size_t first = t * chunk;
+        const size_t count = std::min(n, first + chunk) - first;
+        workers.emplace_back(kernel, ax, ay, bx, by, _points.x.data() + first,
+                             _points.y.data() + first, _out + first, count);
+    }
+    for (auto& w : workers)
+        w.join();
+}
+
+void rez::orientation2dBatch(const Point2d& a, const Point2d& b, const Points2dSoA& _points,
+                             std::vector<int8_t>& _out, unsigned _threads)
+{
+    _out.resize(_points.size());
+    orientation2dBatch(a, b, _points, _out.data(), _threads);
+}
+
+void rez::areaTriangle2dBatch(const Point2d& a, const Point2d& b, const Points2dSoA& _points,
+                              double* _out)
+{
+    const double ax = a[X_], ay = a[Y_];
+    const double abx = b[X_] - ax, aby = b[Y_] - ay;
+    const double* px = _points.x.data();
+    const double* py = _points.y.data();
+    for (size_t i = 0; i < _points.size(); i++)
+        _out[i] = 0.5 * (abx * (py[i] - ay) - (px[i] - ax) * aby);
+}
+
+long rez::leftOfBatch(const Point2d& a, const Point2d& b, const Points2dSoA& _points,
+                      std::vector<uint32_t>& _left)
+{
+    thread_local std::vector<int8_t> signs;
+    orientation2dBatch(a, b, _points, signs);
+    const double ax = a[X_], ay = a[Y_];
+    const double abx = b[X_] - ax, aby = b[Y_] - ay;
+    long farthest = -1;
+    double max_area = 0.0, max_along = 0.0;
+    _left.clear();
+    for (size_t i = 0; i < signs.size(); i++) {
+        if (signs[i] <= 0)
+            continue;
+        _left.push_back(static_cast<uint32_t>(i));
+        const double dx = _points.x[i] - ax, dy = _points.y[i] - ay;
+        const double area = abx * dy - dx * aby;
+        const double along = abx * dx + aby * dy;
+        if (farthest < 0 || area > max_area || (area == max_area && along > max_along)) {
+            farthest = static_cast<long>(i);
+            max_area = area;
+            max_along = along;
+        }
+    }
+    return farthest;
+}
+
+long rez::leftOfBatch(const Point2d& a, const Point2d& b, const Points2dSoA& _points,
+                      const std::vector<uint32_t>& _candidates, std::vector<uint32_t>& _left)
+{
+    const double ax = a[X_], ay = a[Y_], bx = b[X_], by = b[Y_];
+    const double abx = bx - ax, aby = by - ay;
+    long farthest = -1;
+    double max_area = 0.0, max_along = 0.0;
+    _left.clear();
+    for (uint32_t i : _candidates) {
+        const double px = _points.x[i], py = _points.y[i];
+        if (orientation2dExact(ax, ay, bx, by, px, py) <= 0)
+            continue;
+        _left.push_back(i);
+        const double area = abx * (py - ay) - (px - ax) * aby;
+        const double along = abx * (px - ax) + aby * (py - ay);
+        if (farthest < 0 || area > max_area || (area == max_area && along > max_along)) {
+            farthest = static_cast<long>(i);
+            max_area = area;
+            max_along = along;
+        }
+    }
+    return farthest;
+}
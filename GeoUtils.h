@@ -5,6 +5,7 @@
 #ifndef PHYSICSFORMULA_GEOUTILS_H
 #define PHYSICSFORMULA_GEOUTILS_H
 
+#include <cstdint>
 #include <vector>
 #include "Intersection.h"
 #include "Point.h"
@@ -45,8 +46,8 @@ namespace rez
     // Predicate to determine whether the [Point c] is left to or between the segment [a b]
     bool leftOrBetween(const Point3d& a, const Point3d& b, const Point3d& c);
 
-    // Return true if the v1-v2 is a diagonal. Use to poly to get the vertice list
-    bool isDiagonal(const Vertex2dSimple* v1, const Vertex2dSimple* v2, Polygon2dSimple* poly = nullptr);
+    // Return true if the v1-v2 is a diagonal of the ring through v1
+    bool isDiagonal(const Vertex2dSimple* v1, const Vertex2dSimple* v2);
 
     // Returns counter clockwise angle (0 - 360) measure from referece point to the give point
     float polarAngle(const Point2d& _other, const Point2d& _ref);
@@ -104,6 +105,65 @@ namespace rez
     Vector3f getFaceNormal(const Point3d& a, const Point3d& b, const Point3d& c);
 
     float volumTetrahedron(const Point3d& a, const Point3d& b, const Point3d& c, const Point3d& d);
+
+    // Structure of arrays copy of 2D points, the layout the batched predicates read
+    struct Points2dSoA {
+        std::vector<double> x, y;
+
+        Points2dSoA() {}
+
+        explicit Points2dSoA(const std::vector<Point2d>& _points);
+
+        void push_back(const Point2d& _p) { x.push_back(_p[X_]); y.push_back(_p[Y_]); }
+
+        size_t size() const { return x.size(); }
+    };
+
+    // Exact sign of the orientation of [c] relative to the directed line [a b].
+    // +1 left (counter clockwise), -1 right, 0 collinear. Floating point filter
+    // first, falls back to exact expansion arithmetic when the filter cannot decide.
+    int orientation2dExact(double ax, double ay, double bx, double by, double cx, double cy);
+
+    int orientation2dExact(const Point2d& a, const Point2d& b, const Point2d& c);
+
+    // Exact sign of the in circle test of [d] against the circle through the
+    // counter clockwise triangle [a b c]. +1 inside, -1 outside, 0 on the circle.
+    // Same filter plus exact fallback scheme as orientation2dExact.
+    int inCircleExact(double ax, double ay, double bx, double by, double cx, double cy,
+                      double dx, double dy);
+
+    int inCircleExact(const Point2d& a, const Point2d& b, const Point2d& c, const Point2d& d);
+
+    // Exact sign of the orientation of [d] relative to the plane through [a b c].
+    // +1 when [d] is on the side [a b c] appear counter clockwise from, -1 on the
+    // other side, 0 coplanar. Same filter plus exact fallback scheme as above.
+    int orientation3dExact(double ax, double ay, double az, double bx, double by, double bz,
+                           double cx, double cy, double cz, double dx, double dy, double dz);
+
+    int orientation3dExact(const Point3d& a, const Point3d& b, const Point3d& c, const Point3d& d);
+
+    // Exact orientation sign of every point against the edge [a b] written to
+    // _out[i]. Runs 4 points per step with AVX2 when the CPU has it, _threads > 1
+    // splits the points over worker threads.
+    void orientation2dBatch(const Point2d& a, const Point2d& b, const Points2dSoA& _points,
+                            int8_t* _out, unsigned _threads = 1);
+
+    void orientation2dBatch(const Point2d& a, const Point2d& b, const Points2dSoA& _points,
+                            std::vector<int8_t>& _out, unsigned _threads = 1);
+
+    // Signed area of every triangle [a b p_i], positive when p_i is left of [a b]
+    void areaTriangle2dBatch(const Point2d& a, const Point2d& b, const Points2dSoA& _points,
+                             double* _out);
+
+    // Indices of the points strictly left of [a b]. Return the index of the one
+    // farthest from the line, ties going to the one farthest along [a b], or -1
+    // when no point is left of it.
+    long leftOfBatch(const Point2d& a, const Point2d& b, const Points2dSoA& _points,
+                     std::vector<uint32_t>& _left);
+
+    // Same, restricted to the points whose indices are in _candidates
+    long leftOfBatch(const Point2d& a, const Point2d& b, const Points2dSoA& _points,
+                     const std::vector<uint32_t>& _candidates, std::vector<uint32_t>& _left);
 }
 
 #endif //PHYSICSFORMULA_GEOUTILS_H
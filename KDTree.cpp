@@ -5,189 +5,78 @@
 
 using namespace rez;
 
-void KDTree::traverse(KDNode* _node, std::list<Vector2f>& _list) {
-    if (!_node)
-        return;
-    traverse(_node->left, _list);
-    if (isALeaf(_node))
-        _list.push_back(_node->data);
-    traverse(_node->right, _list);
-}
-
-bool KDTree::isALeaf(KDNode* _node) {
-    if (!_node->left && !_node->right)
-        return true;
-    return false;
+KDTree::KDTree(const std::list<Vector2f>& _data)
+        : points(_data.begin(), _data.end()) {
+    computeBounds(points);
+    tree = KDTreeND<float, DIM2>(points);
 }
 
-bool KDTree::isIntersect(const KDRange& r1, const KDRange& r2) {
-    if (r1.x_max < r2.x_min || r1.x_min > r2.x_max)
-        return false;
-    if (r1.y_max < r2.y_min || r1.y_min > r2.y_max)
-        return false;
-    return true;
+KDTree::KDTree(const std::vector<Vector2f>& _data) : tree(_data), points(_data) {
+    computeBounds(points);
 }
 
-bool KDTree::isContained(const KDRange& r1, const KDRange& r2) {
-    if (r1.x_min >= r2.x_min && r1.x_max <= r2.x_max && r1.y_min >= r2.y_min && r1.y_max <= r2.y_max)
-        return true;
-    return false;
-}
-
-bool KDTree::isInRange(const Vector2f& p, const KDRange& r) {
-    if (p[X_] >= r.x_min && p[X_] <= r.x_max && p[Y_] >= r.y_min && p[Y_] <= r.y_max)
-        return true;
-    return false;
-}
-
-static float sqrd_distance(const Vector2f& v1, const Vector2f& v2) {
-    return (v1[X_] - v2[X_]) * (v1[X_] - v2[X_]) + (v1[Y_] - v2[Y_]) * (v1[Y_] - v2[Y_]);
-}
-
-KDTree::KDRange KDTree::intersection(const KDRange& r1, const KDRange& r2) {
-    if (!isIntersect(r1, r2))
-        return INVALID_RANGE;
-    if (isContained(r1, r2))
-        return r1;
-    if (isContained(r2, r1))
-        return r2;
-
-    auto max_x_min = r1.x_min > r2.x_min ? r1.x_min : r2.x_min;
-    auto min_x_max = r1.x_max < r2.x_max ? r1.x_max : r2.x_max;
-    auto max_y_min = r1.y_min > r2.y_min ? r1.y_min : r2.y_min;
-    auto min_y_max = r1.x_max < r2.x_max ? r1.x_max : r2.x_max;
-
-    return KDRange{ max_x_min, min_x_max, max_y_min, min_y_max };
-}
-
-KDTree::KDNode* rez::KDTree::constructKDTree(std::list<Vector2f>& _data, uint32_t _depth)
-{
-    auto size = _data.size();
-    if (size == 1)
-        return new KDNode(_data.front());
-    if (_depth % 2 == 0)
-        _data.sort([](Vector2f a, Vector2f b) { return (a[X_] < b[X_]); });
-    else {
-        _data.sort([](Vector2f a, Vector2f b) { return (a[Y_] < b[Y_]); });
-    }
-
-    auto mid = size / 2;
-    auto mid_ptr = _data.begin();
-    std::advance(mid_ptr, mid);
-    auto left_list = std::list<Vector2f>(_data.begin(), mid_ptr);
-    auto right_list = std::list<Vector2f>(mid_ptr, _data.end());
-
-    auto left_child = constructKDTree(left_list, _depth + 1);
-    auto right_child = constructKDTree(right_list, _depth + 1);
-    return new KDNode((*mid_ptr)[_depth % 2], left_child, right_child);
-}
-
-void KDTree::searchKDTree(KDNode* _node, KDRange _range, std::list<Vector2f>& _list) {
-    if (isALeaf(_node)) {
-        if (isInRange(_node->data, _range))
-            _list.push_back(_node->data);
-    }
-    else {
-        if (isContained(_node->left->boundary, _range)) {
-            traverse(_node->left, _list);
-        }
-        else if (isIntersect(_node->left->boundary, _range)) {
-            searchKDTree(_node->left, _range, _list);
-        }
-
-        if (isContained(_node->right->boundary, _range)) {
-            traverse(_node->right, _list);
-        }
-        else if (isIntersect(_node->right->boundary, _range)) {
-            searchKDTree(_node->right, _range, _list);
-        }
-    }
-}
-
-void KDTree::preprocessBoundaries(KDNode* _node, bool _isEvenDepth) {
-    if (!_node || isALeaf(_node))
+void KDTree::computeBounds(const std::vector<Vector2f>& _data) {
+    if (_data.empty())
         return;
-
-    if (_isEvenDepth) {
-        if (_node->left) {
-            _node->left->boundary = _node->boundary;
-            _node->left->boundary.x_max = _node->value;
-            preprocessBoundaries(_node->left, !_isEvenDepth);
-        }
-
-        if (_node->right) {
-            _node->right->boundary = _node->boundary;
-            _node->right->boundary.x_min = _node->value;
-            preprocessBoundaries(_node->right, !_isEvenDepth);
-        }
-    }
-    else {
-        if (_node->left) {
-            _node->left->boundary = _node->boundary;
-            _node->left->boundary.y_max = _node->value;
-            preprocessBoundaries(_node->left, !_isEvenDepth);
-        }
-
-        if (_node->right) {
-            _node->right->boundary = _node->boundary;
-            _node->right->boundary.y_min = _node->value;
-            preprocessBoundaries(_node->right, !_isEvenDepth);
-        }
-    }
-}
-
-void rez::KDTree::nearestNeighbour(KDNode* _node, const Vector2f& _value, float& _current_distance
-        , bool _even_depth, Vector2f& _current_nn) {
-    if (isALeaf(_node)) {
-        auto distance = sqrd_distance(_value, _node->data);
-        if (distance < _current_distance) {
-            _current_distance = distance;
-            _current_nn = _node->data;
-        }
-    }
-    else {
-        auto index = _even_depth ? X_ : Y_;
-        if (_value[index] < _node->value) {
-            nearestNeighbour(_node->left, _value, _current_distance, !_even_depth, _current_nn);
-            if (fabs(_value[index] - _node->value) < _current_distance)
-                nearestNeighbour(_node->right, _value, _current_distance, !_even_depth, _current_nn);
-        }
-        else {
-            nearestNeighbour(_node->right, _value, _current_distance, !_even_depth, _current_nn);
-            if (fabs(_value[index] - _node->value) < _current_distance)
-                nearestNeighbour(_node->left, _value, _current_distance, !_even_depth, _current_nn);
-        }
+    x_min = x_max = _data.front()[X_];
+    y_min = y_max = _data.front()[Y_];
+    for (const auto& p : _data) {
+        x_min = std::min(x_min, p.coords[X_]);
+        x_max = std::max(x_max, p.coords[X_]);
+        y_min = std::min(y_min, p.coords[Y_]);
+        y_max = std::max(y_max, p.coords[Y_]);
     }
 }
 
 void KDTree::Search(const float x_min, const float x_max, const float y_min,
                     const float y_max, std::list<Vector2f>& _list) {
-    KDRange range{ x_min, x_max, y_min, y_max };
-    searchKDTree(root, range, _list);
+    for (size_t id : tree.rangeSearch(Vector2f(x_min, y_min), Vector2f(x_max, y_max)))
+        _list.push_back(points[id]);
 }
 
 void KDTree::Traverse(std::list<Vector2f>& _list) {
-    traverse(root, _list);
+    const auto& ordered = tree.data();
+    _list.insert(_list.end(), ordered.begin(), ordered.end());
 }
 
-void KDTree::getSplitLineData(KDNode* _node, std::list<Vector2f>& _data, bool _isEvenDepth) {
-    if (!_node)
-        return;
+void KDTree::getSplitLineData(std::list<Vector2f>& _data) {
+    tree.visitSplits(Vector2f(x_min, y_min), Vector2f(x_max, y_max),
+                     [&](size_t _axis, float _value, const Vector2f& _lo, const Vector2f& _hi) {
+                         if (_axis == X_) {
+                             _data.push_back(Vector2f(_value, _lo[Y_]));
+                             _data.push_back(Vector2f(_value, _hi[Y_]));
+                         }
+                         else {
+                             _data.push_back(Vector2f(_lo[X_], _value));
+                             _data.push_back(Vector2f(_hi[X_], _value));
+                         }
+                     });
+}
 
-    if (_isEvenDepth) {
-        _data.push_back(Vector2f(_node->value, root->boundary.y_min));
-        _data.push_back(Vector2f(_node->value, root->boundary.y_max));
-    }
-    else {
-        _data.push_back(Vector2f(_node->boundary.x_min, _node->value));
-        _data.push_back(Vector2f(_node->boundary.y_max, _node->value));
-    }
+void KDTree::NearestNeighbour(const Vector2f& _search_node, Vector2f& _ref_node) {
+    KDTreeND<float, DIM2>::Neighbour nn{};
+    if (tree.nearestNeighbour(_search_node, nn))
+        _ref_node = points[nn.index];
+}
 
-    getSplitLineData(_node->left, _data, !_isEvenDepth);
-    getSplitLineData(_node->right, _data, !_isEvenDepth);
+void KDTree::KNearest(const Vector2f& _search_node, size_t _k, std::vector<Vector2f>& _result) {
+    _result.clear();
+    for (const auto& n : tree.kNearest(_search_node, _k))
+        _result.push_back(points[n.index]);
 }
 
-void KDTree::NearestNeighbour(const Vector2f& _search_node, Vector2f& _ref_node) {
-    float current_val = FLT_MAX;
-    nearestNeighbour(root, _search_node, current_val, true, _ref_node);
+void KDTree::RadiusSearch(const Vector2f& _search_node, float _radius, std::list<Vector2f>& _list) {
+    for (const auto& n : tree.radiusSearch(_search_node, _radius))
+        _list.push_back(points[n.index]);
+}
+
+std::vector<std::vector<Vector2f>> KDTree::KNearest(const std::vector<Vector2f>& _queries, size_t _k) {
+    auto neighbours = tree.kNearest(_queries, _k);
+    std::vector<std::vector<Vector2f>> result(neighbours.size());
+    for (size_t i = 0; i < neighbours.size(); i++) {
+        result[i].reserve(neighbours[i].size());
+        for (const auto& n : neighbours[i])
+            result[i].push_back(points[n.index]);
+    }
+    return result;
 }
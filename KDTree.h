@@ -8,6 +8,7 @@
 #include "Core.h"
 #include "Vector.h"
 #include "Point.h"
+#include "KDTreeND.h"
 
 #include <list>
 #include <vector>
@@ -15,75 +16,41 @@
 #include <algorithm>
 
 namespace rez {
+    // 2D float kd-tree, a thin wrapper over the bulk loaded KDTreeND
     class KDTree {
+        KDTreeND<float, DIM2> tree;
+        std::vector<Vector2f> points; // input order, neighbour indices refer here
+        // bounding box of the data, frames the split lines
+        float x_min = 0, x_max = 0, y_min = 0, y_max = 0;
 
-        struct KDRange {
-            float x_min, x_max, y_min, y_max;
-        };
-
-        struct KDNode {
-            KDNode* left;
-            KDNode* right;
-            rez::Vector2f data;
-            float value = FLT_MIN;
-            KDRange boundary{ -10, 10, -10, 10 };
-
-            KDNode(float _value, KDNode* _left = nullptr, KDNode* _right = nullptr)
-                    :value(_value), left(_left), right(_right) {}
-
-            KDNode(Vector2f _data, KDNode* _left = nullptr, KDNode* _right = nullptr)
-                    :data(_data), left(_left), right(_right) {}
-        };
-
-        KDNode* root = nullptr;
-        KDRange default_bound{ -10, 10, -10, 10 };
-        KDRange INVALID_RANGE{ 0, 0, 0, 0 };
-
-        void traverse(KDNode* _node, std::list<Vector2f>& _list);
-
-        bool isALeaf(KDNode* _node);
-        bool isIntersect(const KDRange&, const KDRange&);
-
-        // Check if r1 reside completely with in r2
-        bool isContained(const KDRange& r1, const KDRange& r2);
-
-        // Cehck if p is inside the r
-        bool isInRange(const Vector2f& p, const KDRange& r);
-
-        // Return the common region if r1 amd r2 intersect. If not return INVALID_RANGE
-        KDRange intersection(const KDRange& r1, const KDRange& r2);
-
-        KDNode* constructKDTree(std::list<Vector2f>& _data, uint32_t _depth);
-        void searchKDTree(KDNode*, KDRange, std::list<Vector2f>&);
-
-        // Calculate bounded rectangle for non leaf nodes in the KDTree
-        void preprocessBoundaries(KDNode* _node, bool _isEvenDepth);
-
-        void getSplitLineData(KDNode* _node, std::list<Vector2f>& _data, bool _isEvenDepth);
-
-        void nearestNeighbour(KDNode* _node, const Vector2f& _value, float& current_distance, bool _even_depth, Vector2f& _current_nn);
+        void computeBounds(const std::vector<Vector2f>& _data);
 
     public:
         KDTree() {}
 
-        KDTree(std::list<Vector2f> _data) {
-            root = constructKDTree(_data, 0);
-            root->boundary = default_bound;
-            preprocessBoundaries(root, true);
-        }
+        KDTree(const std::list<Vector2f>& _data);
+
+        KDTree(const std::vector<Vector2f>& _data);
 
         void Search(const float x_min, const float x_max,
                     const float y_min, const float y_max, std::list<Vector2f>&);
 
         void Traverse(std::list<Vector2f>&);
 
-        void getSplitLineData(std::list<Vector2f>& _data) {
-            if (root) {
-                getSplitLineData(root, _data, true);
-            }
-        }
+        void getSplitLineData(std::list<Vector2f>& _data);
 
         void NearestNeighbour(const Vector2f&, Vector2f&);
+
+        // the _k closest points, nearest first
+        void KNearest(const Vector2f&, size_t _k, std::vector<Vector2f>&);
+
+        // all points within _radius of the query point
+        void RadiusSearch(const Vector2f&, float _radius, std::list<Vector2f>&);
+
+        // batched k nearest over all hardware threads
+        std::vector<std::vector<Vector2f>> KNearest(const std::vector<Vector2f>&, size_t _k);
+
+        [[nodiscard]] size_t size() const { return tree.size(); }
     };
 };
 #endif //PHYSICSFORMULA_KDTREE_H
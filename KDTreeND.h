@@ -0,0 +1,397 @@
+#ifndef PHYSICSFORMULA_KDTREEND_H
+#define PHYSICSFORMULA_KDTREEND_H
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Vector.h"
+
+/**
+ * @brief static kd-tree over rez::Vector<coordinate_type, dim> points.
+ * The tree is bulk loaded once: every level splits its range at the median
+ * (std::nth_element) along the widest axis, so the build is O(n log n) and
+ * the tree is perfectly balanced. Because of that all leaves sit on the
+ * same depth and the nodes are kept in an implicit heap layout (children
+ * of node i are 2i+1 and 2i+2), only the split value and axis per node are
+ * stored and the points themselves live in one contiguous array in leaf
+ * order.
+ *
+ * Queries: nearest, k nearest, radius and axis aligned box. The batched
+ * versions split the queries over worker threads, the tree is read only
+ * after construction so no locking is needed.
+ */
+namespace rez {
+    template<typename coordinate_type, size_t dim = DIM2>
+    class KDTreeND {
+    public:
+        using point_type = Vector<coordinate_type, dim>;
+        using distance_type = std::conditional_t<std::is_floating_point_v<coordinate_type>,
+                                                 coordinate_type, double>;
+
+        // result of a proximity query, index is the position in the input
+        struct Neighbour {
+            size_t index;
+            distance_type squaredDistance;
+            bool operator<(const Neighbour& other) const {
+                return squaredDistance < other.squaredDistance;
+            }
+        };
+
+        static constexpr size_t LEAF_SIZE = 8;
+
+    private:
+        std::vector<point_type> points;     // leaf order
+        std::vector<size_t> ids;            // input index of points[i]
+        std::vector<coordinate_type> splits;
+        std::vector<uint8_t> axes;
+        size_t depth = 0;                   // number of internal levels
+
+        struct Entry {
+            point_type p;
+            size_t id;
+        };
+
+        static distance_type squaredDistance(const point_type& a, const point_type& b) {
+            distance_type d = 0;
+            for (size_t i = 0; i < dim; i++) {
+                const distance_type t = distance_type(a.coords[i]) - distance_type(b.coords[i]);
+                d += t * t;
+            }
+            return d;
+        }
+
+        void build(std::vector<Entry>& entries, size_t node, size_t level,
+                   size_t begin, size_t end, size_t parallelLevels);
+
+        void nearest(const point_type& q, size_t k, std::vector<Neighbour>& heap,
+                     size_t node, size_t level, size_t begin, size_t end) const;
+
+        void radius(const point_type& q, distance_type r2, std::vector<Neighbour>& out,
+                    size_t node, size_t level, size_t begin, size_t end) const;
+
+        void box(const point_type& lo, const point_type& hi, std::vector<size_t>& out,
+                 size_t node, size_t level, size_t begin, size_t end) const;
+
+        template<typename Query>
+        static void forEachParallel(size_t count, unsigned threads, Query query);
+
+    public:
+        KDTreeND() = default;
+
+        explicit KDTreeND(const std::vector<point_type>& input);
+
+        [[nodiscard]] size_t size() const { return points.size(); }
+        [[nodiscard]] bool empty() const { return points.empty(); }
+
+        // point by input index order is lost, these give the leaf order
+        [[nodiscard]] const std::vector<point_type>& data() const { return points; }
+        [[nodiscard]] const std::vector<size_t>& indices() const { return ids; }
+
+        /**
+         * @brief closest point to q
+         * @param q query point
+         * @param result set to the closest neighbour
+         * @return false if the tree is empty
+         */
+        bool nearestNeighbour(const point_type& q, Neighbour& result) const;
+
+        // k closest points sorted by increasing distance
+        std::vector<Neighbour> kNearest(const point_type& q, size_t k) const;
+
+        // every point with |p - q| <= r, unordered
+        std::vector<Neighbour> radiusSearch(const point_type& q, distance_type r) const;
+
+        // input indices of the points inside the closed box [lo, hi]
+        std::vector<size_t> rangeSearch(const point_type& lo, const point_type& hi) const;
+
+        // batched k nearest, threads == 0 uses hardware_concurrency
+        std::vector<std::vector<Neighbour>> kNearest(const std::vector<point_type>& queries,
+                                                     size_t k, unsigned threads = 0) const;
+
+        std::vector<std::vector<Neighbour>> radiusSearch(const std::vector<point_type>& queries,
+                                                         distance_type r,
+                                                         unsigned threads = 0) const;
+
+        /**
+         * @brief walks the splitting planes top down
+         * @param visit called as visit(axis, split, lo, hi) where lo/hi bound
+         * the cell that the plane cuts, starting from the given bounds
+         */
+        template<typename Visitor>
+        void visitSplits(const point_type& lo, const point_type& hi, Visitor visit) const;
+    };
+
+//*****************************************************************************
+// construction
+//*****************************************************************************
+    template<typename coordinate_type, size_t dim>
+    KDTreeND<coordinate_type, dim>::KDTreeND(const std::vector<point_type>& input) {
+        const size_t n = input.size();
+        if (n == 0)
+            return;
+        while ((n >> depth) > LEAF_SIZE)
+            depth++;
+        const size_t internal = (size_t(1) << depth) - 1;
+        splits.resize(internal);
+        axes.resize(internal);
+
+        std::vector<Entry> entries(n);
+        for (size_t i = 0; i < n; i++)
+            entries[i] = { input[i], i };
+
+        // one level of fork per doubling of the available threads
+        size_t parallelLevels = 0;
+        unsigned hw = std::thread::hardware_concurrency();
+        while ((size_t(1) << parallelLevels) < hw && n > 65536)
+            parallelLevels++;
+        build(entries, 0, 0, 0, n, parallelLevels);
+
+        points.resize(n);
+        ids.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            points[i] = entries[i].p;
+            ids[i] = entries[i].id;
+        }
+    }
+
+    template<typename coordinate_type, size_t dim>
+    void KDTreeND<coordinate_type, dim>::build(std::vector<Entry>& entries, size_t node,
+                                               size_t level, size_t begin, size_t end,
+                                               size_t parallelLevels) {
+        if (level == depth)
+            return;
+        // widest extent picks the axis, keeps cells close to square
+        point_type lo = entries[begin].p, hi = entries[begin].p;
+        for (size_t i = begin + 1; i < end; i++)
+            for (size_t a = 0; a < dim; a++) {
+                const coordinate_type v = entries[i].p.coords[a];
+                if (v < lo.coords[a]) lo.coords[a] = v;
+                if (v > hi.coords[a]) hi.coords[a] = v;
+            }
+        size_t axis = 0;
+        for (size_t a = 1; a < dim; a++)
+            if (hi.coords[a] - lo.coords[a] > hi.coords[axis] - lo.coords[axis])
+                axis = a;
+
+        const size_t mid = begin + (end - begin) / 2;
+        std::nth_element(entries.begin() + begin, entries.begin() + mid, entries.begin() + end,
+                         [axis](const Entry& a, const Entry& b) { return a.p.coords[axis] < b.p.coords[axis]; });
+        splits[node] = entries[mid].p.coords[axis];
+        axes[node] = static_cast<uint8_t>(axis);
+
+        if (level < parallelLevels) {
+            auto left = std::async(std::launch::async, [&] {
+                build(entries, 2 * node + 1, level + 1, begin, mid, parallelLevels);
+            });
+            build(entries, 2 * node + 2, level + 1, mid, end, parallelLevels);
+            left.get();
+        } else {
+            build(entries, 2 * node + 1, level + 1, begin, mid, parallelLevels);
+            build(entries, 2 * node + 2, level + 1, mid, end, parallelLevels);
+        }
+    }
+
+//*****************************************************************************
+// queries
+//*****************************************************************************
+    template<typename coordinate_type, size_t dim>
+    void KDTreeND<coordinate_type, dim>::nearest(const point_type& q, size_t k,
+                                                 std::vector<Neighbour>& heap, size_t node,
+                                                 size_t level, size_t begin, size_t end) const {
+        if (level == depth) {
+            for (size_t i = begin; i < end; i++) {
+                const distance_type d = squaredDistance(q, points[i]);
+                if (heap.size() < k) {
+                    heap.push_back({ ids[i], d });
+                    std::push_heap(heap.begin(), heap.end());
+                } else if (d < heap.front().squaredDistance) {
+                    std::pop_heap(heap.begin(), heap.end());
+                    heap.back() = { ids[i], d };
+                    std::push_heap(heap.begin(), heap.end());
+                }
+            }
+            return;
+        }
+        const size_t mid = begin + (end - begin) / 2;
+        const distance_type diff = distance_type(q.coords[axes[node]]) - distance_type(splits[node]);
+        const bool goLeft = diff < 0;
+        if (goLeft)
+            nearest(q, k, heap, 2 * node + 1, level + 1, begin, mid);
+        else
+            nearest(q, k, heap, 2 * node + 2, level + 1, mid, end);
+        // the far side can only help if the plane is closer than the worst kept
+        if (heap.size() < k || diff * diff < heap.front().squaredDistance) {
+            if (goLeft)
+                nearest(q, k, heap, 2 * node + 2, level + 1, mid, end);
+            else
+                nearest(q, k, heap, 2 * node + 1, level + 1, begin, mid);
+        }
+    }
+
+    template<typename coordinate_type, size_t dim>
+    void KDTreeND<coordinate_type, dim>::radius(const point_type& q, distance_type r2,
+                                                std::vector<Neighbour>& out, size_t node,
+                                                size_t level, size_t begin, size_t end) const {
+        if (level == depth) {
+            for (size_t i = begin; i < end; i++) {
+                const distance_type d = squaredDistance(q, points[i]);
+                if (d <= r2)
+                    out.push_back({ ids[i], d });
+            }
+            return;
+        }
+        const size_t mid = begin + (end - begin) / 2;
+        const distance_type diff = distance_type(q.coords[axes[node]]) - distance_type(splits[node]);
+        if (diff <= 0 || diff * diff <= r2)
+            radius(q, r2, out, 2 * node + 1, level + 1, begin, mid);
+        if (diff >= 0 || diff * diff <= r2)
+            radius(q, r2, out, 2 * node + 2, level + 1, mid, end);
+    }
+
+    template<typename coordinate_type, size_t dim>
+    void KDTreeND<coordinate_type, dim>::box(const point_type& lo, const point_type& hi,
+                                             std::vector<size_t>& out, size_t node,
+                                             size_t level, size_t begin, size_t end) const {
+        if (level == depth) {
+            for (size_t i = begin; i < end; i++) {
+                bool inside = true;
+                for (size_t a = 0; a < dim && inside; a++)
+                    inside = points[i].coords[a] >= lo.coords[a] && points[i].coords[a] <= hi.coords[a];
+                if (inside)
+                    out.push_back(ids[i]);
+            }
+            return;
+        }
+        const size_t mid = begin + (end - begin) / 2;
+        const size_t axis = axes[node];
+        if (lo.coords[axis] <= splits[node])
+            box(lo, hi, out, 2 * node + 1, level + 1, begin, mid);
+        if (hi.coords[axis] >= splits[node])
+            box(lo, hi, out, 2 * node + 2, level + 1, mid, end);
+    }
+
+    template<typename coordinate_type, size_t dim>
+    bool KDTreeND<coordinate_type, dim>::nearestNeighbour(const point_type& q,
+                                                          Neighbour& result) const {
+        if (points.empty())
+            return false;
+        std::vector<Neighbour> heap;
+        heap.reserve(1);
+        nearest(q, 1, heap, 0, 0, 0, points.size());
+        result = heap.front();
+        return true;
+    }
+
+    template<typename coordinate_type, size_t dim>
+    std::vector<typename KDTreeND<coordinate_type, dim>::Neighbour>
+    KDTreeND<coordinate_type, dim>::kNearest(const point_type& q, size_t k) const {
+        std::vector<Neighbour> heap;
+        if (points.empty() || k == 0)
+            return heap;
+        heap.reserve(k);
+        nearest(q, k, heap, 0, 0, 0, points.size());
+        std::sort_heap(heap.begin(), heap.end());
+        return heap;
+    }
+
+    template<typename coordinate_type, size_t dim>
+    std::vector<typename KDTreeND<coordinate_type, dim>::Neighbour>
+    KDTreeND<coordinate_type, dim>::radiusSearch(const point_type& q, distance_type r) const {
+        std::vector<Neighbour> out;
+        if (!points.empty())
+            radius(q, r * r, out, 0, 0, 0, points.size());
+        return out;
+    }
+
+    template<typename coordinate_type, size_t dim>
+    std::vector<size_t> KDTreeND<coordinate_type, dim>::rangeSearch(const point_type& lo,
+                                                                    const point_type& hi) const {
+        std::vector<size_t> out;
+        if (!points.empty())
+            box(lo, hi, out, 0, 0, 0, points.size());
+        return out;
+    }
+
+    template<typename coordinate_type, size_t dim>
+    template<typename Query>
+    void KDTreeND<coordinate_type, dim>::forEachParallel(size_t count, unsigned threads,
+                                                         Query query) {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<unsigned>(std::min<size_t>(threads, (count + 255) / 256));
+        if (threads <= 1) {
+            for (size_t i = 0; i < count; i++)
+                query(i);
+            return;
+        }
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        const size_t chunk = (count + threads - 1) / threads;
+        for (unsigned t = 0; t < threads; t++) {
+            const size_t first = t * chunk;
+            const size_t last = std::min(count, first + chunk);
+            workers.emplace_back([first, last, &query] {
+                for (size_t i = first; i < last; i++)
+                    query(i);
+            });
+        }
+        for (auto& w : workers)
+            w.join();
+    }
+
+    template<typename coordinate_type, size_t dim>
+    std::vector<std::vector<typename KDTreeND<coordinate_type, dim>::Neighbour>>
+    KDTreeND<coordinate_type, dim>::kNearest(const std::vector<point_type>& queries, size_t k,
+                                             unsigned threads) const {
+        std::vector<std::vector<Neighbour>> results(queries.size());
+        forEachParallel(queries.size(), threads,
+                        [&](size_t i) { results[i] = kNearest(queries[i], k); });
+        return results;
+    }
+
+    template<typename coordinate_type, size_t dim>
+    std::vector<std::vector<typename KDTreeND<coordinate_type, dim>::Neighbour>>
+    KDTreeND<coordinate_type, dim>::radiusSearch(const std::vector<point_type>& queries,
+                                                 distance_type r, unsigned threads) const {
+        std::vector<std::vector<Neighbour>> results(queries.size());
+        forEachParallel(queries.size(), threads,
+                        [&](size_t i) { results[i] = radiusSearch(queries[i], r); });
+        return results;
+    }
+
+    template<typename coordinate_type, size_t dim>
+    template<typename Visitor>
+    void KDTreeND<coordinate_type, dim>::visitSplits(const point_type& lo, const point_type& hi,
+                                                     Visitor visit) const {
+        if (points.empty() || depth == 0)
+            return;
+        struct Cell {
+            size_t node;
+            point_type lo, hi;
+        };
+        std::vector<Cell> stack{ { 0, lo, hi } };
+        const size_t internal = splits.size();
+        while (!stack.empty()) {
+            Cell c = stack.back();
+            stack.pop_back();
+            const size_t axis = axes[c.node];
+            visit(axis, splits[c.node], c.lo, c.hi);
+            if (2 * c.node + 1 >= internal)
+                continue;
+            Cell left = c, right = c;
+            left.node = 2 * c.node + 1;
+            left.hi.coords[axis] = splits[c.node];
+            right.node = 2 * c.node + 2;
+            right.lo.coords[axis] = splits[c.node];
+            stack.push_back(right);
+            stack.push_back(left);
+        }
+    }
+} // namespace rez
+
+#endif //PHYSICSFORMULA_KDTREEND_H
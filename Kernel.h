@@ -0,0 +1,151 @@
+#ifndef PHYSICSFORMULA_KERNEL_H
+#define PHYSICSFORMULA_KERNEL_H
+#include <cfloat>
+#include <cmath>
+#include "Core.h"
+#include "Point.h"
+#include "GeoUtils.h"
+
+namespace rez
+{
+    // Geometric kernels, the predicates hull, triangulation, Voronoi and segment
+    // intersection code is templated on. Every kernel has
+    //   orientation2d(a, b, c)     +1 when c is left of [a b], -1 right, 0 collinear
+    //   inCircle(a, b, c, d)       +1 when d is inside the circle through the
+    //                              counter clockwise triangle [a b c], -1 outside
+    //   orientation3d(a, b, c, d)  +1 when d is on the side [a b c] appear counter
+    //                              clockwise from, -1 on the other side
+    // taking coordinates as doubles or as points.
+
+    // Plain double arithmetic, determinants within TOLERANCE of zero count as
+    // zero. The fastest, but near degenerate input can get answers that do not
+    // fit together, which is what makes incremental algorithms loop.
+    struct InexactKernel {
+        static constexpr bool exact = false;
+
+        static int sign(double _det) { return _det > TOLERANCE ? 1 : (_det < -TOLERANCE ? -1 : 0); }
+
+        static int orientation2d(double ax, double ay, double bx, double by, double cx, double cy)
+        {
+            return sign((ax - cx) * (by - cy) - (ay - cy) * (bx - cx));
+        }
+
+        static int inCircle(double ax, double ay, double bx, double by, double cx, double cy,
+                            double dx, double dy)
+        {
+            const double adx = ax - dx, ady = ay - dy;
+            const double bdx = bx - dx, bdy = by - dy;
+            const double cdx = cx - dx, cdy = cy - dy;
+            return sign((adx * adx + ady * ady) * (bdx * cdy - cdx * bdy)
+                        + (bdx * bdx + bdy * bdy) * (cdx * ady - adx * cdy)
+                        + (cdx * cdx + cdy * cdy) * (adx * bdy - bdx * ady));
+        }
+
+        static int orientation3d(double ax, double ay, double az, double bx, double by, double bz,
+                                 double cx, double cy, double cz, double dx, double dy, double dz)
+        {
+            const double adx = ax - dx, ady = ay - dy, adz = az - dz;
+            const double bdx = bx - dx, bdy = by - dy, bdz = bz - dz;
+            const double cdx = cx - dx, cdy = cy - dy, cdz = cz - dz;
+            return -sign(adz * (bdx * cdy - cdx * bdy) + bdz * (cdx * ady - adx * cdy)
+                         + cdz * (adx * bdy - bdx * ady));
+        }
+
+        static int orientation2d(const Point2d& a, const Point2d& b, const Point2d& c)
+        {
+            return orientation2d(a[X_], a[Y_], b[X_], b[Y_], c[X_], c[Y_]);
+        }
+
+        static int inCircle(const Point2d& a, const Point2d& b, const Point2d& c, const Point2d& d)
+        {
+            return inCircle(a[X_], a[Y_], b[X_], b[Y_], c[X_], c[Y_], d[X_], d[Y_]);
+        }
+
+        static int orientation3d(const Point3d& a, const Point3d& b, const Point3d& c, const Point3d& d)
+        {
+            return orientation3d(a[X_], a[Y_], a[Z_], b[X_], b[Y_], b[Z_], c[X_], c[Y_], c[Z_], d[X_], d[Y_], d[Z_]);
+        }
+    };
+
+    // Exact signs. The determinant is evaluated in doubles against Shewchuk's
+    // forward error bound inline, only the rare calls the filter cannot decide go
+    // to the expansion arithmetic of orientation2dExact and friends.
+    struct FilteredKernel {
+        static constexpr bool exact = true;
+
+        static int orientation2d(double ax, double ay, double bx, double by, double cx, double cy)
+        {
+            const double bound = (3.0 + 16.0 * (DBL_EPSILON / 2)) * (DBL_EPSILON / 2);
+            const double detleft = (ax - cx) * (by - cy);
+            const double detright = (ay - cy) * (bx - cx);
+            const double det = detleft - detright;
+            const double error = bound * (std::fabs(detleft) + std::fabs(detright));
+            if (det > error)
+                return 1;
+            if (-det > error)
+                return -1;
+            return orientation2dExact(ax, ay, bx, by, cx, cy);
+        }
+
+        static int inCircle(double ax, double ay, double bx, double by, double cx, double cy,
+                            double dx, double dy)
+        {
+            const double bound = (10.0 + 96.0 * (DBL_EPSILON / 2)) * (DBL_EPSILON / 2);
+            const double adx = ax - dx, ady = ay - dy;
+            const double bdx = bx - dx, bdy = by - dy;
+            const double cdx = cx - dx, cdy = cy - dy;
+            const double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+            const double cdxady = cdx * ady, adxcdy = adx * cdy;
+            const double adxbdy = adx * bdy, bdxady = bdx * ady;
+            const double alift = adx * adx + ady * ady;
+            const double blift = bdx * bdx + bdy * bdy;
+            const double clift = cdx * cdx + cdy * cdy;
+            const double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+            const double error = bound * ((std::fabs(bdxcdy) + std::fabs(cdxbdy)) * alift
+                                          + (std::fabs(cdxady) + std::fabs(adxcdy)) * blift
+                                          + (std::fabs(adxbdy) + std::fabs(bdxady)) * clift);
+            if (det > error)
+                return 1;
+            if (-det > error)
+                return -1;
+            return inCircleExact(ax, ay, bx, by, cx, cy, dx, dy);
+        }
+
+        static int orientation3d(double ax, double ay, double az, double bx, double by, double bz,
+                                 double cx, double cy, double cz, double dx, double dy, double dz)
+        {
+            const double bound = (7.0 + 56.0 * (DBL_EPSILON / 2)) * (DBL_EPSILON / 2);
+            const double adx = ax - dx, ady = ay - dy, adz = az - dz;
+            const double bdx = bx - dx, bdy = by - dy, bdz = bz - dz;
+            const double cdx = cx - dx, cdy = cy - dy, cdz = cz - dz;
+            const double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+            const double cdxady = cdx * ady, adxcdy = adx * cdy;
+            const double adxbdy = adx * bdy, bdxady = bdx * ady;
+            const double det = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+            const double error = bound * ((std::fabs(bdxcdy) + std::fabs(cdxbdy)) * std::fabs(adz)
+                                          + (std::fabs(cdxady) + std::fabs(adxcdy)) * std::fabs(bdz)
+                                          + (std::fabs(adxbdy) + std::fabs(bdxady)) * std::fabs(cdz));
+            if (det > error)
+                return -1;
+            if (-det > error)
+                return 1;
+            return orientation3dExact(ax, ay, az, bx, by, bz, cx, cy, cz, dx, dy, dz);
+        }
+
+        static int orientation2d(const Point2d& a, const Point2d& b, const Point2d& c)
+        {
+            return orientation2d(a[X_], a[Y_], b[X_], b[Y_], c[X_], c[Y_]);
+        }
+
+        static int inCircle(const Point2d& a, const Point2d& b, const Point2d& c, const Point2d& d)
+        {
+            return inCircle(a[X_], a[Y_], b[X_], b[Y_], c[X_], c[Y_], d[X_], d[Y_]);
+        }
+
+        static int orientation3d(const Point3d& a, const Point3d& b, const Point3d& c, const Point3d& d)
+        {
+            return orientation3d(a[X_], a[Y_], a[Z_], b[X_], b[Y_], b[Z_], c[X_], c[Y_], c[Z_], d[X_], d[Y_], d[Z_]);
+        }
+    };
+}
+#endif //PHYSICSFORMULA_KERNEL_H
@@ -6,16 +6,48 @@
 #define PHYSICSFORMULA_KIRSCHOFF_H
 #include <iostream>
 #include <cmath>
+#include <map>
 #include <utility>
 #include "MatrixND.h"
+#include "SparseMatrix.h"
 using namespace std;
 
 
+// how the sparse nodal system is solved, conductance matrices of resistor
+// networks are symmetric positive definite once a node is fixed, so CG is
+// the default, BiCGSTAB and the sparse LU are there for hard cases
+enum class KirschoffSolver {
+    CONJUGATE_GRADIENT,
+    BICGSTAB,
+    SPARSE_LU
+};
+
 class Kirschoff {
     MatrixND<long double> kirschoffMatrix;
     vector<long double> resistances;
     vector<long double> currents;
     vector<long double> voltages;
+
+    // sparse nodal analysis mode, a network of resistors between numbered
+    // nodes with current injections and nodes held at a fixed voltage
+    struct Branch {
+        int nodeA;
+        int nodeB;
+        long double resistance;
+    };
+    vector<Branch> branches;
+    vector<long double> injections;      // current flowing into each node
+    map<int, long double> fixedVoltages; // node -> volts, ground is 0 V
+    vector<long double> nodeVoltages;    // result of the last solve
+    int nodeCount = 0;
+
+    void touchNode(int node_) {
+        assert(node_ >= 0);
+        if (node_ >= nodeCount) {
+            nodeCount = node_ + 1;
+            injections.resize(nodeCount, 0.0L);
+        }
+    }
 public:
     Kirschoff() {
         kirschoffMatrix = MatrixND<long double>(0, 0);
@@ -47,6 +79,11 @@ public:
         resistances = kirschoff_.resistances;
         currents = kirschoff_.currents;
         voltages = kirschoff_.voltages;
+        branches = kirschoff_.branches;
+        injections = kirschoff_.injections;
+        fixedVoltages = kirschoff_.fixedVoltages;
+        nodeVoltages = kirschoff_.nodeVoltages;
+        nodeCount = kirschoff_.nodeCount;
     }
 
     Kirschoff(Kirschoff&& kirschoff_) {
@@ -54,6 +91,11 @@ public:
         resistances = std::move(kirschoff_.resistances);
         currents = std::move(kirschoff_.currents);
         voltages = std::move(kirschoff_.voltages);
+        branches = std::move(kirschoff_.branches);
+        injections = std::move(kirschoff_.injections);
+        fixedVoltages = std::move(kirschoff_.fixedVoltages);
+        nodeVoltages = std::move(kirschoff_.nodeVoltages);
+        nodeCount = kirschoff_.nodeCount;
     }
 
     Kirschoff& operator=(const Kirschoff& kirschoff_) {
@@ -62,6 +104,11 @@ public:
             resistances = kirschoff_.resistances;
             currents = kirschoff_.currents;
             voltages = kirschoff_.voltages;
+            branches = kirschoff_.branches;
+            injections = kirschoff_.injections;
+            fixedVoltages = kirschoff_.fixedVoltages;
+            nodeVoltages = kirschoff_.nodeVoltages;
+            nodeCount = kirschoff_.nodeCount;
         }
         return *this;
     }
@@ -72,6 +119,11 @@ public:
             resistances = std::move(kirschoff_.resistances);
             currents = std::move(kirschoff_.currents);
             voltages = std::move(kirschoff_.voltages);
+            branches = std::move(kirschoff_.branches);
+            injections = std::move(kirschoff_.injections);
+            fixedVoltages = std::move(kirschoff_.fixedVoltages);
+            nodeVoltages = std::move(kirschoff_.nodeVoltages);
+            nodeCount = kirschoff_.nodeCount;
         }
         return *this;
     }
@@ -150,9 +202,9 @@ public:
         for (int i = 0; i < resistances.size(); i++) {
             for (int j = 0; j < resistances.size(); j++) {
                 if (i == j) {
-                    kirschoffMatrix.set(i, j, resistances[i]);
+                    kirschoffMatrix.setAt(i, j, resistances[i]);
                 } else {
-                    kirschoffMatrix.set(i, j, 0);
+                    kirschoffMatrix.setAt(i, j, 0);
                 }
             }
         }
@@ -163,9 +215,9 @@ public:
         for (int i = 0; i < resistances_.size(); i++) {
             for (int j = 0; j < resistances_.size(); j++) {
                 if (i == j) {
-                    kirschoffMatrix.set(i, j, resistances_[i]);
+                    kirschoffMatrix.setAt(i, j, resistances_[i]);
                 } else {
-                    kirschoffMatrix.set(i, j, 0);
+                    kirschoffMatrix.setAt(i, j, 0);
                 }
             }
         }
@@ -176,14 +228,14 @@ public:
         for (int i = 0; i < resistances_.size(); i++) {
             for (int j = 0; j < resistances_.size(); j++) {
                 if (i == j) {
-                    kirschoffMatrix.set(i, j, resistances_[i]);
+                    kirschoffMatrix.setAt(i, j, resistances_[i]);
                 } else {
-                    kirschoffMatrix.set(i, j, 0);
+                    kirschoffMatrix.setAt(i, j, 0);
                 }
             }
         }
         for (int i = 0; i < currents_.size(); i++) {
-            kirschoffMatrix.set(i, i, -currents_[i]);
+            kirschoffMatrix.setAt(i, i, -currents_[i]);
         }
     }
 
@@ -192,17 +244,17 @@ public:
         for (int i = 0; i < resistances_.size(); i++) {
             for (int j = 0; j < resistances_.size(); j++) {
                 if (i == j) {
-                    kirschoffMatrix.set(i, j, resistances_[i]);
+                    kirschoffMatrix.setAt(i, j, resistances_[i]);
                 } else {
-                    kirschoffMatrix.set(i, j, 0);
+                    kirschoffMatrix.setAt(i, j, 0);
                 }
             }
         }
         for (int i = 0; i < currents_.size(); i++) {
-            kirschoffMatrix.set(i, i, -currents_[i]);
+            kirschoffMatrix.setAt(i, i, -currents_[i]);
         }
         for (int i = 0; i < voltages_.size(); i++) {
-            kirschoffMatrix.set(i, i, -voltages_[i]);
+            kirschoffMatrix.setAt(i, i, -voltages_[i]);
         }
     }
 
@@ -214,6 +266,147 @@ public:
         return voltage;
     }
 
+    /**
+     * @brief adds a resistor between two nodes of the sparse network
+     * @param nodeA_ first node number
+     * @param nodeB_ second node number
+     * @param resistance_ resistance in ohms, must be positive
+     * @return index of the branch, used with branchCurrent()
+     */
+    int addBranch(int nodeA_, int nodeB_, long double resistance_) {
+        assert(resistance_ > 0);
+        touchNode(nodeA_);
+        touchNode(nodeB_);
+        branches.push_back({ nodeA_, nodeB_, resistance_ });
+        return static_cast<int>(branches.size()) - 1;
+    }
+
+    /**
+     * @brief injects a current into a node, negative values draw current out
+     * @param node_ node number
+     * @param amps_ current in amperes
+     */
+    void addCurrentSource(int node_, long double amps_) {
+        touchNode(node_);
+        injections[node_] += amps_;
+    }
+
+    /**
+     * @brief holds a node at a fixed potential, e.g. a battery terminal
+     * @param node_ node number
+     * @param volts_ potential in volts
+     */
+    void fixNodeVoltage(int node_, long double volts_) {
+        touchNode(node_);
+        fixedVoltages[node_] = volts_;
+    }
+
+    void setGround(int node_) {
+        fixNodeVoltage(node_, 0.0L);
+    }
+
+    [[nodiscard]] int getNodeCount() const {
+        return nodeCount;
+    }
+
+    [[nodiscard]] size_t getBranchCount() const {
+        return branches.size();
+    }
+
+    /**
+     * @brief assembles the nodal conductance matrix G v = i of the free
+     * nodes directly in sparse form, fixed nodes move to the right hand side
+     * @param unknown_ filled with the row of each node, -1 for fixed nodes
+     * @param rhs_ filled with the right hand side
+     * @return sparse conductance matrix
+     */
+    rez::SparseMatrix<long double> buildConductanceMatrix(vector<int>& unknown_,
+                                                          vector<long double>& rhs_) const {
+        unknown_.assign(nodeCount, -1);
+        int n = 0;
+        for (int i = 0; i < nodeCount; i++)
+            if (fixedVoltages.find(i) == fixedVoltages.end())
+                unknown_[i] = n++;
+        rhs_.assign(n, 0.0L);
+        for (int i = 0; i < nodeCount; i++)
+            if (unknown_[i] >= 0)
+                rhs_[unknown_[i]] += injections[i];
+
+        vector<rez::Triplet<long double>> stamps;
+        stamps.reserve(branches.size() * 4);
+        for (const Branch& b : branches) {
+            const long double g = 1.0L / b.resistance;
+            const int ra = unknown_[b.nodeA];
+            const int rb = unknown_[b.nodeB];
+            if (ra >= 0) {
+                stamps.push_back({ ra, ra, g });
+                if (rb >= 0)
+                    stamps.push_back({ ra, rb, -g });
+                else
+                    rhs_[ra] += g * fixedVoltages.at(b.nodeB);
+            }
+            if (rb >= 0) {
+                stamps.push_back({ rb, rb, g });
+                if (ra >= 0)
+                    stamps.push_back({ rb, ra, -g });
+                else
+                    rhs_[rb] += g * fixedVoltages.at(b.nodeA);
+            }
+        }
+        return rez::SparseMatrix<long double>(n, n, std::move(stamps));
+    }
+
+    /**
+     * @brief solves the network for every node potential using the sparse
+     * conductance matrix, at least one node has to be fixed (grounded)
+     * @param solver_ which sparse solver to use
+     * @param tolerance_ relative residual for the iterative solvers
+     * @return node voltages indexed by node number
+     */
+    vector<long double> solveNodeVoltages(
+            KirschoffSolver solver_ = KirschoffSolver::CONJUGATE_GRADIENT,
+            long double tolerance_ = 1e-12L) {
+        if (fixedVoltages.empty()) {
+            cout << "Network needs a ground or fixed voltage node" << endl;
+            return {};
+        }
+        vector<int> unknown;
+        vector<long double> rhs;
+        const rez::SparseMatrix<long double> G = buildConductanceMatrix(unknown, rhs);
+
+        vector<long double> x(rhs.size(), 0.0L);
+        if (solver_ == KirschoffSolver::SPARSE_LU) {
+            rez::SparseLU<long double> lu(G);
+            if (lu.isSingular())
+                cout << "Network has floating nodes, conductance matrix is singular" << endl;
+            x = lu.solve(rhs);
+        } else {
+            rez::IterativeResult<long double> status =
+                    solver_ == KirschoffSolver::BICGSTAB
+                    ? rez::biCGSTAB(G, rhs, x, tolerance_)
+                    : rez::conjugateGradient(G, rhs, x, tolerance_);
+            if (!status.converged)
+                cout << "Sparse solve stopped after " << status.iterations
+                     << " iterations, residual " << status.residual << endl;
+        }
+
+        nodeVoltages.assign(nodeCount, 0.0L);
+        for (int i = 0; i < nodeCount; i++)
+            nodeVoltages[i] = unknown[i] >= 0 ? x[unknown[i]] : fixedVoltages.at(i);
+        return nodeVoltages;
+    }
+
+    /**
+     * @brief current through a branch from nodeA to nodeB after a solve
+     * @param branch_ index returned by addBranch
+     * @return current in amperes
+     */
+    [[nodiscard]] long double branchCurrent(int branch_) const {
+        assert(!nodeVoltages.empty());
+        const Branch& b = branches[branch_];
+        return (nodeVoltages[b.nodeA] - nodeVoltages[b.nodeB]) / b.resistance;
+    }
+
 
 };
 
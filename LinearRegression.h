@@ -8,6 +8,7 @@
 //Ω=234,δ=235,∞=236,φ=237,ε=238,∩=239,≡=240,Γ=226,γ, σ, ϑ, Å, Ώ, λ, γ
 #include <iostream>
 #include "ETL.h"
+#include "ModelTrainer.h"
 /**
  * @class LinearRegression
  * @details
@@ -17,6 +18,7 @@
  template <typename T>
 class LinearRegression
 {
+    using R = rez::decomposition_scalar<T>;
 
 public:
     LinearRegression()
@@ -29,60 +31,98 @@ public:
     /// <param name="y">The y.</param>
     /// <param name="theta">The theta.</param>
     /// <returns></returns>
-    float OLS_Cost(MatrixND<T> X, MatrixND<T> y, MatrixND<T> theta)const;
-    std::tuple<VectorND<T>,std::vector<float>>
-    GradientDescent(MatrixND<T> X, MatrixND<T> y,
-                    VectorND<T> theta, float alpha, int iters)const;
-    float RSquared(MatrixND<T> y, MatrixND<T> y_hat)const;
+    float OLS_Cost(const MatrixND<T>& X, const MatrixND<T>& y, const MatrixND<T>& theta)const;
+
+    /// <summary>
+    /// Batch gradient descent on the OLS cost, X carries its own bias column
+    /// </summary>
+    /// <returns>theta and the cost before the first and after every iteration</returns>
+    std::tuple<MatrixND<T>,std::vector<float>>
+    GradientDescent(const MatrixND<T>& X, const MatrixND<T>& y,
+                    const MatrixND<T>& theta, float alpha, int iters)const;
+
+    /// <summary>
+    /// Closed form OLS theta, (X^T X + lambda I) theta = X^T y
+    /// </summary>
+    MatrixND<T> NormalEquation(const MatrixND<T>& X, const MatrixND<T>& y, double lambda = 0.0)const;
+
+    /// <summary>
+    /// Mini-batch SGD, momentum, Adam or L-BFGS with an intercept, see ModelTrainer.h
+    /// </summary>
+    rez::TrainingResult<R> Train(const MatrixND<T>& X, const MatrixND<T>& y,
+                                 const rez::TrainingOptions& options)const;
+
+    float RSquared(const MatrixND<T>& y, const MatrixND<T>& y_hat)const;
 };
 
-#endif //LinearRegression_h
 template <typename T>
-inline float LinearRegression<T>::OLS_Cost(MatrixND<T> X, MatrixND<T> y, MatrixND<T> theta)const
+inline float LinearRegression<T>::OLS_Cost(const MatrixND<T>& X, const MatrixND<T>& y, const MatrixND<T>& theta)const
 {
-
-    MatrixND<T> inner = pow(((X*theta)-y).array(),2);
-
-    return static_cast<float>( inner.sum()/(2*X.rows()));
+    rez::LinearModelTrainer<T> trainer(X, y, rez::TrainingLoss::Squared);
+    std::vector<R> params(theta.data.begin(), theta.data.end());
+    params.push_back(R(0));
+    std::vector<R> gradient(params.size());
+    return static_cast<float>(trainer.evaluate(params.data(), 0, X.rows, 0.0, gradient.data()));
 }
 template <typename T>
-inline std::tuple<VectorND<T>,std::vector<float>>
-LinearRegression<T>::GradientDescent(MatrixND<T> X, MatrixND<T> y,
-                                  VectorND<T> theta, float alpha, int iters)const
+inline std::tuple<MatrixND<T>,std::vector<float>>
+LinearRegression<T>::GradientDescent(const MatrixND<T>& X, const MatrixND<T>& y,
+                                  const MatrixND<T>& theta, float alpha, int iters)const
 {
+    rez::LinearModelTrainer<T> trainer(X, y, rez::TrainingLoss::Squared);
+    rez::TrainingOptions options;
+    options.optimizer = rez::TrainingOptimizer::SGD;
+    options.epochs = iters;
+    options.learningRate = alpha;
+    options.fitIntercept = false;
+    options.shuffle = false;
+    const auto result = trainer.fit(options, std::vector<R>(theta.data.begin(), theta.data.end()));
 
-    MatrixND<T> temp = theta;
-
-    const int parameters = static_cast<int>( theta.rows());
-
-    std::vector<float> cost;
-    cost.push_back(OLS_Cost(X,y,theta));
+    // the trainer reports the cost before every step, add the one after the last
+    std::vector<float> cost(result.loss.begin(), result.loss.end());
+    std::vector<R> params(result.weights);
+    params.push_back(R(0));
+    std::vector<R> gradient(params.size());
+    cost.push_back(static_cast<float>(trainer.evaluate(params.data(), 0, X.rows, 0.0, gradient.data())));
 
-    for(int i=0; i<iters; ++i){
-        MatrixND<T> error = X*theta - y;
-        for(int j=0; j<parameters; ++j){
-            MatrixND<T> X_i = X.col(j);
-            MatrixND<T> term = error.cwiseProduct(X_i);
-            temp(j,0) = theta(j,0) - ((alpha/X.rows())*term.sum());
-        }
-        theta = temp;
-        cost.push_back(OLS_Cost(X,y,theta));
-    }
-
-    return std::make_tuple(theta,cost);
+    MatrixND<T> fitted(theta.rows, theta.cols);
+    for (size_t j = 0; j < result.weights.size(); j++)
+        fitted.data[j] = rez::fromDecompositionScalar<T>(result.weights[j]);
+    return std::make_tuple(fitted,cost);
 }
 template <typename T>
-inline float LinearRegression<T>::RSquared(MatrixND<T> y, MatrixND<T> y_hat)const
+inline MatrixND<T> LinearRegression<T>::NormalEquation(const MatrixND<T>& X, const MatrixND<T>& y, double lambda)const
 {
-    std::cout << "in Rsq - y:" << y << std::endl;
-    std::cout << "in Rsq - yhat: " << y_hat << std::endl;
-    auto num = pow((y-y_hat).array(),2).sum();
-    std::cout << "in Rsq num: " << num << std::endl;
-    auto den = pow(y.array()-y.mean(),2).sum();
-    std::cout << "in Rsq den: " << den << std::endl;
-    return static_cast<float>( 1 - num/den);
+    const auto result = rez::solveNormalEquation(X, y, lambda, false);
+    MatrixND<T> theta(X.cols, 1);
+    for (int j = 0; j < X.cols; j++)
+        theta.data[j] = rez::fromDecompositionScalar<T>(result.weights[j]);
+    return theta;
 }
+template <typename T>
+inline rez::TrainingResult<typename LinearRegression<T>::R>
+LinearRegression<T>::Train(const MatrixND<T>& X, const MatrixND<T>& y, const rez::TrainingOptions& options)const
+{
+    rez::LinearModelTrainer<T> trainer(X, y, rez::TrainingLoss::Squared);
+    return trainer.fit(options);
+}
+template <typename T>
+inline float LinearRegression<T>::RSquared(const MatrixND<T>& y, const MatrixND<T>& y_hat)const
+{
+    const size_t m = y.data.size();
+    double mean = 0.0;
+    for (size_t i = 0; i < m; i++)
+        mean += static_cast<double>(y.data[i]);
+    mean /= static_cast<double>(m);
 
+    double num = 0.0, den = 0.0;
+    for (size_t i = 0; i < m; i++) {
+        const double residual = static_cast<double>(y.data[i]) - static_cast<double>(y_hat.data[i]);
+        const double spread = static_cast<double>(y.data[i]) - mean;
+        num += residual * residual;
+        den += spread * spread;
+    }
+    return static_cast<float>( 1 - num/den);
+}
 
-
-
+#endif //PHYSICSFORMULA_LINEARREGRESSION_H
@@ -6,114 +6,118 @@
 #define PHYSICSFORMULA_LOGISTICREGRESSION_H
 
 #include "LinearRegression.h"
+#include "ModelTrainer.h"
 #include <list>
 #include <iostream>
     template<typename T>
     class LogisticRegression {
+        using R = rez::decomposition_scalar<T>;
+
     public:
         LogisticRegression() {}
 
-        static MatrixND<T> Sigmoid(MatrixND<T> Z);
+        static MatrixND<T> Sigmoid(const MatrixND<T>& Z);
 
+        // gradient dw (1 x features), db and the cross entropy cost of W, b
         static std::tuple<MatrixND<T>, double, double>
-        Propagate(MatrixND<T> W, double b, MatrixND<T> X,
-                  MatrixND<T> y, double lambda);
+        Propagate(const MatrixND<T>& W, double b, const MatrixND<T>& X,
+                  const MatrixND<T>& y, double lambda);
 
+        // batch gradient descent, the cost of every 100th iteration is kept
+        // and printed when log_cost
         static std::tuple<MatrixND<T>, double, MatrixND<T>, double, std::list<double>>
-        Optimize(MatrixND<T> W, double b, MatrixND<T> X,
-                 MatrixND<T> y, int num_iter, double learning_rate,
+        Optimize(const MatrixND<T>& W, double b, const MatrixND<T>& X,
+                 const MatrixND<T>& y, int num_iter, double learning_rate,
                  double lambda, bool log_cost);
 
+        // mini-batch SGD, momentum, Adam or L-BFGS, see ModelTrainer.h
+        static rez::TrainingResult<R>
+        Train(const MatrixND<T>& X, const MatrixND<T>& y, const rez::TrainingOptions& options);
+
         MatrixND<T>
-        Predict(MatrixND<T> W, double b, MatrixND<T> X) const;
+        Predict(const MatrixND<T>& W, double b, const MatrixND<T>& X) const;
     };
 
-#endif //PHYSICSFORMULA_LOGISTICREGRESSION_H
     template<typename T>
-    inline MatrixND<T> LogisticRegression<T>::Sigmoid(MatrixND<T> Z) {
+    inline MatrixND<T> LogisticRegression<T>::Sigmoid(const MatrixND<T>& Z) {
         return 1 / (1 + (-Z.array()).exp());
     }
     template<typename T>
     inline std::tuple<MatrixND<T>, double, double>
-    LogisticRegression<T>::Propagate(MatrixND<T> W, double b,
-                                  MatrixND<T> X,
-                                  MatrixND<T> y, double lambda) {
-        const int m = static_cast<int>( y.rows());
-
-
-        MatrixND<T> Z = (W.transpose() * X.transpose()).array() + b;
-        MatrixND<T> A = 1 / (1 + (-Z.array()).exp());//Sigmoid(Z_);
-        auto ce_var1 =
-                y.transpose() * (MatrixND<T>) A.array().log().transpose();
-        auto ce_var2 = ((MatrixND<T>)(1 - y.array())).transpose();
-        auto ce_var3 = (MatrixND<T>)(1 - A.array()).log().transpose();
-
-        auto cross_entropy =
-                -(ce_var1 + ce_var2 * ce_var3) / m;
-        double l2_reg_cost = W.array().pow(2).sum() * (lambda / (2.0 * m));
-        std::cout << "in Propagate(l2 reg cost) = W.array.pow.sum*lamda/2*m: "
-                  << l2_reg_cost << endl;
-
-        double cost = static_cast<const double>((cross_entropy.array()[0])) +
-                      l2_reg_cost;
-        std::cout << "in Propagate(cost) = cross_entrtopy.array[0]+l2regCost: "
-                  << cost << endl;
-        MatrixND<T> dw =
-                (MatrixND<T>)(
-                        ((MatrixND<T>)(A - y.transpose()) * X) / m) +
-                ((MatrixND<T>)(lambda / m * W)).transpose();
-        double db = (A - y.transpose()).array().sum() / m;
+    LogisticRegression<T>::Propagate(const MatrixND<T>& W, double b,
+                                  const MatrixND<T>& X,
+                                  const MatrixND<T>& y, double lambda) {
+        rez::LinearModelTrainer<T> trainer(X, y, rez::TrainingLoss::Logistic);
+        std::vector<R> params(W.data.begin(), W.data.end());
+        params.push_back(static_cast<R>(b));
+        std::vector<R> gradient(params.size());
+        const double cost = trainer.evaluate(params.data(), 0, X.rows, lambda, gradient.data());
+
+        MatrixND<T> dw(1, X.cols);
+        for (int j = 0; j < X.cols; j++)
+            dw.data[j] = rez::fromDecompositionScalar<T>(gradient[j]);
+        const double db = static_cast<double>(gradient[X.cols]);
         return std::make_tuple(dw, db, cost);
     }
     template <typename T>
     inline std::tuple<MatrixND<T>, double, MatrixND<T>, double, std::list<double>>
-    LogisticRegression<T>::Optimize(MatrixND<T> W, double b,
-                                    MatrixND<T> X, MatrixND<T> y,
+    LogisticRegression<T>::Optimize(const MatrixND<T>& W, double b,
+                                    const MatrixND<T>& X, const MatrixND<T>& y,
                                  int num_iter,
                                  double learning_rate, double lambda,
                                  bool log_cost) {
         std::list<double> costsList;
-        MatrixND<T> dw;
-        double db = 0.0, cost = 0.0;
-
-        for (int i = 0; i < num_iter; i++) {
-            std::cout << "in Optimize(for prop loop, lambda): " << lambda
-                      << endl;
-            std::tuple<MatrixND<T>, double, double> propagate =
-                    Propagate(W, b, X, y, lambda);
-            std::tie(dw, db, cost) = propagate;
-
-            W = W - (learning_rate * dw).transpose();
-            b = b - (learning_rate * db);
+        rez::TrainingOptions options;
+        options.optimizer = rez::TrainingOptimizer::SGD;
+        options.epochs = num_iter;
+        options.learningRate = learning_rate;
+        options.lambda = lambda;
+        options.shuffle = false;
+        options.log = [&](int i, double cost) {
             if (i % 100 == 0) {
                 costsList.push_back(cost);
+                if (log_cost)
+                    std::cout << "Cost after iteration " << i << ": " << cost
+                              << std::endl;
             }
-
-            if (log_cost && i % 100 == 0) {
-                std::cout << "Cost after iteration " << i << ": " << cost
-                          << std::endl;
-            }
+        };
+
+        rez::LinearModelTrainer<T> trainer(X, y, rez::TrainingLoss::Logistic);
+        const auto result = trainer.fit(options, std::vector<R>(W.data.begin(), W.data.end()),
+                                        static_cast<R>(b));
+
+        MatrixND<T> fitted(W.rows, W.cols);
+        MatrixND<T> dw(1, X.cols);
+        const auto& gradient = trainer.gradient();
+        for (int j = 0; j < X.cols; j++) {
+            fitted.data[j] = rez::fromDecompositionScalar<T>(result.weights[j]);
+            dw.data[j] = rez::fromDecompositionScalar<T>(gradient[j]);
         }
-
-        return std::make_tuple(W, b, dw, db, costsList);
+        return std::make_tuple(fitted, static_cast<double>(result.bias), dw,
+                               static_cast<double>(gradient[X.cols]), costsList);
+    }
+    template <typename T>
+    inline rez::TrainingResult<typename LogisticRegression<T>::R>
+    LogisticRegression<T>::Train(const MatrixND<T>& X, const MatrixND<T>& y,
+                                 const rez::TrainingOptions& options) {
+        rez::LinearModelTrainer<T> trainer(X, y, rez::TrainingLoss::Logistic);
+        return trainer.fit(options);
     }
     template <typename T>
     inline MatrixND<T>
-    LogisticRegression<T>::Predict(MatrixND<T> W, double b,
-                                   MatrixND<T> X) const {
-        const int m = static_cast<int>( X.rows());
-        MatrixND<T> y_pred = MatrixND<T>::Zero(m).transpose();
-
-        MatrixND<T> Z = (W.transpose() * X.transpose()).array() + b;
-        MatrixND<T> A = 1 / (1 + (-Z.array()).exp());//Sigmoid(Z_);
-
-        for (int i = 0; i < A.cols(); i++) {
-            if (A(0, i) <= 0.5) {
-                y_pred(0, i) = 0;
-            } else {
-                y_pred(0, i) = 1;
-            }
+    LogisticRegression<T>::Predict(const MatrixND<T>& W, double b,
+                                   const MatrixND<T>& X) const {
+        const int m = X.rows;
+        MatrixND<T> y_pred(m, 1);
+        std::vector<R> w(W.data.begin(), W.data.end());
+
+        // sigmoid(z) > 0.5 exactly when z > 0
+        for (int i = 0; i < m; i++) {
+            const T* x = X.data.data() + static_cast<size_t>(i) * X.cols;
+            const R z = static_cast<R>(b) + rez::trainer_detail::dot(x, w.data(), X.cols);
+            y_pred(i, 0) = z > R(0) ? T(1) : T(0);
         }
-        return y_pred.transpose();
+        return y_pred;
     }
 
+#endif //PHYSICSFORMULA_LOGISTICREGRESSION_H
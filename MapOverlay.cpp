@@ -0,0 +1,557 @@
+#include "MapOverlay.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <set>
+#include <unordered_map>
+#include "GeoUtils.h"
+#include "SegmentIntersection.h"
+#include "ThreadPool.h"
+
+using namespace rez;
+
+namespace {
+    const uint32_t NONE = MapOverlay::NONE;
+
+    // Faces on both sides of an input edge, NONE for the input it does not come from
+    struct SourceEdge {
+        uint32_t left_a, right_a, left_b, right_b;
+    };
+
+    uint64_t pointKey(const Point2d& _p)
+    {
+        // adding 0 turns -0 into 0 so both give the same vertex
+        const float x = _p.coords[X_] + 0.0f, y = _p.coords[Y_] + 0.0f;
+        uint32_t bx, by;
+        std::memcpy(&bx, &x, sizeof(bx));
+        std::memcpy(&by, &y, sizeof(by));
+        return (uint64_t(bx) << 32) | by;
+    }
+
+    // Appends every edge of _polygon once with the faces on its two sides, the
+    // faces are numbered in the order of getFaceList
+    void collectEdges(Polygon2d& _polygon, bool _second, std::vector<Segment2d>& _segments,
+                      std::vector<SourceEdge>& _sources, std::vector<char>& _bounded, uint32_t& _unbounded)
+    {
+        const auto faces = _polygon.getFaceList();
+        std::unordered_map<const FaceDCEL<float, DIM2>*, uint32_t> index;
+        index.reserve(faces.size());
+        _bounded.resize(faces.size());
+        for (size_t i = 0; i < faces.size(); i++) {
+            index[faces[i]] = static_cast<uint32_t>(i);
+            _bounded[i] = faces[i]->outer != nullptr;
+            if (!faces[i]->outer && _unbounded == NONE)
+                _unbounded = static_cast<uint32_t>(i);
+        }
+        auto faceIndex = [&](const FaceDCEL<float, DIM2>* _face) {
+            auto found = index.find(_face);
+            return found == index.end() ? NONE : found->second;
+        };
+
+        for (auto* edge : _polygon.getEdgeList()) {
+            if (!edge->twin || !std::less<const Edge2dDCEL*>()(edge, edge->twin))
+                continue;
+            Point2d p1 = edge->origin->point;
+            Point2d p2 = edge->twin->origin->point;
+            if (p1 == p2)
+                continue;
+            _segments.emplace_back(p1, p2);
+            SourceEdge source{ NONE, NONE, NONE, NONE };
+            (_second ? source.left_b : source.left_a) = faceIndex(edge->incident_face);
+            (_second ? source.right_b : source.right_a) = faceIndex(edge->twin->incident_face);
+            _sources.push_back(source);
+        }
+    }
+
+    // Bottom to top order of non crossing edges where they overlap in x, each edge
+    // given by its half edge running left to right. A point compares with the
+    // edges by the side of their line it lies on.
+    struct BelowOrder {
+        using is_transparent = void;
+        const std::vector<Point2d>* points;
+        const std::vector<uint32_t>* origin;
+
+        const Point2d& left(uint32_t _e) const { return (*points)[(*origin)[_e]]; }
+
+        const Point2d& right(uint32_t _e) const { return (*points)[(*origin)[_e ^ 1]]; }
+
+        bool operator()(uint32_t _e, uint32_t _f) const
+        {
+            if (_e == _f)
+                return false;
+            if (left(_e).coords[X_] >= left(_f).coords[X_]) {
+                int side = orientation2dExact(left(_f), right(_f), left(_e));
+                if (side == 0)
+                    side = orientation2dExact(left(_f), right(_f), right(_e));
+                return side != 0 ? side < 0 : _e < _f;
+            }
+            int side = orientation2dExact(left(_e), right(_e), left(_f));
+            if (side == 0)
+                side = orientation2dExact(left(_e), right(_e), right(_f));
+            return side != 0 ? side > 0 : _e < _f;
+        }
+
+        bool operator()(uint32_t _e, const Point2d& _p) const { return orientation2dExact(left(_e), right(_e), _p) > 0; }
+
+        bool operator()(const Point2d& _p, uint32_t _e) const { return orientation2dExact(left(_e), right(_e), _p) < 0; }
+    };
+}
+
+rez::MapOverlay::MapOverlay(Polygon2d& _a, Polygon2d& _b)
+{
+    compute(_a, _b);
+}
+
+void rez::MapOverlay::clear()
+{
+    points.clear();
+    origin.clear();
+    next.clear();
+    left_a.clear();
+    left_b.clear();
+    cycle_of.clear();
+    cycle_edge.clear();
+    cycle_face.clear();
+    face_start.clear();
+    face_cycles.clear();
+    face_a.clear();
+    face_b.clear();
+    bounded_a.clear();
+    bounded_b.clear();
+    unbounded_a = unbounded_b = NONE;
+}
+
+bool rez::MapOverlay::compute(Polygon2d& _a, Polygon2d& _b)
+{
+    clear();
+    if (_a.getFaceList().empty() || _b.getFaceList().empty())
+        return false;
+
+    std::vector<Segment2d> segments;
+    std::vector<SourceEdge> sources;
+    collectEdges(_a, false, segments, sources, bounded_a, unbounded_a);
+    collectEdges(_b, true, segments, sources, bounded_b, unbounded_b);
+
+    std::vector<SegmentIntersection2d> hits;
+    intersect_segments(segments, hits);
+
+    std::unordered_map<uint64_t, uint32_t> vertex_of;
+    vertex_of.reserve(2 * segments.size() + hits.size());
+    auto vertex = [&](const Point2d& _p) {
+        auto added = vertex_of.emplace(pointKey(_p), static_cast<uint32_t>(points.size()));
+        if (added.second)
+            points.push_back(_p);
+        return added.first->second;
+    };
+
+    // the vertices on every segment, its end points included
+    std::vector<std::pair<uint32_t, uint32_t>> on;
+    on.reserve(2 * segments.size() + 2 * hits.size());
+    for (uint32_t s = 0; s < segments.size(); s++) {
+        on.emplace_back(s, vertex(segments[s].p1));
+        on.emplace_back(s, vertex(segments[s].p2));
+    }
+    for (const auto& hit : hits) {
+        const uint32_t v = vertex(hit.point);
+        for (uint32_t s : hit.segments)
+            on.emplace_back(s, v);
+    }
+    std::sort(on.begin(), on.end());
+
+    // cut the segments at their vertices, pieces shared by both inputs are merged
+    std::unordered_map<uint64_t, uint32_t> edge_of;
+    edge_of.reserve(on.size());
+    std::vector<uint32_t> chain;
+    for (size_t i = 0; i < on.size();) {
+        const uint32_t s = on[i].first;
+        chain.clear();
+        for (; i < on.size() && on[i].first == s; i++)
+            if (chain.empty() || chain.back() != on[i].second)
+                chain.push_back(on[i].second);
+
+        const double x1 = segments[s].p1.coords[X_], y1 = segments[s].p1.coords[Y_];
+        const double dx = segments[s].p2.coords[X_] - x1, dy = segments[s].p2.coords[Y_] - y1;
+        auto along = [&](uint32_t _v) {
+            return (points[_v].coords[X_] - x1) * dx + (points[_v].coords[Y_] - y1) * dy;
+        };
+        std::sort(chain.begin(), chain.end(), [&](uint32_t _u, uint32_t _v) { return along(_u) < along(_v); });
+
+        const SourceEdge& source = sources[s];
+        for (size_t k = 0; k + 1 < chain.size(); k++) {
+            const uint32_t u = chain[k], v = chain[k + 1];
+            const uint64_t key = (uint64_t(std::min(u, v)) << 32) | std::max(u, v);
+            auto added = edge_of.emplace(key, static_cast<uint32_t>(origin.size()));
+            if (added.second) {
+                origin.push_back(u);
+                origin.push_back(v);
+                left_a.insert(left_a.end(), 2, NONE);
+                left_b.insert(left_b.end(), 2, NONE);
+            }
+            // the half edge running from u to v
+            const uint32_t e = origin[added.first->second] == u ? added.first->second : added.first->second ^ 1;
+            if (source.left_a != NONE || source.right_a != NONE) {
+                left_a[e] = source.left_a;
+                left_a[e ^ 1] = source.right_a;
+            }
+            if (source.left_b != NONE || source.right_b != NONE) {
+                left_b[e] = source.left_b;
+                left_b[e ^ 1] = source.right_b;
+            }
+        }
+    }
+
+    build();
+    return true;
+}
+
+void rez::MapOverlay::build()
+{
+    std::vector<char> outer;
+    std::vector<uint32_t> lowest;
+    link();
+    traceCycles(outer, lowest);
+    locateHoles(outer, lowest);
+    labelFaces();
+}
+
+void rez::MapOverlay::link()
+{
+    const auto half_edges = static_cast<uint32_t>(origin.size());
+
+    // the half edges leaving every vertex, counter clockwise from the positive x axis
+    std::vector<uint32_t> start(points.size() + 1, 0), around(half_edges), position(half_edges);
+    for (uint32_t e = 0; e < half_edges; e++)
+        start[origin[e] + 1]++;
+    for (size_t v = 0; v < points.size(); v++)
+        start[v + 1] += start[v];
+    std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+    for (uint32_t e = 0; e < half_edges; e++)
+        around[fill[origin[e]]++] = e;
+
+    auto counterClockwise = [this](uint32_t _e, uint32_t _f) {
+        const Point2d& o = points[origin[_e]];
+        const Point2d& a = points[origin[_e ^ 1]];
+        const Point2d& b = points[origin[_f ^ 1]];
+        const double ax = double(a.coords[X_]) - o.coords[X_], ay = double(a.coords[Y_]) - o.coords[Y_];
+        const double bx = double(b.coords[X_]) - o.coords[X_], by = double(b.coords[Y_]) - o.coords[Y_];
+        const bool lower_a = ay < 0 || (ay == 0 && ax < 0);
+        const bool lower_b = by < 0 || (by == 0 && bx < 0);
+        if (lower_a != lower_b)
+            return lower_b;
+        const int turn = orientation2dExact(o, a, b);
+        if (turn != 0)
+            return turn > 0;
+        return _e < _f;
+    };
+    for (size_t v = 0; v < points.size(); v++)
+        std::sort(around.begin() + start[v], around.begin() + start[v + 1], counterClockwise);
+    for (uint32_t i = 0; i < half_edges; i++)
+        position[around[i]] = i;
+
+    // the face left of e continues with the edge leaving its end point right
+    // after its twin, going clockwise
+    next.resize(half_edges);
+    for (uint32_t e = 0; e < half_edges; e++) {
+        const uint32_t t = e ^ 1, v = origin[t], i = position[t];
+        next[e] = around[i == start[v] ? start[v + 1] - 1 : i - 1];
+    }
+}
+
+void rez::MapOverlay::traceCycles(std::vector<char>& _outer, std::vector<uint32_t>& _lowest)
+{
+    const auto half_edges = static_cast<uint32_t>(origin.size());
+    cycle_of.assign(half_edges, NONE);
+    cycle_edge.clear();
+    _outer.clear();
+    _lowest.clear();
+
+    for (uint32_t first = 0; first < half_edges; first++) {
+        if (cycle_of[first] != NONE)
+            continue;
+        const auto cycle = static_cast<uint32_t>(cycle_edge.size());
+        cycle_edge.push_back(first);
+
+        // signed area relative to the first vertex, the left most lowest vertex
+        // is where the sweep looks for the face around a hole
+        const double x0 = points[origin[first]].coords[X_], y0 = points[origin[first]].coords[Y_];
+        double area = 0;
+        uint32_t lowest = origin[first];
+        uint32_t e = first;
+        do {
+            cycle_of[e] = cycle;
+            const Point2d& p = points[origin[e]];
+            const Point2d& q = points[origin[e ^ 1]];
+            area += (p.coords[X_] - x0) * (q.coords[Y_] - y0) - (q.coords[X_] - x0) * (p.coords[Y_] - y0);
+            const Point2d& l = points[lowest];
+            if (p.coords[X_] < l.coords[X_] || (p.coords[X_] == l.coords[X_] && p.coords[Y_] < l.coords[Y_]))
+                lowest = origin[e];
+            e = next[e];
+        } while (e != first);
+        _outer.push_back(area > 0);
+        _lowest.push_back(lowest);
+    }
+}
+
+void rez::MapOverlay::locateHoles(const std::vector<char>& _outer, const std::vector<uint32_t>& _lowest)
+{
+    const auto cycles = static_cast<uint32_t>(cycle_edge.size());
+    cycle_face.assign(cycles, NONE);
+    uint32_t faces = 0;
+    for (uint32_t c = 0; c < cycles; c++)
+        if (_outer[c])
+            cycle_face[c] = faces++;
+    const uint32_t unbounded = faces++;
+
+    // A clockwise cycle is a hole in the face around it, or part of the outside.
+    // That face lies above the edge right below the left most vertex of the
+    // hole, found by a sweep over x with the edges ordered bottom to top.
+    auto x = [this](uint32_t _v) { return points[_v].coords[X_]; };
+    std::vector<uint32_t> rightward, by_right, holes;
+    for (uint32_t e = 0; e < origin.size(); e += 2) {
+        if (x(origin[e]) == x(origin[e + 1]))
+            continue;
+        rightward.push_back(x(origin[e]) < x(origin[e + 1]) ? e : e + 1);
+    }
+    by_right = rightward;
+    std::sort(rightward.begin(), rightward.end(),
+              [&](uint32_t _e, uint32_t _f) { return x(origin[_e]) < x(origin[_f]); });
+    std::sort(by_right.begin(), by_right.end(),
+              [&](uint32_t _e, uint32_t _f) { return x(origin[_e ^ 1]) < x(origin[_f ^ 1]); });
+    for (uint32_t c = 0; c < cycles; c++)
+        if (!_outer[c])
+            holes.push_back(c);
+    std::sort(holes.begin(), holes.end(), [&](uint32_t _c, uint32_t _d) { return x(_lowest[_c]) < x(_lowest[_d]); });
+
+    std::set<uint32_t, BelowOrder> status(BelowOrder{ &points, &origin });
+    std::vector<std::set<uint32_t, BelowOrder>::iterator> handle(origin.size());
+
+    size_t inserted = 0, removed = 0;
+    for (uint32_t c : holes) {
+        const Point2d& w = points[_lowest[c]];
+        const float wx = w.coords[X_];
+        // edges ending left of the vertex leave before the ones starting at it enter
+        while (true) {
+            const bool can_remove = removed < by_right.size() && x(origin[by_right[removed] ^ 1]) < wx;
+            const bool can_insert = inserted < rightward.size() && x(origin[rightward[inserted]]) < wx;
+            if (can_remove && (!can_insert || x(origin[by_right[removed] ^ 1]) <= x(origin[rightward[inserted]]))) {
+                status.erase(handle[by_right[removed]]);
+                removed++;
+            }
+            else if (can_insert) {
+                handle[rightward[inserted]] = status.insert(rightward[inserted]).first;
+                inserted++;
+            }
+            else
+                break;
+        }
+
+        // the first edge with w below it, the one before is right below w
+        auto above = status.lower_bound(w);
+        if (above == status.begin()) {
+            cycle_face[c] = unbounded;
+            continue;
+        }
+        cycle_face[c] = cycle_face[cycle_of[*std::prev(above)]];
+    }
+
+    face_start.assign(faces + 1, 0);
+    for (uint32_t c = 0; c < cycles; c++)
+        face_start[cycle_face[c] + 1]++;
+    for (uint32_t f = 0; f < faces; f++)
+        face_start[f + 1] += face_start[f];
+    face_cycles.resize(cycles);
+    std::vector<uint32_t> fill(face_start.begin(), face_start.end() - 1);
+    for (uint32_t c = 0; c < cycles; c++)
+        if (_outer[c])
+            face_cycles[fill[cycle_face[c]]++] = c;
+    for (uint32_t c = 0; c < cycles; c++)
+        if (!_outer[c])
+            face_cycles[fill[cycle_face[c]]++] = c;
+}
+
+void rez::MapOverlay::labelFaces()
+{
+    const auto faces = static_cast<uint32_t>(face_start.size() - 1);
+    face_a.assign(faces, NONE);
+    face_b.assign(faces, NONE);
+    for (uint32_t e = 0; e < origin.size(); e++) {
+        if (left_a[e] != NONE)
+            face_a[faceOfEdge(e)] = left_a[e];
+        if (left_b[e] != NONE)
+            face_b[faceOfEdge(e)] = left_b[e];
+    }
+    if (face_a[faces - 1] == NONE)
+        face_a[faces - 1] = unbounded_a;
+    if (face_b[faces - 1] == NONE)
+        face_b[faces - 1] = unbounded_b;
+
+    spreadLabels(face_a, left_a);
+    spreadLabels(face_b, left_b);
+}
+
+// Faces bounded by edges of one input only take the label of the other input
+// from their neighbours across those edges
+void rez::MapOverlay::spreadLabels(std::vector<uint32_t>& _label, const std::vector<uint32_t>& _left) const
+{
+    std::vector<uint32_t> queue;
+    for (uint32_t f = 0; f < _label.size(); f++)
+        if (_label[f] != NONE)
+            queue.push_back(f);
+    while (!queue.empty()) {
+        const uint32_t f = queue.back();
+        queue.pop_back();
+        for (uint32_t i = face_start[f]; i < face_start[f + 1]; i++) {
+            const uint32_t first = cycle_edge[face_cycles[i]];
+            uint32_t e = first;
+            do {
+                if (_left[e] == NONE && _left[e ^ 1] == NONE) {
+                    const uint32_t g = faceOfEdge(e ^ 1);
+                    if (_label[g] == NONE) {
+                        _label[g] = _label[f];
+                        queue.push_back(g);
+                    }
+                }
+                e = next[e];
+            } while (e != first);
+        }
+    }
+}
+
+bool rez::MapOverlay::insideA(size_t _face) const
+{
+    return face_a[_face] != NONE && bounded_a[face_a[_face]];
+}
+
+bool rez::MapOverlay::insideB(size_t _face) const
+{
+    return face_b[_face] != NONE && bounded_b[face_b[_face]];
+}
+
+bool rez::MapOverlay::selected(size_t _face, BooleanOperation _op) const
+{
+    const bool a = insideA(_face), b = insideB(_face);
+    switch (_op) {
+        case BooleanOperation::UNION:
+            return a || b;
+        case BooleanOperation::INTERSECTION:
+            return a && b;
+        case BooleanOperation::DIFFERENCE:
+            return a && !b;
+        case BooleanOperation::XOR:
+            return a != b;
+    }
+    return false;
+}
+
+// The subdivision made of the edges between a face of the result and one that
+// is not. Its faces are labelled as inputs a with face 0 inside the result and
+// face 1 outside.
+MapOverlay rez::MapOverlay::select(BooleanOperation _op) const
+{
+    MapOverlay region;
+    std::vector<uint32_t> vertex(points.size(), NONE);
+    for (uint32_t e = 0; e < origin.size(); e += 2) {
+        const bool left = selected(faceOfEdge(e), _op), right = selected(faceOfEdge(e + 1), _op);
+        if (left == right)
+            continue;
+        for (uint32_t h : { e, e + 1 }) {
+            if (vertex[origin[h]] == NONE) {
+                vertex[origin[h]] = static_cast<uint32_t>(region.points.size());
+                region.points.push_back(points[origin[h]]);
+            }
+            region.origin.push_back(vertex[origin[h]]);
+            region.left_b.push_back(NONE);
+        }
+        region.left_a.push_back(left ? 0 : 1);
+        region.left_a.push_back(right ? 0 : 1);
+    }
+    region.bounded_a = { 1, 0 };
+    region.unbounded_a = 1;
+    region.build();
+    return region;
+}
+
+Polygon2d rez::MapOverlay::makeDCEL(const std::vector<uint32_t>& _order) const
+{
+    std::vector<Point2d> vertices(points);
+    std::vector<std::vector<uint32_t>> faces(_order.size());
+    for (size_t i = 0; i < _order.size(); i++)
+        for (uint32_t k = face_start[_order[i]]; k < face_start[_order[i] + 1]; k++)
+            faces[i].push_back(cycle_edge[face_cycles[k]]);
+    return Polygon2d(vertices, origin, next, faces);
+}
+
+void rez::MapOverlay::result(BooleanOperation _op, std::vector<std::vector<Point2d>>& _rings) const
+{
+    const MapOverlay region = select(_op);
+    for (uint32_t first : region.cycle_edge) {
+        if (region.left_a[first] != 0)
+            continue;
+        std::vector<Point2d> ring;
+        uint32_t e = first;
+        do {
+            ring.push_back(region.points[region.origin[e]]);
+            e = region.next[e];
+        } while (e != first);
+        _rings.push_back(std::move(ring));
+    }
+}
+
+Polygon2d rez::MapOverlay::toDCEL() const
+{
+    std::vector<uint32_t> order(faceCount());
+    for (uint32_t f = 0; f < order.size(); f++)
+        order[f] = f;
+    return makeDCEL(order);
+}
+
+Polygon2d rez::MapOverlay::toDCEL(BooleanOperation _op, size_t& _covered) const
+{
+    const MapOverlay region = select(_op);
+    const auto faces = static_cast<uint32_t>(region.faceCount());
+    std::vector<uint32_t> order;
+    order.reserve(faces);
+    for (uint32_t f = 0; f + 1 < faces; f++)
+        if (region.insideA(f))
+            order.push_back(f);
+    _covered = order.size();
+    for (uint32_t f = 0; f + 1 < faces; f++)
+        if (!region.insideA(f))
+            order.push_back(f);
+    order.push_back(faces - 1);
+    return region.makeDCEL(order);
+}
+
+bool rez::polygon_boolean(Polygon2d& _a, Polygon2d& _b, BooleanOperation _op,
+                          std::vector<std::vector<Point2d>>& _rings)
+{
+    MapOverlay overlay;
+    if (!overlay.compute(_a, _b))
+        return false;
+    overlay.result(_op, _rings);
+    return true;
+}
+
+void rez::map_overlay_batch(const std::vector<std::pair<Polygon2d*, Polygon2d*>>& _pairs,
+                            std::vector<MapOverlay>& _overlays, unsigned _threads)
+{
+    ThreadPool& pool = ThreadPool::global();
+    const size_t tasks = std::min<size_t>(_threads ? _threads : pool.size(), _pairs.size());
+    _overlays.resize(_pairs.size());
+
+    // pairs vary a lot in size, so the tasks take the next pair as they finish one
+    std::atomic<size_t> cursor{ 0 };
+    auto work = [&] {
+        for (size_t i = cursor++; i < _pairs.size(); i = cursor++)
+            _overlays[i].compute(*_pairs[i].first, *_pairs[i].second);
+    };
+    if (tasks < 2) {
+        work();
+        return;
+    }
+    TaskGroup group(pool);
+    for (size_t t = 0; t < tasks; t++)
+        group.run(work);
+    group.wait();
+}
@@ -0,0 +1,103 @@
+#ifndef PHYSICSFORMULA_MAPOVERLAY_H
+#define PHYSICSFORMULA_MAPOVERLAY_H
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Point.h"
+#include "PolygonDCEL.h"
+
+namespace rez
+{
+    enum class BooleanOperation { UNION, INTERSECTION, DIFFERENCE, XOR };
+
+    // Overlay of two planar subdivisions given as DCELs.
+    //
+    // The edges of both inputs are cut at all their intersections by the
+    // segment sweep, the pieces are linked into one subdivision and every face
+    // of it is labelled with the face of each input covering it. A face counts
+    // as inside an input when that label is a bounded face, so an input may be a
+    // single polygon or a whole layer of them. Union, intersection, difference
+    // and xor select faces by those two flags. Runs in O((n + k) log n) for n
+    // input edges and k intersections. Intersection points are rounded to the
+    // float coordinates of the DCEL.
+    class MapOverlay {
+    public:
+        static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+    private:
+        std::vector<Point2d> points;
+        std::vector<uint32_t> origin;           // half edges come in twin pairs 2i, 2i + 1
+        std::vector<uint32_t> next;             // next half edge around the face on the left
+        std::vector<uint32_t> left_a, left_b;   // input face left of a half edge, NONE if not an edge of that input
+        std::vector<uint32_t> cycle_of;         // boundary cycle of every half edge
+        std::vector<uint32_t> cycle_edge;       // one half edge per cycle
+        std::vector<uint32_t> cycle_face;
+        std::vector<uint32_t> face_start, face_cycles;  // cycles of every face, the outer one first
+        std::vector<uint32_t> face_a, face_b;   // labels, the unbounded face is the last one
+        std::vector<char> bounded_a, bounded_b; // per face of the inputs
+        uint32_t unbounded_a = NONE, unbounded_b = NONE;
+
+        void build();
+        void link();
+        void traceCycles(std::vector<char>& _outer, std::vector<uint32_t>& _lowest);
+        void locateHoles(const std::vector<char>& _outer, const std::vector<uint32_t>& _lowest);
+        void labelFaces();
+        void spreadLabels(std::vector<uint32_t>& _label, const std::vector<uint32_t>& _left) const;
+        uint32_t faceOfEdge(uint32_t _e) const { return cycle_face[cycle_of[_e]]; }
+        MapOverlay select(BooleanOperation _op) const;
+        Polygon2d makeDCEL(const std::vector<uint32_t>& _order) const;
+
+    public:
+        MapOverlay() {}
+
+        MapOverlay(Polygon2d& _a, Polygon2d& _b);
+
+        void clear();
+
+        // overlays _a and _b, false if either has no faces
+        bool compute(Polygon2d& _a, Polygon2d& _b);
+
+        size_t faceCount() const { return face_a.size(); }
+
+        // index into getFaceList() of the face of _a (_b) covering overlay face _face
+        uint32_t faceOfA(size_t _face) const { return face_a[_face]; }
+
+        uint32_t faceOfB(size_t _face) const { return face_b[_face]; }
+
+        bool insideA(size_t _face) const;
+
+        bool insideB(size_t _face) const;
+
+        // true if overlay face _face belongs to the result of _op
+        bool selected(size_t _face, BooleanOperation _op) const;
+
+        /**
+         * @brief boundary of the result of _op, counter clockwise rings around
+         * the regions and clockwise rings around their holes. Edges between two
+         * faces of the result are dropped.
+         */
+        void result(BooleanOperation _op, std::vector<std::vector<Point2d>>& _rings) const;
+
+        // The whole overlay as a DCEL, its faces in the order of the labels above
+        Polygon2d toDCEL() const;
+
+        // The result of _op as a DCEL, the first _covered faces make up the result
+        Polygon2d toDCEL(BooleanOperation _op, size_t& _covered) const;
+    };
+
+    /**
+     * @brief boundary rings of _a _op _b, see MapOverlay::result
+     * @return false if either polygon has no faces
+     */
+    bool polygon_boolean(Polygon2d& _a, Polygon2d& _b, BooleanOperation _op,
+                         std::vector<std::vector<Point2d>>& _rings);
+
+    /**
+     * @brief overlays every pair on the global thread pool. The polygons are
+     * only read, one may appear in several pairs.
+     * @param _threads number of tasks, 0 uses the size of the global pool
+     */
+    void map_overlay_batch(const std::vector<std::pair<Polygon2d*, Polygon2d*>>& _pairs,
+                           std::vector<MapOverlay>& _overlays, unsigned _threads = 0);
+}
+#endif //PHYSICSFORMULA_MAPOVERLAY_H
@@ -0,0 +1,162 @@
+#include "MappedFile.h"
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace rez;
+
+namespace {
+    // mappings have to start on a multiple of this
+    uint64_t granularity()
+    {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwAllocationGranularity;
+#else
+        return uint64_t(sysconf(_SC_PAGESIZE));
+#endif
+    }
+}
+
+rez::MappedFile::MappedFile(MappedFile&& _other) noexcept
+{
+    *this = std::move(_other);
+}
+
+rez::MappedFile& rez::MappedFile::operator=(MappedFile&& _other) noexcept
+{
+    if (this != &_other) {
+        close();
+        path = std::move(_other.path);
+        length = std::exchange(_other.length, 0);
+        view = std::exchange(_other.view, nullptr);
+        viewLength = std::exchange(_other.viewLength, 0);
+        skip = std::exchange(_other.skip, 0);
+#ifdef _WIN32
+        file = std::exchange(_other.file, nullptr);
+        mapping = std::exchange(_other.mapping, nullptr);
+#else
+        file = std::exchange(_other.file, -1);
+#endif
+    }
+    return *this;
+}
+
+bool rez::MappedFile::open(const std::string& _path)
+{
+    close();
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        CloseHandle(handle);
+        return false;
+    }
+    file = handle;
+    length = uint64_t(size.QuadPart);
+    if (length > 0) {
+        mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            close();
+            return false;
+        }
+    }
+#else
+    file = ::open(_path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+    struct stat info {};
+    if (fstat(file, &info) != 0) {
+        close();
+        return false;
+    }
+    length = uint64_t(info.st_size);
+#endif
+    path = _path;
+    return true;
+}
+
+bool rez::MappedFile::isOpen() const
+{
+#ifdef _WIN32
+    return file != nullptr;
+#else
+    return file >= 0;
+#endif
+}
+
+void rez::MappedFile::unmap()
+{
+    if (view) {
+#ifdef _WIN32
+        UnmapViewOfFile(view);
+#else
+        munmap(const_cast<char*>(view), viewLength);
+#endif
+    }
+    view = nullptr;
+    viewLength = 0;
+    skip = 0;
+}
+
+void rez::MappedFile::close()
+{
+    unmap();
+#ifdef _WIN32
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (file >= 0)
+        ::close(file);
+    file = -1;
+#endif
+    length = 0;
+    path.clear();
+}
+
+bool rez::MappedFile::map(uint64_t _offset, size_t _length, bool _sequential)
+{
+    unmap();
+    if (!isOpen())
+        return false;
+    if (_offset >= length)
+        return true;
+    const uint64_t end = _length >= length - _offset ? length : _offset + _length;
+    const uint64_t base = _offset - _offset % granularity();
+    const size_t bytes = size_t(end - base);
+#ifdef _WIN32
+    void* pages = MapViewOfFile(mapping, FILE_MAP_READ, DWORD(base >> 32), DWORD(base & 0xFFFFFFFFu), bytes);
+    if (!pages)
+        return false;
+    (void)_sequential;
+#else
+    void* pages = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, file, off_t(base));
+    if (pages == MAP_FAILED)
+        return false;
+    if (_sequential)
+        madvise(pages, bytes, MADV_SEQUENTIAL);
+#endif
+    view = static_cast<const char*>(pages);
+    viewLength = bytes;
+    skip = size_t(_offset - base);
+    return true;
+}
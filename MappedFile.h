@@ -0,0 +1,69 @@
+#ifndef PHYSICSFORMULA_MAPPEDFILE_H
+#define PHYSICSFORMULA_MAPPEDFILE_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace rez
+{
+    // Read only memory mapping of a file, the whole file or a window of it.
+    //
+    // Pages are only read when touched and the kernel can drop them again at
+    // any time, so a mapping costs no memory up front and files larger than RAM
+    // can be walked window by window. Windows may start at any byte, the mapping
+    // itself is rounded down to the page (or on Windows allocation) granularity
+    // behind the scenes. Move only, the mapping is released on destruction.
+    class MappedFile {
+        std::string path;
+        uint64_t length = 0;        // size of the file
+        const char* view = nullptr; // start of the mapped pages
+        size_t viewLength = 0;
+        size_t skip = 0;            // bytes from view to the requested offset
+#ifdef _WIN32
+        void* file = nullptr;
+        void* mapping = nullptr;
+#else
+        int file = -1;
+#endif
+
+    public:
+        MappedFile() {}
+
+        explicit MappedFile(const std::string& _path) { open(_path); }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& _other) noexcept;
+        MappedFile& operator=(MappedFile&& _other) noexcept;
+
+        ~MappedFile() { close(); }
+
+        // opens the file without mapping anything, false if it cannot be read
+        bool open(const std::string& _path);
+
+        void close();
+
+        bool isOpen() const;
+
+        /**
+         * @brief maps _length bytes from _offset, replacing the previous window
+         * @param _length clipped to the end of the file, SIZE_MAX maps the rest
+         * @param _sequential hints the kernel to read ahead
+         * @return false when nothing could be mapped, an empty window is not an error
+         */
+        bool map(uint64_t _offset = 0, size_t _length = SIZE_MAX, bool _sequential = true);
+
+        // drops the window, the file stays open
+        void unmap();
+
+        // start and size of the mapped window
+        const char* data() const { return view ? view + skip : nullptr; }
+
+        size_t size() const { return viewLength - skip; }
+
+        uint64_t fileSize() const { return length; }
+
+        const std::string& fileName() const { return path; }
+    };
+}
+#endif //PHYSICSFORMULA_MAPPEDFILE_H
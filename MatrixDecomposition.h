@@ -0,0 +1,517 @@
+#ifndef PHYSICSFORMULA_MATRIXDECOMPOSITION_H
+#define PHYSICSFORMULA_MATRIXDECOMPOSITION_H
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "MatrixScalar.h"
+
+// defined in MatrixND.h, which includes this header at its end
+template<typename T> class MatrixND;
+
+/**
+ * @brief factorization objects for MatrixND. Each one factors the matrix
+ * once in its constructor and can then be reused for any number of solves.
+ *  - LUDecomposition       : P*A = L*U with partial pivoting, square A
+ *  - CholeskyDecomposition : A = L*L^T, symmetric positive definite A
+ *  - QRDecomposition       : A*P = Q*R by Householder reflections with
+ *                            column pivoting, any m x n A (rank, least squares)
+ * All work is O(n^3) and is carried out in T, integral element types are
+ * promoted to double for the factorization.
+ */
+namespace rez {
+    template<typename T>
+    class LUDecomposition {
+        using R = decomposition_scalar<T>;
+        int n = 0;
+        std::vector<R> lu;      // L below the diagonal (unit diagonal), U on and above
+        std::vector<int> perm;  // row i of P*A is row perm[i] of A
+        int pivotSign = 1;
+        bool singular = false;
+
+        void solveInPlace(R* x, int stride) const;
+    public:
+        explicit LUDecomposition(const MatrixND<T>& A);
+
+        [[nodiscard]] int size() const { return n; }
+        // true if a pivot vanished relative to the largest one, with the rank
+        // tolerance of QRDecomposition, solve() and inverse() are then undefined
+        [[nodiscard]] bool isSingular() const { return singular; }
+        [[nodiscard]] T determinant() const;
+        // solve A*x = b for a single right hand side
+        [[nodiscard]] std::vector<T> solve(const std::vector<T>& b) const;
+        // solve A*X = B, one column of B per right hand side
+        [[nodiscard]] MatrixND<T> solve(const MatrixND<T>& B) const;
+        [[nodiscard]] MatrixND<T> inverse() const;
+        [[nodiscard]] MatrixND<T> lower() const;
+        [[nodiscard]] MatrixND<T> upper() const;
+        [[nodiscard]] const std::vector<int>& permutation() const { return perm; }
+    };
+
+    template<typename T>
+    class CholeskyDecomposition {
+        using R = decomposition_scalar<T>;
+        int n = 0;
+        std::vector<R> l;       // lower triangular factor, row-major
+        bool positiveDefinite = true;
+    public:
+        explicit CholeskyDecomposition(const MatrixND<T>& A);
+
+        // false if A was not symmetric positive definite
+        [[nodiscard]] bool isPositiveDefinite() const { return positiveDefinite; }
+        [[nodiscard]] T determinant() const;
+        [[nodiscard]] std::vector<T> solve(const std::vector<T>& b) const;
+        [[nodiscard]] MatrixND<T> solve(const MatrixND<T>& B) const;
+        [[nodiscard]] MatrixND<T> lower() const;
+    };
+
+    template<typename T>
+    class QRDecomposition {
+        using R = decomposition_scalar<T>;
+        int m = 0, n = 0;
+        std::vector<R> qr;      // R on and above the diagonal, reflectors below
+        std::vector<R> tau;     // Householder scalars
+        std::vector<int> perm;  // column j of A*P is column perm[j] of A
+        int numericalRank = 0;
+
+        void applyQt(R* x) const;
+    public:
+        explicit QRDecomposition(const MatrixND<T>& A);
+
+        [[nodiscard]] int rank() const { return numericalRank; }
+        [[nodiscard]] bool isFullRank() const { return numericalRank == std::min(m, n); }
+        // least squares solution of A*x = b (exact when A is square and full rank)
+        [[nodiscard]] std::vector<T> solve(const std::vector<T>& b) const;
+        [[nodiscard]] MatrixND<T> solve(const MatrixND<T>& B) const;
+        [[nodiscard]] MatrixND<T> Q() const;
+        [[nodiscard]] MatrixND<T> upper() const;
+        [[nodiscard]] const std::vector<int>& permutation() const { return perm; }
+    };
+
+//*****************************************************************************
+// LUDecomposition
+//*****************************************************************************
+    template<typename T>
+    LUDecomposition<T>::LUDecomposition(const MatrixND<T>& A) {
+        assert(A.rows == A.cols);
+        n = A.rows;
+        lu.assign(A.data.begin(), A.data.end());
+        perm.resize(n);
+        for (int i = 0; i < n; i++)
+            perm[i] = i;
+
+        R maxPivot = R(0);
+        for (int k = 0; k < n; k++) {
+            // partial pivoting on the largest magnitude in column k
+            int p = k;
+            R big = std::abs(lu[k * n + k]);
+            for (int i = k + 1; i < n; i++) {
+                R v = std::abs(lu[i * n + k]);
+                if (v > big) {
+                    big = v;
+                    p = i;
+                }
+            }
+            if (big == R(0)) {
+                singular = true;
+                continue;
+            }
+            maxPivot = std::max(maxPivot, big);
+            if (p != k) {
+                std::swap_ranges(lu.begin() + p * n, lu.begin() + (p + 1) * n,
+                                 lu.begin() + k * n);
+                std::swap(perm[p], perm[k]);
+                pivotSign = -pivotSign;
+            }
+            const R pivot = lu[k * n + k];
+            const R* rowK = lu.data() + k * n;
+            for (int i = k + 1; i < n; i++) {
+                R* rowI = lu.data() + i * n;
+                const R f = rowI[k] / pivot;
+                rowI[k] = f;
+                if (f == R(0))
+                    continue;
+                for (int j = k + 1; j < n; j++)
+                    rowI[j] -= f * rowK[j];
+            }
+        }
+        // rounding leaves a pivot of about eps * |A| where exact elimination
+        // gives 0, judge them the way QRDecomposition judges its rank
+        const R threshold = static_cast<R>(n) * std::numeric_limits<R>::epsilon() * maxPivot;
+        for (int k = 0; k < n && !singular; k++)
+            singular = std::abs(lu[k * n + k]) <= threshold;
+    }
+
+    template<typename T>
+    T LUDecomposition<T>::determinant() const {
+        if (singular)
+            return T(0);
+        R det = static_cast<R>(pivotSign);
+        for (int i = 0; i < n; i++)
+            det *= lu[i * n + i];
+        return fromDecompositionScalar<T>(det);
+    }
+
+    // x holds P*b on entry (stride apart) and the solution on exit
+    template<typename T>
+    void LUDecomposition<T>::solveInPlace(R* x, int stride) const {
+        for (int i = 0; i < n; i++) {
+            R sum = x[i * stride];
+            const R* row = lu.data() + i * n;
+            for (int j = 0; j < i; j++)
+                sum -= row[j] * x[j * stride];
+            x[i * stride] = sum;
+        }
+        for (int i = n - 1; i >= 0; i--) {
+            R sum = x[i * stride];
+            const R* row = lu.data() + i * n;
+            for (int j = i + 1; j < n; j++)
+                sum -= row[j] * x[j * stride];
+            x[i * stride] = sum / row[i];
+        }
+    }
+
+    template<typename T>
+    std::vector<T> LUDecomposition<T>::solve(const std::vector<T>& b) const {
+        assert(static_cast<int>(b.size()) == n);
+        std::vector<R> x(n);
+        for (int i = 0; i < n; i++)
+            x[i] = static_cast<R>(b[perm[i]]);
+        solveInPlace(x.data(), 1);
+        std::vector<T> result(n);
+        for (int i = 0; i < n; i++)
+            result[i] = fromDecompositionScalar<T>(x[i]);
+        return result;
+    }
+
+    template<typename T>
+    MatrixND<T> LUDecomposition<T>::solve(const MatrixND<T>& B) const {
+        assert(B.rows == n);
+        const int nrhs = B.cols;
+        // permuted copy of B, every column is solved in place
+        std::vector<R> x(static_cast<std::size_t>(n) * nrhs);
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < nrhs; j++)
+                x[i * nrhs + j] = static_cast<R>(B.data[perm[i] * nrhs + j]);
+        // forward and back substitution row by row so every rhs is updated
+        // by one contiguous sweep
+        for (int i = 0; i < n; i++) {
+            R* xi = x.data() + i * nrhs;
+            const R* row = lu.data() + i * n;
+            for (int k = 0; k < i; k++) {
+                const R f = row[k];
+                const R* xk = x.data() + k * nrhs;
+                for (int j = 0; j < nrhs; j++)
+                    xi[j] -= f * xk[j];
+            }
+        }
+        for (int i = n - 1; i >= 0; i--) {
+            R* xi = x.data() + i * nrhs;
+            const R* row = lu.data() + i * n;
+            for (int k = i + 1; k < n; k++) {
+                const R f = row[k];
+                const R* xk = x.data() + k * nrhs;
+                for (int j = 0; j < nrhs; j++)
+                    xi[j] -= f * xk[j];
+            }
+            const R d = row[i];
+            for (int j = 0; j < nrhs; j++)
+                xi[j] /= d;
+        }
+        MatrixND<T> result(n, nrhs);
+        for (std::size_t i = 0; i < x.size(); i++)
+            result.data[i] = fromDecompositionScalar<T>(x[i]);
+        return result;
+    }
+
+    template<typename T>
+    MatrixND<T> LUDecomposition<T>::inverse() const {
+        return solve(MatrixND<T>::identity(n));
+    }
+
+    template<typename T>
+    MatrixND<T> LUDecomposition<T>::lower() const {
+        MatrixND<T> L(n, n);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < i; j++)
+                L.data[i * n + j] = fromDecompositionScalar<T>(lu[i * n + j]);
+            L.data[i * n + i] = T(1);
+        }
+        return L;
+    }
+
+    template<typename T>
+    MatrixND<T> LUDecomposition<T>::upper() const {
+        MatrixND<T> U(n, n);
+        for (int i = 0; i < n; i++)
+            for (int j = i; j < n; j++)
+                U.data[i * n + j] = fromDecompositionScalar<T>(lu[i * n + j]);
+        return U;
+    }
+
+//*****************************************************************************
+// CholeskyDecomposition
+//*****************************************************************************
+    template<typename T>
+    CholeskyDecomposition<T>::CholeskyDecomposition(const MatrixND<T>& A) {
+        assert(A.rows == A.cols);
+        n = A.rows;
+        l.assign(static_cast<std::size_t>(n) * n, R(0));
+        for (int j = 0; j < n; j++) {
+            R* lj = l.data() + j * n;
+            R d = static_cast<R>(A.data[j * n + j]);
+            for (int k = 0; k < j; k++)
+                d -= lj[k] * lj[k];
+            if (!(d > R(0))) {
+                positiveDefinite = false;
+                return;
+            }
+            lj[j] = std::sqrt(d);
+            for (int i = j + 1; i < n; i++) {
+                R* li = l.data() + i * n;
+                R s = static_cast<R>(A.data[i * n + j]);
+                for (int k = 0; k < j; k++)
+                    s -= li[k] * lj[k];
+                li[j] = s / lj[j];
+            }
+        }
+    }
+
+    template<typename T>
+    T CholeskyDecomposition<T>::determinant() const {
+        if (!positiveDefinite)
+            return T(0);
+        R det = R(1);
+        for (int i = 0; i < n; i++)
+            det *= l[i * n + i] * l[i * n + i];
+        return fromDecompositionScalar<T>(det);
+    }
+
+    template<typename T>
+    std::vector<T> CholeskyDecomposition<T>::solve(const std::vector<T>& b) const {
+        assert(static_cast<int>(b.size()) == n && positiveDefinite);
+        std::vector<R> x(b.begin(), b.end());
+        for (int i = 0; i < n; i++) {
+            const R* li = l.data() + i * n;
+            R s = x[i];
+            for (int k = 0; k < i; k++)
+                s -= li[k] * x[k];
+            x[i] = s / li[i];
+        }
+        for (int i = n - 1; i >= 0; i--) {
+            R s = x[i];
+            for (int k = i + 1; k < n; k++)
+                s -= l[k * n + i] * x[k];
+            x[i] = s / l[i * n + i];
+        }
+        std::vector<T> result(n);
+        for (int i = 0; i < n; i++)
+            result[i] = fromDecompositionScalar<T>(x[i]);
+        return result;
+    }
+
+    template<typename T>
+    MatrixND<T> CholeskyDecomposition<T>::solve(const MatrixND<T>& B) const {
+        assert(B.rows == n && positiveDefinite);
+        const int nrhs = B.cols;
+        std::vector<R> x(B.data.begin(), B.data.end());
+        for (int i = 0; i < n; i++) {
+            R* xi = x.data() + i * nrhs;
+            const R* li = l.data() + i * n;
+            for (int k = 0; k < i; k++) {
+                const R* xk = x.data() + k * nrhs;
+                for (int j = 0; j < nrhs; j++)
+                    xi[j] -= li[k] * xk[j];
+            }
+            for (int j = 0; j < nrhs; j++)
+                xi[j] /= li[i];
+        }
+        for (int i = n - 1; i >= 0; i--) {
+            R* xi = x.data() + i * nrhs;
+            for (int k = i + 1; k < n; k++) {
+                const R f = l[k * n + i];
+                const R* xk = x.data() + k * nrhs;
+                for (int j = 0; j < nrhs; j++)
+                    xi[j] -= f * xk[j];
+            }
+            for (int j = 0; j < nrhs; j++)
+                xi[j] /= l[i * n + i];
+        }
+        MatrixND<T> result(n, nrhs);
+        for (std::size_t i = 0; i < x.size(); i++)
+            result.data[i] = fromDecompositionScalar<T>(x[i]);
+        return result;
+    }
+
+    template<typename T>
+    MatrixND<T> CholeskyDecomposition<T>::lower() const {
+        MatrixND<T> L(n, n);
+        for (std::size_t i = 0; i < l.size(); i++)
+            L.data[i] = fromDecompositionScalar<T>(l[i]);
+        return L;
+    }
+
+//*****************************************************************************
+// QRDecomposition
+//*****************************************************************************
+    template<typename T>
+    QRDecomposition<T>::QRDecomposition(const MatrixND<T>& A) {
+        m = A.rows;
+        n = A.cols;
+        qr.assign(A.data.begin(), A.data.end());
+        const int steps = std::min(m, n);
+        tau.assign(steps, R(0));
+        perm.resize(n);
+        std::vector<R> norms(n, R(0));
+        for (int j = 0; j < n; j++) {
+            perm[j] = j;
+            for (int i = 0; i < m; i++)
+                norms[j] += qr[i * n + j] * qr[i * n + j];
+        }
+        R maxDiag = R(0);
+        const R eps = std::numeric_limits<R>::epsilon();
+
+        for (int k = 0; k < steps; k++) {
+            // bring the remaining column with the largest norm forward
+            int p = k;
+            for (int j = k + 1; j < n; j++)
+                if (norms[j] > norms[p])
+                    p = j;
+            if (p != k) {
+                for (int i = 0; i < m; i++)
+                    std::swap(qr[i * n + k], qr[i * n + p]);
+                std::swap(norms[k], norms[p]);
+                std::swap(perm[k], perm[p]);
+            }
+
+            // Householder reflector zeroing column k below the diagonal
+            R alpha = R(0);
+            for (int i = k; i < m; i++)
+                alpha += qr[i * n + k] * qr[i * n + k];
+            alpha = std::sqrt(alpha);
+            if (alpha == R(0))
+                break;
+            const R x0 = qr[k * n + k];
+            const R beta = x0 > R(0) ? -alpha : alpha;
+            const R v0 = x0 - beta;
+            for (int i = k + 1; i < m; i++)
+                qr[i * n + k] /= v0;
+            tau[k] = (beta - x0) / beta;
+            qr[k * n + k] = beta;
+
+            // apply H = I - tau*v*v^T to the trailing columns
+            for (int j = k + 1; j < n; j++) {
+                R s = qr[k * n + j];
+                for (int i = k + 1; i < m; i++)
+                    s += qr[i * n + k] * qr[i * n + j];
+                s *= tau[k];
+                qr[k * n + j] -= s;
+                for (int i = k + 1; i < m; i++)
+                    qr[i * n + j] -= s * qr[i * n + k];
+            }
+            // downdate the remaining column norms
+            for (int j = k + 1; j < n; j++) {
+                norms[j] -= qr[k * n + j] * qr[k * n + j];
+                if (norms[j] < R(0))
+                    norms[j] = R(0);
+            }
+
+            if (k == 0)
+                maxDiag = std::abs(beta);
+            const R threshold = static_cast<R>(std::max(m, n)) * eps * maxDiag;
+            if (std::abs(beta) > threshold)
+                numericalRank = k + 1;
+            else
+                break;
+        }
+    }
+
+    // x (length m) is overwritten with Q^T * x
+    template<typename T>
+    void QRDecomposition<T>::applyQt(R* x) const {
+        for (int k = 0; k < static_cast<int>(tau.size()); k++) {
+            if (tau[k] == R(0))
+                continue;
+            R s = x[k];
+            for (int i = k + 1; i < m; i++)
+                s += qr[i * n + k] * x[i];
+            s *= tau[k];
+            x[k] -= s;
+            for (int i = k + 1; i < m; i++)
+                x[i] -= s * qr[i * n + k];
+        }
+    }
+
+    template<typename T>
+    std::vector<T> QRDecomposition<T>::solve(const std::vector<T>& b) const {
+        assert(static_cast<int>(b.size()) == m);
+        std::vector<R> y(b.begin(), b.end());
+        applyQt(y.data());
+        // back substitute on the leading rank x rank block, the free
+        // variables of a rank deficient system are set to zero
+        std::vector<R> z(n, R(0));
+        for (int i = numericalRank - 1; i >= 0; i--) {
+            R s = y[i];
+            for (int j = i + 1; j < numericalRank; j++)
+                s -= qr[i * n + j] * z[j];
+            z[i] = s / qr[i * n + i];
+        }
+        std::vector<T> x(n);
+        for (int j = 0; j < n; j++)
+            x[perm[j]] = fromDecompositionScalar<T>(z[j]);
+        return x;
+    }
+
+    template<typename T>
+    MatrixND<T> QRDecomposition<T>::solve(const MatrixND<T>& B) const {
+        assert(B.rows == m);
+        MatrixND<T> X(n, B.cols);
+        std::vector<T> column(m);
+        for (int c = 0; c < B.cols; c++) {
+            for (int i = 0; i < m; i++)
+                column[i] = B.data[i * B.cols + c];
+            std::vector<T> x = solve(column);
+            for (int i = 0; i < n; i++)
+                X.data[i * B.cols + c] = x[i];
+        }
+        return X;
+    }
+
+    template<typename T>
+    MatrixND<T> QRDecomposition<T>::Q() const {
+        // accumulate the reflectors applied to the identity, Q = H0*H1*...
+        std::vector<R> q(static_cast<std::size_t>(m) * m, R(0));
+        for (int i = 0; i < m; i++)
+            q[i * m + i] = R(1);
+        for (int k = static_cast<int>(tau.size()) - 1; k >= 0; k--) {
+            if (tau[k] == R(0))
+                continue;
+            for (int j = 0; j < m; j++) {
+                R s = q[k * m + j];
+                for (int i = k + 1; i < m; i++)
+                    s += qr[i * n + k] * q[i * m + j];
+                s *= tau[k];
+                q[k * m + j] -= s;
+                for (int i = k + 1; i < m; i++)
+                    q[i * m + j] -= s * qr[i * n + k];
+            }
+        }
+        MatrixND<T> result(m, m);
+        for (std::size_t i = 0; i < q.size(); i++)
+            result.data[i] = fromDecompositionScalar<T>(q[i]);
+        return result;
+    }
+
+    template<typename T>
+    MatrixND<T> QRDecomposition<T>::upper() const {
+        MatrixND<T> result(m, n);
+        for (int i = 0; i < std::min(m, n); i++)
+            for (int j = i; j < n; j++)
+                result.data[i * n + j] = fromDecompositionScalar<T>(qr[i * n + j]);
+        return result;
+    }
+} // namespace rez
+
+#endif //PHYSICSFORMULA_MATRIXDECOMPOSITION_H
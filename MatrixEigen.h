@@ -0,0 +1,1082 @@
+#ifndef PHYSICSFORMULA_MATRIXEIGEN_H
+#define PHYSICSFORMULA_MATRIXEIGEN_H
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <type_traits>
+#include <vector>
+#include "MatrixScalar.h"
+
+// defined in MatrixND.h, which includes this header at its end
+template<typename T> class MatrixND;
+
+/**
+ * @brief eigenvalue solvers for MatrixND and for large operators.
+ *  - SymmetricEigenSolver : Householder tridiagonalization followed by the
+ *                           implicit QL algorithm, real ascending eigenvalues
+ *                           and orthonormal eigenvectors, O(n^3)
+ *  - EigenSolver          : Hessenberg reduction followed by the shifted
+ *                           double QR algorithm, complex eigenvalues and
+ *                           eigenvectors of any real square matrix, O(n^3)
+ *  - lanczos / arnoldi    : k eigenpairs at one end of the spectrum of a
+ *                           symmetric / general operator that is only
+ *                           applied to vectors (SparseMatrix, a lambda),
+ *                           thick restarted Krylov subspaces of a fixed size
+ * The dense solvers follow the EISPACK routines tred2, tql2, orthes and
+ * hqr2, reorganized for row-major storage so the inner loops run along rows.
+ * Integral element types are promoted to double as in MatrixDecomposition.h.
+ */
+namespace rez {
+    template<typename T>
+    class SymmetricEigenSolver {
+        using R = decomposition_scalar<T>;
+        int n = 0;
+        std::vector<R> values;      // ascending
+        std::vector<R> vectors;     // row k is the unit eigenvector of values[k]
+        bool hasVectors = false;
+        bool converged = true;
+
+        void compute(std::vector<R>& a);
+        void tridiagonalize(std::vector<R>& a, std::vector<R>& d, std::vector<R>& e);
+        void implicitQL(std::vector<R>& d, std::vector<R>& e);
+    public:
+        // only the lower triangle of A is read
+        explicit SymmetricEigenSolver(const MatrixND<T>& A, bool computeVectors = true);
+        // n x n row-major data
+        SymmetricEigenSolver(std::vector<R> a, int size, bool computeVectors = true);
+
+        [[nodiscard]] int size() const { return n; }
+        // false if the QL iteration ran out of steps, the results are then approximate
+        [[nodiscard]] bool isConverged() const { return converged; }
+        [[nodiscard]] const std::vector<R>& eigenvalues() const { return values; }
+        [[nodiscard]] std::vector<R> eigenvector(int k) const;
+        // column k is the eigenvector of eigenvalues()[k]
+        [[nodiscard]] MatrixND<T> eigenvectors() const;
+    };
+
+    template<typename T>
+    class EigenSolver {
+        using R = decomposition_scalar<T>;
+        int n = 0;
+        std::vector<R> re, im;      // eigenvalues in the order of the Schur form
+        // eigenvectors as columns, a complex pair k, k + 1 (im[k] > 0) stores the
+        // real part of the vector of eigenvalue k in column k and its imaginary
+        // part in column k + 1
+        std::vector<R> v;
+        bool hasVectors = false;
+        bool converged = true;
+
+        void hessenberg(std::vector<R>& h);
+        void schur(std::vector<R>& h);
+    public:
+        explicit EigenSolver(const MatrixND<T>& A, bool computeVectors = true);
+        EigenSolver(std::vector<R> a, int size, bool computeVectors = true);
+
+        [[nodiscard]] int size() const { return n; }
+        [[nodiscard]] bool isConverged() const { return converged; }
+        // complex conjugate pairs are next to each other, positive imaginary part first
+        [[nodiscard]] std::vector<std::complex<R>> eigenvalues() const;
+        // unit length eigenvector of eigenvalues()[k]
+        [[nodiscard]] std::vector<std::complex<R>> eigenvector(int k) const;
+    };
+
+    // which end of the spectrum lanczos and arnoldi converge to
+    enum class EigenTarget { LargestAlgebraic, SmallestAlgebraic, LargestMagnitude };
+
+    template<typename S>
+    struct KrylovResult {
+        std::vector<S> values;                  // ordered by the target, best first
+        std::vector<std::vector<S>> vectors;    // unit length
+        int iterations = 0;                     // operator applications
+        double residual = 0;                    // largest ||A x - l x|| / |l| of the pairs
+        bool converged = false;
+    };
+
+    /**
+     * @brief k eigenpairs of a symmetric n x n operator.
+     * op is a SparseMatrix, a MatrixND or anything callable as
+     * op(const std::vector<T>& x, std::vector<T>& y) computing y = A x.
+     * @param basis size of the Krylov subspace, 0 picks max(2k + 1, 20)
+     */
+    template<typename T, typename Operator>
+    KrylovResult<T> lanczos(int n, const Operator& op, int k,
+                            EigenTarget target = EigenTarget::LargestAlgebraic,
+                            T tolerance = T(1e-10), int basis = 0, int maxRestarts = 200);
+
+    // k eigenpairs of a general real n x n operator, see lanczos
+    template<typename T, typename Operator>
+    KrylovResult<std::complex<T>> arnoldi(int n, const Operator& op, int k,
+                                          EigenTarget target = EigenTarget::LargestMagnitude,
+                                          T tolerance = T(1e-10), int basis = 0, int maxRestarts = 200);
+
+//*****************************************************************************
+// SymmetricEigenSolver
+//*****************************************************************************
+    template<typename T>
+    SymmetricEigenSolver<T>::SymmetricEigenSolver(const MatrixND<T>& A, bool computeVectors)
+            : n(A.rows), hasVectors(computeVectors) {
+        assert(A.rows == A.cols);
+        std::vector<R> a(A.data.begin(), A.data.end());
+        compute(a);
+    }
+
+    template<typename T>
+    SymmetricEigenSolver<T>::SymmetricEigenSolver(std::vector<R> a, int size, bool computeVectors)
+            : n(size), hasVectors(computeVectors) {
+        assert(static_cast<int>(a.size()) == size * size);
+        compute(a);
+    }
+
+    template<typename T>
+    void SymmetricEigenSolver<T>::compute(std::vector<R>& a) {
+        std::vector<R> d, e;
+        tridiagonalize(a, d, e);
+        implicitQL(d, e);
+
+        std::vector<int> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int x, int y) { return d[x] < d[y]; });
+        values.resize(n);
+        for (int k = 0; k < n; k++)
+            values[k] = d[order[k]];
+        if (hasVectors) {
+            std::vector<R> sorted(vectors.size());
+            for (int k = 0; k < n; k++)
+                std::copy_n(vectors.begin() + std::size_t(order[k]) * n, n, sorted.begin() + std::size_t(k) * n);
+            vectors.swap(sorted);
+        }
+    }
+
+    // A = Q*T*Q^T with T tridiagonal, d its diagonal and e[i] = T(i, i - 1).
+    // Every reflector I - b*v*v^T is applied to both sides of the trailing block
+    // as the symmetric rank two update A -= v*w^T + w*v^T on the lower
+    // triangle, and kept in the column it cleared. vectors receives Q^T.
+    template<typename T>
+    void SymmetricEigenSolver<T>::tridiagonalize(std::vector<R>& a, std::vector<R>& d, std::vector<R>& e) {
+        d.assign(n, R(0));
+        e.assign(n, R(0));
+        std::vector<R> v(n), w(n), beta(n, R(0));
+        for (int k = 0; k + 2 < n; k++) {
+            R scale = 0;
+            for (int i = k + 1; i < n; i++) {
+                v[i] = a[std::size_t(i) * n + k];
+                scale = std::max(scale, std::abs(v[i]));
+            }
+            if (scale == R(0))
+                continue;
+            R norm = 0;
+            for (int i = k + 1; i < n; i++)
+                norm += (v[i] / scale) * (v[i] / scale);
+            R alpha = scale * std::sqrt(norm);
+            if (v[k + 1] > 0)
+                alpha = -alpha;
+            v[k + 1] -= alpha;
+            R vv = 0;
+            for (int i = k + 1; i < n; i++)
+                vv += v[i] * v[i];
+            const R b = 2 / vv;
+            e[k + 1] = alpha;
+
+            // w = b*A*v from the lower triangle, then w -= (b/2)(w.v) v
+            std::fill(w.begin() + k + 1, w.end(), R(0));
+            for (int i = k + 1; i < n; i++) {
+                const R* row = a.data() + std::size_t(i) * n;
+                const R vi = v[i];
+                R sum = 0;
+                for (int j = k + 1; j < i; j++) {
+                    sum += row[j] * v[j];
+                    w[j] += row[j] * vi;
+                }
+                w[i] += sum + row[i] * vi;
+            }
+            R wv = 0;
+            for (int i = k + 1; i < n; i++) {
+                w[i] *= b;
+                wv += w[i] * v[i];
+            }
+            const R K = b * wv / 2;
+            for (int i = k + 1; i < n; i++)
+                w[i] -= K * v[i];
+            for (int i = k + 1; i < n; i++) {
+                R* row = a.data() + std::size_t(i) * n;
+                const R vi = v[i], wi = w[i];
+                for (int j = k + 1; j <= i; j++)
+                    row[j] -= vi * w[j] + wi * v[j];
+            }
+            for (int i = k + 1; i < n; i++)
+                a[std::size_t(i) * n + k] = v[i];
+            beta[k] = b;
+        }
+        for (int i = 0; i < n; i++)
+            d[i] = a[std::size_t(i) * n + i];
+        if (n >= 2)
+            e[n - 1] = a[std::size_t(n - 1) * n + n - 2];
+        if (!hasVectors)
+            return;
+
+        // Q = H_0 * H_1 * ..., built from the back so every reflector only meets
+        // the block it acts on
+        std::vector<R> q(std::size_t(n) * n, R(0));
+        for (int i = 0; i < n; i++)
+            q[std::size_t(i) * n + i] = 1;
+        for (int k = n - 3; k >= 0; k--) {
+            if (beta[k] == R(0))
+                continue;
+            std::fill(w.begin() + k + 1, w.end(), R(0));
+            for (int i = k + 1; i < n; i++) {
+                const R vi = a[std::size_t(i) * n + k];
+                const R* row = q.data() + std::size_t(i) * n;
+                for (int j = k + 1; j < n; j++)
+                    w[j] += vi * row[j];
+            }
+            for (int i = k + 1; i < n; i++) {
+                const R f = beta[k] * a[std::size_t(i) * n + k];
+                R* row = q.data() + std::size_t(i) * n;
+                for (int j = k + 1; j < n; j++)
+                    row[j] -= f * w[j];
+            }
+        }
+        vectors.resize(std::size_t(n) * n);
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++)
+                vectors[std::size_t(j) * n + i] = q[std::size_t(i) * n + j];
+    }
+
+    // tql2. The plane rotations act on the eigenvector columns of Q*S, kept
+    // transposed so each rotation combines two contiguous rows.
+    template<typename T>
+    void SymmetricEigenSolver<T>::implicitQL(std::vector<R>& d, std::vector<R>& e) {
+        if (n == 0)
+            return;
+        for (int i = 1; i < n; i++)
+            e[i - 1] = e[i];
+        e[n - 1] = 0;
+        const R eps = std::numeric_limits<R>::epsilon();
+        R f = 0, tst1 = 0;
+        for (int l = 0; l < n; l++) {
+            tst1 = std::max(tst1, std::abs(d[l]) + std::abs(e[l]));
+            int m = l;
+            while (m < n - 1 && std::abs(e[m]) > eps * tst1)
+                m++;
+            if (m > l) {
+                int iter = 0;
+                do {
+                    if (++iter > 60) {
+                        converged = false;
+                        break;
+                    }
+                    R g = d[l];
+                    R p = (d[l + 1] - g) / (2 * e[l]);
+                    R r = std::hypot(p, R(1));
+                    if (p < 0)
+                        r = -r;
+                    d[l] = e[l] / (p + r);
+                    d[l + 1] = e[l] * (p + r);
+                    const R dl1 = d[l + 1];
+                    R h = g - d[l];
+                    for (int i = l + 2; i < n; i++)
+                        d[i] -= h;
+                    f += h;
+
+                    p = d[m];
+                    R c = 1, c2 = 1, c3 = 1;
+                    const R el1 = e[l + 1];
+                    R s = 0, s2 = 0;
+                    for (int i = m - 1; i >= l; i--) {
+                        c3 = c2;
+                        c2 = c;
+                        s2 = s;
+                        g = c * e[i];
+                        h = c * p;
+                        r = std::hypot(p, e[i]);
+                        e[i + 1] = s * r;
+                        s = e[i] / r;
+                        c = p / r;
+                        p = c * d[i] - s * g;
+                        d[i + 1] = h + s * (c * g + s * d[i]);
+                        if (hasVectors) {
+                            R* zi = vectors.data() + std::size_t(i) * n;
+                            R* zi1 = zi + n;
+                            for (int k = 0; k < n; k++) {
+                                const R t = zi1[k];
+                                zi1[k] = s * zi[k] + c * t;
+                                zi[k] = c * zi[k] - s * t;
+                            }
+                        }
+                    }
+                    p = -s * s2 * c3 * el1 * e[l] / dl1;
+                    e[l] = s * p;
+                    d[l] = c * p;
+                } while (std::abs(e[l]) > eps * tst1);
+            }
+            d[l] += f;
+            e[l] = 0;
+        }
+    }
+
+    template<typename T>
+    std::vector<typename SymmetricEigenSolver<T>::R> SymmetricEigenSolver<T>::eigenvector(int k) const {
+        assert(hasVectors && k >= 0 && k < n);
+        return std::vector<R>(vectors.begin() + std::size_t(k) * n, vectors.begin() + std::size_t(k + 1) * n);
+    }
+
+    template<typename T>
+    MatrixND<T> SymmetricEigenSolver<T>::eigenvectors() const {
+        assert(hasVectors);
+        MatrixND<T> V(n, n);
+        for (int k = 0; k < n; k++)
+            for (int i = 0; i < n; i++)
+                V.data[std::size_t(i) * n + k] = fromDecompositionScalar<T>(vectors[std::size_t(k) * n + i]);
+        return V;
+    }
+
+//*****************************************************************************
+// EigenSolver
+//*****************************************************************************
+    template<typename T>
+    EigenSolver<T>::EigenSolver(const MatrixND<T>& A, bool computeVectors)
+            : EigenSolver(std::vector<R>(A.data.begin(), A.data.end()), A.rows, computeVectors) {
+        assert(A.rows == A.cols);
+    }
+
+    template<typename T>
+    EigenSolver<T>::EigenSolver(std::vector<R> a, int size, bool computeVectors)
+            : n(size), hasVectors(computeVectors) {
+        assert(static_cast<int>(a.size()) == size * size);
+        re.assign(n, R(0));
+        im.assign(n, R(0));
+        if (n == 0)
+            return;
+        hessenberg(a);
+        schur(a);
+    }
+
+    // orthes, H = V^T*A*V upper Hessenberg by Householder reflections, V is kept
+    // only when the eigenvectors are wanted
+    template<typename T>
+    void EigenSolver<T>::hessenberg(std::vector<R>& h) {
+        const int high = n - 1;
+        std::vector<R> ort(n, R(0)), f(n);
+        auto H = [&](int i, int j) -> R& { return h[std::size_t(i) * n + j]; };
+        for (int m = 1; m <= high - 1; m++) {
+            R scale = 0;
+            for (int i = m; i <= high; i++)
+                scale += std::abs(H(i, m - 1));
+            if (scale == R(0))
+                continue;
+            R hh = 0;
+            for (int i = high; i >= m; i--) {
+                ort[i] = H(i, m - 1) / scale;
+                hh += ort[i] * ort[i];
+            }
+            R g = std::sqrt(hh);
+            if (ort[m] > 0)
+                g = -g;
+            hh -= ort[m] * g;
+            ort[m] -= g;
+
+            // H = (I - u*u^T/h) * H * (I - u*u^T/h), rows first
+            std::fill(f.begin() + m, f.end(), R(0));
+            for (int i = m; i <= high; i++)
+                for (int j = m; j < n; j++)
+                    f[j] += ort[i] * H(i, j);
+            for (int i = m; i <= high; i++) {
+                const R u = ort[i] / hh;
+                for (int j = m; j < n; j++)
+                    H(i, j) -= f[j] * u;
+            }
+            for (int i = 0; i <= high; i++) {
+                R s = 0;
+                for (int j = m; j <= high; j++)
+                    s += ort[j] * H(i, j);
+                s /= hh;
+                for (int j = m; j <= high; j++)
+                    H(i, j) -= s * ort[j];
+            }
+            ort[m] *= scale;
+            H(m, m - 1) = scale * g;
+        }
+        if (!hasVectors)
+            return;
+
+        v.assign(std::size_t(n) * n, R(0));
+        for (int i = 0; i < n; i++)
+            v[std::size_t(i) * n + i] = 1;
+        for (int m = high - 1; m >= 1; m--) {
+            if (H(m, m - 1) == R(0))
+                continue;
+            for (int i = m + 1; i <= high; i++)
+                ort[i] = H(i, m - 1);
+            std::fill(f.begin() + m, f.end(), R(0));
+            for (int i = m; i <= high; i++)
+                for (int j = m; j <= high; j++)
+                    f[j] += ort[i] * v[std::size_t(i) * n + j];
+            for (int j = m; j <= high; j++)
+                f[j] = (f[j] / ort[m]) / H(m, m - 1);   // double division avoids underflow
+            for (int i = m; i <= high; i++)
+                for (int j = m; j <= high; j++)
+                    v[std::size_t(i) * n + j] += f[j] * ort[i];
+        }
+    }
+
+    namespace eigen_detail {
+        template<typename R>
+        std::complex<R> cdiv(R xr, R xi, R yr, R yi) {
+            R r, d;
+            if (std::abs(yr) > std::abs(yi)) {
+                r = yi / yr;
+                d = yr + r * yi;
+                return { (xr + r * xi) / d, (xi - r * xr) / d };
+            }
+            r = yr / yi;
+            d = yi + r * yr;
+            return { (r * xr + xi) / d, (r * xi - xr) / d };
+        }
+    }
+
+    // hqr2, shifted double QR steps on the Hessenberg matrix down to the real
+    // Schur form, then back substitution for the eigenvectors
+    template<typename T>
+    void EigenSolver<T>::schur(std::vector<R>& h) {
+        const int nn = n;
+        int top = nn - 1;
+        const int low = 0, high = nn - 1;
+        const R eps = std::numeric_limits<R>::epsilon();
+        R exshift = 0;
+        R p = 0, q = 0, r = 0, s = 0, z = 0, t, w, x, y;
+        auto H = [&](int i, int j) -> R& { return h[std::size_t(i) * nn + j]; };
+        auto V = [&](int i, int j) -> R& { return v[std::size_t(i) * nn + j]; };
+        std::vector<R>& d = re;
+        std::vector<R>& e = im;
+
+        R norm = 0;
+        for (int i = 0; i < nn; i++)
+            for (int j = std::max(i - 1, 0); j < nn; j++)
+                norm += std::abs(H(i, j));
+
+        int iter = 0;
+        while (top >= low) {
+            // look for a single small subdiagonal element
+            int l = top;
+            while (l > low) {
+                s = std::abs(H(l - 1, l - 1)) + std::abs(H(l, l));
+                if (s == R(0))
+                    s = norm;
+                if (std::abs(H(l, l - 1)) < eps * s)
+                    break;
+                l--;
+            }
+
+            if (l == top) {
+                // one root found
+                H(top, top) += exshift;
+                d[top] = H(top, top);
+                e[top] = 0;
+                top--;
+                iter = 0;
+            } else if (l == top - 1) {
+                // two roots found
+                w = H(top, top - 1) * H(top - 1, top);
+                p = (H(top - 1, top - 1) - H(top, top)) / 2;
+                q = p * p + w;
+                z = std::sqrt(std::abs(q));
+                H(top, top) += exshift;
+                H(top - 1, top - 1) += exshift;
+                x = H(top, top);
+                if (q >= 0) {
+                    // real pair
+                    z = p >= 0 ? p + z : p - z;
+                    d[top - 1] = x + z;
+                    d[top] = d[top - 1];
+                    if (z != R(0))
+                        d[top] = x - w / z;
+                    e[top - 1] = 0;
+                    e[top] = 0;
+                    x = H(top, top - 1);
+                    s = std::abs(x) + std::abs(z);
+                    p = x / s;
+                    q = z / s;
+                    r = std::sqrt(p * p + q * q);
+                    p /= r;
+                    q /= r;
+                    for (int j = top - 1; j < nn; j++) {
+                        z = H(top - 1, j);
+                        H(top - 1, j) = q * z + p * H(top, j);
+                        H(top, j) = q * H(top, j) - p * z;
+                    }
+                    for (int i = 0; i <= top; i++) {
+                        z = H(i, top - 1);
+                        H(i, top - 1) = q * z + p * H(i, top);
+                        H(i, top) = q * H(i, top) - p * z;
+                    }
+                    if (hasVectors)
+                        for (int i = low; i <= high; i++) {
+                            z = V(i, top - 1);
+                            V(i, top - 1) = q * z + p * V(i, top);
+                            V(i, top) = q * V(i, top) - p * z;
+                        }
+                } else {
+                    // complex pair
+                    d[top - 1] = x + p;
+                    d[top] = x + p;
+                    e[top - 1] = z;
+                    e[top] = -z;
+                }
+                top -= 2;
+                iter = 0;
+            } else {
+                // no convergence yet, form the shift
+                x = H(top, top);
+                y = 0;
+                w = 0;
+                if (l < top) {
+                    y = H(top - 1, top - 1);
+                    w = H(top, top - 1) * H(top - 1, top);
+                }
+                // Wilkinson's original ad hoc shift
+                if (iter == 10) {
+                    exshift += x;
+                    for (int i = low; i <= top; i++)
+                        H(i, i) -= x;
+                    s = std::abs(H(top, top - 1)) + std::abs(H(top - 1, top - 2));
+                    x = y = R(0.75) * s;
+                    w = R(-0.4375) * s * s;
+                }
+                // MATLAB's ad hoc shift
+                if (iter == 30) {
+                    s = (y - x) / 2;
+                    s = s * s + w;
+                    if (s > 0) {
+                        s = std::sqrt(s);
+                        if (y < x)
+                            s = -s;
+                        s = x - w / ((y - x) / 2 + s);
+                        for (int i = low; i <= top; i++)
+                            H(i, i) -= s;
+                        exshift += s;
+                        x = y = w = R(0.964);
+                    }
+                }
+                if (++iter > 100) {
+                    // give up on the rest, what is left keeps its diagonal
+                    converged = false;
+                    for (int i = low; i <= top; i++) {
+                        d[i] = H(i, i) + exshift;
+                        e[i] = 0;
+                    }
+                    hasVectors = false;
+                    v.clear();
+                    return;
+                }
+
+                // look for two consecutive small subdiagonal elements
+                int m = top - 2;
+                while (m >= l) {
+                    z = H(m, m);
+                    r = x - z;
+                    s = y - z;
+                    p = (r * s - w) / H(m + 1, m) + H(m, m + 1);
+                    q = H(m + 1, m + 1) - z - r - s;
+                    r = H(m + 2, m + 1);
+                    s = std::abs(p) + std::abs(q) + std::abs(r);
+                    p /= s;
+                    q /= s;
+                    r /= s;
+                    if (m == l)
+                        break;
+                    if (std::abs(H(m, m - 1)) * (std::abs(q) + std::abs(r))
+                        < eps * (std::abs(p) * (std::abs(H(m - 1, m - 1)) + std::abs(z) + std::abs(H(m + 1, m + 1)))))
+                        break;
+                    m--;
+                }
+                for (int i = m + 2; i <= top; i++) {
+                    H(i, i - 2) = 0;
+                    if (i > m + 2)
+                        H(i, i - 3) = 0;
+                }
+
+                // double QR step on rows l..top and columns m..top
+                for (int k = m; k <= top - 1; k++) {
+                    const bool notlast = k != top - 1;
+                    if (k != m) {
+                        p = H(k, k - 1);
+                        q = H(k + 1, k - 1);
+                        r = notlast ? H(k + 2, k - 1) : R(0);
+                        x = std::abs(p) + std::abs(q) + std::abs(r);
+                        if (x == R(0))
+                            continue;
+                        p /= x;
+                        q /= x;
+                        r /= x;
+                    }
+                    s = std::sqrt(p * p + q * q + r * r);
+                    if (p < 0)
+                        s = -s;
+                    if (s == R(0))
+                        continue;
+                    if (k != m)
+                        H(k, k - 1) = -s * x;
+                    else if (l != m)
+                        H(k, k - 1) = -H(k, k - 1);
+                    p += s;
+                    x = p / s;
+                    y = q / s;
+                    z = r / s;
+                    q /= p;
+                    r /= p;
+                    for (int j = k; j < nn; j++) {
+                        p = H(k, j) + q * H(k + 1, j);
+                        if (notlast) {
+                            p += r * H(k + 2, j);
+                            H(k + 2, j) -= p * z;
+                        }
+                        H(k, j) -= p * x;
+                        H(k + 1, j) -= p * y;
+                    }
+                    for (int i = 0; i <= std::min(top, k + 3); i++) {
+                        p = x * H(i, k) + y * H(i, k + 1);
+                        if (notlast) {
+                            p += z * H(i, k + 2);
+                            H(i, k + 2) -= p * r;
+                        }
+                        H(i, k) -= p;
+                        H(i, k + 1) -= p * q;
+                    }
+                    if (hasVectors)
+                        for (int i = low; i <= high; i++) {
+                            p = x * V(i, k) + y * V(i, k + 1);
+                            if (notlast) {
+                                p += z * V(i, k + 2);
+                                V(i, k + 2) -= p * r;
+                            }
+                            V(i, k) -= p;
+                            V(i, k + 1) -= p * q;
+                        }
+                }
+            }
+        }
+        if (!hasVectors || norm == R(0))
+            return;
+
+        // back substitute for the eigenvectors of the upper triangular form
+        for (top = nn - 1; top >= 0; top--) {
+            p = d[top];
+            q = e[top];
+            if (q == R(0)) {
+                // real vector
+                int l = top;
+                H(top, top) = 1;
+                for (int i = top - 1; i >= 0; i--) {
+                    w = H(i, i) - p;
+                    r = 0;
+                    for (int j = l; j <= top; j++)
+                        r += H(i, j) * H(j, top);
+                    if (e[i] < 0) {
+                        z = w;
+                        s = r;
+                    } else {
+                        l = i;
+                        if (e[i] == R(0)) {
+                            H(i, top) = w != R(0) ? -r / w : -r / (eps * norm);
+                        } else {
+                            x = H(i, i + 1);
+                            y = H(i + 1, i);
+                            q = (d[i] - p) * (d[i] - p) + e[i] * e[i];
+                            t = (x * s - z * r) / q;
+                            H(i, top) = t;
+                            H(i + 1, top) = std::abs(x) > std::abs(z) ? (-r - w * t) / x : (-s - y * t) / z;
+                        }
+                        // overflow control
+                        t = std::abs(H(i, top));
+                        if ((eps * t) * t > 1)
+                            for (int j = i; j <= top; j++)
+                                H(j, top) /= t;
+                    }
+                }
+            } else if (q < 0) {
+                // complex vector, the last component is imaginary
+                int l = top - 1;
+                if (std::abs(H(top, top - 1)) > std::abs(H(top - 1, top))) {
+                    H(top - 1, top - 1) = q / H(top, top - 1);
+                    H(top - 1, top) = -(H(top, top) - p) / H(top, top - 1);
+                } else {
+                    const std::complex<R> c = eigen_detail::cdiv(R(0), -H(top - 1, top), H(top - 1, top - 1) - p, q);
+                    H(top - 1, top - 1) = c.real();
+                    H(top - 1, top) = c.imag();
+                }
+                H(top, top - 1) = 0;
+                H(top, top) = 1;
+                for (int i = top - 2; i >= 0; i--) {
+                    R ra = 0, sa = 0;
+                    for (int j = l; j <= top; j++) {
+                        ra += H(i, j) * H(j, top - 1);
+                        sa += H(i, j) * H(j, top);
+                    }
+                    w = H(i, i) - p;
+                    if (e[i] < 0) {
+                        z = w;
+                        r = ra;
+                        s = sa;
+                    } else {
+                        l = i;
+                        if (e[i] == R(0)) {
+                            const std::complex<R> c = eigen_detail::cdiv(-ra, -sa, w, q);
+                            H(i, top - 1) = c.real();
+                            H(i, top) = c.imag();
+                        } else {
+                            x = H(i, i + 1);
+                            y = H(i + 1, i);
+                            R vr = (d[i] - p) * (d[i] - p) + e[i] * e[i] - q * q;
+                            const R vi = (d[i] - p) * 2 * q;
+                            if (vr == R(0) && vi == R(0))
+                                vr = eps * norm * (std::abs(w) + std::abs(q) + std::abs(x) + std::abs(y) + std::abs(z));
+                            const std::complex<R> c = eigen_detail::cdiv(x * r - z * ra + q * sa,
+                                                                         x * s - z * sa - q * ra, vr, vi);
+                            H(i, top - 1) = c.real();
+                            H(i, top) = c.imag();
+                            if (std::abs(x) > std::abs(z) + std::abs(q)) {
+                                H(i + 1, top - 1) = (-ra - w * H(i, top - 1) + q * H(i, top)) / x;
+                                H(i + 1, top) = (-sa - w * H(i, top) - q * H(i, top - 1)) / x;
+                            } else {
+                                const std::complex<R> c2 = eigen_detail::cdiv(-r - y * H(i, top - 1),
+                                                                              -s - y * H(i, top), z, q);
+                                H(i + 1, top - 1) = c2.real();
+                                H(i + 1, top) = c2.imag();
+                            }
+                        }
+                        // overflow control
+                        t = std::max(std::abs(H(i, top - 1)), std::abs(H(i, top)));
+                        if ((eps * t) * t > 1)
+                            for (int j = i; j <= top; j++) {
+                                H(j, top - 1) /= t;
+                                H(j, top) /= t;
+                            }
+                    }
+                }
+            }
+        }
+
+        // back transformation to the eigenvectors of the original matrix,
+        // row by row: V(i, j) = sum over k <= j of V(i, k) * H(k, j)
+        std::vector<R> row(nn);
+        for (int i = low; i <= high; i++) {
+            std::fill(row.begin(), row.end(), R(0));
+            for (int k = low; k <= high; k++) {
+                const R vik = V(i, k);
+                if (vik == R(0))
+                    continue;
+                const R* hk = h.data() + std::size_t(k) * nn;
+                for (int j = k; j < nn; j++)
+                    row[j] += vik * hk[j];
+            }
+            std::copy(row.begin(), row.end(), v.begin() + std::size_t(i) * nn);
+        }
+    }
+
+    template<typename T>
+    std::vector<std::complex<typename EigenSolver<T>::R>> EigenSolver<T>::eigenvalues() const {
+        std::vector<std::complex<R>> result(n);
+        for (int k = 0; k < n; k++)
+            result[k] = { re[k], im[k] };
+        return result;
+    }
+
+    template<typename T>
+    std::vector<std::complex<typename EigenSolver<T>::R>> EigenSolver<T>::eigenvector(int k) const {
+        assert(hasVectors && k >= 0 && k < n);
+        std::vector<std::complex<R>> x(n);
+        R norm = 0;
+        for (int i = 0; i < n; i++) {
+            const R* row = v.data() + std::size_t(i) * n;
+            if (im[k] == R(0))
+                x[i] = { row[k], R(0) };
+            else if (im[k] > 0)
+                x[i] = { row[k], row[k + 1] };
+            else
+                x[i] = { row[k - 1], -row[k] };
+            norm += std::norm(x[i]);
+        }
+        norm = std::sqrt(norm);
+        if (norm > 0)
+            for (auto& c : x)
+                c /= norm;
+        return x;
+    }
+
+//*****************************************************************************
+// Krylov solvers
+//*****************************************************************************
+    namespace eigen_detail {
+        template<typename R, typename Operator>
+        void apply(const Operator& op, const std::vector<R>& x, std::vector<R>& y) {
+            if constexpr (std::is_same_v<Operator, MatrixND<R>>) {
+                y.assign(op.rows, R(0));
+                for (int i = 0; i < op.rows; i++) {
+                    const R* row = op.data.data() + std::size_t(i) * op.cols;
+                    R sum = 0;
+                    for (int j = 0; j < op.cols; j++)
+                        sum += row[j] * x[j];
+                    y[i] = sum;
+                }
+            } else if constexpr (requires { op.multiply(x, y); }) {
+                op.multiply(x, y);
+            } else {
+                op(x, y);
+            }
+        }
+
+        template<typename R>
+        R dot(const std::vector<R>& a, const std::vector<R>& b) {
+            R s = 0;
+            for (std::size_t i = 0; i < a.size(); i++)
+                s += a[i] * b[i];
+            return s;
+        }
+
+        // true when Ritz value a should come before b
+        template<typename R>
+        bool before(EigenTarget target, const std::complex<R>& a, const std::complex<R>& b) {
+            R ka, kb;
+            switch (target) {
+                case EigenTarget::LargestAlgebraic:
+                    ka = a.real();
+                    kb = b.real();
+                    break;
+                case EigenTarget::SmallestAlgebraic:
+                    ka = -a.real();
+                    kb = -b.real();
+                    break;
+                default:
+                    ka = std::abs(a);
+                    kb = std::abs(b);
+                    break;
+            }
+            return ka != kb ? ka > kb : a.imag() > b.imag();
+        }
+
+        /**
+         * Arnoldi process with full (twice repeated Gram-Schmidt) orthogonalization
+         * and thick restarts. After m steps A*V = V*H + beta*v_m*e_m^T. The Ritz
+         * vectors wanted most, real and imaginary parts of complex pairs separately,
+         * span an invariant subspace Y of H, so [V*Y, v_m] with the projected
+         * Y^T*H*Y and the coupling row beta*e_m^T*Y is again an Arnoldi relation
+         * the process continues from. For a symmetric operator H is symmetric and
+         * this is the thick restart Lanczos method.
+         */
+        template<typename R, bool symmetric, typename Operator>
+        KrylovResult<std::complex<R>> krylov(int n, const Operator& op, int k, EigenTarget target,
+                                             R tolerance, int basis, int maxRestarts) {
+            KrylovResult<std::complex<R>> result;
+            k = std::clamp(k, 0, n);
+            if (k == 0) {
+                result.converged = true;
+                return result;
+            }
+            int m = basis > 0 ? basis : std::max(2 * k + 1, 20);
+            m = std::min(std::max(m, k + 2), n);
+            const R eps = std::numeric_limits<R>::epsilon();
+            const R floor = std::pow(eps, R(2) / 3);
+
+            std::vector<std::vector<R>> V(m + 1, std::vector<R>(n, R(0)));
+            std::vector<R> H(std::size_t(m + 1) * m, R(0));  // (m + 1) x m, row-major
+            std::vector<R> w(n), h(m + 1);
+            {
+                std::mt19937 random(5489u);
+                std::uniform_real_distribution<R> uniform(R(-1), R(1));
+                for (auto& x : V[0])
+                    x = uniform(random);
+                const R norm = std::sqrt(dot(V[0], V[0]));
+                for (auto& x : V[0])
+                    x /= norm;
+            }
+
+            int start = 0;
+            for (int restart = 0;; restart++) {
+                // extend the factorization to m columns
+                int size = m;
+                R hnorm = 0;
+                for (int j = start; j < m; j++) {
+                    apply<R>(op, V[j], w);
+                    result.iterations++;
+                    std::fill(h.begin(), h.end(), R(0));
+                    for (int pass = 0; pass < 2; pass++)
+                        for (int i = 0; i <= j; i++) {
+                            const R c = dot(V[i], w);
+                            h[i] += c;
+                            for (int x = 0; x < n; x++)
+                                w[x] -= c * V[i][x];
+                        }
+                    for (int i = 0; i <= j; i++) {
+                        H[std::size_t(i) * m + j] = h[i];
+                        hnorm = std::max(hnorm, std::abs(h[i]));
+                    }
+                    const R beta = std::sqrt(dot(w, w));
+                    H[std::size_t(j + 1) * m + j] = beta;
+                    if (beta <= 16 * eps * std::max(hnorm, R(1)) * std::sqrt(R(n))) {
+                        // invariant subspace, its Ritz pairs are exact
+                        size = j + 1;
+                        H[std::size_t(j + 1) * m + j] = 0;
+                        break;
+                    }
+                    for (int x = 0; x < n; x++)
+                        V[j + 1][x] = w[x] / beta;
+                }
+                const R beta = size < m || m == n ? R(0) : H[std::size_t(m) * m + m - 1];
+
+                // Ritz pairs of the leading size x size block
+                std::vector<R> block(std::size_t(size) * size);
+                for (int i = 0; i < size; i++)
+                    for (int j = 0; j < size; j++)
+                        block[std::size_t(i) * size + j] = symmetric
+                                ? (H[std::size_t(i) * m + j] + H[std::size_t(j) * m + i]) / 2
+                                : H[std::size_t(i) * m + j];
+                std::vector<std::complex<R>> theta(size);
+                std::vector<std::vector<std::complex<R>>> ritz(size);
+                if constexpr (symmetric) {
+                    SymmetricEigenSolver<R> solver(std::move(block), size);
+                    for (int i = 0; i < size; i++) {
+                        theta[i] = solver.eigenvalues()[i];
+                        const std::vector<R> s = solver.eigenvector(i);
+                        ritz[i].assign(s.begin(), s.end());
+                    }
+                } else {
+                    EigenSolver<R> solver(std::move(block), size);
+                    theta = solver.eigenvalues();
+                    for (int i = 0; i < size; i++)
+                        ritz[i] = solver.eigenvector(i);
+                }
+                std::vector<int> order(size);
+                std::iota(order.begin(), order.end(), 0);
+                std::stable_sort(order.begin(), order.end(),
+                                 [&](int a, int b) { return before(target, theta[a], theta[b]); });
+                const int wanted = std::min(k, size);
+
+                R worst = 0;
+                for (int c = 0; c < wanted; c++) {
+                    const int i = order[c];
+                    const R res = std::abs(beta) * std::abs(ritz[i][size - 1]);
+                    worst = std::max(worst, res / std::max(std::abs(theta[i]), floor));
+                }
+                const bool done = worst <= tolerance || size < m || m == n;
+                if (done || restart >= maxRestarts) {
+                    result.converged = done;
+                    result.residual = double(worst);
+                    for (int c = 0; c < wanted; c++) {
+                        const int i = order[c];
+                        std::vector<std::complex<R>> x(n);
+                        for (int j = 0; j < size; j++)
+                            for (int e = 0; e < n; e++)
+                                x[e] += ritz[i][j] * V[j][e];
+                        result.values.push_back(theta[i]);
+                        result.vectors.push_back(std::move(x));
+                    }
+                    return result;
+                }
+
+                // real basis Y of the Ritz vectors kept, complex pairs as two columns
+                const int keep = std::min(m - 1, k + (m - k) / 2);
+                std::vector<std::vector<R>> Y;
+                for (int c = 0; c < size && int(Y.size()) < keep; c++) {
+                    const int i = order[c];
+                    if (theta[i].imag() == R(0)) {
+                        std::vector<R> y(size);
+                        for (int j = 0; j < size; j++)
+                            y[j] = ritz[i][j].real();
+                        Y.push_back(std::move(y));
+                    } else if (theta[i].imag() > 0 || c == 0 || theta[order[c - 1]] != std::conj(theta[i])) {
+                        if (int(Y.size()) + 2 > m - 1)
+                            break;
+                        std::vector<R> yr(size), yi(size);
+                        for (int j = 0; j < size; j++) {
+                            yr[j] = ritz[i][j].real();
+                            yi[j] = ritz[i][j].imag();
+                        }
+                        Y.push_back(std::move(yr));
+                        Y.push_back(std::move(yi));
+                    }
+                }
+                // orthonormalize, dropping columns that turn out dependent
+                std::vector<std::vector<R>> Q;
+                for (auto& y : Y) {
+                    for (int pass = 0; pass < 2; pass++)
+                        for (const auto& q : Q) {
+                            const R c = dot(q, y);
+                            for (int j = 0; j < size; j++)
+                                y[j] -= c * q[j];
+                        }
+                    const R norm = std::sqrt(dot(y, y));
+                    if (norm <= std::sqrt(eps))
+                        continue;
+                    for (auto& x : y)
+                        x /= norm;
+                    Q.push_back(std::move(y));
+                }
+                const int l = static_cast<int>(Q.size());
+
+                // H' = [Q^T H Q ; beta * e_m^T Q], V' = [V Q, v_m]
+                std::vector<R> hq(std::size_t(size) * l, R(0));
+                for (int i = 0; i < size; i++)
+                    for (int b = 0; b < l; b++) {
+                        R sum = 0;
+                        for (int j = 0; j < size; j++)
+                            sum += H[std::size_t(i) * m + j] * Q[b][j];
+                        hq[std::size_t(i) * l + b] = sum;
+                    }
+                std::fill(H.begin(), H.end(), R(0));
+                for (int a = 0; a < l; a++)
+                    for (int b = 0; b < l; b++) {
+                        R sum = 0;
+                        for (int i = 0; i < size; i++)
+                            sum += Q[a][i] * hq[std::size_t(i) * l + b];
+                        H[std::size_t(a) * m + b] = sum;
+                    }
+                for (int b = 0; b < l; b++)
+                    H[std::size_t(l) * m + b] = beta * Q[b][size - 1];
+
+                std::vector<std::vector<R>> U(l, std::vector<R>(n, R(0)));
+                for (int a = 0; a < l; a++)
+                    for (int j = 0; j < size; j++) {
+                        const R c = Q[a][j];
+                        for (int x = 0; x < n; x++)
+                            U[a][x] += c * V[j][x];
+                    }
+                V[l].swap(V[m]);
+                for (int a = 0; a < l; a++)
+                    V[a].swap(U[a]);
+                start = l;
+            }
+        }
+    }
+
+    template<typename T, typename Operator>
+    KrylovResult<T> lanczos(int n, const Operator& op, int k, EigenTarget target, T tolerance, int basis,
+                            int maxRestarts) {
+        static_assert(std::is_floating_point_v<T>, "lanczos works on floating point vectors");
+        KrylovResult<std::complex<T>> pairs =
+                eigen_detail::krylov<T, true>(n, op, k, target, tolerance, basis, maxRestarts);
+        KrylovResult<T> result;
+        result.iterations = pairs.iterations;
+        result.residual = pairs.residual;
+        result.converged = pairs.converged;
+        for (std::size_t i = 0; i < pairs.values.size(); i++) {
+            result.values.push_back(pairs.values[i].real());
+            std::vector<T> x(pairs.vectors[i].size());
+            for (std::size_t j = 0; j < x.size(); j++)
+                x[j] = pairs.vectors[i][j].real();
+            result.vectors.push_back(std::move(x));
+        }
+        return result;
+    }
+
+    template<typename T, typename Operator>
+    KrylovResult<std::complex<T>> arnoldi(int n, const Operator& op, int k, EigenTarget target, T tolerance,
+                                          int basis, int maxRestarts) {
+        static_assert(std::is_floating_point_v<T>, "arnoldi works on floating point vectors");
+        return eigen_detail::krylov<T, false>(n, op, k, target, tolerance, basis, maxRestarts);
+    }
+} // namespace rez
+#endif //PHYSICSFORMULA_MATRIXEIGEN_H
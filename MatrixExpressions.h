@@ -0,0 +1,404 @@
+#ifndef PHYSICSFORMULA_MATRIXEXPRESSIONS_H
+#define PHYSICSFORMULA_MATRIXEXPRESSIONS_H
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+template<typename T> class MatrixND;
+template<typename T> class VectorND;
+namespace rez {
+    template<typename E> struct ArrayExpression;
+    // defined in MatrixReduction.h
+    template<typename E> class ColwiseReduction;
+    template<typename E> class RowwiseReduction;
+}
+
+/**
+ * @brief lazy element-wise expressions for MatrixND and VectorND.
+ * The arithmetic operators build small expression nodes instead of
+ * temporaries, so a chain like A*alpha + B - C is evaluated in a single
+ * loop when it is finally assigned to a MatrixND (or VectorND), which
+ * allocates the output once, or reuses its storage when assigned into an
+ * existing object of the same size.
+ *
+ * array() switches to Eigen's array semantics: * and / between two arrays
+ * are coefficient-wise, scalars can appear on either side of any operator,
+ * and square(), sqrt(), exp(), log(), abs() and pow() apply per element.
+ *
+ * Nodes keep pointers to the named matrices they read from, so an
+ * expression held in an auto variable must not outlive them. A temporary
+ * MatrixND operand, as in auto e = f() + Q, is moved into the node and lives
+ * as long as it does (the VectorND member operators still read both sides in
+ * place). Operands of different shapes give an empty 0 x 0 expression, as
+ * MatrixND::add does. Call eval() to turn any expression into a MatrixND on
+ * the spot.
+ */
+namespace rez {
+    // CRTP base of every expression node
+    template<typename E>
+    struct MatrixExpression {
+        [[nodiscard]] const E& self() const { return static_cast<const E&>(*this); }
+        [[nodiscard]] int rows() const { return self().rows(); }
+        [[nodiscard]] int cols() const { return self().cols(); }
+        [[nodiscard]] std::size_t size() const {
+            return static_cast<std::size_t>(rows()) * cols();
+        }
+        auto operator[](std::size_t i) const { return self()[i]; }
+        // materialize the expression into a new matrix
+        auto eval() const {
+            using V = std::decay_t<decltype(self()[0])>;
+            return MatrixND<V>(self());
+        }
+        // coefficient-wise view of the expression
+        ArrayExpression<E> array() const { return ArrayExpression<E>(self()); }
+    };
+
+    // reads the contiguous storage of a MatrixND or VectorND
+    template<typename T>
+    struct ExpressionLeaf : MatrixExpression<ExpressionLeaf<T>> {
+        const T* p;
+        int r, c;
+        ExpressionLeaf(const T* _p, int _r, int _c) : p(_p), r(_r), c(_c) {}
+        [[nodiscard]] int rows() const { return r; }
+        [[nodiscard]] int cols() const { return c; }
+        T operator[](std::size_t i) const { return p[i]; }
+    };
+
+    struct OpAdd { template<typename A, typename B> static auto apply(const A& a, const B& b) { return a + b; } };
+    struct OpSub { template<typename A, typename B> static auto apply(const A& a, const B& b) { return a - b; } };
+    struct OpMul { template<typename A, typename B> static auto apply(const A& a, const B& b) { return a * b; } };
+    struct OpDiv { template<typename A, typename B> static auto apply(const A& a, const B& b) { return a / b; } };
+
+    // element-wise combination of two equally shaped expressions, empty
+    // when the shapes differ
+    template<typename L, typename R, typename Op>
+    struct BinaryExpression : MatrixExpression<BinaryExpression<L, R, Op>> {
+        L lhs;
+        R rhs;
+        bool matched;
+        BinaryExpression(L _l, R _r) : lhs(std::move(_l)), rhs(std::move(_r)),
+                matched(lhs.rows() == rhs.rows() && lhs.cols() == rhs.cols()) {}
+        [[nodiscard]] int rows() const { return matched ? lhs.rows() : 0; }
+        [[nodiscard]] int cols() const { return matched ? lhs.cols() : 0; }
+        auto operator[](std::size_t i) const { return Op::apply(lhs[i], rhs[i]); }
+    };
+
+    // expression combined with a scalar, scalarOnLeft selects s op e
+    template<typename E, typename S, typename Op, bool scalarOnLeft>
+    struct ScalarExpression : MatrixExpression<ScalarExpression<E, S, Op, scalarOnLeft>> {
+        E expr;
+        S scalar;
+        ScalarExpression(E _e, const S& _s) : expr(std::move(_e)), scalar(_s) {}
+        [[nodiscard]] int rows() const { return expr.rows(); }
+        [[nodiscard]] int cols() const { return expr.cols(); }
+        auto operator[](std::size_t i) const {
+            if constexpr (scalarOnLeft)
+                return Op::apply(scalar, expr[i]);
+            else
+                return Op::apply(expr[i], scalar);
+        }
+    };
+
+    template<typename E>
+    struct NegateExpression : MatrixExpression<NegateExpression<E>> {
+        E expr;
+        explicit NegateExpression(E _e) : expr(std::move(_e)) {}
+        [[nodiscard]] int rows() const { return expr.rows(); }
+        [[nodiscard]] int cols() const { return expr.cols(); }
+        auto operator[](std::size_t i) const { return -expr[i]; }
+    };
+
+    struct OpSquare { template<typename A> static auto apply(const A& a) { return a * a; } };
+    struct OpSqrt { template<typename A> static auto apply(const A& a) { using std::sqrt; return sqrt(a); } };
+    struct OpExp { template<typename A> static auto apply(const A& a) { using std::exp; return exp(a); } };
+    struct OpLog { template<typename A> static auto apply(const A& a) { using std::log; return log(a); } };
+    struct OpAbs { template<typename A> static auto apply(const A& a) { using std::abs; return abs(a); } };
+    struct OpPow {
+        template<typename A, typename B>
+        static auto apply(const A& a, const B& b) { using std::pow; return pow(a, b); }
+    };
+
+    // function applied to every element
+    template<typename E, typename Op>
+    struct UnaryExpression : MatrixExpression<UnaryExpression<E, Op>> {
+        E expr;
+        explicit UnaryExpression(E _e) : expr(std::move(_e)) {}
+        [[nodiscard]] int rows() const { return expr.rows(); }
+        [[nodiscard]] int cols() const { return expr.cols(); }
+        auto operator[](std::size_t i) const { return Op::apply(expr[i]); }
+    };
+
+    // wraps operands so matrices, vectors and nodes can be mixed freely
+    template<typename X, typename = void>
+    struct expression_operand {
+        static constexpr bool value = false;
+        static constexpr bool node = false;
+    };
+
+    template<typename E>
+    struct expression_operand<E, std::enable_if_t<std::is_base_of_v<MatrixExpression<E>, E>>> {
+        static constexpr bool value = true;
+        static constexpr bool node = true;
+        static const E& wrap(const E& e) { return e; }
+    };
+
+    template<typename T>
+    struct expression_operand<MatrixND<T>> {
+        static constexpr bool value = true;
+        static constexpr bool node = false;
+        static ExpressionLeaf<T> wrap(const MatrixND<T>& m) {
+            return ExpressionLeaf<T>(m.data.data(), m.rows, m.cols);
+        }
+    };
+
+    template<typename T>
+    struct expression_operand<VectorND<T>> {
+        static constexpr bool value = true;
+        static constexpr bool node = false;
+        static ExpressionLeaf<T> wrap(const VectorND<T>& v) {
+            return ExpressionLeaf<T>(v.data(), static_cast<int>(v.size()), 1);
+        }
+    };
+
+    template<typename X>
+    using expression_t = std::decay_t<decltype(expression_operand<X>::wrap(std::declval<const X&>()))>;
+
+    template<typename X>
+    expression_t<X> asExpression(const X& x) { return expression_operand<X>::wrap(x); }
+
+    // owns a MatrixND or VectorND that was a temporary operand
+    template<typename M>
+    struct ExpressionValue : MatrixExpression<ExpressionValue<M>> {
+        M value;
+        explicit ExpressionValue(M&& _value) : value(std::move(_value)) {}
+        [[nodiscard]] int rows() const { return expression_operand<M>::wrap(value).rows(); }
+        [[nodiscard]] int cols() const { return expression_operand<M>::wrap(value).cols(); }
+        auto operator[](std::size_t i) const { return expression_operand<M>::wrap(value)[i]; }
+    };
+
+    // how a forwarded operand is stored in a node: nodes by value, named
+    // matrices and vectors by pointer, temporary ones moved into the node
+    template<typename X>
+    using operand_t = std::conditional_t<!std::is_lvalue_reference_v<X> && !expression_operand<std::decay_t<X>>::node,
+                                         ExpressionValue<std::decay_t<X>>, expression_t<std::decay_t<X>>>;
+
+    template<typename X>
+    operand_t<X> toExpression(X&& x) {
+        if constexpr (expression_operand<std::decay_t<X>>::node)
+            return std::forward<X>(x);
+        else if constexpr (std::is_lvalue_reference_v<X>)
+            return asExpression(x);
+        else
+            return ExpressionValue<std::decay_t<X>>(std::move(x));
+    }
+
+    template<typename Op, typename L, typename R>
+    auto makeBinary(L&& l, R&& r) {
+        return BinaryExpression<operand_t<L>, operand_t<R>, Op>(toExpression(std::forward<L>(l)),
+                                                               toExpression(std::forward<R>(r)));
+    }
+
+    template<typename E>
+    constexpr bool node_v = expression_operand<std::decay_t<E>>::node;
+
+    // arrays have their own operators, see below
+    template<typename X>
+    struct is_array_expression : std::false_type {};
+    template<typename E>
+    struct is_array_expression<ArrayExpression<E>> : std::true_type {};
+    template<typename X>
+    constexpr bool array_v = is_array_expression<std::decay_t<X>>::value;
+
+    // true when L op R should build a node: both are operands and at least
+    // one of them already is a node (plain matrix op matrix goes through the
+    // member operators)
+    template<typename L, typename R>
+    constexpr bool lazy_pair_v = expression_operand<std::decay_t<L>>::value && expression_operand<std::decay_t<R>>::value
+                                 && (node_v<L> || node_v<R>) && !(array_v<L> && array_v<R>);
+
+    template<typename L, typename S>
+    constexpr bool lazy_scalar_v = expression_operand<std::decay_t<L>>::value && std::is_arithmetic_v<S>;
+
+    template<typename L, typename R>
+    constexpr bool operand_pair_v = expression_operand<std::decay_t<L>>::value && expression_operand<std::decay_t<R>>::value;
+
+    template<typename L, typename R, std::enable_if_t<lazy_pair_v<L, R>, int> = 0>
+    auto operator+(L&& l, R&& r) {
+        return makeBinary<OpAdd>(std::forward<L>(l), std::forward<R>(r));
+    }
+
+    template<typename L, typename R, std::enable_if_t<lazy_pair_v<L, R>, int> = 0>
+    auto operator-(L&& l, R&& r) {
+        return makeBinary<OpSub>(std::forward<L>(l), std::forward<R>(r));
+    }
+
+    // element-wise (Hadamard) product of two expressions
+    template<typename L, typename R, std::enable_if_t<operand_pair_v<L, R>, int> = 0>
+    auto cwiseProduct(L&& l, R&& r) {
+        return makeBinary<OpMul>(std::forward<L>(l), std::forward<R>(r));
+    }
+
+    template<typename L, typename R, std::enable_if_t<operand_pair_v<L, R>, int> = 0>
+    auto cwiseQuotient(L&& l, R&& r) {
+        return makeBinary<OpDiv>(std::forward<L>(l), std::forward<R>(r));
+    }
+
+    template<typename E, std::enable_if_t<node_v<E> && !array_v<E>, int> = 0>
+    auto operator-(E&& e) {
+        return NegateExpression<std::decay_t<E>>(std::forward<E>(e));
+    }
+
+    template<typename E, typename S, std::enable_if_t<lazy_scalar_v<E, S> && node_v<E> && !array_v<E>, int> = 0>
+    auto operator*(E&& e, const S& s) {
+        return ScalarExpression<std::decay_t<E>, S, OpMul, false>(std::forward<E>(e), s);
+    }
+
+    template<typename E, typename S, std::enable_if_t<lazy_scalar_v<E, S> && !array_v<E>, int> = 0>
+    auto operator*(const S& s, E&& e) {
+        return ScalarExpression<operand_t<E>, S, OpMul, true>(toExpression(std::forward<E>(e)), s);
+    }
+
+    template<typename E, typename S, std::enable_if_t<lazy_scalar_v<E, S> && node_v<E> && !array_v<E>, int> = 0>
+    auto operator/(E&& e, const S& s) {
+        return ScalarExpression<std::decay_t<E>, S, OpDiv, false>(std::forward<E>(e), s);
+    }
+
+    template<typename E, typename S, std::enable_if_t<lazy_scalar_v<E, S> && node_v<E> && !array_v<E>, int> = 0>
+    auto operator+(E&& e, const S& s) {
+        return ScalarExpression<std::decay_t<E>, S, OpAdd, false>(std::forward<E>(e), s);
+    }
+
+    template<typename E, typename S, std::enable_if_t<lazy_scalar_v<E, S> && node_v<E> && !array_v<E>, int> = 0>
+    auto operator-(E&& e, const S& s) {
+        return ScalarExpression<std::decay_t<E>, S, OpSub, false>(std::forward<E>(e), s);
+    }
+
+    // Eigen style array view, every operation on it gives another array
+    template<typename E>
+    struct ArrayExpression : MatrixExpression<ArrayExpression<E>> {
+        E expr;
+        explicit ArrayExpression(E _e) : expr(std::move(_e)) {}
+        [[nodiscard]] int rows() const { return expr.rows(); }
+        [[nodiscard]] int cols() const { return expr.cols(); }
+        auto operator[](std::size_t i) const { return expr[i]; }
+
+        auto square() const { return ArrayExpression<UnaryExpression<E, OpSquare>>(UnaryExpression<E, OpSquare>(expr)); }
+        auto sqrt() const { return ArrayExpression<UnaryExpression<E, OpSqrt>>(UnaryExpression<E, OpSqrt>(expr)); }
+        auto exp() const { return ArrayExpression<UnaryExpression<E, OpExp>>(UnaryExpression<E, OpExp>(expr)); }
+        auto log() const { return ArrayExpression<UnaryExpression<E, OpLog>>(UnaryExpression<E, OpLog>(expr)); }
+        auto abs() const { return ArrayExpression<UnaryExpression<E, OpAbs>>(UnaryExpression<E, OpAbs>(expr)); }
+        template<typename S>
+        auto pow(const S& p) const {
+            return ArrayExpression<ScalarExpression<E, S, OpPow, false>>(ScalarExpression<E, S, OpPow, false>(expr, p));
+        }
+        // back to matrix semantics
+        const E& matrix() const { return expr; }
+
+        // reductions over all elements
+        auto sum() const {
+            std::decay_t<decltype(expr[0])> total{};
+            for (std::size_t i = 0; i < this->size(); i++)
+                total += expr[i];
+            return total;
+        }
+        auto mean() const { return sum() / static_cast<std::decay_t<decltype(expr[0])>>(this->size()); }
+        auto minCoeff() const {
+            auto m = expr[0];
+            for (std::size_t i = 1; i < this->size(); i++)
+                m = expr[i] < m ? expr[i] : m;
+            return m;
+        }
+        auto maxCoeff() const {
+            auto m = expr[0];
+            for (std::size_t i = 1; i < this->size(); i++)
+                m = m < expr[i] ? expr[i] : m;
+            return m;
+        }
+        // partial reductions, see MatrixReduction.h
+        ColwiseReduction<E> colwise() const { return ColwiseReduction<E>(expr); }
+        RowwiseReduction<E> rowwise() const { return RowwiseReduction<E>(expr); }
+
+        // free function spellings, pow(x.array(), 2) as in Eigen. Hidden friends,
+        // only found through an array argument, so they never hide std::pow and
+        // friends from unqualified calls elsewhere in namespace rez
+        template<typename S, std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+        friend auto pow(const ArrayExpression& a, const S& p) { return a.pow(p); }
+        friend auto sqrt(const ArrayExpression& a) { return a.sqrt(); }
+        friend auto exp(const ArrayExpression& a) { return a.exp(); }
+        friend auto log(const ArrayExpression& a) { return a.log(); }
+        friend auto abs(const ArrayExpression& a) { return a.abs(); }
+    };
+
+    template<typename A, typename B, typename Op>
+    using ArrayBinary = ArrayExpression<BinaryExpression<A, B, Op>>;
+    template<typename A, typename S, typename Op, bool scalarOnLeft>
+    using ArrayScalar = ArrayExpression<ScalarExpression<A, S, Op, scalarOnLeft>>;
+
+    template<typename A, typename B>
+    auto operator+(const ArrayExpression<A>& a, const ArrayExpression<B>& b) {
+        return ArrayBinary<A, B, OpAdd>(BinaryExpression<A, B, OpAdd>(a.expr, b.expr));
+    }
+    template<typename A, typename B>
+    auto operator-(const ArrayExpression<A>& a, const ArrayExpression<B>& b) {
+        return ArrayBinary<A, B, OpSub>(BinaryExpression<A, B, OpSub>(a.expr, b.expr));
+    }
+    template<typename A, typename B>
+    auto operator*(const ArrayExpression<A>& a, const ArrayExpression<B>& b) {
+        return ArrayBinary<A, B, OpMul>(BinaryExpression<A, B, OpMul>(a.expr, b.expr));
+    }
+    template<typename A, typename B>
+    auto operator/(const ArrayExpression<A>& a, const ArrayExpression<B>& b) {
+        return ArrayBinary<A, B, OpDiv>(BinaryExpression<A, B, OpDiv>(a.expr, b.expr));
+    }
+    template<typename A>
+    auto operator-(const ArrayExpression<A>& a) {
+        return ArrayExpression<NegateExpression<A>>(NegateExpression<A>(a.expr));
+    }
+
+    // array op scalar and scalar op array
+    template<typename A, typename S, std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+    auto operator+(const ArrayExpression<A>& a, const S& s) {
+        return ArrayScalar<A, S, OpAdd, false>(ScalarExpression<A, S, OpAdd, false>(a.expr, s));
+    }
+    template<typename A, typename S, std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+    auto operator+(const S& s, const ArrayExpression<A>& a) {
+        return ArrayScalar<A, S, OpAdd, true>(ScalarExpression<A, S, OpAdd, true>(a.expr, s));
+    }
+    template<typename A, typename S, std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+    auto operator-(const ArrayExpression<A>& a, const S& s) {
+        return ArrayScalar<A, S, OpSub, false>(ScalarExpression<A, S, OpSub, false>(a.expr, s));
+    }
+    template<typename A, typename S, std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+    auto operator-(const S& s, const ArrayExpression<A>& a) {
+        return ArrayScalar<A, S, OpSub, true>(ScalarExpression<A, S, OpSub, true>(a.expr, s));
+    }
+    template<typename A, typename S, std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+    auto operator*(const ArrayExpression<A>& a, const S& s) {
+        return ArrayScalar<A, S, OpMul, false>(ScalarExpression<A, S, OpMul, false>(a.expr, s));
+    }
+    template<typename A, typename S, std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+    auto operator*(const S& s, const ArrayExpression<A>& a) {
+        return ArrayScalar<A, S, OpMul, true>(ScalarExpression<A, S, OpMul, true>(a.expr, s));
+    }
+    template<typename A, typename S, std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+    auto operator/(const ArrayExpression<A>& a, const S& s) {
+        return ArrayScalar<A, S, OpDiv, false>(ScalarExpression<A, S, OpDiv, false>(a.expr, s));
+    }
+    template<typename A, typename S, std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+    auto operator/(const S& s, const ArrayExpression<A>& a) {
+        return ArrayScalar<A, S, OpDiv, true>(ScalarExpression<A, S, OpDiv, true>(a.expr, s));
+    }
+
+    // write an expression into a contiguous buffer of e.size() elements
+    template<typename T, typename E>
+    void evaluateInto(T* out, const MatrixExpression<E>& e) {
+        const E& expr = e.self();
+        const std::size_t n = expr.size();
+        for (std::size_t i = 0; i < n; i++)
+            out[i] = static_cast<T>(expr[i]);
+    }
+} // namespace rez
+
+#endif //PHYSICSFORMULA_MATRIXEXPRESSIONS_H
@@ -0,0 +1,408 @@
+#ifndef PHYSICSFORMULA_MATRIXFIXED_H
+#define PHYSICSFORMULA_MATRIXFIXED_H
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+#include "MatrixND.h"
+#include "MatrixScalar.h"
+#include "Vector.h"
+#include "Vector3D.h"
+
+/**
+ * @brief compile time sized matrices and vectors for the small 2x2, 3x3 and
+ * 4x4 kernels used throughout the physics code (rotations, inertia tensors,
+ * cross products). Storage is a row-major std::array so nothing touches the
+ * heap, every operation is constexpr, and products, determinants and
+ * inverses are written out element by element for the common sizes.
+ * Convert to and from MatrixND, rez::Vector and Vector3D when a value has
+ * to cross into the dynamically sized code.
+ */
+namespace rez {
+    template<typename T, std::size_t R, std::size_t C>
+    struct MatrixFixed {
+        static_assert(std::is_arithmetic_v<T>, "MatrixFixed can only store integral or floating points values");
+        static_assert(R > 0 && C > 0, "MatrixFixed needs at least one row and column");
+
+        std::array<T, R * C> data{};
+
+        constexpr MatrixFixed() = default;
+
+        // row-major element list, MatrixFixed<double,2,2> m{1, 2, 3, 4}
+        template<typename... Args,
+                 std::enable_if_t<sizeof...(Args) == R * C && (R * C > 1), int> = 0>
+        constexpr MatrixFixed(Args... args) : data{ static_cast<T>(args)... } {}
+
+        constexpr explicit MatrixFixed(const std::array<T, R * C>& _data) : data(_data) {}
+
+        // build from a MatrixND of matching shape
+        explicit MatrixFixed(const MatrixND<T>& m) {
+            assert(m.rows == static_cast<int>(R) && m.cols == static_cast<int>(C));
+            for (std::size_t i = 0; i < R * C; i++)
+                data[i] = m.data[i];
+        }
+
+        // column vector from a rez::Vector of the same dimension
+        template<typename U, std::size_t N = R, std::enable_if_t<C == 1 && N == R, int> = 0>
+        explicit MatrixFixed(const Vector<U, N>& v) {
+            for (std::size_t i = 0; i < R; i++)
+                data[i] = static_cast<T>(v.coords[i]);
+        }
+
+        // 3 component column vector from a Vector3D
+        template<std::size_t N = R, std::enable_if_t<C == 1 && N == 3, int> = 0>
+        explicit MatrixFixed(const Vector3D& v)
+                : data{ static_cast<T>(v.getX()), static_cast<T>(v.getY()), static_cast<T>(v.getZ()) } {}
+
+        [[nodiscard]] static constexpr std::size_t rows() { return R; }
+        [[nodiscard]] static constexpr std::size_t cols() { return C; }
+        [[nodiscard]] static constexpr std::size_t size() { return R * C; }
+
+        constexpr T& operator()(std::size_t r, std::size_t c) { return data[r * C + c]; }
+        constexpr const T& operator()(std::size_t r, std::size_t c) const { return data[r * C + c]; }
+        constexpr T& operator[](std::size_t i) { return data[i]; }
+        constexpr const T& operator[](std::size_t i) const { return data[i]; }
+
+        static constexpr MatrixFixed zero() { return MatrixFixed(); }
+
+        static constexpr MatrixFixed identity() {
+            static_assert(R == C, "identity needs a square matrix");
+            MatrixFixed m;
+            for (std::size_t i = 0; i < R; i++)
+                m(i, i) = T(1);
+            return m;
+        }
+
+        [[nodiscard]] MatrixND<T> toMatrixND() const {
+            return MatrixND<T>(std::vector<T>(data.begin(), data.end()), R, C);
+        }
+
+        template<std::size_t N = R, std::enable_if_t<C == 1 && N == R, int> = 0>
+        [[nodiscard]] Vector<T, N> toVector() const {
+            return Vector<T, N>(data);
+        }
+
+        template<std::size_t N = R, std::enable_if_t<C == 1 && N == 3, int> = 0>
+        [[nodiscard]] Vector3D toVector3D() const {
+            return Vector3D(data[0], data[1], data[2]);
+        }
+
+        constexpr MatrixFixed& operator+=(const MatrixFixed& o) {
+            for (std::size_t i = 0; i < R * C; i++)
+                data[i] += o.data[i];
+            return *this;
+        }
+
+        constexpr MatrixFixed& operator-=(const MatrixFixed& o) {
+            for (std::size_t i = 0; i < R * C; i++)
+                data[i] -= o.data[i];
+            return *this;
+        }
+
+        constexpr MatrixFixed& operator*=(T s) {
+            for (auto& v : data)
+                v *= s;
+            return *this;
+        }
+
+        constexpr MatrixFixed& operator/=(T s) {
+            for (auto& v : data)
+                v /= s;
+            return *this;
+        }
+
+        constexpr bool operator==(const MatrixFixed& o) const { return data == o.data; }
+        constexpr bool operator!=(const MatrixFixed& o) const { return data != o.data; }
+    };
+
+    template<typename T, std::size_t N>
+    using VectorFixed = MatrixFixed<T, N, 1>;
+
+    typedef MatrixFixed<double, 2, 2> Matrix2d;
+    typedef MatrixFixed<double, 3, 3> Matrix3d;
+    typedef MatrixFixed<double, 4, 4> Matrix4d;
+    typedef MatrixFixed<float, 3, 3>  Matrix3f;
+    typedef VectorFixed<double, 2>    Vector2dFixed;
+    typedef VectorFixed<double, 3>    Vector3dFixed;
+    typedef VectorFixed<double, 4>    Vector4dFixed;
+
+    template<typename T, std::size_t R, std::size_t C>
+    constexpr MatrixFixed<T, R, C> operator+(MatrixFixed<T, R, C> a, const MatrixFixed<T, R, C>& b) {
+        return a += b;
+    }
+
+    template<typename T, std::size_t R, std::size_t C>
+    constexpr MatrixFixed<T, R, C> operator-(MatrixFixed<T, R, C> a, const MatrixFixed<T, R, C>& b) {
+        return a -= b;
+    }
+
+    template<typename T, std::size_t R, std::size_t C>
+    constexpr MatrixFixed<T, R, C> operator-(MatrixFixed<T, R, C> a) {
+        for (auto& v : a.data)
+            v = -v;
+        return a;
+    }
+
+    template<typename T, std::size_t R, std::size_t C>
+    constexpr MatrixFixed<T, R, C> operator*(MatrixFixed<T, R, C> a, T s) {
+        return a *= s;
+    }
+
+    template<typename T, std::size_t R, std::size_t C>
+    constexpr MatrixFixed<T, R, C> operator*(T s, MatrixFixed<T, R, C> a) {
+        return a *= s;
+    }
+
+    template<typename T, std::size_t R, std::size_t C>
+    constexpr MatrixFixed<T, R, C> operator/(MatrixFixed<T, R, C> a, T s) {
+        return a /= s;
+    }
+
+    namespace fixed_detail {
+        // one element of a*b, the k sum is expanded by a fold
+        template<typename T, std::size_t R, std::size_t K, std::size_t C, std::size_t... k>
+        constexpr T productElement(const MatrixFixed<T, R, K>& a, const MatrixFixed<T, K, C>& b,
+                                   std::size_t i, std::size_t j, std::index_sequence<k...>) {
+            return ((a.data[i * K + k] * b.data[k * C + j]) + ...);
+        }
+
+        template<typename T, std::size_t R, std::size_t K, std::size_t C, std::size_t... e>
+        constexpr MatrixFixed<T, R, C> product(const MatrixFixed<T, R, K>& a, const MatrixFixed<T, K, C>& b,
+                                               std::index_sequence<e...>) {
+            return MatrixFixed<T, R, C>(std::array<T, R * C>{
+                    productElement(a, b, e / C, e % C, std::make_index_sequence<K>())... });
+        }
+    }
+
+    // matrix product, every output element is generated at compile time
+    template<typename T, std::size_t R, std::size_t K, std::size_t C>
+    constexpr MatrixFixed<T, R, C> operator*(const MatrixFixed<T, R, K>& a, const MatrixFixed<T, K, C>& b) {
+        return fixed_detail::product(a, b, std::make_index_sequence<R * C>());
+    }
+
+    template<typename T, std::size_t R, std::size_t C>
+    constexpr MatrixFixed<T, C, R> transpose(const MatrixFixed<T, R, C>& m) {
+        MatrixFixed<T, C, R> t;
+        for (std::size_t i = 0; i < R; i++)
+            for (std::size_t j = 0; j < C; j++)
+                t(j, i) = m(i, j);
+        return t;
+    }
+
+    template<typename T, std::size_t N>
+    constexpr T trace(const MatrixFixed<T, N, N>& m) {
+        T sum = T(0);
+        for (std::size_t i = 0; i < N; i++)
+            sum += m(i, i);
+        return sum;
+    }
+
+    template<typename T, std::size_t N>
+    constexpr T determinant(const MatrixFixed<T, N, N>& m) {
+        const auto& a = m.data;
+        if constexpr (N == 1) {
+            return a[0];
+        } else if constexpr (N == 2) {
+            return a[0] * a[3] - a[1] * a[2];
+        } else if constexpr (N == 3) {
+            return a[0] * (a[4] * a[8] - a[5] * a[7])
+                 - a[1] * (a[3] * a[8] - a[5] * a[6])
+                 + a[2] * (a[3] * a[7] - a[4] * a[6]);
+        } else if constexpr (N == 4) {
+            // expansion along the first row using 2x2 minors of the bottom rows
+            const T s0 = a[10] * a[15] - a[11] * a[14];
+            const T s1 = a[9] * a[15] - a[11] * a[13];
+            const T s2 = a[9] * a[14] - a[10] * a[13];
+            const T s3 = a[8] * a[15] - a[11] * a[12];
+            const T s4 = a[8] * a[14] - a[10] * a[12];
+            const T s5 = a[8] * a[13] - a[9] * a[12];
+            return a[0] * (a[5] * s0 - a[6] * s1 + a[7] * s2)
+                 - a[1] * (a[4] * s0 - a[6] * s3 + a[7] * s4)
+                 + a[2] * (a[4] * s1 - a[5] * s3 + a[7] * s5)
+                 - a[3] * (a[4] * s2 - a[5] * s4 + a[6] * s5);
+        } else {
+            // larger sizes: Gaussian elimination with partial pivoting, in
+            // double for integral T so the divisions do not truncate
+            using R = decomposition_scalar<T>;
+            std::array<R, N * N> u{};
+            for (std::size_t i = 0; i < N * N; i++)
+                u[i] = static_cast<R>(a[i]);
+            R det = R(1);
+            for (std::size_t k = 0; k < N; k++) {
+                std::size_t p = k;
+                for (std::size_t i = k + 1; i < N; i++)
+                    if ((u[i * N + k] < 0 ? -u[i * N + k] : u[i * N + k]) > (u[p * N + k] < 0 ? -u[p * N + k] : u[p * N + k]))
+                        p = i;
+                if (u[p * N + k] == R(0))
+                    return T(0);
+                if (p != k) {
+                    for (std::size_t j = 0; j < N; j++) {
+                        R tmp = u[k * N + j];
+                        u[k * N + j] = u[p * N + j];
+                        u[p * N + j] = tmp;
+                    }
+                    det = -det;
+                }
+                det *= u[k * N + k];
+                for (std::size_t i = k + 1; i < N; i++) {
+                    const R f = u[i * N + k] / u[k * N + k];
+                    for (std::size_t j = k; j < N; j++)
+                        u[i * N + j] -= f * u[k * N + j];
+                }
+            }
+            return fromDecompositionScalar<T>(det);
+        }
+    }
+
+    // inverse by the adjugate for N <= 4, Gauss-Jordan above that. Both work
+    // in double for integral T and round the entries back at the end.
+    // The result is unspecified (division by zero) for a singular matrix.
+    template<typename T, std::size_t N>
+    constexpr MatrixFixed<T, N, N> inverse(const MatrixFixed<T, N, N>& m) {
+        if constexpr (N <= 4) {
+            using R = decomposition_scalar<T>;
+            std::array<R, N * N> a{};
+            for (std::size_t i = 0; i < N * N; i++)
+                a[i] = static_cast<R>(m.data[i]);
+            std::array<R, N * N> r{};
+            if constexpr (N == 1) {
+                r = { R(1) / a[0] };
+            } else if constexpr (N == 2) {
+                const R inv = R(1) / (a[0] * a[3] - a[1] * a[2]);
+                r = { a[3] * inv, -a[1] * inv, -a[2] * inv, a[0] * inv };
+            } else if constexpr (N == 3) {
+                const R c00 = a[4] * a[8] - a[5] * a[7];
+                const R c01 = a[5] * a[6] - a[3] * a[8];
+                const R c02 = a[3] * a[7] - a[4] * a[6];
+                const R inv = R(1) / (a[0] * c00 + a[1] * c01 + a[2] * c02);
+                r = {
+                        c00 * inv, (a[2] * a[7] - a[1] * a[8]) * inv, (a[1] * a[5] - a[2] * a[4]) * inv,
+                        c01 * inv, (a[0] * a[8] - a[2] * a[6]) * inv, (a[2] * a[3] - a[0] * a[5]) * inv,
+                        c02 * inv, (a[1] * a[6] - a[0] * a[7]) * inv, (a[0] * a[4] - a[1] * a[3]) * inv };
+            } else {
+                // cofactors built from the 2x2 minors of the top and bottom row pairs
+                const R s0 = a[0] * a[5] - a[4] * a[1];
+                const R s1 = a[0] * a[6] - a[4] * a[2];
+                const R s2 = a[0] * a[7] - a[4] * a[3];
+                const R s3 = a[1] * a[6] - a[5] * a[2];
+                const R s4 = a[1] * a[7] - a[5] * a[3];
+                const R s5 = a[2] * a[7] - a[6] * a[3];
+                const R c5 = a[10] * a[15] - a[14] * a[11];
+                const R c4 = a[9] * a[15] - a[13] * a[11];
+                const R c3 = a[9] * a[14] - a[13] * a[10];
+                const R c2 = a[8] * a[15] - a[12] * a[11];
+                const R c1 = a[8] * a[14] - a[12] * a[10];
+                const R c0 = a[8] * a[13] - a[12] * a[9];
+                const R inv = R(1) / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+                r = {
+                        ( a[5] * c5 - a[6] * c4 + a[7] * c3) * inv,
+                        (-a[1] * c5 + a[2] * c4 - a[3] * c3) * inv,
+                        ( a[13] * s5 - a[14] * s4 + a[15] * s3) * inv,
+                        (-a[9] * s5 + a[10] * s4 - a[11] * s3) * inv,
+                        (-a[4] * c5 + a[6] * c2 - a[7] * c1) * inv,
+                        ( a[0] * c5 - a[2] * c2 + a[3] * c1) * inv,
+                        (-a[12] * s5 + a[14] * s2 - a[15] * s1) * inv,
+                        ( a[8] * s5 - a[10] * s2 + a[11] * s1) * inv,
+                        ( a[4] * c4 - a[5] * c2 + a[7] * c0) * inv,
+                        (-a[0] * c4 + a[1] * c2 - a[3] * c0) * inv,
+                        ( a[12] * s4 - a[13] * s2 + a[15] * s0) * inv,
+                        (-a[8] * s4 + a[9] * s2 - a[11] * s0) * inv,
+                        (-a[4] * c3 + a[5] * c1 - a[6] * c0) * inv,
+                        ( a[0] * c3 - a[1] * c1 + a[2] * c0) * inv,
+                        (-a[12] * s3 + a[13] * s1 - a[14] * s0) * inv,
+                        ( a[8] * s3 - a[9] * s1 + a[10] * s0) * inv };
+            }
+            MatrixFixed<T, N, N> result;
+            for (std::size_t i = 0; i < N * N; i++)
+                result.data[i] = fromDecompositionScalar<T>(r[i]);
+            return result;
+        } else {
+            // Gauss-Jordan with partial pivoting
+            using R = decomposition_scalar<T>;
+            std::array<R, N * N> u{};
+            std::array<R, N * N> inv{};
+            for (std::size_t i = 0; i < N * N; i++)
+                u[i] = static_cast<R>(m.data[i]);
+            for (std::size_t i = 0; i < N; i++)
+                inv[i * N + i] = R(1);
+            for (std::size_t k = 0; k < N; k++) {
+                std::size_t p = k;
+                for (std::size_t i = k + 1; i < N; i++)
+                    if ((u[i * N + k] < 0 ? -u[i * N + k] : u[i * N + k]) > (u[p * N + k] < 0 ? -u[p * N + k] : u[p * N + k]))
+                        p = i;
+                for (std::size_t j = 0; j < N; j++) {
+                    R tmp = u[k * N + j]; u[k * N + j] = u[p * N + j]; u[p * N + j] = tmp;
+                    tmp = inv[k * N + j]; inv[k * N + j] = inv[p * N + j]; inv[p * N + j] = tmp;
+                }
+                const R d = u[k * N + k];
+                for (std::size_t j = 0; j < N; j++) {
+                    u[k * N + j] /= d;
+                    inv[k * N + j] /= d;
+                }
+                for (std::size_t i = 0; i < N; i++) {
+                    if (i == k)
+                        continue;
+                    const R f = u[i * N + k];
+                    for (std::size_t j = 0; j < N; j++) {
+                        u[i * N + j] -= f * u[k * N + j];
+                        inv[i * N + j] -= f * inv[k * N + j];
+                    }
+                }
+            }
+            MatrixFixed<T, N, N> result;
+            for (std::size_t i = 0; i < N * N; i++)
+                result.data[i] = fromDecompositionScalar<T>(inv[i]);
+            return result;
+        }
+    }
+
+    template<typename T, std::size_t N>
+    constexpr T dot(const VectorFixed<T, N>& a, const VectorFixed<T, N>& b) {
+        T sum = T(0);
+        for (std::size_t i = 0; i < N; i++)
+            sum += a.data[i] * b.data[i];
+        return sum;
+    }
+
+    template<typename T>
+    constexpr VectorFixed<T, 3> cross(const VectorFixed<T, 3>& a, const VectorFixed<T, 3>& b) {
+        return VectorFixed<T, 3>(a[1] * b[2] - a[2] * b[1],
+                                 a[2] * b[0] - a[0] * b[2],
+                                 a[0] * b[1] - a[1] * b[0]);
+    }
+
+    template<typename T, std::size_t N>
+    T norm(const VectorFixed<T, N>& v) {
+        return std::sqrt(dot(v, v));
+    }
+
+    template<typename T, std::size_t N>
+    VectorFixed<T, N> normalized(const VectorFixed<T, N>& v) {
+        return v / norm(v);
+    }
+
+    // outer product a * b^T
+    template<typename T, std::size_t R, std::size_t C>
+    constexpr MatrixFixed<T, R, C> outer(const VectorFixed<T, R>& a, const VectorFixed<T, C>& b) {
+        MatrixFixed<T, R, C> m;
+        for (std::size_t i = 0; i < R; i++)
+            for (std::size_t j = 0; j < C; j++)
+                m(i, j) = a[i] * b[j];
+        return m;
+    }
+
+    template<typename T, std::size_t R, std::size_t C>
+    std::ostream& operator<<(std::ostream& os, const MatrixFixed<T, R, C>& m) {
+        for (std::size_t i = 0; i < R; i++) {
+            for (std::size_t j = 0; j < C; j++)
+                os << std::setw(6) << std::left << m(i, j) << "  ";
+            os << std::endl;
+        }
+        return os;
+    }
+} // namespace rez
+
+#endif //PHYSICSFORMULA_MATRIXFIXED_H
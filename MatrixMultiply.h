@@ -0,0 +1,313 @@
+#ifndef PHYSICSFORMULA_MATRIXMULTIPLY_H
+#define PHYSICSFORMULA_MATRIXMULTIPLY_H
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define REZ_GEMM_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief packed, cache blocked general matrix multiply used by MatrixND.
+ * C(m x n) = A(m x k) * B(k x n), all three matrices row-major.
+ *
+ * The k dimension is cut into KC deep slices and the n dimension into NC
+ * wide slices so a packed panel of B stays resident in L2, and the rows of
+ * A are cut into MC tall blocks so the packed A block stays in L1/L2. Each
+ * MR x NR tile of C is then computed by a micro-kernel that keeps the whole
+ * tile in registers. float and double get AVX2/FMA and AVX-512 kernels
+ * selected at runtime, every other type falls back to the scalar kernel.
+ */
+namespace rez {
+    namespace gemm_detail {
+        // blocking parameters, MC and NC are multiples of every MR / NR used
+        constexpr int MR = 4;
+        constexpr int MC = 128;
+        constexpr int KC = 256;
+        constexpr int NC = 2048;
+        // below this many multiply-adds packing costs more than it saves
+        constexpr long long SMALL_PRODUCT = 32LL * 32LL * 32LL;
+
+        template<typename T>
+        using MicroKernel = void (*)(int kc, const T* a, const T* b,
+                                     T* c, int ldc);
+
+        template<typename T>
+        struct KernelInfo {
+            MicroKernel<T> kernel;
+            int nr;
+        };
+
+        // portable MR x NR kernel, NR fixed at 8
+        template<typename T>
+        void kernelScalar(int kc, const T* a, const T* b, T* c, int ldc) {
+            constexpr int NR = 8;
+            T acc[MR][NR] = {};
+            for (int p = 0; p < kc; p++) {
+                const T* ap = a + p * MR;
+                const T* bp = b + p * NR;
+                for (int i = 0; i < MR; i++) {
+                    const T ai = ap[i];
+                    for (int j = 0; j < NR; j++)
+                        acc[i][j] += ai * bp[j];
+                }
+            }
+            for (int i = 0; i < MR; i++)
+                for (int j = 0; j < NR; j++)
+                    c[i * ldc + j] += acc[i][j];
+        }
+
+#ifdef REZ_GEMM_X86
+        // 4 x 8 doubles, two ymm accumulators per row
+        __attribute__((target("avx2,fma")))
+        inline void kernelAvx2(int kc, const double* a, const double* b,
+                               double* c, int ldc) {
+            __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+            __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+            __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+            __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+            for (int p = 0; p < kc; p++) {
+                const __m256d b0 = _mm256_loadu_pd(b + p * 8);
+                const __m256d b1 = _mm256_loadu_pd(b + p * 8 + 4);
+                __m256d ai = _mm256_broadcast_sd(a + p * MR);
+                c00 = _mm256_fmadd_pd(ai, b0, c00);
+                c01 = _mm256_fmadd_pd(ai, b1, c01);
+                ai = _mm256_broadcast_sd(a + p * MR + 1);
+                c10 = _mm256_fmadd_pd(ai, b0, c10);
+                c11 = _mm256_fmadd_pd(ai, b1, c11);
+                ai = _mm256_broadcast_sd(a + p * MR + 2);
+                c20 = _mm256_fmadd_pd(ai, b0, c20);
+                c21 = _mm256_fmadd_pd(ai, b1, c21);
+                ai = _mm256_broadcast_sd(a + p * MR + 3);
+                c30 = _mm256_fmadd_pd(ai, b0, c30);
+                c31 = _mm256_fmadd_pd(ai, b1, c31);
+            }
+            __m256d acc[MR][2] = { {c00, c01}, {c10, c11},
+                                   {c20, c21}, {c30, c31} };
+            for (int i = 0; i < MR; i++) {
+                double* ci = c + i * ldc;
+                _mm256_storeu_pd(ci, _mm256_add_pd(_mm256_loadu_pd(ci), acc[i][0]));
+                _mm256_storeu_pd(ci + 4, _mm256_add_pd(_mm256_loadu_pd(ci + 4), acc[i][1]));
+            }
+        }
+
+        // 4 x 16 floats, two ymm accumulators per row
+        __attribute__((target("avx2,fma")))
+        inline void kernelAvx2(int kc, const float* a, const float* b,
+                               float* c, int ldc) {
+            __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+            __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+            __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+            __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+            for (int p = 0; p < kc; p++) {
+                const __m256 b0 = _mm256_loadu_ps(b + p * 16);
+                const __m256 b1 = _mm256_loadu_ps(b + p * 16 + 8);
+                __m256 ai = _mm256_broadcast_ss(a + p * MR);
+                c00 = _mm256_fmadd_ps(ai, b0, c00);
+                c01 = _mm256_fmadd_ps(ai, b1, c01);
+                ai = _mm256_broadcast_ss(a + p * MR + 1);
+                c10 = _mm256_fmadd_ps(ai, b0, c10);
+                c11 = _mm256_fmadd_ps(ai, b1, c11);
+                ai = _mm256_broadcast_ss(a + p * MR + 2);
+                c20 = _mm256_fmadd_ps(ai, b0, c20);
+                c21 = _mm256_fmadd_ps(ai, b1, c21);
+                ai = _mm256_broadcast_ss(a + p * MR + 3);
+                c30 = _mm256_fmadd_ps(ai, b0, c30);
+                c31 = _mm256_fmadd_ps(ai, b1, c31);
+            }
+            __m256 acc[MR][2] = { {c00, c01}, {c10, c11},
+                                  {c20, c21}, {c30, c31} };
+            for (int i = 0; i < MR; i++) {
+                float* ci = c + i * ldc;
+                _mm256_storeu_ps(ci, _mm256_add_ps(_mm256_loadu_ps(ci), acc[i][0]));
+                _mm256_storeu_ps(ci + 8, _mm256_add_ps(_mm256_loadu_ps(ci + 8), acc[i][1]));
+            }
+        }
+
+        // 4 x 16 doubles, two zmm accumulators per row
+        __attribute__((target("avx512f")))
+        inline void kernelAvx512(int kc, const double* a, const double* b,
+                                 double* c, int ldc) {
+            __m512d acc[MR][2];
+            for (int i = 0; i < MR; i++)
+                acc[i][0] = acc[i][1] = _mm512_setzero_pd();
+            for (int p = 0; p < kc; p++) {
+                const __m512d b0 = _mm512_loadu_pd(b + p * 16);
+                const __m512d b1 = _mm512_loadu_pd(b + p * 16 + 8);
+                for (int i = 0; i < MR; i++) {
+                    const __m512d ai = _mm512_set1_pd(a[p * MR + i]);
+                    acc[i][0] = _mm512_fmadd_pd(ai, b0, acc[i][0]);
+                    acc[i][1] = _mm512_fmadd_pd(ai, b1, acc[i][1]);
+                }
+            }
+            for (int i = 0; i < MR; i++) {
+                double* ci = c + i * ldc;
+                _mm512_storeu_pd(ci, _mm512_add_pd(_mm512_loadu_pd(ci), acc[i][0]));
+                _mm512_storeu_pd(ci + 8, _mm512_add_pd(_mm512_loadu_pd(ci + 8), acc[i][1]));
+            }
+        }
+
+        // 4 x 32 floats, two zmm accumulators per row
+        __attribute__((target("avx512f")))
+        inline void kernelAvx512(int kc, const float* a, const float* b,
+                                 float* c, int ldc) {
+            __m512 acc[MR][2];
+            for (int i = 0; i < MR; i++)
+                acc[i][0] = acc[i][1] = _mm512_setzero_ps();
+            for (int p = 0; p < kc; p++) {
+                const __m512 b0 = _mm512_loadu_ps(b + p * 32);
+                const __m512 b1 = _mm512_loadu_ps(b + p * 32 + 16);
+                for (int i = 0; i < MR; i++) {
+                    const __m512 ai = _mm512_set1_ps(a[p * MR + i]);
+                    acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+                    acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+                }
+            }
+            for (int i = 0; i < MR; i++) {
+                float* ci = c + i * ldc;
+                _mm512_storeu_ps(ci, _mm512_add_ps(_mm512_loadu_ps(ci), acc[i][0]));
+                _mm512_storeu_ps(ci + 16, _mm512_add_ps(_mm512_loadu_ps(ci + 16), acc[i][1]));
+            }
+        }
+#endif
+
+        // pick the widest kernel the running cpu supports, done once per type
+        template<typename T>
+        KernelInfo<T> selectKernel() {
+#ifdef REZ_GEMM_X86
+            if constexpr (std::is_same_v<T, double> || std::is_same_v<T, float>) {
+                constexpr int lanes = std::is_same_v<T, double> ? 8 : 16;
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx512f"))
+                    return { static_cast<MicroKernel<T>>(&kernelAvx512), 2 * lanes };
+                if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+                    return { static_cast<MicroKernel<T>>(&kernelAvx2), lanes };
+            }
+#endif
+            return { &kernelScalar<T>, 8 };
+        }
+
+        template<typename T>
+        const KernelInfo<T>& kernelFor() {
+            static const KernelInfo<T> info = selectKernel<T>();
+            return info;
+        }
+
+        // copy an mc x kc block of A into MR row panels, zero padded
+        template<typename T>
+        void packA(int mc, int kc, const T* A, int lda, T* buf) {
+            for (int ip = 0; ip < mc; ip += MR) {
+                const int mr = std::min(MR, mc - ip);
+                for (int p = 0; p < kc; p++) {
+                    for (int i = 0; i < mr; i++)
+                        buf[p * MR + i] = A[(ip + i) * lda + p];
+                    for (int i = mr; i < MR; i++)
+                        buf[p * MR + i] = T(0);
+                }
+                buf += MR * kc;
+            }
+        }
+
+        // copy a kc x nc block of B into NR column panels, zero padded
+        template<typename T>
+        void packB(int kc, int nc, int nr, const T* B, int ldb, T* buf) {
+            for (int jp = 0; jp < nc; jp += nr) {
+                const int w = std::min(nr, nc - jp);
+                for (int p = 0; p < kc; p++) {
+                    const T* bp = B + p * ldb + jp;
+                    for (int j = 0; j < w; j++)
+                        buf[p * nr + j] = bp[j];
+                    for (int j = w; j < nr; j++)
+                        buf[p * nr + j] = T(0);
+                }
+                buf += nr * kc;
+            }
+        }
+
+        // straight i-k-j loop, contiguous in both B and C
+        template<typename T>
+        void gemmSmall(int m, int n, int k, const T* A, int lda,
+                       const T* B, int ldb, T* C, int ldc) {
+            for (int i = 0; i < m; i++) {
+                T* ci = C + i * ldc;
+                for (int p = 0; p < k; p++) {
+                    const T aip = A[i * lda + p];
+                    const T* bp = B + p * ldb;
+                    for (int j = 0; j < n; j++)
+                        ci[j] += aip * bp[j];
+                }
+            }
+        }
+    } // namespace gemm_detail
+
+    /**
+     * @brief C += A * B on row-major storage with leading dimensions.
+     * @param m rows of A and C
+     * @param n columns of B and C
+     * @param k columns of A, rows of B
+     */
+    template<typename T>
+    void gemmAccumulate(int m, int n, int k, const T* A, int lda,
+                        const T* B, int ldb, T* C, int ldc) {
+        using namespace gemm_detail;
+        if (m <= 0 || n <= 0 || k <= 0)
+            return;
+        if (static_cast<long long>(m) * n * k <= SMALL_PRODUCT) {
+            gemmSmall(m, n, k, A, lda, B, ldb, C, ldc);
+            return;
+        }
+        const KernelInfo<T>& info = kernelFor<T>();
+        const int nr = info.nr;
+
+        thread_local std::vector<T> aPack, bPack;
+        aPack.resize(static_cast<std::size_t>(MC) * KC);
+        bPack.resize(static_cast<std::size_t>(KC) * NC);
+        // edge tiles are computed into this scratch tile then copied out
+        std::vector<T> edge(static_cast<std::size_t>(MR) * nr);
+
+        for (int jc = 0; jc < n; jc += NC) {
+            const int nc = std::min(NC, n - jc);
+            for (int pc = 0; pc < k; pc += KC) {
+                const int kc = std::min(KC, k - pc);
+                packB(kc, nc, nr, B + pc * ldb + jc, ldb, bPack.data());
+                for (int ic = 0; ic < m; ic += MC) {
+                    const int mc = std::min(MC, m - ic);
+                    packA(mc, kc, A + ic * lda + pc, lda, aPack.data());
+                    for (int jr = 0; jr < nc; jr += nr) {
+                        const int w = std::min(nr, nc - jr);
+                        const T* bp = bPack.data() + jr * kc;
+                        for (int ir = 0; ir < mc; ir += MR) {
+                            const int h = std::min(MR, mc - ir);
+                            const T* ap = aPack.data() + ir * kc;
+                            T* cp = C + (ic + ir) * ldc + jc + jr;
+                            if (h == MR && w == nr) {
+                                info.kernel(kc, ap, bp, cp, ldc);
+                                continue;
+                            }
+                            std::fill(edge.begin(), edge.end(), T(0));
+                            info.kernel(kc, ap, bp, edge.data(), nr);
+                            for (int i = 0; i < h; i++)
+                                for (int j = 0; j < w; j++)
+                                    cp[i * ldc + j] += edge[i * nr + j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief C = A * B for dense row-major matrices stored contiguously.
+     */
+    template<typename T>
+    void gemm(int m, int n, int k, const T* A, const T* B, T* C) {
+        std::fill(C, C + static_cast<std::size_t>(m) * n, T(0));
+        gemmAccumulate(m, n, k, A, k, B, n, C, n);
+    }
+} // namespace rez
+
+#endif //PHYSICSFORMULA_MATRIXMULTIPLY_H
@@ -7,6 +7,7 @@
 #include <algorithm> // for std::swap
 #include <cstddef>
 #include <cassert>
+#include <complex>
 #include <vector>
 #include <iostream>
 #include <iomanip>
@@ -14,6 +15,9 @@
 #include <ctime>
 #include <random>
 #include "VectorND.h"
+#include "MatrixMultiply.h"
+#include "MatrixExpressions.h"
+#include "MatrixScalar.h"
 #define THRESHOLD 1e-10
 // enum class for different random_device types
 enum class RandomGenTypes {
@@ -185,6 +189,13 @@ namespace rez {
         }
         std::cout << std::endl;
     }
+    // factorizations used by determinant, inverse, rank and solve,
+    // defined in MatrixDecomposition.h
+    template<typename T> class LUDecomposition;
+    template<typename T> class QRDecomposition;
+    // used by eigenvalues and eigenvectors, defined in MatrixEigen.h
+    template<typename T> class SymmetricEigenSolver;
+    template<typename T> class EigenSolver;
 } // namespace rez
 //*****************************************************************************
 //*****************************************************************************
@@ -212,6 +223,12 @@ public:
     MatrixND(MatrixND&& other) noexcept; // move constructor
     MatrixND& operator=(const MatrixND& other); // copy assignment
     MatrixND& operator=(MatrixND&& other) noexcept ; // move assignment
+    // evaluate a lazy element-wise expression (see MatrixExpressions.h)
+    template<typename E>
+    MatrixND(const rez::MatrixExpression<E>& expr);
+    // assign an expression in one pass, reusing the existing storage
+    template<typename E>
+    MatrixND& operator=(const rez::MatrixExpression<E>& expr);
     // allow for MatrixND<T> M = {{1,2,3},{4,5,6}} for initializer list
     MatrixND(std::initializer_list<std::initializer_list<T>> list) :
     MatrixND(list.size(), list.size() ?  list.begin()->size() : 0) {
@@ -271,8 +288,12 @@ public:
     // returns the inverse of the matrix
     MatrixND<T> inverse();
     // returns the determinant of the matrix
-    float determinant();
-    // function to return the characteristic polynomial of the matrix
+    T determinant();
+    // solve A * x = b, LU for square matrices and least squares otherwise
+    std::vector<T> solve(const std::vector<T>& b);
+    // solve A * X = B for every column of B
+    MatrixND<T> solve(const MatrixND<T>& B);
+    // coefficients of det(lambda * I - A), highest power first, from the eigenvalues
     std::vector<T> characteristicPolynomial();
     // method to create an identity matrix of a square matrix
     [[nodiscard]] MatrixND<T> identity();
@@ -304,10 +325,11 @@ public:
     [[nodiscard]] MatrixND<T> concat(const MatrixND<T> &); // concatenate two matrices
     [[nodiscard]] MatrixND<T> stack(const MatrixND<T> &); // stack vertically
     [[nodiscard]] MatrixND<T> kronecker(const MatrixND<T> &); // kronecker product
-    // method to find the eigenvectors of the matrix
-    MatrixND<T> eigenvectors(); // not implemented
-    // method to return a vector of eigenvalues of the matrix
-    std::vector<T> eigenvalues(); // not implemented
+    // eigenvectors as the columns, in the order of eigenvalues(), see MatrixEigen.h
+    // for the complex vectors of a non symmetric matrix
+    MatrixND<T> eigenvectors();
+    // eigenvalues, ascending for a symmetric matrix, real parts otherwise
+    std::vector<T> eigenvalues();
     // method to take the mean of the matrix
     double mean();
     // method to take the standard deviation of the matrix
@@ -373,12 +395,13 @@ public:
     MatrixND<T> rowwiseBottomRows(int r);
     // colwise to return a colwise vector of the matrix
     std::vector<T> colwise(int col);
-    // look at the data in a colwise fashion
-    MatrixND<T> colwise();
+    // per column reductions and broadcasting, m.colwise().mean() as in Eigen,
+    // see MatrixReduction.h
+    rez::ColwiseReduction<rez::ExpressionLeaf<T>> colwise() const;
     // rowwise to return a rowwise vector of the matrix
     std::vector<T> rowwise(int row);
-    // look at the data in a rowwise fashion
-    MatrixND<T> rowwise();
+    // per row reductions and broadcasting, m.rowwise() - m.colwise().mean()
+    rez::RowwiseReduction<rez::ExpressionLeaf<T>> rowwise() const;
     // Function to the find the row with the maximum element at the column given.
     // Returns the row index.
     int findRowWithMaxElement(int col, int row);
@@ -419,17 +442,42 @@ public:
     T trace();
     // method to return the sum of the absolute values of the matrix
     T sumAbs();
-    // method to turn the matrix into an array
-    T* array();
-
-
-    MatrixND<T> operator+(const MatrixND<T> &);
+    // coefficient-wise view of the matrix, m.array().square() as in Eigen
+    rez::ArrayExpression<rez::ExpressionLeaf<T>> array() const &;
+    // of a temporary matrix, which the view takes over
+    rez::ArrayExpression<rez::ExpressionValue<MatrixND<T>>> array() &&;
+
+
+    // the arithmetic operators build element-wise expressions, nothing is
+    // computed until they are assigned to a matrix. Named operands are read
+    // in place, a temporary one is moved into the expression
+    using Leaf = rez::ExpressionLeaf<T>;
+    template<typename M>
+    using if_matrix = std::enable_if_t<std::is_same_v<std::decay_t<M>, MatrixND<T>>, int>;
+
+    // sum and difference of equally shaped matrices, empty when the shapes differ
+    template<typename M, if_matrix<M> = 0>
+    auto operator+(M&& rhs) const & { return rez::makeBinary<rez::OpAdd>(*this, std::forward<M>(rhs)); }
+    template<typename M, if_matrix<M> = 0>
+    auto operator+(M&& rhs) && { return rez::makeBinary<rez::OpAdd>(std::move(*this), std::forward<M>(rhs)); }
     VectorND<T> operator+(const VectorND<T> &);
-    MatrixND<T> operator-(const MatrixND<T> &);
+    template<typename M, if_matrix<M> = 0>
+    auto operator-(M&& rhs) const & { return rez::makeBinary<rez::OpSub>(*this, std::forward<M>(rhs)); }
+    template<typename M, if_matrix<M> = 0>
+    auto operator-(M&& rhs) && { return rez::makeBinary<rez::OpSub>(std::move(*this), std::forward<M>(rhs)); }
     VectorND<T> operator-(const VectorND<T> &);
     MatrixND<T> operator*(const MatrixND<T> &);
     VectorND<T> operator*(const VectorND<T> &);
-    MatrixND<T> operator*(const T &);
+    auto operator*(const T &) const &;
+    auto operator*(const T &) &&;
+    // in place element-wise updates, no temporary is created
+    template<typename E>
+    MatrixND& operator+=(const rez::MatrixExpression<E>& expr);
+    MatrixND& operator+=(const MatrixND<T>& rhs);
+    template<typename E>
+    MatrixND& operator-=(const rez::MatrixExpression<E>& expr);
+    MatrixND& operator-=(const MatrixND<T>& rhs);
+    MatrixND& operator*=(const T& scalar);
     bool operator==(const MatrixND<T> &);
 
 //    template <class U> friend MatrixND<U> operator+ (const MatrixND<U>& lhs, MatrixND<U>& rhs);
@@ -454,9 +502,6 @@ public:
 
 };
 
-
-
-#endif //PHYSICSFORMULA_MATRIXND_H
 /** Default Constructor
 
 	creates an empty matrix
@@ -802,20 +847,6 @@ void MatrixND<T>::set(std::vector<T> elems, int numRows, int numCols)
 }
 
 
-/** operator+ (add)
-	lhs + rhs;
-	elementwise addition of rhs to lhs
-
-	@params rhs; the matrix to add
-	@return matrix; the sum
-
-*/
-
-template <typename T>
-MatrixND<T> MatrixND<T>::operator+(const MatrixND<T> & rhs)
-{
-    return this->add(rhs);
-}
 template<typename T>
 VectorND<T> MatrixND<T>::operator+(const VectorND<T> & rhs) {
     assert(this->cols == rhs.size() && this->rows == 1);
@@ -826,20 +857,6 @@ VectorND<T> MatrixND<T>::operator+(const VectorND<T> & rhs) {
     return result;
 }
 
-/** operator- (subtract)
-	lhs - rhs;
-	elementwise subtraction of rhs from lhs
-
-	@params rhs; the matrix to subtract
-	@return matrix; the difference
-
-*/
-
-template <typename T>
-MatrixND<T> MatrixND<T>::operator-(const MatrixND<T> & rhs)
-{
-    return this->sub(rhs);
-}
 template<typename T>
 VectorND<T> MatrixND<T>::operator-(const VectorND<T> & rhs) {
     assert(this->cols == rhs.size() && this->rows == 1);
@@ -867,13 +884,117 @@ MatrixND<T> MatrixND<T>::operator*(const MatrixND<T> & rhs)
 	calculate scalar product of a matrix
 
 	@params rhs; the scalar;
-	@return matrix; the transformed product matrix
+	@return expression; the scaled matrix
+
+*/
+template <typename T>
+auto MatrixND<T>::operator*(const T & t) const &
+{
+    return rez::ScalarExpression<Leaf, T, rez::OpMul, false>(rez::asExpression(*this), t);
+}
+
+template <typename T>
+auto MatrixND<T>::operator*(const T & t) &&
+{
+    using Owned = rez::ExpressionValue<MatrixND<T>>;
+    return rez::ScalarExpression<Owned, T, rez::OpMul, false>(Owned(std::move(*this)), t);
+}
 
+/** operator* (scalar multiplication)
+	T * M<T>;
+	scalar on the left, lazily evaluated like M<T> * T
 */
 template <typename T>
-MatrixND<T> MatrixND<T>::operator*(const T & t)
+auto operator*(const T & t, const MatrixND<T> & m)
+{
+    return m * t;
+}
+
+template <typename T>
+auto operator*(const T & t, MatrixND<T> && m)
 {
-    return this->mult(t);
+    return std::move(m) * t;
+}
+
+/** expression constructor
+	evaluates an element-wise expression in a single pass into a freshly
+	allocated matrix of the same shape
+*/
+template<typename T>
+template<typename E>
+MatrixND<T>::MatrixND(const rez::MatrixExpression<E>& expr)
+{
+    rows = expr.rows();
+    cols = expr.cols();
+    data.resize(expr.size());
+    rez::evaluateInto(data.data(), expr);
+}
+
+/** expression assignment
+	writes the expression into the existing storage, which is only
+	reallocated when the shape grows. Every element reads only the same
+	index of its operands, so the matrix may appear in the expression
+*/
+template<typename T>
+template<typename E>
+MatrixND<T>& MatrixND<T>::operator=(const rez::MatrixExpression<E>& expr)
+{
+    if (expr.size() > data.size()) {
+        std::vector<T> fresh(expr.size());
+        rez::evaluateInto(fresh.data(), expr);
+        data.swap(fresh);
+    } else {
+        data.resize(expr.size());
+        rez::evaluateInto(data.data(), expr);
+    }
+    rows = expr.rows();
+    cols = expr.cols();
+    return *this;
+}
+
+template<typename T>
+template<typename E>
+MatrixND<T>& MatrixND<T>::operator+=(const rez::MatrixExpression<E>& expr)
+{
+    // like add, a matrix of another shape is not added
+    if (expr.rows() != rows || expr.cols() != cols)
+        return *this;
+    const E& e = expr.self();
+    for (std::size_t i = 0; i < data.size(); i++)
+        data[i] += e[i];
+    return *this;
+}
+
+template<typename T>
+MatrixND<T>& MatrixND<T>::operator+=(const MatrixND<T>& rhs)
+{
+    return *this += rez::asExpression(rhs);
+}
+
+template<typename T>
+template<typename E>
+MatrixND<T>& MatrixND<T>::operator-=(const rez::MatrixExpression<E>& expr)
+{
+    if (expr.rows() != rows || expr.cols() != cols)
+        return *this;
+    const E& e = expr.self();
+    for (std::size_t i = 0; i < data.size(); i++)
+        data[i] -= e[i];
+    return *this;
+}
+
+template<typename T>
+MatrixND<T>& MatrixND<T>::operator-=(const MatrixND<T>& rhs)
+{
+    return *this -= rez::asExpression(rhs);
+}
+
+template<typename T>
+MatrixND<T>& MatrixND<T>::operator*=(const T& scalar)
+{
+    for (auto& v : data)
+        v *= scalar;
+    return *this;
 }
 //template<class U>
 //MatrixND<U> operator+(const MatrixND<U> &lhs, MatrixND<U> &rhs) {
@@ -1094,11 +1215,7 @@ MatrixND<T> MatrixND<T>::add(const MatrixND<T> & rhs)
         MatrixND<T> matrix;
         return matrix;
     }
-    std::vector<T> vec;
-    for(unsigned int i = 0; i < data.size(); i++) {
-        vec.push_back(data[i] + rhs.data[i]);
-    }
-    return MatrixND<T>(vec,rows,cols);
+    return MatrixND<T>(*this + rhs);
 }
 
 template <typename T>
@@ -1147,17 +1264,10 @@ template <typename T>
 MatrixND<T> MatrixND<T>::mult(const MatrixND<T> & rhs)
 {
     assert(this->cols == rhs.rows);
-    std::vector<T> d(this->rows*rhs.cols);
-    MatrixND<T> result(d, this->rows, rhs.cols);
-    for (int i = 0; i < this->rows; i++) {
-        for (int j = 0; j < rhs.cols; j++) {
-            T sum = 0;
-            for (int k = 0; k < rhs.rows; k++) {
-                sum += data[i * this->cols + k] * rhs.data[k * rhs.cols + j];
-                result.data[i * rhs.cols + j] = sum;
-            }
-        }
-    }
+    MatrixND<T> result(this->rows, rhs.cols);
+    // packed and blocked product, see MatrixMultiply.h
+    rez::gemm(this->rows, rhs.cols, this->cols,
+              data.data(), rhs.data.data(), result.data.data());
     return result;
 }
 
@@ -1172,11 +1282,7 @@ MatrixND<T> MatrixND<T>::mult(const MatrixND<T> & rhs)
 template <typename T>
 MatrixND<T> MatrixND<T>::mult(const T & scalar)
 {
-    std::vector<T> vec;
-    for(unsigned int i = 0; i < data.size(); i++) {
-        vec.push_back(data[i] * scalar);
-    }
-    return MatrixND<T>(vec,rows,cols);
+    return MatrixND<T>(*this * scalar);
 }
 
 template<typename T>
@@ -1198,12 +1304,7 @@ MatrixND<T> MatrixND<T>::sub(const MatrixND<T> & rhs)
         return matrix;
     }
 
-    std::vector<T> vec;
-    for(unsigned int i = 0; i < data.size(); i++) {
-        vec.push_back(data[i] - rhs.data[i]);
-    }
-
-    return MatrixND<T>(vec,rows,cols);
+    return MatrixND<T>(*this - rhs);
 }
 
 template <typename T>
@@ -1241,7 +1342,7 @@ MatrixND<T> MatrixND<T>::transpose()
 }
 
 /** Inverse
- * calculate the inverse of a matrix
+ * calculate the inverse of a matrix from its LU factorization
  * @return matrix; the inverse of this matrix
  */
  template<typename T>
@@ -1251,79 +1352,73 @@ MatrixND<T> MatrixND<T>::transpose()
          MatrixND<T> matrix;
          return matrix;
      }
-     MatrixND<T> result(rows, cols);
-     T det = this->determinant();
-     if(det == 0) {
+     rez::LUDecomposition<T> lu(*this);
+     if(lu.isSingular()) {
          std::cout << "Matrix is not invertible" << std::endl;
-         return result;
-     }
-     // calculate the adjoint matrix
-     MatrixND<T> inv(rows, cols);
-     MatrixND<T> adj = this->adjoint();
-     // finding the inverse by dividing the adjoint matrix by the determinant
-     for(int i = 0; i < rows; i++) {
-         for(int j = 0; j < cols; j++) {
-             inv.data[i * cols + j] = adj.data[i * cols + j] / det;
-         }
+         return MatrixND<T>(rows, cols);
      }
-     return inv;
+     return lu.inverse();
  }
 
  /** determinant
-  * calculate the determinant of a matrix
+  * calculate the determinant of a matrix as the signed product of the
+  * pivots of its LU factorization
   * @ return T; the determinant of this matrix  *
   */
  template<typename T>
- float MatrixND<T>::determinant()
+ T MatrixND<T>::determinant()
  {
 // Check if the matrix is square.
      if (!isSquare()) {
          return -999999;
      }
+     if (rows == 0)
+         return 1;
+     return rez::LUDecomposition<T>(*this).determinant();
+ }
 
-     // If the matrix is 2x2, we can just compute the determinant directly.
-     T determinant;
-     if (rows == 2)
-     {
-         determinant = (data[0] * data[3]) - (data[1] * data[2]);
-     }
-     else
-     {
-         /* Otherwise we extract the sub-matrices and then recursively call this function
-             until we get to 2x2 matrices. */
-
-         // We will find the sub-matrices for row 0.
-         // So, loop over each column.
-         T cumulativeSum = 0.0;
-         T sign = 1.0;
-         for (int j = 0; j < cols; ++j)
-         {
-             // And find the sub-matrix for each element.
-             MatrixND<T> subMatrix = this->subMatrix(0, j);
-
-             /* Cumulatively multiply the determinant of the sub-matrix by the
-                 current element of this matrix and the sign variable (note the
-                 recursive calling of the Determinant() method). */
-             cumulativeSum += this->get(0, j) * subMatrix.determinant() * sign;
-             sign = -sign;
-         }
-         determinant = cumulativeSum;
-     }
+/** solve
+ * solve the linear system A * x = b. Square matrices are solved by LU,
+ * rectangular ones in the least squares sense by column pivoted QR
+ * @param b; the right hand side, one entry per row
+ * @return std::vector<T>; the solution x
+ */
+template<typename T>
+std::vector<T> MatrixND<T>::solve(const std::vector<T>& b) {
+    if (isSquare()) {
+        rez::LUDecomposition<T> lu(*this);
+        if (!lu.isSingular())
+            return lu.solve(b);
+    }
+    return rez::QRDecomposition<T>(*this).solve(b);
+}
 
-     return determinant;
- }
-// NOT WORKING NEEDS TO BE FIXED
+template<typename T>
+MatrixND<T> MatrixND<T>::solve(const MatrixND<T>& B) {
+    if (isSquare()) {
+        rez::LUDecomposition<T> lu(*this);
+        if (!lu.isSingular())
+            return lu.solve(B);
+    }
+    return rez::QRDecomposition<T>(*this).solve(B);
+}
+// expands the product of (lambda - lambda_i), conjugate pairs keep the
+// coefficients real
 template<typename T>
 std::vector<T> MatrixND<T>::characteristicPolynomial() {
-    std::vector<T> poly;
-    MatrixND<T> adj = this->adjoint();
-    MatrixND<T> inv = this->inverse();
-    MatrixND<T> adjInv = adj * inv;
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < cols; j++) {
-            poly.push_back(adjInv.data[i * cols + j]);
-        }
+    if (rows != cols)
+        return std::vector<T>();
+    const auto lambda = rez::EigenSolver<T>(*this, false).eigenvalues();
+    using C = typename std::decay_t<decltype(lambda)>::value_type;
+    std::vector<C> coefficients(1, C(1));
+    for (const auto& l : lambda) {
+        coefficients.push_back(C(0));
+        for (std::size_t i = coefficients.size() - 1; i > 0; i--)
+            coefficients[i] -= l * coefficients[i - 1];
     }
+    std::vector<T> poly;
+    for (const auto& c : coefficients)
+        poly.push_back(rez::fromDecompositionScalar<T>(c.real()));
     return poly;
 }
 
@@ -1367,91 +1462,11 @@ MatrixND<T> MatrixND<T>::zero(int rows, int cols) {
 
 template<typename T>
 int MatrixND<T>::rank() {
-    // Convert the matrix to row-echelon form.
-    MatrixND<T> matrixCopy = this->rref();
-
-    /* If this didn't work, then we compute the rank by finding
-        the largest non-zero sub-matrix with a non-zero determinant.
-
-        Note that this method is slower for large matrices, and therefore
-        it is better to use the RowEchelon method if possible. */
-    int numNonZeroRows = 0;
-    if (!matrixCopy.isRowEchelon())
-    {
-        // Set up a std::vector to store the sub-matrices as we go.
-        std::vector<MatrixND<T>> subMatrixVector;
-
-        // Store the current matrix into the array first.
-        subMatrixVector.push_back(*this);
-
-        /* Loop through the subMatrixVector until either we have tested every
-            sub-matrix or the completeFlag is set. */
-        bool completeFlag = false;
-        int subMatrixCount = 0;
-        while ((subMatrixCount < subMatrixVector.size()) && (!completeFlag))
-        {
-            // Extract the currentMatrix to work with.
-            MatrixND<T> currentMatrix = subMatrixVector[subMatrixCount];
-            subMatrixCount++;
-
-            // Test if this matrix is non-zero.
-            if (!currentMatrix.isZero())
-            {
-                // If the determinant is non-zero, then we have our result.
-                T currentMatrixDet = currentMatrix.determinant();
-                if (!closeEnough(currentMatrixDet, 0.0))
-                {
-                    completeFlag = true;
-                    numNonZeroRows = currentMatrix.getRows();
-                }
-                else
-                {
-                    // Extract and store each sub-matrix (if larger than 2x2).
-                    if ((currentMatrix.getRows() > 2) && (currentMatrix.getCols() > 2))
-                    {
-                        for (int i=0; i<currentMatrix.getRows(); ++i)
-                        {
-                            for (int j=0; j<currentMatrix.getCols(); ++j)
-                            {
-                                // Extract this sub-matrix and store.
-                                subMatrixVector.push_back(currentMatrix.subMatrix(i,j));
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-    else
-    {
-        /* Converting to row echelon form did work, so we can simply
-            count the number of non-zero rows to get the rank. */
-
-        /* If we get to here, then we can assume that the matrix is now
-            in row-echelon form, and we can compute the rank quite easily
-            as simply the number of non-zero rows. */
-
-        int nRows = matrixCopy.getRows();
-        int nCols = matrixCopy.getCols();
-
-        // Loop over each row and test whether it has at least one non-zero element.
-        for (int i=0; i<rows; ++i)
-        {
-            // Loop over the columns of this row.
-            int colSum = 0;
-            for (int j=0; j<cols; ++j)
-            {
-                if (!closeEnough(matrixCopy.get(i,j), 0.0))
-                    colSum++;
-            }
-            // If colSum is greater than zero, then increment numNonZeroRows.
-            if (colSum > 0)
-                numNonZeroRows++;
-        }
-
-    }
-    // The rank of the matrix is simply the number of non-zero rows.
-    return numNonZeroRows;
+    // The rank is the number of numerically non-zero diagonal entries of R
+    // in the column pivoted QR factorization.
+    if (rows == 0 || cols == 0)
+        return 0;
+    return rez::QRDecomposition<T>(*this).rank();
 }
 
 template<typename T>
@@ -1591,17 +1606,33 @@ MatrixND<T> MatrixND<T>::kronecker(const MatrixND<T> & rhs)
 }
 template<typename T>
 MatrixND<T> MatrixND<T>::eigenvectors() {
-
+    if (rows != cols)
+        return MatrixND<T>();
+    if (isSymmetric())
+        return rez::SymmetricEigenSolver<T>(*this).eigenvectors();
+    rez::EigenSolver<T> solver(*this);
+    MatrixND<T> V(rows, cols);
+    for (int k = 0; k < cols; k++) {
+        const auto x = solver.eigenvector(k);
+        for (int i = 0; i < rows; i++)
+            V.data[i * cols + k] = rez::fromDecompositionScalar<T>(x[i].real());
+    }
+    return V;
 }
 template <typename T>
 std::vector<T> MatrixND<T>::eigenvalues() {
     if(rows != cols)
         return std::vector<T>();
-    MatrixND<T> A = *this;
     std::vector<T> eigenvalues;
-    for(int i = 0; i < rows; i++) {
-        eigenvalues.push_back(A.data[i*cols + i]);
-    }
+    if (isSymmetric()) {
+        const rez::SymmetricEigenSolver<T> solver(*this, false);
+        for (const auto& l : solver.eigenvalues())
+            eigenvalues.push_back(rez::fromDecompositionScalar<T>(l));
+        return eigenvalues;
+    }
+    const rez::EigenSolver<T> solver(*this, false);
+    for (const auto& l : solver.eigenvalues())
+        eigenvalues.push_back(rez::fromDecompositionScalar<T>(l.real()));
     return eigenvalues;
 }
 
@@ -1750,7 +1781,7 @@ MatrixND<T> MatrixND<T>::bottomRows(int r) {
     MatrixND<T> m(r, cols);
     for(int i = 0; i < r; i++) {
         for(int j = 0; j < cols; j++) {
-            m(i,j) = this->operator()(r - i - 1, j);
+            m(i,j) = this->operator()(rows - r + i, j);
         }
     }
     return m;
@@ -1772,7 +1803,7 @@ MatrixND<T> MatrixND<T>::rightCols(int c) {
     MatrixND<T> m(rows, c);
     for(int i = 0; i < rows; i++) {
         for(int j = 0; j < c; j++) {
-            m(i,j) = this->operator()(i, c - j - 1);
+            m(i,j) = this->operator()(i, cols - c + j);
         }
     }
     return m;
@@ -1894,8 +1925,14 @@ T MatrixND<T>::sumAbs() {
 }
 
 template<typename T>
-T *MatrixND<T>::array() {
-    return data.data();
+rez::ArrayExpression<rez::ExpressionLeaf<T>> MatrixND<T>::array() const & {
+    return rez::ArrayExpression<rez::ExpressionLeaf<T>>(rez::ExpressionLeaf<T>(data.data(), rows, cols));
+}
+
+template<typename T>
+rez::ArrayExpression<rez::ExpressionValue<MatrixND<T>>> MatrixND<T>::array() && {
+    using Owned = rez::ExpressionValue<MatrixND<T>>;
+    return rez::ArrayExpression<Owned>(Owned(std::move(*this)));
 }
 
 template<typename T>
@@ -2242,27 +2279,17 @@ T MatrixND<T>::minCol(int col) {
     return min;
 }
 template<typename T>
-MatrixND<T> MatrixND<T>::rowwise() {
-    MatrixND<T> m(rows,cols);
-    for(int i = 0; i < rows; i++) {
-        for(int j = 0; j < cols; j++) {
-            m(i,j) = this->operator()(i,j);
-        }
-    }
-    return m;
+rez::RowwiseReduction<rez::ExpressionLeaf<T>> MatrixND<T>::rowwise() const {
+    return rez::RowwiseReduction<rez::ExpressionLeaf<T>>(rez::ExpressionLeaf<T>(data.data(), rows, cols));
 }
 
 template<typename T>
-MatrixND<T> MatrixND<T>::colwise() {
-    MatrixND<T> m(rows,1);
-    for(int i = 0; i < rows; i++) {
-        for(int j = 0; j < cols; j++) {
-            m(i,0) = data[i*cols + j];
-        }
-    }
-    return m;
+rez::ColwiseReduction<rez::ExpressionLeaf<T>> MatrixND<T>::colwise() const {
+    return rez::ColwiseReduction<rez::ExpressionLeaf<T>>(rez::ExpressionLeaf<T>(data.data(), rows, cols));
 }
 
-
-
-
+// the solvers and reductions only need the declaration of MatrixND above
+#include "MatrixDecomposition.h"
+#include "MatrixEigen.h"
+#include "MatrixReduction.h"
+#endif //PHYSICSFORMULA_MATRIXND_H
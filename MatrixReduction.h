@@ -0,0 +1,676 @@
+#ifndef PHYSICSFORMULA_MATRIXREDUCTION_H
+#define PHYSICSFORMULA_MATRIXREDUCTION_H
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include "MatrixExpressions.h"
+#include "MatrixScalar.h"
+#include "ThreadPool.h"
+
+// defined in MatrixND.h, which includes this header at its end
+template<typename T> class MatrixND;
+
+/**
+ * @brief column and row reductions of MatrixND and of element-wise
+ * expressions, behind Eigen's colwise() / rowwise() interface.
+ *  - ColumnStatistics   : count, sum, mean, variance, min and max of every
+ *                         column, optionally the covariance matrix
+ *  - columnStatistics   : computes all of them in one pass over the rows
+ *  - ColwiseReduction   : x.colwise().sum(), mean(), minCoeff(), ... as a
+ *                         1 x cols row, x.colwise() - column broadcasting
+ *  - RowwiseReduction   : the same per row as a rows x 1 column,
+ *                         x.rowwise() - row broadcasting
+ *
+ * The rows are read in blocks small enough to stay in L1. A block is reduced
+ * with two passes, its column sums first and then the squared deviations from
+ * the block means, and merged into the running totals with Chan's update, so
+ * the result is as stable as Welford's element by element update while every
+ * inner loop runs along a contiguous row, which the compiler turns into SIMD
+ * code (AVX2 clones are picked at run time for float and double, as in
+ * MatrixMultiply.h). Expressions are evaluated a block at a time into a
+ * scratch buffer and never materialized whole.
+ *
+ * Tall matrices are cut into chunks of a fixed number of rows, reduced on
+ * ThreadPool::global() and merged in chunk order, so the result is the same
+ * bit for bit for any number of threads.
+ */
+namespace rez {
+    template<typename T>
+    struct ColumnStatistics {
+        using R = decomposition_scalar<T>;
+        int count = 0;                  // rows seen
+        int cols = 0;
+        std::vector<R> sum;
+        std::vector<R> mean;
+        std::vector<R> m2;              // sum of squared deviations from the mean
+        std::vector<T> minimum;
+        std::vector<T> maximum;
+        std::vector<R> comoment;        // cols x cols, filled when covariance was asked for
+        bool hasCovariance = false;
+
+        ColumnStatistics() = default;
+        ColumnStatistics(int columns, bool covariance);
+
+        // sample (n - 1) or population (n) statistics
+        [[nodiscard]] std::vector<R> variance(bool sample = true) const;
+        [[nodiscard]] std::vector<R> stddev(bool sample = true) const;
+        [[nodiscard]] MatrixND<R> covariance(bool sample = true) const;
+        [[nodiscard]] MatrixND<R> correlation() const;
+
+        // fold in the statistics of other rows of the same columns
+        void merge(const ColumnStatistics& other);
+    };
+
+    // all column statistics of a matrix or expression in one blocked pass,
+    // threads 0 uses the whole pool and 1 stays on the calling thread
+    template<typename E>
+    auto columnStatistics(const E& m, bool covariance = false, size_t threads = 0);
+
+    template<typename E>
+    class ColwiseReduction {
+        E expr;
+    public:
+        using value_type = std::decay_t<decltype(std::declval<const E&>()[0])>;
+        using R = decomposition_scalar<value_type>;
+
+        explicit ColwiseReduction(const E& e) : expr(e) {}
+
+        [[nodiscard]] ColumnStatistics<value_type> statistics(bool covariance = false, size_t threads = 0) const {
+            return columnStatistics(expr, covariance, threads);
+        }
+        [[nodiscard]] MatrixND<value_type> sum() const;
+        [[nodiscard]] MatrixND<value_type> mean() const;
+        [[nodiscard]] MatrixND<value_type> minCoeff() const;
+        [[nodiscard]] MatrixND<value_type> maxCoeff() const;
+        [[nodiscard]] MatrixND<value_type> squaredNorm() const;
+        [[nodiscard]] MatrixND<value_type> norm() const;
+        [[nodiscard]] MatrixND<R> variance(bool sample = true) const;
+        [[nodiscard]] MatrixND<R> stddev(bool sample = true) const;
+
+        // apply a rows x 1 column to every column
+        template<typename B> friend MatrixND<value_type> operator+(const ColwiseReduction& a, const B& b) {
+            return a.broadcast(asExpression(b), OpAdd());
+        }
+        template<typename B> friend MatrixND<value_type> operator-(const ColwiseReduction& a, const B& b) {
+            return a.broadcast(asExpression(b), OpSub());
+        }
+        template<typename B> friend MatrixND<value_type> operator*(const ColwiseReduction& a, const B& b) {
+            return a.broadcast(asExpression(b), OpMul());
+        }
+        template<typename B> friend MatrixND<value_type> operator/(const ColwiseReduction& a, const B& b) {
+            return a.broadcast(asExpression(b), OpDiv());
+        }
+    private:
+        template<typename B, typename Op>
+        MatrixND<value_type> broadcast(const B& column, Op) const;
+    };
+
+    template<typename E>
+    class RowwiseReduction {
+        E expr;
+    public:
+        using value_type = std::decay_t<decltype(std::declval<const E&>()[0])>;
+        using R = decomposition_scalar<value_type>;
+
+        explicit RowwiseReduction(const E& e) : expr(e) {}
+
+        [[nodiscard]] MatrixND<value_type> sum() const;
+        [[nodiscard]] MatrixND<value_type> mean() const;
+        [[nodiscard]] MatrixND<value_type> minCoeff() const;
+        [[nodiscard]] MatrixND<value_type> maxCoeff() const;
+        [[nodiscard]] MatrixND<value_type> squaredNorm() const;
+        [[nodiscard]] MatrixND<value_type> norm() const;
+        [[nodiscard]] MatrixND<R> variance(bool sample = true) const;
+        [[nodiscard]] MatrixND<R> stddev(bool sample = true) const;
+
+        // apply a 1 x cols row to every row
+        template<typename B> friend MatrixND<value_type> operator+(const RowwiseReduction& a, const B& b) {
+            return a.broadcast(asExpression(b), OpAdd());
+        }
+        template<typename B> friend MatrixND<value_type> operator-(const RowwiseReduction& a, const B& b) {
+            return a.broadcast(asExpression(b), OpSub());
+        }
+        template<typename B> friend MatrixND<value_type> operator*(const RowwiseReduction& a, const B& b) {
+            return a.broadcast(asExpression(b), OpMul());
+        }
+        template<typename B> friend MatrixND<value_type> operator/(const RowwiseReduction& a, const B& b) {
+            return a.broadcast(asExpression(b), OpDiv());
+        }
+    private:
+        // sum, mean and squared deviations of every row
+        void rowMoments(std::vector<R>& sums, std::vector<R>& m2) const;
+        template<typename Reduce>
+        MatrixND<value_type> perRow(Reduce reduce) const;
+        template<typename B, typename Op>
+        MatrixND<value_type> broadcast(const B& row, Op) const;
+    };
+
+//*****************************************************************************
+// reduction kernels
+//*****************************************************************************
+    namespace reduction_detail {
+        // a block of rows should fit in L1 next to the accumulators
+        constexpr size_t BLOCK_BYTES = size_t(16) << 10;
+        // rows of one parallel chunk are at least this many elements
+        constexpr size_t CHUNK_ELEMENTS = size_t(1) << 16;
+        // every chunk holds a cols x cols co-moment matrix, so with covariance
+        // the chunks grow instead of multiplying
+        constexpr int COVARIANCE_CHUNKS = 64;
+
+        inline int blockRows(int cols, size_t elementSize) {
+            return static_cast<int>(std::clamp<size_t>(BLOCK_BYTES / (size_t(std::max(cols, 1)) * elementSize),
+                                                       8, 1024));
+        }
+
+        template<typename E>
+        constexpr bool is_leaf_v = false;
+        template<typename T>
+        constexpr bool is_leaf_v<ExpressionLeaf<T>> = true;
+
+        // rows [first, first + count) of e as contiguous memory, a leaf is read
+        // in place and any other expression is evaluated into buffer
+        template<typename V, typename E>
+        const V* rowBlock(const E& e, int first, int count, std::vector<V>& buffer) {
+            const size_t c = size_t(e.cols());
+            if constexpr (is_leaf_v<E>) {
+                return e.p + size_t(first) * c;
+            } else {
+                buffer.resize(size_t(count) * c);
+                const size_t offset = size_t(first) * c;
+                for (size_t i = 0; i < buffer.size(); i++)
+                    buffer[i] = static_cast<V>(e[offset + i]);
+                return buffer.data();
+            }
+        }
+
+        // sums, minimum and maximum of the columns of a block
+        template<typename T, typename R>
+        inline __attribute__((always_inline)) void blockSums(const T* x, int rows, int cols, R* __restrict sum,
+                                                             T* __restrict lo, T* __restrict hi) {
+            for (int j = 0; j < cols; j++) {
+                sum[j] = R(x[j]);
+                lo[j] = x[j];
+                hi[j] = x[j];
+            }
+            for (int i = 1; i < rows; i++) {
+                const T* __restrict row = x + size_t(i) * cols;
+                for (int j = 0; j < cols; j++) {
+                    sum[j] += R(row[j]);
+                    lo[j] = row[j] < lo[j] ? row[j] : lo[j];
+                    hi[j] = hi[j] < row[j] ? row[j] : hi[j];
+                }
+            }
+        }
+
+        // squared deviations of the columns of a block from its means
+        template<typename T, typename R>
+        inline __attribute__((always_inline)) void blockDeviations(const T* x, int rows, int cols,
+                                                                   const R* __restrict mean, R* __restrict m2) {
+            for (int j = 0; j < cols; j++)
+                m2[j] = R(0);
+            for (int i = 0; i < rows; i++) {
+                const T* __restrict row = x + size_t(i) * cols;
+                for (int j = 0; j < cols; j++) {
+                    const R d = R(row[j]) - mean[j];
+                    m2[j] += d * d;
+                }
+            }
+        }
+
+        // lower triangle of the co-moments of a block about its means
+        template<typename T, typename R>
+        inline __attribute__((always_inline)) void blockComoments(const T* x, int rows, int cols,
+                                                                  const R* __restrict mean, R* __restrict deviation,
+                                                                  R* __restrict comoment) {
+            std::fill(comoment, comoment + size_t(cols) * cols, R(0));
+            for (int i = 0; i < rows; i++) {
+                const T* __restrict row = x + size_t(i) * cols;
+                for (int j = 0; j < cols; j++)
+                    deviation[j] = R(row[j]) - mean[j];
+                for (int a = 0; a < cols; a++) {
+                    const R da = deviation[a];
+                    R* __restrict out = comoment + size_t(a) * cols;
+                    for (int b = 0; b <= a; b++)
+                        out[b] += da * deviation[b];
+                }
+            }
+        }
+
+        template<typename T, typename R>
+        struct BlockKernels {
+            void (*sums)(const T*, int, int, R*, T*, T*);
+            void (*deviations)(const T*, int, int, const R*, R*);
+            void (*comoments)(const T*, int, int, const R*, R*, R*);
+        };
+
+        template<typename T, typename R>
+        void sumsGeneric(const T* x, int rows, int cols, R* sum, T* lo, T* hi) {
+            blockSums(x, rows, cols, sum, lo, hi);
+        }
+        template<typename T, typename R>
+        void deviationsGeneric(const T* x, int rows, int cols, const R* mean, R* m2) {
+            blockDeviations(x, rows, cols, mean, m2);
+        }
+        template<typename T, typename R>
+        void comomentsGeneric(const T* x, int rows, int cols, const R* mean, R* deviation, R* comoment) {
+            blockComoments(x, rows, cols, mean, deviation, comoment);
+        }
+
+#ifdef REZ_GEMM_X86
+        template<typename T, typename R>
+        __attribute__((target("avx2,fma")))
+        void sumsAvx2(const T* x, int rows, int cols, R* sum, T* lo, T* hi) {
+            blockSums(x, rows, cols, sum, lo, hi);
+        }
+        template<typename T, typename R>
+        __attribute__((target("avx2,fma")))
+        void deviationsAvx2(const T* x, int rows, int cols, const R* mean, R* m2) {
+            blockDeviations(x, rows, cols, mean, m2);
+        }
+        template<typename T, typename R>
+        __attribute__((target("avx2,fma")))
+        void comomentsAvx2(const T* x, int rows, int cols, const R* mean, R* deviation, R* comoment) {
+            blockComoments(x, rows, cols, mean, deviation, comoment);
+        }
+#endif
+
+        template<typename T, typename R>
+        const BlockKernels<T, R>& blockKernels() {
+            static const BlockKernels<T, R> kernels = [] {
+#ifdef REZ_GEMM_X86
+                if constexpr (std::is_floating_point_v<T>) {
+                    __builtin_cpu_init();
+                    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+                        return BlockKernels<T, R>{ &sumsAvx2<T, R>, &deviationsAvx2<T, R>, &comomentsAvx2<T, R> };
+                }
+#endif
+                return BlockKernels<T, R>{ &sumsGeneric<T, R>, &deviationsGeneric<T, R>, &comomentsGeneric<T, R> };
+            }();
+            return kernels;
+        }
+
+        // statistics of rows [first, last) of e, block by block
+        template<typename V, typename E>
+        void reduceRows(const E& e, int first, int last, ColumnStatistics<V>& out) {
+            using R = decomposition_scalar<V>;
+            const int c = e.cols();
+            const int block = blockRows(c, sizeof(V));
+            const BlockKernels<V, R>& kernels = blockKernels<V, R>();
+            ColumnStatistics<V> part(c, out.hasCovariance);
+            std::vector<V> buffer;
+            std::vector<R> deviation(out.hasCovariance ? c : 0);
+            for (int i = first; i < last; i += block) {
+                const int count = std::min(block, last - i);
+                const V* x = rowBlock(e, i, count, buffer);
+                kernels.sums(x, count, c, part.sum.data(), part.minimum.data(), part.maximum.data());
+                for (int j = 0; j < c; j++)
+                    part.mean[j] = part.sum[j] / R(count);
+                kernels.deviations(x, count, c, part.mean.data(), part.m2.data());
+                if (out.hasCovariance)
+                    kernels.comoments(x, count, c, part.mean.data(), deviation.data(), part.comoment.data());
+                part.count = count;
+                out.merge(part);
+            }
+        }
+    }
+
+//*****************************************************************************
+// ColumnStatistics
+//*****************************************************************************
+    template<typename T>
+    ColumnStatistics<T>::ColumnStatistics(int columns, bool covariance)
+            : cols(columns), sum(columns, R(0)), mean(columns, R(0)), m2(columns, R(0)),
+              minimum(columns, T(0)), maximum(columns, T(0)),
+              comoment(covariance ? size_t(columns) * columns : 0, R(0)), hasCovariance(covariance) {}
+
+    // Chan, Golub and LeVeque's pairwise update, the co-moments only in the
+    // lower triangle until covariance() mirrors them
+    template<typename T>
+    void ColumnStatistics<T>::merge(const ColumnStatistics& other) {
+        assert(other.cols == cols && (!hasCovariance || other.hasCovariance));
+        if (other.count == 0)
+            return;
+        if (count == 0) {
+            const bool covariance = hasCovariance;
+            *this = other;
+            if (!covariance) {
+                comoment.clear();
+                hasCovariance = false;
+            }
+            return;
+        }
+        const R na = R(count), nb = R(other.count), n = na + nb;
+        const R weight = na * nb / n;
+        std::vector<R> delta(cols);
+        for (int j = 0; j < cols; j++) {
+            delta[j] = other.mean[j] - mean[j];
+            sum[j] += other.sum[j];
+            mean[j] += delta[j] * (nb / n);
+            m2[j] += other.m2[j] + delta[j] * delta[j] * weight;
+            minimum[j] = std::min(minimum[j], other.minimum[j]);
+            maximum[j] = std::max(maximum[j], other.maximum[j]);
+        }
+        if (hasCovariance)
+            for (int a = 0; a < cols; a++) {
+                R* out = comoment.data() + size_t(a) * cols;
+                const R* in = other.comoment.data() + size_t(a) * cols;
+                const R da = delta[a] * weight;
+                for (int b = 0; b <= a; b++)
+                    out[b] += in[b] + da * delta[b];
+            }
+        count += other.count;
+    }
+
+    template<typename T>
+    std::vector<typename ColumnStatistics<T>::R> ColumnStatistics<T>::variance(bool sample) const {
+        const int divisor = sample ? count - 1 : count;
+        std::vector<R> v(cols, R(0));
+        if (divisor > 0)
+            for (int j = 0; j < cols; j++)
+                v[j] = m2[j] / R(divisor);
+        return v;
+    }
+
+    template<typename T>
+    std::vector<typename ColumnStatistics<T>::R> ColumnStatistics<T>::stddev(bool sample) const {
+        std::vector<R> v = variance(sample);
+        for (auto& x : v)
+            x = std::sqrt(x);
+        return v;
+    }
+
+    template<typename T>
+    MatrixND<typename ColumnStatistics<T>::R> ColumnStatistics<T>::covariance(bool sample) const {
+        assert(hasCovariance);
+        const int divisor = sample ? count - 1 : count;
+        MatrixND<R> C(cols, cols);
+        if (divisor <= 0)
+            return C;
+        for (int a = 0; a < cols; a++)
+            for (int b = 0; b <= a; b++) {
+                const R v = comoment[size_t(a) * cols + b] / R(divisor);
+                C.data[size_t(a) * cols + b] = v;
+                C.data[size_t(b) * cols + a] = v;
+            }
+        return C;
+    }
+
+    // a constant column correlates with nothing, its row and column are zero
+    template<typename T>
+    MatrixND<typename ColumnStatistics<T>::R> ColumnStatistics<T>::correlation() const {
+        MatrixND<R> C = covariance(false);
+        std::vector<R> scale(cols);
+        for (int j = 0; j < cols; j++) {
+            const R d = C.data[size_t(j) * cols + j];
+            scale[j] = d > R(0) ? R(1) / std::sqrt(d) : R(0);
+        }
+        for (int a = 0; a < cols; a++)
+            for (int b = 0; b < cols; b++)
+                C.data[size_t(a) * cols + b] *= scale[a] * scale[b];
+        return C;
+    }
+
+    template<typename E>
+    auto columnStatistics(const E& m, bool covariance, size_t threads) {
+        const auto e = asExpression(m);
+        using V = std::decay_t<decltype(e[0])>;
+        const int rows = e.rows(), c = e.cols();
+        ColumnStatistics<V> result(c, covariance);
+        if (rows == 0 || c == 0)
+            return result;
+
+        // fixed chunks, independent of the thread count
+        int chunkRows = static_cast<int>(std::max<size_t>(reduction_detail::CHUNK_ELEMENTS / size_t(c),
+                                                          size_t(reduction_detail::blockRows(c, sizeof(V)))));
+        if (covariance)
+            chunkRows = std::max(chunkRows, (rows + reduction_detail::COVARIANCE_CHUNKS - 1)
+                                            / reduction_detail::COVARIANCE_CHUNKS);
+        const int chunks = (rows + chunkRows - 1) / chunkRows;
+        ThreadPool& pool = ThreadPool::global();
+        const size_t tasks = std::min<size_t>(threads ? threads : pool.size(), size_t(chunks));
+        if (tasks <= 1) {
+            for (int k = 0; k < chunks; k++) {
+                ColumnStatistics<V> part(c, covariance);
+                reduction_detail::reduceRows(e, k * chunkRows, std::min(rows, (k + 1) * chunkRows), part);
+                result.merge(part);
+            }
+            return result;
+        }
+        std::vector<ColumnStatistics<V>> parts(chunks, ColumnStatistics<V>(c, covariance));
+        std::atomic<int> next{ 0 };
+        TaskGroup group(pool);
+        for (size_t t = 0; t < tasks; t++)
+            group.run([&] {
+                for (int k = next++; k < chunks; k = next++)
+                    reduction_detail::reduceRows(e, k * chunkRows, std::min(rows, (k + 1) * chunkRows), parts[k]);
+            });
+        group.wait();
+        for (const auto& part : parts)
+            result.merge(part);
+        return result;
+    }
+
+//*****************************************************************************
+// ColwiseReduction
+//*****************************************************************************
+    template<typename E>
+    MatrixND<typename ColwiseReduction<E>::value_type> ColwiseReduction<E>::sum() const {
+        const auto s = statistics();
+        MatrixND<value_type> out(1, s.cols);
+        for (int j = 0; j < s.cols; j++)
+            out.data[j] = fromDecompositionScalar<value_type>(s.sum[j]);
+        return out;
+    }
+
+    template<typename E>
+    MatrixND<typename ColwiseReduction<E>::value_type> ColwiseReduction<E>::mean() const {
+        const auto s = statistics();
+        MatrixND<value_type> out(1, s.cols);
+        for (int j = 0; j < s.cols; j++)
+            out.data[j] = fromDecompositionScalar<value_type>(s.mean[j]);
+        return out;
+    }
+
+    template<typename E>
+    MatrixND<typename ColwiseReduction<E>::value_type> ColwiseReduction<E>::minCoeff() const {
+        const auto s = statistics();
+        return MatrixND<value_type>(s.minimum, 1, s.cols);
+    }
+
+    template<typename E>
+    MatrixND<typename ColwiseReduction<E>::value_type> ColwiseReduction<E>::maxCoeff() const {
+        const auto s = statistics();
+        return MatrixND<value_type>(s.maximum, 1, s.cols);
+    }
+
+    // sum of squares = m2 + n * mean^2
+    template<typename E>
+    MatrixND<typename ColwiseReduction<E>::value_type> ColwiseReduction<E>::squaredNorm() const {
+        const auto s = statistics();
+        MatrixND<value_type> out(1, s.cols);
+        for (int j = 0; j < s.cols; j++)
+            out.data[j] = fromDecompositionScalar<value_type>(s.m2[j] + R(s.count) * s.mean[j] * s.mean[j]);
+        return out;
+    }
+
+    template<typename E>
+    MatrixND<typename ColwiseReduction<E>::value_type> ColwiseReduction<E>::norm() const {
+        const auto s = statistics();
+        MatrixND<value_type> out(1, s.cols);
+        for (int j = 0; j < s.cols; j++)
+            out.data[j] = fromDecompositionScalar<value_type>(
+                    std::sqrt(s.m2[j] + R(s.count) * s.mean[j] * s.mean[j]));
+        return out;
+    }
+
+    template<typename E>
+    MatrixND<typename ColwiseReduction<E>::R> ColwiseReduction<E>::variance(bool sample) const {
+        const auto s = statistics();
+        return MatrixND<R>(s.variance(sample), 1, s.cols);
+    }
+
+    template<typename E>
+    MatrixND<typename ColwiseReduction<E>::R> ColwiseReduction<E>::stddev(bool sample) const {
+        const auto s = statistics();
+        return MatrixND<R>(s.stddev(sample), 1, s.cols);
+    }
+
+    template<typename E>
+    template<typename B, typename Op>
+    MatrixND<typename ColwiseReduction<E>::value_type> ColwiseReduction<E>::broadcast(const B& column, Op) const {
+        assert(column.rows() == expr.rows() && column.cols() == 1);
+        const int r = expr.rows(), c = expr.cols();
+        MatrixND<value_type> out(r, c);
+        for (int i = 0; i < r; i++) {
+            const auto v = column[i];
+            value_type* row = out.data.data() + size_t(i) * c;
+            for (int j = 0; j < c; j++)
+                row[j] = static_cast<value_type>(Op::apply(expr[size_t(i) * c + j], v));
+        }
+        return out;
+    }
+
+//*****************************************************************************
+// RowwiseReduction
+//*****************************************************************************
+    template<typename E>
+    template<typename Reduce>
+    MatrixND<typename RowwiseReduction<E>::value_type> RowwiseReduction<E>::perRow(Reduce reduce) const {
+        const int r = expr.rows(), c = expr.cols();
+        MatrixND<value_type> out(r, 1);
+        std::vector<value_type> buffer;
+        const int block = reduction_detail::blockRows(c, sizeof(value_type));
+        for (int i = 0; i < r; i += block) {
+            const int count = std::min(block, r - i);
+            const value_type* x = reduction_detail::rowBlock(expr, i, count, buffer);
+            for (int k = 0; k < count; k++)
+                out.data[i + k] = reduce(x + size_t(k) * c, c);
+        }
+        return out;
+    }
+
+    template<typename E>
+    void RowwiseReduction<E>::rowMoments(std::vector<R>& sums, std::vector<R>& m2) const {
+        const int r = expr.rows(), c = expr.cols();
+        sums.assign(r, R(0));
+        m2.assign(r, R(0));
+        std::vector<value_type> buffer;
+        const int block = reduction_detail::blockRows(c, sizeof(value_type));
+        for (int i = 0; i < r; i += block) {
+            const int count = std::min(block, r - i);
+            const value_type* x = reduction_detail::rowBlock(expr, i, count, buffer);
+            for (int k = 0; k < count; k++) {
+                const value_type* row = x + size_t(k) * c;
+                R s = 0;
+                for (int j = 0; j < c; j++)
+                    s += R(row[j]);
+                const R mu = c ? s / R(c) : R(0);
+                R d2 = 0;
+                for (int j = 0; j < c; j++)
+                    d2 += (R(row[j]) - mu) * (R(row[j]) - mu);
+                sums[i + k] = s;
+                m2[i + k] = d2;
+            }
+        }
+    }
+
+    template<typename E>
+    MatrixND<typename RowwiseReduction<E>::value_type> RowwiseReduction<E>::sum() const {
+        return perRow([](const value_type* row, int c) {
+            R s = 0;
+            for (int j = 0; j < c; j++)
+                s += R(row[j]);
+            return fromDecompositionScalar<value_type>(s);
+        });
+    }
+
+    template<typename E>
+    MatrixND<typename RowwiseReduction<E>::value_type> RowwiseReduction<E>::mean() const {
+        return perRow([](const value_type* row, int c) {
+            R s = 0;
+            for (int j = 0; j < c; j++)
+                s += R(row[j]);
+            return fromDecompositionScalar<value_type>(c ? s / R(c) : R(0));
+        });
+    }
+
+    template<typename E>
+    MatrixND<typename RowwiseReduction<E>::value_type> RowwiseReduction<E>::minCoeff() const {
+        return perRow([](const value_type* row, int c) {
+            value_type m = row[0];
+            for (int j = 1; j < c; j++)
+                m = row[j] < m ? row[j] : m;
+            return m;
+        });
+    }
+
+    template<typename E>
+    MatrixND<typename RowwiseReduction<E>::value_type> RowwiseReduction<E>::maxCoeff() const {
+        return perRow([](const value_type* row, int c) {
+            value_type m = row[0];
+            for (int j = 1; j < c; j++)
+                m = m < row[j] ? row[j] : m;
+            return m;
+        });
+    }
+
+    template<typename E>
+    MatrixND<typename RowwiseReduction<E>::value_type> RowwiseReduction<E>::squaredNorm() const {
+        return perRow([](const value_type* row, int c) {
+            R s = 0;
+            for (int j = 0; j < c; j++)
+                s += R(row[j]) * R(row[j]);
+            return fromDecompositionScalar<value_type>(s);
+        });
+    }
+
+    template<typename E>
+    MatrixND<typename RowwiseReduction<E>::value_type> RowwiseReduction<E>::norm() const {
+        return perRow([](const value_type* row, int c) {
+            R s = 0;
+            for (int j = 0; j < c; j++)
+                s += R(row[j]) * R(row[j]);
+            return fromDecompositionScalar<value_type>(std::sqrt(s));
+        });
+    }
+
+    template<typename E>
+    MatrixND<typename RowwiseReduction<E>::R> RowwiseReduction<E>::variance(bool sample) const {
+        std::vector<R> sums, m2;
+        rowMoments(sums, m2);
+        const int divisor = sample ? expr.cols() - 1 : expr.cols();
+        for (auto& v : m2)
+            v = divisor > 0 ? v / R(divisor) : R(0);
+        return MatrixND<R>(m2, expr.rows(), 1);
+    }
+
+    template<typename E>
+    MatrixND<typename RowwiseReduction<E>::R> RowwiseReduction<E>::stddev(bool sample) const {
+        MatrixND<R> v = variance(sample);
+        for (auto& x : v.data)
+            x = std::sqrt(x);
+        return v;
+    }
+
+    template<typename E>
+    template<typename B, typename Op>
+    MatrixND<typename RowwiseReduction<E>::value_type> RowwiseReduction<E>::broadcast(const B& row, Op) const {
+        assert(row.rows() == 1 && row.cols() == expr.cols());
+        const int r = expr.rows(), c = expr.cols();
+        std::vector<std::decay_t<decltype(row[0])>> v(c);
+        for (int j = 0; j < c; j++)
+            v[j] = row[j];
+        MatrixND<value_type> out(r, c);
+        for (int i = 0; i < r; i++) {
+            value_type* o = out.data.data() + size_t(i) * c;
+            for (int j = 0; j < c; j++)
+                o[j] = static_cast<value_type>(Op::apply(expr[size_t(i) * c + j], v[j]));
+        }
+        return out;
+    }
+} // namespace rez
+#endif //PHYSICSFORMULA_MATRIXREDUCTION_H
@@ -0,0 +1,27 @@
+#ifndef PHYSICSFORMULA_MATRIXSCALAR_H
+#define PHYSICSFORMULA_MATRIXSCALAR_H
+#include <cmath>
+#include <type_traits>
+
+/**
+ * @brief scalar type the matrix algorithms compute in. MatrixND,
+ * MatrixDecomposition.h, MatrixEigen.h and MatrixReduction.h all include
+ * this header, so none of them has to include another one for it.
+ */
+namespace rez {
+    // integral element types are promoted to double for factorizations,
+    // reductions and parsing
+    template<typename T>
+    using decomposition_scalar =
+            std::conditional_t<std::is_floating_point_v<T>, T, double>;
+
+    // cast a result in decomposition_scalar<T> back to the element type
+    template<typename T, typename R>
+    T fromDecompositionScalar(R value) {
+        if constexpr (std::is_integral_v<T>)
+            return static_cast<T>(std::llround(value));
+        else
+            return static_cast<T>(value);
+    }
+} // namespace rez
+#endif //PHYSICSFORMULA_MATRIXSCALAR_H
@@ -0,0 +1,518 @@
+#ifndef PHYSICSFORMULA_MODELTRAINER_H
+#define PHYSICSFORMULA_MODELTRAINER_H
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "MatrixND.h"
+#include "MatrixDecomposition.h"
+#include "ThreadPool.h"
+
+/**
+ * @brief training engine for linear and logistic regression, the models
+ * z = X * w + b with a squared or a logistic (cross entropy) loss.
+ * The objective is the mean loss over the rows plus lambda / (2 * rows) * |w|^2,
+ * the same scaling LogisticRegression::Propagate has always used, the bias is
+ * not penalized.
+ *
+ * Every gradient is one pass over the rows of X: each row is read once, its
+ * residual is computed from a dot product and added back into the gradient.
+ * Rows are split into a fixed number of chunks independent of the thread
+ * count, the chunks are spread over ThreadPool::global() and their sums are
+ * merged in chunk order, so results do not depend on the number of threads.
+ * All buffers are allocated when training starts, the updates are in place.
+ *
+ * SGD, Momentum and Adam step once per mini-batch. Batches are contiguous
+ * runs of rows, their order is shuffled every epoch so the rows are still
+ * streamed sequentially. LBFGS works on the full data set with a backtracking
+ * line search. solveNormalEquation builds X^T X in the same chunked way and
+ * solves it by Cholesky, falling back to least squares QR when it is singular.
+ */
+namespace rez {
+    enum class TrainingLoss { Squared, Logistic };
+
+    enum class TrainingOptimizer { SGD, Momentum, Adam, LBFGS };
+
+    struct TrainingOptions {
+        TrainingOptimizer optimizer = TrainingOptimizer::Adam;
+        int epochs = 100;               // passes over the data, iterations for LBFGS
+        int batchSize = 0;              // rows per step, 0 for the whole data set
+        double learningRate = 0.01;
+        double lambda = 0.0;            // L2 penalty
+        double momentum = 0.9;
+        double beta1 = 0.9;             // Adam moment decay rates
+        double beta2 = 0.999;
+        double epsilon = 1e-8;
+        int history = 10;               // correction pairs kept by LBFGS
+        // 0 runs every epoch. LBFGS stops once the largest gradient entry is
+        // below it, the others once the epoch loss changes by less than
+        // tolerance relative to its size
+        double tolerance = 0.0;
+        bool fitIntercept = true;
+        bool shuffle = true;
+        uint64_t seed = 0;
+        size_t threads = 0;             // 0 uses the whole global pool, 1 the calling thread
+        // called after every epoch with its loss, never from inside the gradient pass
+        std::function<void(int, double)> log;
+    };
+
+    template<typename R>
+    struct TrainingResult {
+        std::vector<R> weights;
+        R bias = R(0);
+        std::vector<double> loss;       // objective at the start of every epoch
+        int epochs = 0;
+        bool converged = false;
+    };
+
+    namespace trainer_detail {
+        // four partial sums so the loop does not wait on a single accumulator
+        template<typename T, typename R>
+        inline R dot(const T* x, const R* w, int n) {
+            R s0 = R(0), s1 = R(0), s2 = R(0), s3 = R(0);
+            int j = 0;
+            for (; j + 4 <= n; j += 4) {
+                s0 += static_cast<R>(x[j]) * w[j];
+                s1 += static_cast<R>(x[j + 1]) * w[j + 1];
+                s2 += static_cast<R>(x[j + 2]) * w[j + 2];
+                s3 += static_cast<R>(x[j + 3]) * w[j + 3];
+            }
+            for (; j < n; j++)
+                s0 += static_cast<R>(x[j]) * w[j];
+            return (s0 + s1) + (s2 + s3);
+        }
+
+        // runs body(k) for k in [0, count) on up to tasks threads of the global pool
+        template<typename Body>
+        void forChunks(int count, size_t threads, Body body) {
+            ThreadPool& pool = ThreadPool::global();
+            const size_t tasks = std::min<size_t>(threads ? threads : pool.size(), size_t(count));
+            if (tasks <= 1) {
+                for (int k = 0; k < count; k++)
+                    body(k);
+                return;
+            }
+            std::atomic<int> next{ 0 };
+            TaskGroup group(pool);
+            for (size_t t = 0; t < tasks; t++)
+                group.run([&] {
+                    for (int k = next++; k < count; k = next++)
+                        body(k);
+                });
+            group.wait();
+        }
+    }
+
+    /**
+     * @brief gradients and fits of one data set, X holds a sample per row and
+     * y one target per row (0 or 1 for Logistic). Both are referenced, not
+     * copied, and have to outlive the trainer.
+     */
+    template<typename T>
+    class LinearModelTrainer {
+    public:
+        using R = decomposition_scalar<T>;
+    private:
+        // chunks of one gradient pass, and the fewest elements worth a chunk
+        static constexpr int MAX_CHUNKS = 64;
+        static constexpr size_t CHUNK_ELEMENTS = size_t(1) << 15;
+
+        const MatrixND<T>& X;
+        const T* target;
+        TrainingLoss loss;
+        int n;                      // features
+        std::vector<R> partial;     // per chunk: gradient, bias gradient, loss sum
+        std::vector<R> grad;        // last gradient, weights then bias
+
+        template<bool logistic>
+        void accumulate(const R* params, int first, int last, R* out) const;
+
+        void fitFirstOrder(const TrainingOptions& options, std::vector<R>& params, TrainingResult<R>& result);
+        void fitLbfgs(const TrainingOptions& options, std::vector<R>& params, TrainingResult<R>& result);
+    public:
+        LinearModelTrainer(const MatrixND<T>& X, const MatrixND<T>& y, TrainingLoss loss);
+
+        [[nodiscard]] int features() const { return n; }
+        [[nodiscard]] int samples() const { return X.rows; }
+
+        /**
+         * @brief objective over rows [first, last) and its gradient
+         * @param params features() weights followed by the bias
+         * @param gradient features() + 1 entries, same layout as params
+         * @return mean loss of the rows plus the L2 penalty, which is scaled by
+         * the full sample count so mini-batch gradients estimate the full one
+         */
+        double evaluate(const R* params, int first, int last, double lambda, R* gradient, size_t threads = 0);
+
+        /**
+         * @brief fits the model from weights and bias, zero weights when empty
+         */
+        TrainingResult<R> fit(const TrainingOptions& options, std::vector<R> weights = {}, R bias = R(0));
+
+        // last gradient fit() computed, weights then bias
+        [[nodiscard]] const std::vector<R>& gradient() const { return grad; }
+    };
+
+    /**
+     * @brief least squares weights in closed form, (X^T X + lambda I) w = X^T y
+     * @return converged is false when X^T X was singular and the least
+     * squares answer of the pivoted QR decomposition was used instead
+     */
+    template<typename T>
+    TrainingResult<decomposition_scalar<T>> solveNormalEquation(const MatrixND<T>& X, const MatrixND<T>& y,
+                                                                double lambda = 0.0, bool fitIntercept = true,
+                                                                size_t threads = 0);
+
+//*****************************************************************************
+// LinearModelTrainer
+//*****************************************************************************
+    template<typename T>
+    LinearModelTrainer<T>::LinearModelTrainer(const MatrixND<T>& X, const MatrixND<T>& y, TrainingLoss loss)
+            : X(X), target(y.data.data()), loss(loss), n(X.cols),
+              partial(size_t(MAX_CHUNKS) * (X.cols + 2)), grad(X.cols + 1) {
+        assert(int(y.data.size()) == X.rows);
+    }
+
+    template<typename T>
+    template<bool logistic>
+    void LinearModelTrainer<T>::accumulate(const R* params, int first, int last, R* out) const {
+        std::fill(out, out + n + 2, R(0));
+        const R bias = params[n];
+        R biasGradient = R(0);
+        R lossSum = R(0);
+        for (int i = first; i < last; i++) {
+            const T* x = X.data.data() + size_t(i) * n;
+            const R z = bias + trainer_detail::dot(x, params, n);
+            const R t = static_cast<R>(target[i]);
+            R r;
+            if constexpr (logistic) {
+                // sigmoid and log(1 + e^z) - t z without overflow for large |z|
+                const R e = std::exp(-std::abs(z));
+                r = (z >= R(0) ? R(1) / (R(1) + e) : e / (R(1) + e)) - t;
+                lossSum += std::log1p(e) + std::max(z, R(0)) - t * z;
+            } else {
+                r = z - t;
+                lossSum += R(0.5) * r * r;
+            }
+            for (int j = 0; j < n; j++)
+                out[j] += r * static_cast<R>(x[j]);
+            biasGradient += r;
+        }
+        out[n] = biasGradient;
+        out[n + 1] = lossSum;
+    }
+
+    template<typename T>
+    double LinearModelTrainer<T>::evaluate(const R* params, int first, int last, double lambda, R* gradient,
+                                           size_t threads) {
+        const int rows = last - first;
+        const int minRows = static_cast<int>(std::max<size_t>(CHUNK_ELEMENTS / size_t(std::max(n, 1)), 1));
+        const int chunkRows = std::max((rows + MAX_CHUNKS - 1) / MAX_CHUNKS, minRows);
+        const int chunks = rows > 0 ? (rows + chunkRows - 1) / chunkRows : 0;
+        const size_t stride = size_t(n) + 2;
+        trainer_detail::forChunks(chunks, threads, [&](int k) {
+            const int a = first + k * chunkRows;
+            const int b = std::min(last, a + chunkRows);
+            if (loss == TrainingLoss::Logistic)
+                accumulate<true>(params, a, b, partial.data() + k * stride);
+            else
+                accumulate<false>(params, a, b, partial.data() + k * stride);
+        });
+
+        std::fill(gradient, gradient + n + 1, R(0));
+        double lossSum = 0.0;
+        for (int k = 0; k < chunks; k++) {
+            const R* part = partial.data() + k * stride;
+            for (int j = 0; j <= n; j++)
+                gradient[j] += part[j];
+            lossSum += double(part[n + 1]);
+        }
+        const R scale = rows > 0 ? R(1) / R(rows) : R(0);
+        const R penalty = X.rows > 0 ? R(lambda / X.rows) : R(0);
+        double squaredNorm = 0.0;
+        for (int j = 0; j < n; j++) {
+            gradient[j] = gradient[j] * scale + penalty * params[j];
+            squaredNorm += double(params[j]) * double(params[j]);
+        }
+        gradient[n] *= scale;
+        return lossSum * double(scale) + 0.5 * double(penalty) * squaredNorm;
+    }
+
+    template<typename T>
+    TrainingResult<typename LinearModelTrainer<T>::R>
+    LinearModelTrainer<T>::fit(const TrainingOptions& options, std::vector<R> weights, R bias) {
+        std::vector<R> params(n + 1, R(0));
+        if (int(weights.size()) == n)
+            std::copy(weights.begin(), weights.end(), params.begin());
+        params[n] = options.fitIntercept ? bias : R(0);
+
+        TrainingResult<R> result;
+        result.loss.reserve(std::max(options.epochs, 0));
+        if (options.optimizer == TrainingOptimizer::LBFGS)
+            fitLbfgs(options, params, result);
+        else
+            fitFirstOrder(options, params, result);
+
+        result.bias = params[n];
+        params.pop_back();
+        result.weights = std::move(params);
+        return result;
+    }
+
+    template<typename T>
+    void LinearModelTrainer<T>::fitFirstOrder(const TrainingOptions& options, std::vector<R>& params,
+                                              TrainingResult<R>& result) {
+        const int rows = X.rows;
+        const int batch = options.batchSize > 0 ? std::min(options.batchSize, std::max(rows, 1)) : std::max(rows, 1);
+        const int batches = rows > 0 ? (rows + batch - 1) / batch : 0;
+        std::vector<int> order(batches);
+        std::iota(order.begin(), order.end(), 0);
+        std::mt19937_64 random(options.seed);
+
+        const R rate = R(options.learningRate);
+        const R momentum = R(options.momentum);
+        const R beta1 = R(options.beta1), beta2 = R(options.beta2);
+        const R epsilon = R(options.epsilon);
+        std::vector<R> first(n + 1, R(0));     // velocity, or Adam's first moment
+        std::vector<R> second(n + 1, R(0));    // Adam's second moment
+        R beta1Power = R(1), beta2Power = R(1);
+
+        double previous = 0.0;
+        for (int epoch = 0; epoch < options.epochs; epoch++) {
+            if (options.shuffle && batches > 1)
+                std::shuffle(order.begin(), order.end(), random);
+            double epochLoss = 0.0;
+            for (int b : order) {
+                const int a = b * batch;
+                const int e = std::min(rows, a + batch);
+                epochLoss += evaluate(params.data(), a, e, options.lambda, grad.data(), options.threads)
+                             * double(e - a) / double(rows);
+                if (!options.fitIntercept)
+                    grad[n] = R(0);
+
+                switch (options.optimizer) {
+                case TrainingOptimizer::Momentum:
+                    for (int j = 0; j <= n; j++) {
+                        first[j] = momentum * first[j] + grad[j];
+                        params[j] -= rate * first[j];
+                    }
+                    break;
+                case TrainingOptimizer::Adam: {
+                    beta1Power *= beta1;
+                    beta2Power *= beta2;
+                    const R step = rate * std::sqrt(R(1) - beta2Power) / (R(1) - beta1Power);
+                    for (int j = 0; j <= n; j++) {
+                        first[j] = beta1 * first[j] + (R(1) - beta1) * grad[j];
+                        second[j] = beta2 * second[j] + (R(1) - beta2) * grad[j] * grad[j];
+                        params[j] -= step * first[j] / (std::sqrt(second[j]) + epsilon);
+                    }
+                    break;
+                }
+                default:
+                    for (int j = 0; j <= n; j++)
+                        params[j] -= rate * grad[j];
+                    break;
+                }
+            }
+            result.loss.push_back(epochLoss);
+            result.epochs = epoch + 1;
+            if (options.log)
+                options.log(epoch, epochLoss);
+            if (options.tolerance > 0.0 && epoch > 0
+                && std::abs(previous - epochLoss) <= options.tolerance * std::max(1.0, std::abs(epochLoss))) {
+                result.converged = true;
+                break;
+            }
+            previous = epochLoss;
+        }
+    }
+
+    template<typename T>
+    void LinearModelTrainer<T>::fitLbfgs(const TrainingOptions& options, std::vector<R>& params,
+                                         TrainingResult<R>& result) {
+        constexpr int MAX_BACKTRACKS = 40;
+        const int size = n + 1;
+        const int memory = std::max(options.history, 1);
+        std::vector<R> s(size_t(memory) * size), y(size_t(memory) * size);
+        std::vector<R> rho(memory), alpha(memory);
+        std::vector<R> direction(size), trial(size), trialGradient(size);
+        int stored = 0, newest = -1;
+
+        auto dotProduct = [size](const R* a, const R* b) {
+            R sum = R(0);
+            for (int j = 0; j < size; j++)
+                sum += a[j] * b[j];
+            return sum;
+        };
+        auto fullGradient = [&](const R* p, R* g) {
+            const double f = evaluate(p, 0, X.rows, options.lambda, g, options.threads);
+            if (!options.fitIntercept)
+                g[n] = R(0);
+            return f;
+        };
+
+        double f = fullGradient(params.data(), grad.data());
+        for (int iteration = 0; iteration < options.epochs; iteration++) {
+            R largest = R(0);
+            for (int j = 0; j < size; j++)
+                largest = std::max(largest, std::abs(grad[j]));
+            if (options.tolerance > 0.0 && largest <= R(options.tolerance)) {
+                result.converged = true;
+                break;
+            }
+
+            // two loop recursion, direction = -H * grad
+            for (int j = 0; j < size; j++)
+                direction[j] = -grad[j];
+            for (int k = 0, slot = newest; k < stored; k++, slot = (slot + memory - 1) % memory) {
+                alpha[slot] = rho[slot] * dotProduct(s.data() + slot * size, direction.data());
+                const R* ys = y.data() + slot * size;
+                for (int j = 0; j < size; j++)
+                    direction[j] -= alpha[slot] * ys[j];
+            }
+            if (stored > 0) {
+                const R* ys = y.data() + newest * size;
+                const R gamma = dotProduct(s.data() + newest * size, ys) / dotProduct(ys, ys);
+                for (int j = 0; j < size; j++)
+                    direction[j] *= gamma;
+            }
+            for (int k = 0, slot = (newest + memory - stored + 1) % memory; k < stored; k++, slot = (slot + 1) % memory) {
+                const R beta = rho[slot] * dotProduct(y.data() + slot * size, direction.data());
+                const R* ss = s.data() + slot * size;
+                for (int j = 0; j < size; j++)
+                    direction[j] += (alpha[slot] - beta) * ss[j];
+            }
+            R slope = dotProduct(grad.data(), direction.data());
+            if (!(slope < R(0))) {
+                // not a descent direction, start over from steepest descent
+                stored = 0;
+                for (int j = 0; j < size; j++)
+                    direction[j] = -grad[j];
+                slope = dotProduct(grad.data(), direction.data());
+            }
+
+            R step = stored == 0 ? std::min(R(1), R(1) / std::sqrt(-slope)) : R(1);
+            double trialLoss = f;
+            int backtracks = 0;
+            for (; backtracks < MAX_BACKTRACKS; backtracks++, step *= R(0.5)) {
+                for (int j = 0; j < size; j++)
+                    trial[j] = params[j] + step * direction[j];
+                trialLoss = fullGradient(trial.data(), trialGradient.data());
+                if (trialLoss <= f + 1e-4 * double(step) * double(slope))
+                    break;
+            }
+            result.loss.push_back(f);
+            result.epochs = iteration + 1;
+            if (options.log)
+                options.log(iteration, f);
+            if (backtracks == MAX_BACKTRACKS) {
+                // no decrease along the direction, the objective is at its floor
+                result.converged = true;
+                break;
+            }
+
+            // keep the pair only where the objective curves upwards along the step
+            R curvature = R(0);
+            for (int j = 0; j < size; j++)
+                curvature += (trial[j] - params[j]) * (trialGradient[j] - grad[j]);
+            if (curvature > R(0)) {
+                newest = (newest + 1) % memory;
+                R* sn = s.data() + newest * size;
+                R* yn = y.data() + newest * size;
+                for (int j = 0; j < size; j++) {
+                    sn[j] = trial[j] - params[j];
+                    yn[j] = trialGradient[j] - grad[j];
+                }
+                rho[newest] = R(1) / curvature;
+                stored = std::min(stored + 1, memory);
+            }
+            params.swap(trial);
+            grad.swap(trialGradient);
+            f = trialLoss;
+        }
+    }
+
+//*****************************************************************************
+// normal equation
+//*****************************************************************************
+    template<typename T>
+    TrainingResult<decomposition_scalar<T>> solveNormalEquation(const MatrixND<T>& X, const MatrixND<T>& y,
+                                                                double lambda, bool fitIntercept, size_t threads) {
+        using R = decomposition_scalar<T>;
+        assert(int(y.data.size()) == X.rows);
+        const int n = X.cols;
+        const int p = n + (fitIntercept ? 1 : 0);
+        const int rows = X.rows;
+        // lower triangle of the Gram matrix and X^T y per chunk, at most 32 MB of them
+        const size_t stride = size_t(p) * p + p;
+        const int maxChunks = static_cast<int>(std::clamp<size_t>((size_t(1) << 22) / stride, 1, 64));
+        const int chunkRows = std::max((rows + maxChunks - 1) / maxChunks, 256);
+        const int chunks = rows > 0 ? (rows + chunkRows - 1) / chunkRows : 0;
+        std::vector<R> partial(size_t(chunks) * stride, R(0));
+
+        trainer_detail::forChunks(chunks, threads, [&](int k) {
+            R* gram = partial.data() + k * stride;
+            R* rhs = gram + size_t(p) * p;
+            std::vector<R> row(p, R(1));
+            for (int i = k * chunkRows; i < std::min(rows, (k + 1) * chunkRows); i++) {
+                const T* x = X.data.data() + size_t(i) * n;
+                for (int j = 0; j < n; j++)
+                    row[j] = static_cast<R>(x[j]);
+                const R t = static_cast<R>(y.data[i]);
+                for (int a = 0; a < p; a++) {
+                    R* g = gram + size_t(a) * p;
+                    const R xa = row[a];
+                    for (int b = 0; b <= a; b++)
+                        g[b] += xa * row[b];
+                    rhs[a] += xa * t;
+                }
+            }
+        });
+
+        std::vector<R> gram(size_t(p) * p, R(0));
+        std::vector<R> rhs(p, R(0));
+        for (int k = 0; k < chunks; k++) {
+            const R* part = partial.data() + k * stride;
+            for (size_t e = 0; e < size_t(p) * p; e++)
+                gram[e] += part[e];
+            for (int a = 0; a < p; a++)
+                rhs[a] += part[size_t(p) * p + a];
+        }
+        for (int a = 0; a < p; a++)
+            for (int b = 0; b < a; b++)
+                gram[size_t(b) * p + a] = gram[size_t(a) * p + b];
+        for (int j = 0; j < n; j++)
+            gram[size_t(j) * p + j] += R(lambda);
+
+        TrainingResult<R> result;
+        const MatrixND<R> A(gram, p, p);
+        std::vector<R> solution;
+        const CholeskyDecomposition<R> cholesky(A);
+        if (cholesky.isPositiveDefinite()) {
+            solution = cholesky.solve(rhs);
+            result.converged = true;
+        } else {
+            const QRDecomposition<R> qr(A);
+            solution = qr.solve(rhs);
+            result.converged = qr.isFullRank();
+        }
+        result.bias = fitIntercept ? solution[n] : R(0);
+        solution.resize(n);
+        result.weights = std::move(solution);
+        result.epochs = 1;
+
+        std::vector<R> params(result.weights);
+        params.push_back(result.bias);
+        std::vector<R> gradient(n + 1);
+        LinearModelTrainer<T> trainer(X, y, TrainingLoss::Squared);
+        result.loss.push_back(trainer.evaluate(params.data(), 0, rows, lambda, gradient.data(), threads));
+        return result;
+    }
+} // namespace rez
+#endif //PHYSICSFORMULA_MODELTRAINER_H
@@ -0,0 +1,735 @@
+#ifndef PHYSICSFORMULA_NBODY_H
+#define PHYSICSFORMULA_NBODY_H
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "Constants.h"
+#include "ThreadPool.h"
+
+/**
+ * @brief N-body fields of point charges (Coulomb) or point masses (gravity).
+ * The sources are sorted along a Morton curve and an octree is built over
+ * them, every cell keeps the monopole, dipole and traceless quadrupole of its
+ * sources about their centre. Cells with radius b seen from distance R are
+ * accepted as a whole when b < theta * R, so theta trades accuracy for speed:
+ * 0 gives the direct sum, 0.5 is within about 1e-3 of it.
+ *
+ * BarnesHut walks the tree once per target. FMM walks it against itself,
+ * well separated pairs of cells meet through a third order local expansion
+ * at the target cell, which is then passed down to its particles. Direct is
+ * the O(N^2) sum the other two are measured against. Targets are spread over
+ * the global thread pool, the tree is read only while they are evaluated.
+ *
+ * Fields are returned per unit of target strength: the electric field in N/C
+ * and potential in V for charges, the gravitational acceleration in m/s^2 and
+ * potential in J/kg for masses. forces() multiplies in the target strength.
+ * The constants come from constants::K and constants::G.
+ */
+namespace rez {
+    enum class NBodyInteraction { Coulomb, Gravity };
+
+    enum class NBodyMethod { Direct, BarnesHut, FMM };
+
+    // particles as structure of arrays, strength is the charge in C or mass in kg
+    template<typename real_type = double>
+    struct NBodyParticles {
+        std::vector<real_type> x, y, z, strength;
+
+        [[nodiscard]] size_t size() const { return strength.size(); }
+
+        void reserve(size_t n) {
+            x.reserve(n);
+            y.reserve(n);
+            z.reserve(n);
+            strength.reserve(n);
+        }
+
+        void add(real_type px, real_type py, real_type pz, real_type s) {
+            x.push_back(px);
+            y.push_back(py);
+            z.push_back(pz);
+            strength.push_back(s);
+        }
+    };
+
+    // field vector and potential at every target, in target order
+    template<typename real_type = double>
+    struct NBodyField {
+        std::vector<real_type> x, y, z, potential;
+
+        [[nodiscard]] size_t size() const { return potential.size(); }
+
+        void resize(size_t n) {
+            x.assign(n, 0);
+            y.assign(n, 0);
+            z.assign(n, 0);
+            potential.assign(n, 0);
+        }
+    };
+
+    template<typename real_type = double>
+    class NBody {
+    public:
+        static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+        // below this many targets the evaluation runs on the calling thread
+        static constexpr size_t PARALLEL_MIN = 2048;
+
+        // octree cell, the children of a cell are next to each other
+        struct Node {
+            real_type center[3];
+            real_type radius;           // distance from center to the farthest source
+            real_type monopole;
+            real_type magnitude;        // sum of |strength|
+            real_type dipole[3];
+            real_type quadrupole[6];    // xx xy xz yy yz zz
+            uint32_t first, count;      // run of sorted sources
+            uint32_t child, children;   // first child and number of children, 0 for a leaf
+        };
+
+    private:
+        // third order expansion of the potential around a cell center
+        struct Local {
+            real_type potential = 0;
+            real_type field[3] = { 0, 0, 0 };
+            real_type gradient[6] = { 0, 0, 0, 0, 0, 0 };    // of the field, xx xy xz yy yz zz
+            real_type curvature[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };  // xxx xxy xxz xyy xyz xzz yyy yyz yzz zzz
+        };
+
+        // position of the symmetric component ij in gradient and ijk in curvature
+        static constexpr int SYM2[3][3] = { { 0, 1, 2 }, { 1, 3, 4 }, { 2, 4, 5 } };
+        static constexpr int SYM3[3][3][3] = { { { 0, 1, 2 }, { 1, 3, 4 }, { 2, 4, 5 } },
+                                               { { 1, 3, 4 }, { 3, 6, 7 }, { 4, 7, 8 } },
+                                               { { 2, 4, 5 }, { 4, 7, 8 }, { 5, 8, 9 } } };
+
+        static constexpr unsigned MORTON_BITS = 21;
+
+        NBodyInteraction interaction;
+        NBodyMethod method;
+        real_type theta;
+        real_type softening = 0;
+        unsigned leafSize = 16;
+        unsigned threads;
+
+        std::vector<Node> nodes;
+        std::vector<real_type> xs, ys, zs, ss;  // sources in Morton order
+        std::vector<uint32_t> order;            // input index of every sorted source
+
+        real_type coupling() const {
+            return interaction == NBodyInteraction::Coulomb ? real_type(constants::K) : real_type(-constants::G);
+        }
+
+        template<typename Body>
+        void parallelFor(size_t count, Body body) const;
+
+        void sortSources(const NBodyParticles<real_type>& sources, std::vector<uint64_t>& codes);
+        void buildNode(uint32_t node, const std::vector<uint64_t>& codes, unsigned level);
+        void leafMoments(Node& node) const;
+        void innerMoments(Node& node) const;
+
+        void multipole(const Node& node, real_type rx, real_type ry, real_type rz,
+                       real_type& phi, real_type* g) const;
+        void direct(uint32_t first, uint32_t last, real_type px, real_type py, real_type pz, uint32_t self,
+                    real_type& phi, real_type* g) const;
+        void walk(real_type px, real_type py, real_type pz, uint32_t self, real_type& phi, real_type* g) const;
+
+        void toLocal(const Node& target, const Node& source, Local& local) const;
+        void interact(uint32_t target, uint32_t source, std::vector<Local>& locals, NBodyField<real_type>& out) const;
+        void passDown(uint32_t node, std::vector<Local>& locals, NBodyField<real_type>& out) const;
+        void fmm(NBodyField<real_type>& out) const;
+
+    public:
+        /**
+         * @param openingAngle theta of the acceptance test b < theta * R
+         * @param threadCount 1 runs on the calling thread, 0 uses the global pool
+         */
+        explicit NBody(NBodyInteraction kind, NBodyMethod how = NBodyMethod::BarnesHut,
+                       real_type openingAngle = real_type(0.5), unsigned threadCount = 0)
+                : interaction(kind), method(how), theta(openingAngle), threads(threadCount) {}
+
+        NBody(const NBodyParticles<real_type>& sources, NBodyInteraction kind,
+              NBodyMethod how = NBodyMethod::BarnesHut, real_type openingAngle = real_type(0.5),
+              unsigned threadCount = 0)
+                : NBody(kind, how, openingAngle, threadCount) {
+            build(sources);
+        }
+
+        void setMethod(NBodyMethod how) { method = how; }
+        void setOpeningAngle(real_type openingAngle) { theta = openingAngle; }
+
+        // Plummer softening length, added to the distance of the pairs summed directly
+        void setSoftening(real_type length) { softening = length; }
+
+        // sources per leaf, takes effect on the next build
+        void setLeafSize(unsigned size) { leafSize = std::max(1u, size); }
+
+        void build(const NBodyParticles<real_type>& sources);
+
+        [[nodiscard]] size_t size() const { return ss.size(); }
+        [[nodiscard]] size_t nodeCount() const { return nodes.size(); }
+        [[nodiscard]] const std::vector<Node>& tree() const { return nodes; }
+
+        // field at every source due to all the others
+        void field(NBodyField<real_type>& out) const;
+
+        // field at arbitrary points, FMM falls back to BarnesHut here
+        void field(const std::vector<real_type>& x, const std::vector<real_type>& y,
+                   const std::vector<real_type>& z, NBodyField<real_type>& out) const;
+
+        // force in N on every source and its potential energy in J
+        void forces(NBodyField<real_type>& out) const;
+    };
+
+//*****************************************************************************
+// construction
+//*****************************************************************************
+    template<typename real_type>
+    template<typename Body>
+    void NBody<real_type>::parallelFor(size_t count, Body body) const {
+        ThreadPool& pool = ThreadPool::global();
+        const size_t tasks = std::min<size_t>(threads ? threads : pool.size(), count / (PARALLEL_MIN / 4) + 1);
+        if (tasks <= 1 || count < PARALLEL_MIN) {
+            body(size_t(0), count);
+            return;
+        }
+        const size_t chunks = 8 * tasks;
+        std::atomic<size_t> next{ 0 };
+        TaskGroup group(pool);
+        for (size_t t = 0; t < tasks; t++)
+            group.run([&] {
+                for (size_t c = next++; c < chunks; c = next++)
+                    body(count * c / chunks, count * (c + 1) / chunks);
+            });
+        group.wait();
+    }
+
+    namespace nbody_detail {
+        // spreads the low 21 bits of v to every third bit
+        inline uint64_t spread(uint64_t v) {
+            v &= 0x1FFFFFull;
+            v = (v | v << 32) & 0x1F00000000FFFFull;
+            v = (v | v << 16) & 0x1F0000FF0000FFull;
+            v = (v | v << 8) & 0x100F00F00F00F00Full;
+            v = (v | v << 4) & 0x10C30C30C30C30C3ull;
+            v = (v | v << 2) & 0x1249249249249249ull;
+            return v;
+        }
+    }
+
+    // Sorts the sources along the Morton curve of their bounding cube. Chunks are
+    // sorted as tasks and merged pairwise, so the order does not depend on the
+    // number of threads.
+    template<typename real_type>
+    void NBody<real_type>::sortSources(const NBodyParticles<real_type>& sources, std::vector<uint64_t>& codes) {
+        const size_t n = sources.size();
+        real_type lo[3], hi[3];
+        for (int a = 0; a < 3; a++) {
+            lo[a] = std::numeric_limits<real_type>::max();
+            hi[a] = std::numeric_limits<real_type>::lowest();
+        }
+        const std::vector<real_type>* axis[3] = { &sources.x, &sources.y, &sources.z };
+        for (size_t i = 0; i < n; i++)
+            for (int a = 0; a < 3; a++) {
+                lo[a] = std::min(lo[a], (*axis[a])[i]);
+                hi[a] = std::max(hi[a], (*axis[a])[i]);
+            }
+        real_type extent = 0;
+        for (int a = 0; a < 3; a++)
+            extent = std::max(extent, hi[a] - lo[a]);
+        const double scale = extent > 0 ? double((1u << MORTON_BITS) - 1) / double(extent) : 0.0;
+
+        std::vector<std::pair<uint64_t, uint32_t>> keyed(n);
+        parallelFor(n, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                uint64_t code = 0;
+                for (int a = 0; a < 3; a++)
+                    code |= nbody_detail::spread(uint64_t(double((*axis[a])[i] - lo[a]) * scale)) << a;
+                keyed[i] = { code, static_cast<uint32_t>(i) };
+            }
+        });
+
+        size_t runs = 1;
+        while (runs < (threads ? threads : ThreadPool::global().size()) && n / (runs * 2) >= PARALLEL_MIN)
+            runs *= 2;
+        {
+            TaskGroup group(ThreadPool::global());
+            for (size_t r = 0; r < runs; r++)
+                group.run([&, r] { std::sort(keyed.begin() + n * r / runs, keyed.begin() + n * (r + 1) / runs); });
+            group.wait();
+        }
+        for (size_t width = 1; width < runs; width *= 2) {
+            TaskGroup group(ThreadPool::global());
+            for (size_t r = 0; r + width < runs; r += 2 * width)
+                group.run([&, r] {
+                    std::inplace_merge(keyed.begin() + n * r / runs, keyed.begin() + n * (r + width) / runs,
+                                       keyed.begin() + n * std::min(r + 2 * width, runs) / runs);
+                });
+            group.wait();
+        }
+
+        xs.resize(n);
+        ys.resize(n);
+        zs.resize(n);
+        ss.resize(n);
+        order.resize(n);
+        codes.resize(n);
+        parallelFor(n, [&](size_t first, size_t last) {
+            for (size_t s = first; s < last; s++) {
+                const uint32_t i = keyed[s].second;
+                codes[s] = keyed[s].first;
+                order[s] = i;
+                xs[s] = sources.x[i];
+                ys[s] = sources.y[i];
+                zs[s] = sources.z[i];
+                ss[s] = sources.strength[i];
+            }
+        });
+    }
+
+    template<typename real_type>
+    void NBody<real_type>::build(const NBodyParticles<real_type>& sources) {
+        nodes.clear();
+        std::vector<uint64_t> codes;
+        sortSources(sources, codes);
+        if (ss.empty())
+            return;
+        // a cell of at most leafSize sources per 2 sources bounds the node count
+        nodes.reserve(2 * ss.size() / leafSize + 64);
+        Node root{};
+        root.first = 0;
+        root.count = static_cast<uint32_t>(ss.size());
+        nodes.push_back(root);
+        buildNode(0, codes, MORTON_BITS);
+    }
+
+    // Splits the cell by the next three bits of the Morton codes. Runs of equal
+    // codes below the last level stay in one leaf however long they are.
+    template<typename real_type>
+    void NBody<real_type>::buildNode(uint32_t node, const std::vector<uint64_t>& codes, unsigned level) {
+        const uint32_t first = nodes[node].first, last = first + nodes[node].count;
+        if (nodes[node].count <= leafSize || level == 0) {
+            leafMoments(nodes[node]);
+            return;
+        }
+        const unsigned shift = 3 * (level - 1);
+        uint32_t bounds[9];
+        bounds[0] = first;
+        bounds[8] = last;
+        for (unsigned o = 1; o < 8; o++)
+            bounds[o] = static_cast<uint32_t>(std::partition_point(codes.begin() + bounds[o - 1], codes.begin() + last,
+                                                                   [&](uint64_t c) { return ((c >> shift) & 7) < o; })
+                                              - codes.begin());
+        const uint32_t child = static_cast<uint32_t>(nodes.size());
+        uint32_t children = 0;
+        for (unsigned o = 0; o < 8; o++)
+            if (bounds[o + 1] > bounds[o]) {
+                Node c{};
+                c.first = bounds[o];
+                c.count = bounds[o + 1] - bounds[o];
+                nodes.push_back(c);
+                children++;
+            }
+        if (children == 1) {
+            // every source in one octant, descend without keeping the cell
+            nodes.pop_back();
+            buildNode(node, codes, level - 1);
+            return;
+        }
+        nodes[node].child = child;
+        nodes[node].children = children;
+        for (uint32_t c = 0; c < children; c++)
+            buildNode(child + c, codes, level - 1);
+        innerMoments(nodes[node]);
+    }
+
+    // Moments about the centroid weighted by |strength|, so cells of mixed charges
+    // are centred on where the charge is and the dipole carries the imbalance.
+    template<typename real_type>
+    void NBody<real_type>::leafMoments(Node& node) const {
+        const uint32_t first = node.first, last = first + node.count;
+        real_type weight = 0, cx = 0, cy = 0, cz = 0;
+        for (uint32_t i = first; i < last; i++) {
+            const real_type w = std::abs(ss[i]);
+            weight += w;
+            cx += w * xs[i];
+            cy += w * ys[i];
+            cz += w * zs[i];
+        }
+        if (weight > 0) {
+            cx /= weight;
+            cy /= weight;
+            cz /= weight;
+        } else {
+            cx = cy = cz = 0;
+            for (uint32_t i = first; i < last; i++) {
+                cx += xs[i];
+                cy += ys[i];
+                cz += zs[i];
+            }
+            cx /= real_type(node.count);
+            cy /= real_type(node.count);
+            cz /= real_type(node.count);
+        }
+        node.center[0] = cx;
+        node.center[1] = cy;
+        node.center[2] = cz;
+        node.magnitude = weight;
+        node.radius = node.monopole = 0;
+        std::fill(node.dipole, node.dipole + 3, real_type(0));
+        std::fill(node.quadrupole, node.quadrupole + 6, real_type(0));
+        real_type* q = node.quadrupole;
+        for (uint32_t i = first; i < last; i++) {
+            const real_type dx = xs[i] - cx, dy = ys[i] - cy, dz = zs[i] - cz, s = ss[i];
+            const real_type d2 = dx * dx + dy * dy + dz * dz;
+            node.radius = std::max(node.radius, d2);
+            node.monopole += s;
+            node.dipole[0] += s * dx;
+            node.dipole[1] += s * dy;
+            node.dipole[2] += s * dz;
+            q[0] += s * (3 * dx * dx - d2);
+            q[1] += s * 3 * dx * dy;
+            q[2] += s * 3 * dx * dz;
+            q[3] += s * (3 * dy * dy - d2);
+            q[4] += s * 3 * dy * dz;
+            q[5] += s * (3 * dz * dz - d2);
+        }
+        node.radius = std::sqrt(node.radius);
+    }
+
+    // Shifts the moments of the children to the centre of the cell
+    template<typename real_type>
+    void NBody<real_type>::innerMoments(Node& node) const {
+        real_type weight = 0, c[3] = { 0, 0, 0 };
+        for (uint32_t k = node.child; k < node.child + node.children; k++)
+            weight += nodes[k].magnitude;
+        for (uint32_t k = node.child; k < node.child + node.children; k++) {
+            // cells without strength are centred on their sources
+            const real_type w = weight > 0 ? nodes[k].magnitude : real_type(nodes[k].count);
+            for (int a = 0; a < 3; a++)
+                c[a] += w * nodes[k].center[a];
+        }
+        const real_type total = weight > 0 ? weight : real_type(node.count);
+        for (int a = 0; a < 3; a++)
+            node.center[a] = c[a] / total;
+        node.magnitude = weight;
+
+        node.radius = node.monopole = 0;
+        std::fill(node.dipole, node.dipole + 3, real_type(0));
+        std::fill(node.quadrupole, node.quadrupole + 6, real_type(0));
+        real_type* q = node.quadrupole;
+        for (uint32_t k = node.child; k < node.child + node.children; k++) {
+            const Node& n = nodes[k];
+            const real_type d[3] = { n.center[0] - node.center[0], n.center[1] - node.center[1],
+                                     n.center[2] - node.center[2] };
+            const real_type d2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+            const real_type dd = n.dipole[0] * d[0] + n.dipole[1] * d[1] + n.dipole[2] * d[2];
+            node.radius = std::max(node.radius, std::sqrt(d2) + n.radius);
+            node.monopole += n.monopole;
+            for (int a = 0; a < 3; a++)
+                node.dipole[a] += n.dipole[a] + n.monopole * d[a];
+            // Q' = Q + 3 (D d^T + d D^T) - 2 (D.d) I + M (3 d d^T - d^2 I)
+            const int row[6] = { 0, 0, 0, 1, 1, 2 }, col[6] = { 0, 1, 2, 1, 2, 2 };
+            for (int e = 0; e < 6; e++) {
+                const int i = row[e], j = col[e];
+                const real_type diagonal = i == j ? real_type(1) : real_type(0);
+                q[e] += n.quadrupole[e] + 3 * (n.dipole[i] * d[j] + d[i] * n.dipole[j]) - 2 * dd * diagonal
+                        + n.monopole * (3 * d[i] * d[j] - d2 * diagonal);
+            }
+        }
+    }
+
+//*****************************************************************************
+// evaluation
+//*****************************************************************************
+    // potential and field of the cell moments at offset r from the cell center
+    template<typename real_type>
+    void NBody<real_type>::multipole(const Node& node, real_type rx, real_type ry, real_type rz,
+                                     real_type& phi, real_type* g) const {
+        const real_type* q = node.quadrupole;
+        const real_type* d = node.dipole;
+        const real_type r2 = rx * rx + ry * ry + rz * rz;
+        const real_type inv = 1 / std::sqrt(r2);
+        const real_type inv2 = inv * inv, inv3 = inv * inv2, inv5 = inv3 * inv2;
+        const real_type qx = q[0] * rx + q[1] * ry + q[2] * rz;
+        const real_type qy = q[1] * rx + q[3] * ry + q[4] * rz;
+        const real_type qz = q[2] * rx + q[4] * ry + q[5] * rz;
+        const real_type rqr = rx * qx + ry * qy + rz * qz;
+        const real_type dr = d[0] * rx + d[1] * ry + d[2] * rz;
+        phi += node.monopole * inv + dr * inv3 + real_type(0.5) * rqr * inv5;
+        const real_type radial = node.monopole * inv3 + 3 * dr * inv5 + real_type(2.5) * rqr * inv5 * inv2;
+        g[0] += radial * rx - d[0] * inv3 - qx * inv5;
+        g[1] += radial * ry - d[1] * inv3 - qy * inv5;
+        g[2] += radial * rz - d[2] * inv3 - qz * inv5;
+    }
+
+    template<typename real_type>
+    void NBody<real_type>::direct(uint32_t first, uint32_t last, real_type px, real_type py, real_type pz,
+                                  uint32_t self, real_type& phi, real_type* g) const {
+        const real_type eps2 = softening * softening;
+        for (uint32_t j = first; j < last; j++) {
+            if (j == self)
+                continue;
+            const real_type rx = px - xs[j], ry = py - ys[j], rz = pz - zs[j];
+            const real_type r2 = rx * rx + ry * ry + rz * rz + eps2;
+            if (r2 == 0)
+                continue;
+            const real_type inv = 1 / std::sqrt(r2);
+            const real_type sInv = ss[j] * inv;
+            const real_type sInv3 = sInv * inv * inv;
+            phi += sInv;
+            g[0] += sInv3 * rx;
+            g[1] += sInv3 * ry;
+            g[2] += sInv3 * rz;
+        }
+    }
+
+    // Barnes-Hut walk for one target, self is its sorted index or NONE
+    template<typename real_type>
+    void NBody<real_type>::walk(real_type px, real_type py, real_type pz, uint32_t self,
+                                real_type& phi, real_type* g) const {
+        uint32_t stack[8 * (MORTON_BITS + 2)];
+        size_t top = 0;
+        stack[top++] = 0;
+        while (top) {
+            const Node& node = nodes[stack[--top]];
+            const real_type rx = px - node.center[0], ry = py - node.center[1], rz = pz - node.center[2];
+            const real_type r = std::sqrt(rx * rx + ry * ry + rz * rz);
+            if (node.radius < theta * r && node.radius < r)
+                multipole(node, rx, ry, rz, phi, g);
+            else if (node.children == 0)
+                direct(node.first, node.first + node.count, px, py, pz, self, phi, g);
+            else
+                for (uint32_t c = 0; c < node.children; c++)
+                    stack[top++] = node.child + c;
+        }
+    }
+
+    // Adds the expansion of the source cell moments around the target center.
+    // Every further derivative drops a multipole order, the gradient takes the
+    // monopole and dipole and the curvature the monopole only, the parts left
+    // out are as small as the truncation of the expansion itself.
+    template<typename real_type>
+    void NBody<real_type>::toLocal(const Node& target, const Node& source, Local& local) const {
+        const real_type r[3] = { target.center[0] - source.center[0], target.center[1] - source.center[1],
+                                 target.center[2] - source.center[2] };
+        multipole(source, r[0], r[1], r[2], local.potential, local.field);
+        const real_type r2 = r[0] * r[0] + r[1] * r[1] + r[2] * r[2];
+        const real_type inv2 = 1 / r2, inv3 = inv2 / std::sqrt(r2), inv5 = inv3 * inv2, inv7 = inv5 * inv2;
+        const real_type* d = source.dipole;
+        const real_type m = source.monopole;
+        const real_type dr = d[0] * r[0] + d[1] * r[1] + d[2] * r[2];
+        for (int i = 0; i < 3; i++)
+            for (int j = i; j < 3; j++) {
+                const real_type dij = i == j ? real_type(1) : real_type(0);
+                local.gradient[SYM2[i][j]] += m * (dij * inv3 - 3 * r[i] * r[j] * inv5)
+                                              + 3 * (d[i] * r[j] + d[j] * r[i] + dr * dij) * inv5
+                                              - 15 * dr * r[i] * r[j] * inv7;
+                for (int k = j; k < 3; k++) {
+                    const real_type dik = i == k ? real_type(1) : real_type(0);
+                    const real_type djk = j == k ? real_type(1) : real_type(0);
+                    local.curvature[SYM3[i][j][k]] += m * (15 * r[i] * r[j] * r[k] * inv7
+                                                           - 3 * (dij * r[k] + dik * r[j] + djk * r[i]) * inv5);
+                }
+            }
+    }
+
+    // Dual tree walk, only the target side is written to
+    template<typename real_type>
+    void NBody<real_type>::interact(uint32_t target, uint32_t source, std::vector<Local>& locals,
+                                    NBodyField<real_type>& out) const {
+        const Node& a = nodes[target];
+        const Node& b = nodes[source];
+        const real_type rx = a.center[0] - b.center[0], ry = a.center[1] - b.center[1], rz = a.center[2] - b.center[2];
+        const real_type r = std::sqrt(rx * rx + ry * ry + rz * rz);
+        if (a.radius + b.radius < theta * r && a.radius + b.radius < r) {
+            toLocal(a, b, locals[target]);
+        } else if (a.children == 0 && b.children == 0) {
+            for (uint32_t i = a.first; i < a.first + a.count; i++) {
+                real_type g[3] = { 0, 0, 0 };
+                real_type phi = 0;
+                direct(b.first, b.first + b.count, xs[i], ys[i], zs[i], i, phi, g);
+                out.potential[i] += phi;
+                out.x[i] += g[0];
+                out.y[i] += g[1];
+                out.z[i] += g[2];
+            }
+        } else if (b.children == 0 || (a.children != 0 && a.radius > b.radius)) {
+            for (uint32_t c = 0; c < a.children; c++)
+                interact(a.child + c, source, locals, out);
+        } else {
+            for (uint32_t c = 0; c < b.children; c++)
+                interact(target, b.child + c, locals, out);
+        }
+    }
+
+    // Moves the expansion of a cell to its children and finally to its sources
+    template<typename real_type>
+    void NBody<real_type>::passDown(uint32_t node, std::vector<Local>& locals, NBodyField<real_type>& out) const {
+        const Node& n = nodes[node];
+        const Local& l = locals[node];
+        // expansion at offset d, t receives the curvature contracted with d
+        auto at = [&](const real_type* d, real_type& phi, real_type* g, real_type* t) {
+            real_type jd[3], tdd[3];
+            for (int i = 0; i < 3; i++) {
+                jd[i] = tdd[i] = 0;
+                for (int j = 0; j < 3; j++) {
+                    real_type tij = 0;
+                    for (int k = 0; k < 3; k++)
+                        tij += l.curvature[SYM3[i][j][k]] * d[k];
+                    if (i <= j)
+                        t[SYM2[i][j]] = tij;
+                    jd[i] += l.gradient[SYM2[i][j]] * d[j];
+                    tdd[i] += tij * d[j];
+                }
+            }
+            real_type gd = 0, djd = 0, dtdd = 0;
+            for (int i = 0; i < 3; i++) {
+                gd += l.field[i] * d[i];
+                djd += d[i] * jd[i];
+                dtdd += d[i] * tdd[i];
+                g[i] += l.field[i] + jd[i] + real_type(0.5) * tdd[i];
+            }
+            phi += l.potential - gd - real_type(0.5) * djd - dtdd / 6;
+        };
+        real_type t[6];
+        if (n.children == 0) {
+            for (uint32_t i = n.first; i < n.first + n.count; i++) {
+                const real_type d[3] = { xs[i] - n.center[0], ys[i] - n.center[1], zs[i] - n.center[2] };
+                real_type g[3] = { 0, 0, 0 };
+                real_type phi = 0;
+                at(d, phi, g, t);
+                out.potential[i] += phi;
+                out.x[i] += g[0];
+                out.y[i] += g[1];
+                out.z[i] += g[2];
+            }
+            return;
+        }
+        for (uint32_t c = n.child; c < n.child + n.children; c++) {
+            Local& lc = locals[c];
+            const real_type d[3] = { nodes[c].center[0] - n.center[0], nodes[c].center[1] - n.center[1],
+                                     nodes[c].center[2] - n.center[2] };
+            at(d, lc.potential, lc.field, t);
+            for (int e = 0; e < 6; e++)
+                lc.gradient[e] += l.gradient[e] + t[e];
+            for (int e = 0; e < 10; e++)
+                lc.curvature[e] += l.curvature[e];
+            passDown(c, locals, out);
+        }
+    }
+
+    // Every task takes one cell of a frontier cut through the top of the tree
+    // and walks it against the whole tree, writing only below that cell.
+    // Results are in sorted order.
+    template<typename real_type>
+    void NBody<real_type>::fmm(NBodyField<real_type>& out) const {
+        std::vector<Local> locals(nodes.size());
+        const size_t tasks = threads ? threads : ThreadPool::global().size();
+        const size_t grain = std::max<size_t>(ss.size() / (16 * tasks), PARALLEL_MIN / 4);
+        std::vector<uint32_t> frontier, open{ 0 };
+        while (!open.empty()) {
+            const uint32_t node = open.back();
+            open.pop_back();
+            if (nodes[node].children == 0 || nodes[node].count <= grain)
+                frontier.push_back(node);
+            else
+                for (uint32_t c = 0; c < nodes[node].children; c++)
+                    open.push_back(nodes[node].child + c);
+        }
+        std::atomic<size_t> next{ 0 };
+        auto work = [&] {
+            for (size_t f = next++; f < frontier.size(); f = next++) {
+                interact(frontier[f], 0, locals, out);
+                passDown(frontier[f], locals, out);
+            }
+        };
+        if (tasks <= 1 || frontier.size() == 1) {
+            work();
+            return;
+        }
+        TaskGroup group(ThreadPool::global());
+        for (size_t t = 0; t < std::min(tasks, frontier.size()); t++)
+            group.run(work);
+        group.wait();
+    }
+
+    template<typename real_type>
+    void NBody<real_type>::field(NBodyField<real_type>& out) const {
+        const size_t n = ss.size();
+        NBodyField<real_type> sorted;
+        sorted.resize(n);
+        if (method == NBodyMethod::FMM && !nodes.empty()) {
+            fmm(sorted);
+        } else {
+            parallelFor(n, [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; i++) {
+                    real_type g[3] = { 0, 0, 0 };
+                    real_type phi = 0;
+                    if (method == NBodyMethod::Direct)
+                        direct(0, uint32_t(n), xs[i], ys[i], zs[i], uint32_t(i), phi, g);
+                    else
+                        walk(xs[i], ys[i], zs[i], uint32_t(i), phi, g);
+                    sorted.potential[i] = phi;
+                    sorted.x[i] = g[0];
+                    sorted.y[i] = g[1];
+                    sorted.z[i] = g[2];
+                }
+            });
+        }
+        const real_type k = coupling();
+        out.resize(n);
+        parallelFor(n, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                out.potential[order[i]] = k * sorted.potential[i];
+                out.x[order[i]] = k * sorted.x[i];
+                out.y[order[i]] = k * sorted.y[i];
+                out.z[order[i]] = k * sorted.z[i];
+            }
+        });
+    }
+
+    template<typename real_type>
+    void NBody<real_type>::field(const std::vector<real_type>& x, const std::vector<real_type>& y,
+                                 const std::vector<real_type>& z, NBodyField<real_type>& out) const {
+        const size_t n = x.size();
+        const real_type k = coupling();
+        out.resize(n);
+        if (nodes.empty())
+            return;
+        parallelFor(n, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                real_type g[3] = { 0, 0, 0 };
+                real_type phi = 0;
+                if (method == NBodyMethod::Direct)
+                    direct(0, uint32_t(ss.size()), x[i], y[i], z[i], NONE, phi, g);
+                else
+                    walk(x[i], y[i], z[i], NONE, phi, g);
+                out.potential[i] = k * phi;
+                out.x[i] = k * g[0];
+                out.y[i] = k * g[1];
+                out.z[i] = k * g[2];
+            }
+        });
+    }
+
+    template<typename real_type>
+    void NBody<real_type>::forces(NBodyField<real_type>& out) const {
+        field(out);
+        parallelFor(ss.size(), [&](size_t first, size_t last) {
+            for (size_t s = first; s < last; s++) {
+                const real_type strength = ss[s];
+                const uint32_t i = order[s];
+                out.potential[i] *= strength;
+                out.x[i] *= strength;
+                out.y[i] *= strength;
+                out.z[i] *= strength;
+            }
+        });
+    }
+} // namespace rez
+#endif //PHYSICSFORMULA_NBODY_H
@@ -0,0 +1,545 @@
+#ifndef PHYSICSFORMULA_PARTICLESYSTEM_H
+#define PHYSICSFORMULA_PARTICLESYSTEM_H
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "Constants.h"
+#include "NBody.h"
+#include "ThreadPool.h"
+
+/**
+ * @brief advances a system of point particles through time.
+ * The state is kept as structure of arrays. Every step sums the forces of
+ * the attached ForceModel objects and integrates with one of
+ *   VelocityVerlet  kick drift kick, symplectic, one force pass per step
+ *   Leapfrog        drift kick drift, symplectic, one force pass per step
+ *   RK4             classic fourth order Runge-Kutta, four force passes
+ * Force passes run in chunks on the global thread pool. The update of
+ * a chunk is done in the same pass once its forces are known, so a step
+ * reads the state about once per force pass.
+ *
+ * The force models restate the single shot formulas of Forces, Drag and
+ * Friction per particle: weight m g, drag 0.5 Cd rho A v^2, Stokes drag
+ * 6 pi r eta v and sliding friction mu m g. MutualGravity uses NBody.
+ */
+namespace rez {
+    // state of all particles, a mass of 0 pins a particle in place
+    template<typename real_type = double>
+    struct ParticleState {
+        std::vector<real_type> x, y, z, vx, vy, vz, mass;
+
+        [[nodiscard]] size_t size() const { return mass.size(); }
+
+        void reserve(size_t n) {
+            for (auto* v : { &x, &y, &z, &vx, &vy, &vz, &mass })
+                v->reserve(n);
+        }
+
+        void add(real_type px, real_type py, real_type pz, real_type pvx, real_type pvy, real_type pvz,
+                 real_type m) {
+            x.push_back(px);
+            y.push_back(py);
+            z.push_back(pz);
+            vx.push_back(pvx);
+            vy.push_back(pvy);
+            vz.push_back(pvz);
+            mass.push_back(m);
+        }
+    };
+
+    // positions and velocities a force pass is evaluated at, RK4 passes its stages
+    template<typename real_type = double>
+    struct ParticleView {
+        const real_type* x;
+        const real_type* y;
+        const real_type* z;
+        const real_type* vx;
+        const real_type* vy;
+        const real_type* vz;
+        const real_type* mass;
+        size_t count;
+    };
+
+    /**
+     * @brief a force acting on the particles.
+     * prepare() runs once per force pass on the calling thread, for work over
+     * the whole system. accumulate() then adds the forces on [first, last) to
+     * f and is called concurrently for disjoint ranges. It may only read the
+     * particles of its own range, the rest of the state is being updated.
+     */
+    template<typename real_type = double>
+    class ForceModel {
+    public:
+        virtual ~ForceModel() = default;
+
+        virtual void prepare(const ParticleView<real_type>&, real_type) {}
+
+        virtual void accumulate(const ParticleView<real_type>& view, real_type t, size_t first, size_t last,
+                                real_type* fx, real_type* fy, real_type* fz) const = 0;
+    };
+
+    // weight m g, by default the standard gravity of constants::Ga pointing down z
+    template<typename real_type = double>
+    class UniformGravity : public ForceModel<real_type> {
+        real_type g[3];
+
+    public:
+        explicit UniformGravity(real_type gx = 0, real_type gy = 0, real_type gz = real_type(-constants::Ga))
+                : g{ gx, gy, gz } {}
+
+        void accumulate(const ParticleView<real_type>& view, real_type, size_t first, size_t last,
+                        real_type* fx, real_type* fy, real_type* fz) const override {
+            for (size_t i = first; i < last; i++) {
+                fx[i] += view.mass[i] * g[0];
+                fy[i] += view.mass[i] * g[1];
+                fz[i] += view.mass[i] * g[2];
+            }
+        }
+    };
+
+    // Drag::drag_force, 0.5 Cd rho A |v|^2 against the velocity relative to the air
+    template<typename real_type = double>
+    class QuadraticDrag : public ForceModel<real_type> {
+        real_type k;
+        real_type wind[3];
+
+    public:
+        QuadraticDrag(real_type dragCoeff, real_type areaFace, real_type density,
+                      real_type windX = 0, real_type windY = 0, real_type windZ = 0)
+                : k(real_type(0.5) * dragCoeff * density * areaFace), wind{ windX, windY, windZ } {}
+
+        void accumulate(const ParticleView<real_type>& view, real_type, size_t first, size_t last,
+                        real_type* fx, real_type* fy, real_type* fz) const override {
+            for (size_t i = first; i < last; i++) {
+                const real_type ux = view.vx[i] - wind[0], uy = view.vy[i] - wind[1], uz = view.vz[i] - wind[2];
+                const real_type ku = k * std::sqrt(ux * ux + uy * uy + uz * uz);
+                fx[i] -= ku * ux;
+                fy[i] -= ku * uy;
+                fz[i] -= ku * uz;
+            }
+        }
+    };
+
+    // Drag::stokes_law, 6 pi r eta v for spheres at low Reynolds numbers
+    template<typename real_type = double>
+    class StokesDrag : public ForceModel<real_type> {
+        real_type k;
+
+    public:
+        StokesDrag(real_type radius, real_type viscosity)
+                : k(real_type(6.0 * constants::PI) * radius * viscosity) {}
+
+        void accumulate(const ParticleView<real_type>& view, real_type, size_t first, size_t last,
+                        real_type* fx, real_type* fy, real_type* fz) const override {
+            for (size_t i = first; i < last; i++) {
+                fx[i] -= k * view.vx[i];
+                fy[i] -= k * view.vy[i];
+                fz[i] -= k * view.vz[i];
+            }
+        }
+    };
+
+    // Friction::friction_force, mu m g against the sliding direction of the
+    // particles touching the floor z = height, at most the force that stops them
+    // within minStep seconds so slow particles come to rest instead of jittering
+    template<typename real_type = double>
+    class KineticFriction : public ForceModel<real_type> {
+        real_type mu, height, contact, minStep;
+
+    public:
+        KineticFriction(real_type coefficient, real_type floorHeight = 0, real_type contactDistance = real_type(1e-6),
+                        real_type restStep = real_type(1e-3))
+                : mu(coefficient), height(floorHeight), contact(contactDistance), minStep(restStep) {}
+
+        void accumulate(const ParticleView<real_type>& view, real_type, size_t first, size_t last,
+                        real_type* fx, real_type* fy, real_type*) const override {
+            const real_type ga = real_type(constants::Ga);
+            for (size_t i = first; i < last; i++) {
+                if (view.z[i] > height + contact)
+                    continue;
+                const real_type speed = std::sqrt(view.vx[i] * view.vx[i] + view.vy[i] * view.vy[i]);
+                if (speed == 0)
+                    continue;
+                const real_type f = std::min(mu * view.mass[i] * ga, view.mass[i] * speed / minStep) / speed;
+                fx[i] -= f * view.vx[i];
+                fy[i] -= f * view.vy[i];
+            }
+        }
+    };
+
+    // Newtonian attraction between all particles through the NBody engine
+    template<typename real_type = double>
+    class MutualGravity : public ForceModel<real_type> {
+        NBody<real_type> engine;
+        NBodyParticles<real_type> sources;
+        NBodyField<real_type> field;
+
+    public:
+        explicit MutualGravity(NBodyMethod method = NBodyMethod::BarnesHut, real_type theta = real_type(0.5),
+                               real_type softening = 0)
+                : engine(NBodyInteraction::Gravity, method, theta) {
+            engine.setSoftening(softening);
+        }
+
+        void prepare(const ParticleView<real_type>& view, real_type) override {
+            sources.x.assign(view.x, view.x + view.count);
+            sources.y.assign(view.y, view.y + view.count);
+            sources.z.assign(view.z, view.z + view.count);
+            sources.strength.assign(view.mass, view.mass + view.count);
+            engine.build(sources);
+            engine.field(field);
+        }
+
+        void accumulate(const ParticleView<real_type>& view, real_type, size_t first, size_t last,
+                        real_type* fx, real_type* fy, real_type* fz) const override {
+            for (size_t i = first; i < last; i++) {
+                fx[i] += view.mass[i] * field.x[i];
+                fy[i] += view.mass[i] * field.y[i];
+                fz[i] += view.mass[i] * field.z[i];
+            }
+        }
+    };
+
+    enum class Integrator { VelocityVerlet, Leapfrog, RK4 };
+
+    template<typename real_type = double>
+    class ParticleSystem {
+    public:
+        // below this many particles the passes run on the calling thread
+        static constexpr size_t PARALLEL_MIN = size_t(1) << 14;
+
+    private:
+        ParticleState<real_type> particles;
+        std::vector<std::unique_ptr<ForceModel<real_type>>> forces;
+        Integrator method;
+        unsigned threads;
+        real_type clock = 0;
+
+        bool ground = false;
+        real_type groundHeight = 0, restitution = 0;
+
+        std::vector<real_type> ax, ay, az;      // accelerations of the last force pass
+        bool accelerationsValid = false;        // VelocityVerlet reuses them across steps
+        std::vector<real_type> scratch[12];     // RK4 stage state and sums
+
+        ParticleView<real_type> view() const {
+            return { particles.x.data(), particles.y.data(), particles.z.data(), particles.vx.data(),
+                     particles.vy.data(), particles.vz.data(), particles.mass.data(), particles.size() };
+        }
+
+        template<typename Body>
+        void parallelFor(size_t count, Body body) const;
+
+        template<typename After>
+        void forcePass(const ParticleView<real_type>& at, real_type t, After after);
+
+        void stepVerlet(real_type dt);
+        void stepLeapfrog(real_type dt);
+        void stepRK4(real_type dt);
+        void collideGround();
+
+    public:
+        /**
+         * @param threadCount 1 runs on the calling thread, 0 uses the global pool
+         */
+        explicit ParticleSystem(Integrator integrator = Integrator::VelocityVerlet, unsigned threadCount = 0)
+                : method(integrator), threads(threadCount) {}
+
+        // Changing the state through here restarts the integrator
+        ParticleState<real_type>& state() {
+            accelerationsValid = false;
+            return particles;
+        }
+
+        [[nodiscard]] const ParticleState<real_type>& state() const { return particles; }
+
+        template<typename Model, typename... Args>
+        Model& addForce(Args&&... args) {
+            forces.push_back(std::make_unique<Model>(std::forward<Args>(args)...));
+            accelerationsValid = false;
+            return static_cast<Model&>(*forces.back());
+        }
+
+        void clearForces() {
+            forces.clear();
+            accelerationsValid = false;
+        }
+
+        void setIntegrator(Integrator integrator) {
+            method = integrator;
+            accelerationsValid = false;
+        }
+
+        // particles bounce off the plane z = height keeping restitution of their normal speed
+        void setGround(real_type height, real_type bounce = 0) {
+            ground = true;
+            groundHeight = height;
+            restitution = bounce;
+        }
+
+        [[nodiscard]] real_type time() const { return clock; }
+
+        void step(real_type dt);
+
+        void run(real_type dt, size_t steps) {
+            for (size_t s = 0; s < steps; s++)
+                step(dt);
+        }
+
+        [[nodiscard]] real_type kineticEnergy() const;
+
+        // total momentum, LinearMomentum::momentum summed over the particles
+        void momentum(real_type& px, real_type& py, real_type& pz) const;
+
+        // LinearMomentum::centerOfMass over the moving particles
+        void centerOfMass(real_type& cx, real_type& cy, real_type& cz) const;
+    };
+
+//*****************************************************************************
+// force passes
+//*****************************************************************************
+    template<typename real_type>
+    template<typename Body>
+    void ParticleSystem<real_type>::parallelFor(size_t count, Body body) const {
+        ThreadPool& pool = ThreadPool::global();
+        const size_t tasks = std::min<size_t>(threads ? threads : pool.size(), count / (PARALLEL_MIN / 4) + 1);
+        if (tasks <= 1 || count < PARALLEL_MIN) {
+            body(size_t(0), count);
+            return;
+        }
+        const size_t chunks = 4 * tasks;
+        std::atomic<size_t> next{ 0 };
+        TaskGroup group(pool);
+        for (size_t t = 0; t < tasks; t++)
+            group.run([&] {
+                for (size_t c = next++; c < chunks; c = next++)
+                    body(count * c / chunks, count * (c + 1) / chunks);
+            });
+        group.wait();
+    }
+
+    // Fills the accelerations at the given positions and velocities and hands
+    // every finished chunk to after(first, last) while it is still in cache.
+    template<typename real_type>
+    template<typename After>
+    void ParticleSystem<real_type>::forcePass(const ParticleView<real_type>& at, real_type t, After after) {
+        for (auto& force : forces)
+            force->prepare(at, t);
+        const size_t n = at.count;
+        ax.resize(n);
+        ay.resize(n);
+        az.resize(n);
+        parallelFor(n, [&](size_t first, size_t last) {
+            std::fill(ax.begin() + first, ax.begin() + last, real_type(0));
+            std::fill(ay.begin() + first, ay.begin() + last, real_type(0));
+            std::fill(az.begin() + first, az.begin() + last, real_type(0));
+            for (auto& force : forces)
+                force->accumulate(at, t, first, last, ax.data(), ay.data(), az.data());
+            for (size_t i = first; i < last; i++) {
+                const real_type inverse = at.mass[i] != 0 ? 1 / at.mass[i] : real_type(0);
+                ax[i] *= inverse;
+                ay[i] *= inverse;
+                az[i] *= inverse;
+            }
+            after(first, last);
+        });
+    }
+
+//*****************************************************************************
+// integrators
+//*****************************************************************************
+    template<typename real_type>
+    void ParticleSystem<real_type>::step(real_type dt) {
+        if (particles.size() == 0) {
+            clock += dt;
+            return;
+        }
+        switch (method) {
+            case Integrator::VelocityVerlet:
+                stepVerlet(dt);
+                break;
+            case Integrator::Leapfrog:
+                stepLeapfrog(dt);
+                break;
+            case Integrator::RK4:
+                stepRK4(dt);
+                break;
+        }
+        clock += dt;
+        if (ground)
+            collideGround();
+    }
+
+    // Velocity dependent forces are taken at the half step velocity
+    template<typename real_type>
+    void ParticleSystem<real_type>::stepVerlet(real_type dt) {
+        auto& p = particles;
+        const real_type half = dt / 2;
+        if (!accelerationsValid || ax.size() != p.size())
+            forcePass(view(), clock, [](size_t, size_t) {});
+        parallelFor(p.size(), [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                p.vx[i] += half * ax[i];
+                p.vy[i] += half * ay[i];
+                p.vz[i] += half * az[i];
+                p.x[i] += dt * p.vx[i];
+                p.y[i] += dt * p.vy[i];
+                p.z[i] += dt * p.vz[i];
+            }
+        });
+        forcePass(view(), clock + dt, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                p.vx[i] += half * ax[i];
+                p.vy[i] += half * ay[i];
+                p.vz[i] += half * az[i];
+            }
+        });
+        accelerationsValid = true;
+    }
+
+    template<typename real_type>
+    void ParticleSystem<real_type>::stepLeapfrog(real_type dt) {
+        auto& p = particles;
+        const real_type half = dt / 2;
+        parallelFor(p.size(), [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                p.x[i] += half * p.vx[i];
+                p.y[i] += half * p.vy[i];
+                p.z[i] += half * p.vz[i];
+            }
+        });
+        forcePass(view(), clock + half, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                p.vx[i] += dt * ax[i];
+                p.vy[i] += dt * ay[i];
+                p.vz[i] += dt * az[i];
+                p.x[i] += half * p.vx[i];
+                p.y[i] += half * p.vy[i];
+                p.z[i] += half * p.vz[i];
+            }
+        });
+        accelerationsValid = false;
+    }
+
+    // Every stage keeps its state in scratch[0..5] and adds its slopes to the
+    // sums in scratch[6..11], the chunk being finished is the only one written.
+    template<typename real_type>
+    void ParticleSystem<real_type>::stepRK4(real_type dt) {
+        auto& p = particles;
+        const size_t n = p.size();
+        for (auto& s : scratch)
+            s.resize(n);
+        real_type* sx = scratch[0].data(), * sy = scratch[1].data(), * sz = scratch[2].data();
+        real_type* svx = scratch[3].data(), * svy = scratch[4].data(), * svz = scratch[5].data();
+        real_type* dx = scratch[6].data(), * dy = scratch[7].data(), * dz = scratch[8].data();
+        real_type* dvx = scratch[9].data(), * dvy = scratch[10].data(), * dvz = scratch[11].data();
+        const ParticleView<real_type> stage{ sx, sy, sz, svx, svy, svz, p.mass.data(), n };
+        const real_type half = dt / 2;
+
+        forcePass(view(), clock, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                dx[i] = p.vx[i];
+                dy[i] = p.vy[i];
+                dz[i] = p.vz[i];
+                dvx[i] = ax[i];
+                dvy[i] = ay[i];
+                dvz[i] = az[i];
+                sx[i] = p.x[i] + half * p.vx[i];
+                sy[i] = p.y[i] + half * p.vy[i];
+                sz[i] = p.z[i] + half * p.vz[i];
+                svx[i] = p.vx[i] + half * ax[i];
+                svy[i] = p.vy[i] + half * ay[i];
+                svz[i] = p.vz[i] + half * az[i];
+            }
+        });
+        for (real_type h : { half, dt }) {
+            forcePass(stage, clock + half, [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; i++) {
+                    dx[i] += 2 * svx[i];
+                    dy[i] += 2 * svy[i];
+                    dz[i] += 2 * svz[i];
+                    dvx[i] += 2 * ax[i];
+                    dvy[i] += 2 * ay[i];
+                    dvz[i] += 2 * az[i];
+                    sx[i] = p.x[i] + h * svx[i];
+                    sy[i] = p.y[i] + h * svy[i];
+                    sz[i] = p.z[i] + h * svz[i];
+                    svx[i] = p.vx[i] + h * ax[i];
+                    svy[i] = p.vy[i] + h * ay[i];
+                    svz[i] = p.vz[i] + h * az[i];
+                }
+            });
+        }
+        const real_type sixth = dt / 6;
+        forcePass(stage, clock + dt, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                p.x[i] += sixth * (dx[i] + svx[i]);
+                p.y[i] += sixth * (dy[i] + svy[i]);
+                p.z[i] += sixth * (dz[i] + svz[i]);
+                p.vx[i] += sixth * (dvx[i] + ax[i]);
+                p.vy[i] += sixth * (dvy[i] + ay[i]);
+                p.vz[i] += sixth * (dvz[i] + az[i]);
+            }
+        });
+        accelerationsValid = false;
+    }
+
+    template<typename real_type>
+    void ParticleSystem<real_type>::collideGround() {
+        auto& p = particles;
+        parallelFor(p.size(), [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++)
+                if (p.z[i] < groundHeight && p.mass[i] != 0) {
+                    p.z[i] = groundHeight;
+                    if (p.vz[i] < 0)
+                        p.vz[i] = -restitution * p.vz[i];
+                }
+        });
+    }
+
+//*****************************************************************************
+// observables
+//*****************************************************************************
+    template<typename real_type>
+    real_type ParticleSystem<real_type>::kineticEnergy() const {
+        const auto& p = particles;
+        real_type energy = 0;
+        for (size_t i = 0; i < p.size(); i++)
+            energy += p.mass[i] * (p.vx[i] * p.vx[i] + p.vy[i] * p.vy[i] + p.vz[i] * p.vz[i]);
+        return energy / 2;
+    }
+
+    template<typename real_type>
+    void ParticleSystem<real_type>::momentum(real_type& px, real_type& py, real_type& pz) const {
+        const auto& p = particles;
+        px = py = pz = 0;
+        for (size_t i = 0; i < p.size(); i++) {
+            px += p.mass[i] * p.vx[i];
+            py += p.mass[i] * p.vy[i];
+            pz += p.mass[i] * p.vz[i];
+        }
+    }
+
+    template<typename real_type>
+    void ParticleSystem<real_type>::centerOfMass(real_type& cx, real_type& cy, real_type& cz) const {
+        const auto& p = particles;
+        real_type total = 0;
+        cx = cy = cz = 0;
+        for (size_t i = 0; i < p.size(); i++) {
+            total += p.mass[i];
+            cx += p.mass[i] * p.x[i];
+            cy += p.mass[i] * p.y[i];
+            cz += p.mass[i] * p.z[i];
+        }
+        if (total != 0) {
+            cx /= total;
+            cy /= total;
+            cz /= total;
+        }
+    }
+} // namespace rez
+#endif //PHYSICSFORMULA_PARTICLESYSTEM_H
@@ -4,6 +4,7 @@
 #include "Polygon.h"
 
 #include "GeoUtils.h"
+#include "MapOverlay.h"
 
 using namespace rez;
 
@@ -137,7 +138,44 @@ std::vector<Vertex2dSimple*> rez::Polygon2dSimple::getVertcies()
 }
 
 
-void rez::merge(Polygon& poly1, Polygon& poly2, Polygon& final_poly)
+// Outline of _polygon in the XY plane, counter clockwise
+static std::vector<Point2d> outline2d(Polygon& _polygon)
 {
+    std::vector<Point2d> outline;
+    for (const Point3d& point : _polygon.getPoints())
+        outline.push_back(Point2d(point[X_], point[Y_]));
 
+    double area = 0;
+    for (size_t i = 0; i < outline.size(); i++)
+    {
+        const Point2d& a = outline[i];
+        const Point2d& b = outline[(i + 1) % outline.size()];
+        area += double(a[X_]) * b[Y_] - double(b[X_]) * a[Y_];
+    }
+    if (area < 0)
+        std::reverse(outline.begin(), outline.end());
+    return outline;
+}
+
+// The outlines are overlaid as DCELs and the faces covered by either one are
+// kept, see polygon_boolean.
+bool rez::merge(Polygon& poly1, Polygon& poly2, Polygon& final_poly)
+{
+    final_poly = Polygon();
+    std::vector<Point2d> first = outline2d(poly1);
+    std::vector<Point2d> second = outline2d(poly2);
+    if (first.size() < 3 || second.size() < 3)
+        return false;
+
+    Polygon2d a(first);
+    Polygon2d b(second);
+    std::vector<std::vector<Point2d>> rings;
+    if (!polygon_boolean(a, b, BooleanOperation::UNION, rings) || rings.size() != 1)
+        return false;
+
+    std::vector<Point3d> outline;
+    for (const Point2d& point : rings[0])
+        outline.push_back(Point3d(point[X_], point[Y_], 0.0f));
+    final_poly = Polygon(outline);
+    return true;
 }
@@ -88,6 +88,11 @@ namespace rez {
 
     };
 
-    void merge(Polygon& poly1, Polygon& poly2, Polygon& final_poly);
+    // Union of two simple polygons in the XY plane, z is dropped. Either
+    // orientation is accepted, final_poly receives the outline counter clockwise.
+    // Returns false, leaving final_poly empty, if a polygon has fewer than 3
+    // vertices or the union is not a single ring, as for disjoint polygons or
+    // a union with holes.
+    bool merge(Polygon& poly1, Polygon& poly2, Polygon& final_poly);
 }
 #endif //PHYSICSFORMULA_POLYGON_H
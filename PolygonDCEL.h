@@ -6,8 +6,10 @@
 #define PHYSICSFORMULA_POLYGONDCEL_H
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <iostream>
+#include <unordered_map>
 #include "Point.h"
 
 namespace rez {
@@ -124,6 +126,19 @@ namespace rez {
         // Assume the given points list is for polygon and have counter clockwise order
         explicit PolygonDCEL(std::vector<VectorNf>&);
 
+        // Construct the subdivision of a triangulation. _triangles holds three indices
+        // into _points per counter clockwise triangle, each triangle becomes a face and
+        // the outside of the triangulation is the unbounded face.
+        PolygonDCEL(std::vector<VectorNf>& _points, const std::vector<uint32_t>& _triangles);
+
+        // Construct a general subdivision. Half edges 2i and 2i + 1 are twins, _origins
+        // holds the origin point of every half edge and _next the half edge following it
+        // around the face on its left. _faces lists one half edge per boundary cycle of
+        // every face, the outer cycle first. The last face is the unbounded one and only
+        // has inner cycles.
+        PolygonDCEL(std::vector<VectorNf>& _points, const std::vector<uint32_t>& _origins,
+                    const std::vector<uint32_t>& _next, const std::vector<std::vector<uint32_t>>& _faces);
+
         // Insert an edge between virtices _v1 and _v2 given that the edge lies completely inside the orginal polygon
         bool split(VertexDCEL<type, dim>* _v1, VertexDCEL<type, dim>* _v2);
 
@@ -238,6 +253,112 @@ namespace rez {
 
     }
 
+    template<class type, size_t dim>
+    inline PolygonDCEL<type, dim>::PolygonDCEL(std::vector<VectorNf>& _points,
+                                               const std::vector<uint32_t>& _triangles)
+    {
+        for (size_t i = 0; i < _points.size(); i++)
+            vertex_list.push_back(new VertexDCEL<type, dim>(_points[i]));
+
+        // Half edges keyed by (origin, destination) so twins can be matched up
+        auto key = [](uint64_t a, uint64_t b) { return (a << 32) | b; };
+        std::unordered_map<uint64_t, EdgeDCEL<type, dim>*> by_key;
+        by_key.reserve(_triangles.size());
+
+        for (size_t t = 0; t + 2 < _triangles.size(); t += 3) {
+            auto* face = new FaceDCEL<type, dim>();
+            EdgeDCEL<type, dim>* edges[3];
+            for (int k = 0; k < 3; k++) {
+                auto* origin = vertex_list[_triangles[t + k]];
+                edges[k] = new EdgeDCEL<type, dim>(origin);
+                edges[k]->incident_face = face;
+                origin->incident_edge = edges[k];
+                by_key[key(_triangles[t + k], _triangles[t + (k + 1) % 3])] = edges[k];
+            }
+            for (int k = 0; k < 3; k++) {
+                edges[k]->next = edges[(k + 1) % 3];
+                edges[k]->prev = edges[(k + 2) % 3];
+            }
+            face->outer = edges[0];
+            face_list.push_back(face);
+        }
+
+        // Pair the twins, the edges without one lie on the boundary and get a twin
+        // in the unbounded face. Those twins run clockwise around the triangulation.
+        auto* unbounded = new FaceDCEL<type, dim>();
+        std::unordered_map<uint32_t, EdgeDCEL<type, dim>*> boundary_from;
+        std::vector<std::pair<EdgeDCEL<type, dim>*, uint32_t>> boundary;
+        for (size_t t = 0; t + 2 < _triangles.size(); t += 3) {
+            for (int k = 0; k < 3; k++) {
+                const uint32_t a = _triangles[t + k], b = _triangles[t + (k + 1) % 3];
+                auto* edge = by_key[key(a, b)];
+                if (edge->twin)
+                    continue;
+                auto found = by_key.find(key(b, a));
+                EdgeDCEL<type, dim>* twin;
+                if (found != by_key.end()) {
+                    twin = found->second;
+                }
+                else {
+                    twin = new EdgeDCEL<type, dim>(vertex_list[b]);
+                    twin->incident_face = unbounded;
+                    boundary_from[b] = twin;
+                    boundary.emplace_back(twin, a);
+                }
+                edge->twin = twin;
+                twin->twin = edge;
+                edge_list.push_back(edge);
+                edge_list.push_back(twin);
+            }
+        }
+        for (auto& entry : boundary) {
+            entry.first->next = boundary_from[entry.second];
+            entry.first->next->prev = entry.first;
+        }
+        if (!boundary.empty())
+            unbounded->inner.push_back(boundary.front().first);
+        face_list.push_back(unbounded);
+    }
+
+    template<class type, size_t dim>
+    inline PolygonDCEL<type, dim>::PolygonDCEL(std::vector<VectorNf>& _points, const std::vector<uint32_t>& _origins,
+                                               const std::vector<uint32_t>& _next,
+                                               const std::vector<std::vector<uint32_t>>& _faces)
+    {
+        for (size_t i = 0; i < _points.size(); i++)
+            vertex_list.push_back(new VertexDCEL<type, dim>(_points[i]));
+
+        for (size_t e = 0; e < _origins.size(); e++) {
+            auto* origin = vertex_list[_origins[e]];
+            edge_list.push_back(new EdgeDCEL<type, dim>(origin));
+            if (!origin->incident_edge)
+                origin->incident_edge = edge_list.back();
+        }
+        for (size_t e = 0; e < edge_list.size(); e++) {
+            edge_list[e]->twin = edge_list[e ^ 1];
+            edge_list[e]->next = edge_list[_next[e]];
+            edge_list[_next[e]]->prev = edge_list[e];
+        }
+
+        for (size_t f = 0; f < _faces.size(); f++) {
+            auto* face = new FaceDCEL<type, dim>();
+            const bool unbounded = f + 1 == _faces.size();
+            for (size_t c = 0; c < _faces[f].size(); c++) {
+                auto* first = edge_list[_faces[f][c]];
+                if (c == 0 && !unbounded)
+                    face->outer = first;
+                else
+                    face->inner.push_back(first);
+                auto* edge = first;
+                do {
+                    edge->incident_face = face;
+                    edge = edge->next;
+                } while (edge != first);
+            }
+            face_list.push_back(face);
+        }
+    }
+
     template<class type, size_t dim>
     inline void PolygonDCEL<type, dim>::getEdgesWithSamefaceAndGivenOrigins(
             VertexDCEL<type, dim>* _v1, VertexDCEL<type, dim>* _v2,
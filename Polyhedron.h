@@ -90,6 +90,11 @@ namespace rez {
         std::vector<Face> faces;
 
     public:
+        Polyhedron() {}
+
+        explicit Polyhedron(const std::vector<Face>& _faces) : faces(_faces) {}
+
+        std::vector<Face>& getFaces() { return faces; }
     };
 
 }
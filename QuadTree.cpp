@@ -3,79 +3,554 @@
 //
 
 #include "QuadTree.h"
+#include <algorithm>
+#include <cmath>
 
-rez::QuadTree::QuadTree(const std::vector<Point2d>& _points)
+static bool contains(const rez::AABB& _box, const rez::Point2d& _point)
 {
+    return _box.x_min <= _point.coords[X_] && _point.coords[X_] <= _box.x_max
+           && _box.y_min <= _point.coords[Y_] && _point.coords[Y_] <= _box.y_max;
+}
+
+static bool contains(const rez::AABB& _outer, const rez::AABB& _inner)
+{
+    return _outer.x_min <= _inner.x_min && _inner.x_max <= _outer.x_max
+           && _outer.y_min <= _inner.y_min && _inner.y_max <= _outer.y_max;
+}
+
+static bool overlaps(const rez::AABB& _a, const rez::AABB& _b)
+{
+    return _a.x_min <= _b.x_max && _b.x_min <= _a.x_max && _a.y_min <= _b.y_max && _b.y_min <= _a.y_max;
+}
+
+static float squaredDistance(const rez::AABB& _box, const rez::Point2d& _point)
+{
+    const float dx = std::max(std::max(_box.x_min - _point.coords[X_], _point.coords[X_] - _box.x_max), 0.0f);
+    const float dy = std::max(std::max(_box.y_min - _point.coords[Y_], _point.coords[Y_] - _box.y_max), 0.0f);
+    return dx * dx + dy * dy;
+}
+
+static float squaredDistance(const rez::Point2d& _a, const rez::Point2d& _b)
+{
+    const float dx = _a.coords[X_] - _b.coords[X_], dy = _a.coords[Y_] - _b.coords[Y_];
+    return dx * dx + dy * dy;
+}
+
+// Child quadrant of _point, points on a mid line go north / east
+static uint32_t quadrant(const rez::AABB& _box, const rez::Point2d& _point)
+{
+    const bool east = _point.coords[X_] >= (_box.x_min + _box.x_max) / 2;
+    const bool north = _point.coords[Y_] >= (_box.y_min + _box.y_max) / 2;
+    return north ? (east ? INE : INW) : (east ? ISE : ISW);
+}
+
+static rez::AABB childBox(const rez::AABB& _box, uint32_t _quadrant)
+{
+    float x_mid = (_box.x_min + _box.x_max) / 2;
+    float y_mid = (_box.y_min + _box.y_max) / 2;
+    switch (_quadrant) {
+        case INE: return rez::AABB{ x_mid, _box.x_max, y_mid, _box.y_max };
+        case INW: return rez::AABB{ _box.x_min, x_mid, y_mid, _box.y_max };
+        case ISE: return rez::AABB{ x_mid, _box.x_max, _box.y_min, y_mid };
+        default:  return rez::AABB{ _box.x_min, x_mid, _box.y_min, y_mid };
+    }
+}
+
+//*****************************************************************************
+// Storage
+//*****************************************************************************
+
+uint32_t rez::QuadTree::allocQuad(uint32_t _parent)
+{
+    uint32_t first;
+    if (!free_quads.empty()) {
+        first = free_quads.back();
+        free_quads.pop_back();
+    }
+    else {
+        first = static_cast<uint32_t>(nodes.size());
+        nodes.resize(nodes.size() + NUM_POINTS);
+    }
+    for (uint32_t q = 0; q < NUM_POINTS; q++) {
+        QDTNode& child = nodes[first + q];
+        child = QDTNode();
+        child.box = childBox(nodes[_parent].box, q);
+        child.parent = _parent;
+    }
+    nodes[_parent].first_child = first;
+    return first;
+}
+
+uint32_t rez::QuadTree::allocBlock()
+{
+    uint32_t block;
+    if (!free_blocks.empty()) {
+        block = free_blocks.back();
+        free_blocks.pop_back();
+    }
+    else {
+        block = static_cast<uint32_t>(block_next.size());
+        block_next.push_back(QDT_NONE);
+        entries.resize(entries.size() + bucket_size);
+    }
+    block_next[block] = QDT_NONE;
+    return block;
+}
+
+// Appends to the leaf's last block, chaining a new one when it is full. Keeps
+// count of the leaf, but not of its ancestors.
+void rez::QuadTree::appendEntry(uint32_t _leaf, const Entry& _entry)
+{
+    uint32_t slot = nodes[_leaf].count;
+    if (nodes[_leaf].block == QDT_NONE)
+        nodes[_leaf].block = allocBlock();
+    uint32_t block = nodes[_leaf].block;
+    while (slot >= bucket_size) {
+        if (block_next[block] == QDT_NONE) {
+            const uint32_t fresh = allocBlock();
+            block_next[block] = fresh;
+        }
+        block = block_next[block];
+        slot -= bucket_size;
+    }
+    entries[size_t(block) * bucket_size + slot] = _entry;
+    leaf_of[_entry.id] = _leaf;
+    nodes[_leaf].count++;
+}
 
+// Moves the entries below _node into _out and gives its quads and blocks back
+// to the pools. _node itself is left as an empty leaf.
+void rez::QuadTree::releaseSubtree(uint32_t _node, std::vector<Entry>& _out)
+{
+    if (nodes[_node].isALeaf()) {
+        forEachEntry(_node, [&](const Entry& e) { _out.push_back(e); });
+        for (uint32_t b = nodes[_node].block; b != QDT_NONE; b = block_next[b])
+            free_blocks.push_back(b);
+    }
+    else {
+        const uint32_t first = nodes[_node].first_child;
+        for (uint32_t q = 0; q < NUM_POINTS; q++)
+            releaseSubtree(first + q, _out);
+        free_quads.push_back(first);
+    }
+    nodes[_node].first_child = QDT_NONE;
+    nodes[_node].block = QDT_NONE;
+    nodes[_node].count = 0;
+}
+
+void rez::QuadTree::splitLeaf(uint32_t _node)
+{
+    scratch.clear();
+    const uint32_t count = nodes[_node].count;
+    releaseSubtree(_node, scratch);
+    const uint32_t first = allocQuad(_node);
+    for (const Entry& e : scratch)
+        appendEntry(first + quadrant(nodes[_node].box, e.point), e);
+    nodes[_node].count = count;
+}
+
+void rez::QuadTree::collapse(uint32_t _node)
+{
+    scratch.clear();
+    releaseSubtree(_node, scratch);
+    for (const Entry& e : scratch)
+        appendEntry(_node, e);
 }
 
-static void partition(rez::QDTNode* _parent, std::vector<rez::Point2d> _points) {
-    if (_points.empty()) {
-        //_parent->isAEmptyNode = true;
-        _parent->isALeaf = true;
+// Doubles the root box towards _point until it is covered. The old root moves
+// into the quadrant of the new one it covers, so nodes[0] stays the root.
+// Points only ever move into leaves whose box holds them, this keeps it so.
+void rez::QuadTree::grow(const Point2d& _point)
+{
+    while (!contains(nodes[0].box, _point)) {
+        const AABB old = nodes[0].box;
+        const float w = old.x_max - old.x_min, h = old.y_max - old.y_min;
+        AABB box = old;
+        uint32_t q;
+        if (_point.coords[X_] < old.x_min) {
+            box.x_min -= w;
+            q = _point.coords[Y_] < old.y_min ? INE : ISE;
+        }
+        else {
+            box.x_max += w;
+            q = _point.coords[Y_] < old.y_min ? INW : ISW;
+        }
+        if (q == INE || q == INW)
+            box.y_min -= h;
+        else
+            box.y_max += h;
+
+        QDTNode moved = nodes[0];
+        nodes[0].box = box;
+        const uint32_t first = allocQuad(0);
+        moved.box = nodes[first + q].box;
+        moved.parent = 0;
+        nodes[first + q] = moved;
+        if (moved.isALeaf())
+            forEachEntry(first + q, [&](const Entry& e) { leaf_of[e.id] = first + q; });
+        else
+            for (uint32_t c = 0; c < NUM_POINTS; c++)
+                nodes[moved.first_child + c].parent = first + q;
+        nodes[0].count = moved.count;
+        // exact for the power of two boxes of the bulk constructor, otherwise the
+        // midpoints may round differently and the old boxes are redone
+        if (moved.box.x_min != old.x_min || moved.box.x_max != old.x_max
+            || moved.box.y_min != old.y_min || moved.box.y_max != old.y_max)
+            refit(first + q);
+    }
+}
+
+void rez::QuadTree::refit(uint32_t _node)
+{
+    if (nodes[_node].isALeaf())
         return;
+    for (uint32_t q = 0; q < NUM_POINTS; q++) {
+        nodes[nodes[_node].first_child + q].box = childBox(nodes[_node].box, q);
+        refit(nodes[_node].first_child + q);
     }
-    else if (_points.size() == 1) {
-        _parent->point = _points[0];
-        _parent->isALeaf = true;
+}
+
+void rez::QuadTree::insertEntry(const Entry& _entry)
+{
+    if (nodes.empty()) {
+        // the unit cell around the first point, grown as needed
+        QDTNode root;
+        const float left = std::floor(_entry.point.coords[X_]), bottom = std::floor(_entry.point.coords[Y_]);
+        root.box = AABB{ left, left + 1, bottom, bottom + 1 };
+        nodes.push_back(root);
+    }
+    grow(_entry.point);
+
+    uint32_t node = 0, depth = 0;
+    while (true) {
+        if (nodes[node].isALeaf()) {
+            if (nodes[node].count < bucket_size || depth >= MAX_DEPTH) {
+                appendEntry(node, _entry);
+                return;
+            }
+            splitLeaf(node);
+        }
+        nodes[node].count++;
+        node = nodes[node].first_child + quadrant(nodes[node].box, _entry.point);
+        depth++;
+    }
+}
+
+//*****************************************************************************
+// Bulk loading
+//*****************************************************************************
+
+// Sorts scratch[_begin, _end) into the quadrants in place, the slices are
+// handed down without copying.
+void rez::QuadTree::build(uint32_t _node, size_t _begin, size_t _end, uint32_t _depth)
+{
+    if (_end - _begin <= bucket_size || _depth >= MAX_DEPTH) {
+        for (size_t i = _begin; i < _end; i++)
+            appendEntry(_node, scratch[i]);
         return;
     }
-    else {
-        // Calcualte the boundaries of each child using the bounds of the parent
-        auto box = _parent->box;
-        float x_mid = (box.x_min + box.x_max) / 2;
-        float y_mid = (box.y_min + box.y_max) / 2;
+    nodes[_node].count = static_cast<uint32_t>(_end - _begin);
+    const AABB box = nodes[_node].box;
+    auto in = [&](uint32_t q) { return [&box, q](const Entry& e) { return quadrant(box, e.point) == q; }; };
+    auto first = scratch.begin() + _begin, last = scratch.begin() + _end;
+    auto north_end = std::partition(first, last, [&](const Entry& e) {
+        const uint32_t q = quadrant(box, e.point);
+        return q == INE || q == INW;
+    });
+    auto ne_end = std::partition(first, north_end, in(INE));
+    auto se_end = std::partition(north_end, last, in(ISE));
+
+    const uint32_t child = allocQuad(_node);
+    const size_t bounds[NUM_POINTS + 1] = { _begin, size_t(ne_end - scratch.begin()),
+                                            size_t(north_end - scratch.begin()),
+                                            size_t(se_end - scratch.begin()), _end };
+    for (uint32_t q = 0; q < NUM_POINTS; q++)
+        build(child + q, bounds[q], bounds[q + 1], _depth + 1);
+}
 
-        rez::AABB boxNW{ box.x_min, x_mid, y_mid, box.y_max };
-        rez::AABB boxNE{ x_mid, box.x_max, y_mid, box.y_max };
-        rez::AABB boxSW{ box.x_min, x_mid, box.y_min, y_mid };
-        rez::AABB boxSE{ x_mid, box.x_max, box.y_min, y_mid };
-
-        // Paritition the _points to four list.
-        std::vector<rez::Point2d> pointsNW, pointsNE, pointsSW, pointsSE;
-        for (auto& point : _points) {
-            if (boxNW.isInside(point))
-                pointsNW.push_back(point);
-            else if (boxNE.isInside(point))
-                pointsNE.push_back(point);
-            else if (boxSW.isInside(point))
-                pointsSW.push_back(point);
-            else
-                pointsSE.push_back(point);
+void rez::QuadTree::bulkLoad(const std::vector<Point2d>& _points, const AABB& _bounds)
+{
+    QDTNode root;
+    root.box = _bounds;
+    nodes.push_back(root);
+    points = _points;
+    leaf_of.assign(points.size(), QDT_NONE);
+    live = points.size();
+
+    std::vector<Entry> items(points.size());
+    for (size_t i = 0; i < points.size(); i++)
+        items[i] = Entry{ points[i], static_cast<uint32_t>(i) };
+    scratch.swap(items);
+    build(0, 0, scratch.size(), 0);
+    scratch.clear();
+}
+
+rez::QuadTree::QuadTree(const std::vector<Point2d>& _points, uint32_t _bucket_size)
+        : bucket_size(std::max(_bucket_size, 1u))
+{
+    if (_points.empty())
+        return;
+    float x_min = _points[0].coords[X_], x_max = x_min, y_min = _points[0].coords[Y_], y_max = y_min;
+    for (const auto& p : _points) {
+        x_min = std::min(x_min, p.coords[X_]);
+        x_max = std::max(x_max, p.coords[X_]);
+        y_min = std::min(y_min, p.coords[Y_]);
+        y_max = std::max(y_max, p.coords[Y_]);
+    }
+    // A square power of two box on a grid of half its size. Square cells keep the
+    // nearest neighbour pruning tight and every midpoint is exact, also for the
+    // boxes Insert doubles it into later.
+    float side = std::exp2(std::ceil(std::log2(std::max(std::max(x_max - x_min, y_max - y_min), 1e-30f))));
+    float left, bottom;
+    while (true) {
+        left = std::floor(x_min / (side / 2)) * (side / 2);
+        bottom = std::floor(y_min / (side / 2)) * (side / 2);
+        if (left + side >= x_max && bottom + side >= y_max)
+            break;
+        side *= 2;
+    }
+    bulkLoad(_points, AABB{ left, left + side, bottom, bottom + side });
+}
+
+rez::QuadTree::QuadTree(const std::vector<Point2d>& _points, AABB& bounds, uint32_t _bucket_size)
+        : bucket_size(std::max(_bucket_size, 1u))
+{
+    AABB box = bounds;
+    for (const auto& p : _points) {
+        box.x_min = std::min(box.x_min, p.coords[X_]);
+        box.x_max = std::max(box.x_max, p.coords[X_]);
+        box.y_min = std::min(box.y_min, p.coords[Y_]);
+        box.y_max = std::max(box.y_max, p.coords[Y_]);
+    }
+    bulkLoad(_points, box);
+}
+
+//*****************************************************************************
+// Updates
+//*****************************************************************************
+
+uint32_t rez::QuadTree::Insert(const Point2d& _point)
+{
+    const auto id = static_cast<uint32_t>(points.size());
+    points.push_back(_point);
+    leaf_of.push_back(QDT_NONE);
+    insertEntry(Entry{ _point, id });
+    live++;
+    return id;
+}
+
+bool rez::QuadTree::Remove(uint32_t _id)
+{
+    if (_id >= leaf_of.size() || leaf_of[_id] == QDT_NONE)
+        return false;
+    const uint32_t leaf = leaf_of[_id];
+    leaf_of[_id] = QDT_NONE;
+
+    // swap the entry with the last one of the leaf and drop the last
+    Entry* found = nullptr;
+    Entry* last = nullptr;
+    uint32_t last_block = QDT_NONE, prev_block = QDT_NONE;
+    uint32_t remaining = nodes[leaf].count;
+    for (uint32_t b = nodes[leaf].block; remaining > 0; b = block_next[b]) {
+        const uint32_t n = std::min(remaining, bucket_size);
+        Entry* block = entries.data() + size_t(b) * bucket_size;
+        for (uint32_t i = 0; i < n; i++)
+            if (block[i].id == _id)
+                found = block + i;
+        remaining -= n;
+        if (remaining == 0) {
+            last = block + n - 1;
+            last_block = b;
         }
+        else
+            prev_block = b;
+    }
+    *found = *last;
+    if (last == entries.data() + size_t(last_block) * bucket_size) {
+        // the last block is now empty
+        free_blocks.push_back(last_block);
+        if (prev_block == QDT_NONE)
+            nodes[leaf].block = QDT_NONE;
+        else
+            block_next[prev_block] = QDT_NONE;
+    }
+    for (uint32_t n = leaf; n != QDT_NONE; n = nodes[n].parent)
+        nodes[n].count--;
+    live--;
+
+    // merge the highest ancestor that fits half a bucket, the slack keeps a
+    // point moving back and forth over a split line from thrashing
+    uint32_t top = QDT_NONE;
+    for (uint32_t n = nodes[leaf].parent; n != QDT_NONE && nodes[n].count <= bucket_size / 2; n = nodes[n].parent)
+        top = n;
+    if (top != QDT_NONE)
+        collapse(top);
+    return true;
+}
 
-        // Create 4 childs and set the bounds
-        auto nodeNW = new rez::QDTNode();
-        auto nodeNE = new rez::QDTNode();
-        auto nodeSW = new rez::QDTNode();
-        auto nodeSE = new rez::QDTNode();
-
-        nodeNW->box = boxNW;
-        nodeNE->box = boxNE;
-        nodeSW->box = boxSW;
-        nodeSE->box = boxSE;
-
-        // Do the recursive call.
-        partition(nodeNW, pointsNW);
-        partition(nodeNE, pointsNE);
-        partition(nodeSW, pointsSW);
-        partition(nodeSE, pointsSE);
-
-        _parent->NW = nodeNW;
-        _parent->NE = nodeNE;
-        _parent->SW = nodeSW;
-        _parent->SE = nodeSE;
-        nodeNW->parent = _parent;
-        nodeNE->parent = _parent;
-        nodeSW->parent = _parent;
-        nodeSE->parent = _parent;
+bool rez::QuadTree::Move(uint32_t _id, const Point2d& _point)
+{
+    if (_id >= leaf_of.size() || leaf_of[_id] == QDT_NONE)
+        return false;
+    const uint32_t leaf = leaf_of[_id];
+    points[_id] = _point;
+    if (contains(nodes[leaf].box, _point)) {
+        uint32_t remaining = nodes[leaf].count;
+        for (uint32_t b = nodes[leaf].block; remaining > 0; b = block_next[b]) {
+            const uint32_t n = std::min(remaining, bucket_size);
+            Entry* block = entries.data() + size_t(b) * bucket_size;
+            for (uint32_t i = 0; i < n; i++)
+                if (block[i].id == _id) {
+                    block[i].point = _point;
+                    return true;
+                }
+            remaining -= n;
+        }
     }
+    Remove(_id);
+    insertEntry(Entry{ _point, _id });
+    live++;
+    return true;
 }
 
-static void addBoundariesToTheList(rez::QDTNode* _node, std::vector<rez::Segment2d>& _segList) {
-    //if (!_node->isALeaf && !_node->isAEmptyNode) {
-    if (!_node->isALeaf) {
-        auto box = _node->box;
+//*****************************************************************************
+// Queries
+//*****************************************************************************
+
+void rez::QuadTree::reportAll(uint32_t _node, std::vector<uint32_t>& _ids) const
+{
+    if (nodes[_node].count == 0)
+        return;
+    if (nodes[_node].isALeaf()) {
+        forEachEntry(_node, [&](const Entry& e) { _ids.push_back(e.id); });
+        return;
+    }
+    for (uint32_t q = 0; q < NUM_POINTS; q++)
+        reportAll(nodes[_node].first_child + q, _ids);
+}
+
+void rez::QuadTree::RangeSearch(const AABB& _range, std::vector<uint32_t>& _ids) const
+{
+    if (nodes.empty())
+        return;
+    std::vector<uint32_t> stack{ 0 };
+    while (!stack.empty()) {
+        const uint32_t n = stack.back();
+        stack.pop_back();
+        const QDTNode& node = nodes[n];
+        if (node.count == 0 || !overlaps(_range, node.box))
+            continue;
+        if (contains(_range, node.box))
+            reportAll(n, _ids);
+        else if (node.isALeaf())
+            forEachEntry(n, [&](const Entry& e) {
+                if (contains(_range, e.point))
+                    _ids.push_back(e.id);
+            });
+        else
+            for (uint32_t q = 0; q < NUM_POINTS; q++)
+                stack.push_back(node.first_child + q);
+    }
+}
+
+void rez::QuadTree::RadiusSearch(const Point2d& _center, float _radius, std::vector<uint32_t>& _ids) const
+{
+    if (nodes.empty())
+        return;
+    const float r2 = _radius * _radius;
+    std::vector<uint32_t> stack{ 0 };
+    while (!stack.empty()) {
+        const uint32_t n = stack.back();
+        stack.pop_back();
+        const QDTNode& node = nodes[n];
+        if (node.count == 0 || squaredDistance(node.box, _center) > r2)
+            continue;
+        // all four corners inside the circle, so is the whole box
+        const float fx = std::max(_center.coords[X_] - node.box.x_min, node.box.x_max - _center.coords[X_]);
+        const float fy = std::max(_center.coords[Y_] - node.box.y_min, node.box.y_max - _center.coords[Y_]);
+        if (fx * fx + fy * fy <= r2)
+            reportAll(n, _ids);
+        else if (node.isALeaf())
+            forEachEntry(n, [&](const Entry& e) {
+                if (squaredDistance(e.point, _center) <= r2)
+                    _ids.push_back(e.id);
+            });
+        else
+            for (uint32_t q = 0; q < NUM_POINTS; q++)
+                stack.push_back(node.first_child + q);
+    }
+}
+
+// Depth first, nearer quadrants first, pruned by the worst of the _k kept so far
+void rez::QuadTree::nearest(uint32_t _node, const Point2d& _query, size_t _k, std::vector<Neighbour>& _heap) const
+{
+    const QDTNode& node = nodes[_node];
+    if (node.isALeaf()) {
+        forEachEntry(_node, [&](const Entry& e) {
+            const float d = squaredDistance(e.point, _query);
+            if (_heap.size() < _k) {
+                _heap.push_back({ e.id, d });
+                std::push_heap(_heap.begin(), _heap.end());
+            }
+            else if (d < _heap.front().squaredDistance) {
+                std::pop_heap(_heap.begin(), _heap.end());
+                _heap.back() = { e.id, d };
+                std::push_heap(_heap.begin(), _heap.end());
+            }
+        });
+        return;
+    }
+    // at most four children, kept in order by insertion
+    Neighbour order[NUM_POINTS];
+    uint32_t count = 0;
+    for (uint32_t q = 0; q < NUM_POINTS; q++) {
+        const uint32_t child = node.first_child + q;
+        if (nodes[child].count == 0)
+            continue;
+        const Neighbour n{ child, squaredDistance(nodes[child].box, _query) };
+        uint32_t i = count++;
+        for (; i > 0 && n < order[i - 1]; i--)
+            order[i] = order[i - 1];
+        order[i] = n;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (_heap.size() == _k && order[i].squaredDistance >= _heap.front().squaredDistance)
+            break;
+        nearest(order[i].id, _query, _k, _heap);
+    }
+}
+
+bool rez::QuadTree::NearestNeighbour(const Point2d& _query, uint32_t& _id) const
+{
+    std::vector<uint32_t> ids;
+    KNearest(_query, 1, ids);
+    if (ids.empty())
+        return false;
+    _id = ids[0];
+    return true;
+}
+
+void rez::QuadTree::KNearest(const Point2d& _query, size_t _k, std::vector<uint32_t>& _ids) const
+{
+    _ids.clear();
+    if (nodes.empty() || _k == 0 || nodes[0].count == 0)
+        return;
+    std::vector<Neighbour> heap;
+    heap.reserve(_k);
+    nearest(0, _query, _k, heap);
+    std::sort_heap(heap.begin(), heap.end());
+    for (const auto& n : heap)
+        _ids.push_back(n.id);
+}
+
+//*****************************************************************************
+// Meshing
+//*****************************************************************************
+
+static void addBoundariesToTheList(const std::vector<rez::QDTNode>& _nodes, uint32_t _node,
+                                   std::vector<rez::Segment2d>& _segList) {
+    if (!_nodes[_node].isALeaf()) {
+        auto box = _nodes[_node].box;
         float x_mid = (box.x_min + box.x_max) / 2;
         float y_mid = (box.y_min + box.y_max) / 2;
 
@@ -87,257 +562,155 @@ static void addBoundariesToTheList(rez::QDTNode* _node, std::vector<rez::Segment
         _segList.emplace_back(bot_mid, top_mid);
         _segList.emplace_back(left_mid, right_mid);
 
-        addBoundariesToTheList(_node->NW, _segList);
-        addBoundariesToTheList(_node->NE, _segList);
-        addBoundariesToTheList(_node->SW, _segList);
-        addBoundariesToTheList(_node->SE, _segList);
+        for (uint32_t q = 0; q < NUM_POINTS; q++)
+            addBoundariesToTheList(_nodes, _nodes[_node].first_child + q, _segList);
     }
 }
 
-static rez::QDTNode* northNeighbor(rez::QDTNode* _node, rez::QDTNode* _root) {
-    if (_node == _root)
-        return nullptr;
+// Which child of its parent _node is, INE .. ISW
+static uint32_t childIndex(const std::vector<rez::QDTNode>& _nodes, uint32_t _node) {
+    return _node - _nodes[_nodes[_node].parent].first_child;
+}
 
-    if (_node == _node->parent->SW)
-        return _node->parent->NW;
+static uint32_t northNeighbor(const std::vector<rez::QDTNode>& _nodes, uint32_t _node) {
+    if (_node == 0)
+        return rez::QDT_NONE;
 
-    if (_node == _node->parent->SE)
-        return _node->parent->NE;
+    const uint32_t first = _nodes[_nodes[_node].parent].first_child;
+    const uint32_t q = childIndex(_nodes, _node);
+    if (q == ISW)
+        return first + INW;
 
-    auto u = northNeighbor(_node->parent, _root);
-    //if (!u || u->isALeaf || u->isAEmptyNode)
-    if (!u || u->isALeaf)
+    if (q == ISE)
+        return first + INE;
+
+    auto u = northNeighbor(_nodes, _nodes[_node].parent);
+    if (u == rez::QDT_NONE || _nodes[u].isALeaf())
         return u;
-    else if (_node == _node->parent->NW)
-        return u->SW;
+    else if (q == INW)
+        return _nodes[u].first_child + ISW;
     else
-        return u->SE;
+        return _nodes[u].first_child + ISE;
 }
 
-static rez::QDTNode* southNeighbor(rez::QDTNode* _node, rez::QDTNode* _root) {
-    if (_node == _root)
-        return nullptr;
+static uint32_t southNeighbor(const std::vector<rez::QDTNode>& _nodes, uint32_t _node) {
+    if (_node == 0)
+        return rez::QDT_NONE;
 
-    if (_node == _node->parent->NW)
-        return _node->parent->SW;
+    const uint32_t first = _nodes[_nodes[_node].parent].first_child;
+    const uint32_t q = childIndex(_nodes, _node);
+    if (q == INW)
+        return first + ISW;
 
-    if (_node == _node->parent->NE)
-        return _node->parent->SE;
+    if (q == INE)
+        return first + ISE;
 
-    auto u = southNeighbor(_node->parent, _root);
-    //if (!u || u->isALeaf || u->isAEmptyNode)
-    if (!u || u->isALeaf)
+    auto u = southNeighbor(_nodes, _nodes[_node].parent);
+    if (u == rez::QDT_NONE || _nodes[u].isALeaf())
         return u;
-    else if (_node == _node->parent->SW)
-        return u->NW;
+    else if (q == ISW)
+        return _nodes[u].first_child + INW;
     else
-        return u->NE;
+        return _nodes[u].first_child + INE;
 }
 
-static rez::QDTNode* eastNeighbor(rez::QDTNode* _node, rez::QDTNode* _root) {
-    if (_node == _root)
-        return nullptr;
+static uint32_t eastNeighbor(const std::vector<rez::QDTNode>& _nodes, uint32_t _node) {
+    if (_node == 0)
+        return rez::QDT_NONE;
 
-    if (_node == _node->parent->NW)
-        return _node->parent->NE;
+    const uint32_t first = _nodes[_nodes[_node].parent].first_child;
+    const uint32_t q = childIndex(_nodes, _node);
+    if (q == INW)
+        return first + INE;
 
-    if (_node == _node->parent->SW)
-        return _node->parent->SE;
+    if (q == ISW)
+        return first + ISE;
 
-    auto u = eastNeighbor(_node->parent, _root);
-    //if (!u || u->isALeaf || u->isAEmptyNode)
-    if (!u || u->isALeaf)
+    auto u = eastNeighbor(_nodes, _nodes[_node].parent);
+    if (u == rez::QDT_NONE || _nodes[u].isALeaf())
         return u;
-    else if (_node == _node->parent->NE)
-        return u->NW;
+    else if (q == INE)
+        return _nodes[u].first_child + INW;
     else
-        return u->SW;
+        return _nodes[u].first_child + ISW;
 }
 
-static rez::QDTNode* westNeighbor(rez::QDTNode* _node, rez::QDTNode* _root) {
-    if (_node == _root)
-        return nullptr;
+static uint32_t westNeighbor(const std::vector<rez::QDTNode>& _nodes, uint32_t _node) {
+    if (_node == 0)
+        return rez::QDT_NONE;
 
-    if (_node == _node->parent->NE)
-        return _node->parent->NW;
+    const uint32_t first = _nodes[_nodes[_node].parent].first_child;
+    const uint32_t q = childIndex(_nodes, _node);
+    if (q == INE)
+        return first + INW;
 
-    if (_node == _node->parent->SE)
-        return _node->parent->SW;
+    if (q == ISE)
+        return first + ISW;
 
-    auto u = westNeighbor(_node->parent, _root);
-    //if (!u || u->isALeaf || u->isAEmptyNode)
-    if (!u || u->isALeaf)
+    auto u = westNeighbor(_nodes, _nodes[_node].parent);
+    if (u == rez::QDT_NONE || _nodes[u].isALeaf())
         return u;
-    else if (_node == _node->parent->NW)
-        return u->NE;
+    else if (q == INW)
+        return _nodes[u].first_child + INE;
     else
-        return u->SE;
-}
-
-rez::QuadTree::QuadTree(const std::vector<Point2d>& _points, AABB& bounds)
-{
-    if (_points.empty())
-        return;
-    else {
-        root = new rez::QDTNode();
-        root->box = bounds;
-        partition(root, _points);
-    }
-}
-
-void balancing(rez::QDTNode* _node) {
-
+        return _nodes[u].first_child + ISE;
 }
 
-static void getLeafNodes(rez::QDTNode* _node, std::vector<rez::QDTNode*>& _leafs) {
-    if (!_node)
-        return;
-    //if (_node->isALeaf || _node->isAEmptyNode)
-    if (_node->isALeaf)
+static void getLeafNodes(const std::vector<rez::QDTNode>& _nodes, uint32_t _node, std::vector<uint32_t>& _leafs) {
+    if (_nodes[_node].isALeaf())
         _leafs.push_back(_node);
-    else {
-        getLeafNodes(_node->NW, _leafs);
-        getLeafNodes(_node->NE, _leafs);
-        getLeafNodes(_node->SW, _leafs);
-        getLeafNodes(_node->SE, _leafs);
-    }
+    else
+        for (uint32_t q = 0; q < NUM_POINTS; q++)
+            getLeafNodes(_nodes, _nodes[_node].first_child + q, _leafs);
 }
 
-static bool isEndNode(rez::QDTNode* _node) {
-    //if (_node && (_node->isALeaf || _node->isAEmptyNode))
-    if (_node && (_node->isALeaf))
-        return true;
-    return false;
+static bool isEndNode(const std::vector<rez::QDTNode>& _nodes, uint32_t _node) {
+    return _node != rez::QDT_NONE && _nodes[_node].isALeaf();
 }
 
-static bool needToSplit(rez::QDTNode* _node, rez::QDTNode* root) {
-    if (!_node)
+// A leaf has to split when a neighbour is split twice, the children of the
+// neighbour facing it are not leaves
+static bool needToSplit(const std::vector<rez::QDTNode>& _nodes, uint32_t _node) {
+    if (_node == rez::QDT_NONE)
         return false;
 
-    auto nNbor = northNeighbor(_node, root);
-    auto sNbor = southNeighbor(_node, root);
-    auto wNbor = westNeighbor(_node, root);
-    auto eNbor = eastNeighbor(_node, root);
-
-    // Check if this leaf has to split
-    bool hasToSplit = false;
-    if (nNbor && !(nNbor->isALeaf)
-        && (!(nNbor->SW->isALeaf) || !(nNbor->SE->isALeaf))) {
-        hasToSplit = true;
-    }
-    else if (sNbor && !(sNbor->isALeaf)
-             && (!(sNbor->NW->isALeaf) || !(sNbor->NE->isALeaf))) {
-        hasToSplit = true;
-    }
-    else if (wNbor && !(wNbor->isALeaf)
-             && (!(wNbor->NE->isALeaf) || !(wNbor->SE->isALeaf))) {
-        hasToSplit = true;
-    }
-    else if (eNbor && !(eNbor->isALeaf)
-             && (!(eNbor->NW->isALeaf) || !(eNbor->SW->isALeaf))) {
-        hasToSplit = true;
-    }
-
-    //if (nNbor && !(nNbor->isALeaf || nNbor->isAEmptyNode)
-    //	&& (!(nNbor->SW->isALeaf || nNbor->SW->isAEmptyNode) || !( nNbor->SE->isALeaf || nNbor->SE->isAEmptyNode))) {
-    //	hasToSplit = true;
-    //}
-    //else if (sNbor && !(sNbor->isALeaf || sNbor->isAEmptyNode)
-    //	&& (!(sNbor->NW->isALeaf|| sNbor->NW->isAEmptyNode) || !(sNbor->NE->isALeaf || sNbor->NE->isAEmptyNode))) {
-    //	hasToSplit = true;
-    //}
-    //else if (wNbor && !(wNbor->isALeaf || wNbor->isAEmptyNode)
-    //	&& (!(wNbor->NE->isALeaf || wNbor->NE->isAEmptyNode) || !(wNbor->SE->isALeaf || wNbor->SE->isAEmptyNode))) {
-    //	hasToSplit = true;
-    //}
-    //else if (eNbor && !(eNbor->isALeaf || eNbor->isAEmptyNode)
-    //	&& (!(eNbor->NW->isALeaf || eNbor->NW->isAEmptyNode) || !(eNbor->SW->isALeaf || eNbor->SW->isAEmptyNode))) {
-    //	hasToSplit = true;
-    //}
-
-    return hasToSplit;
+    auto split = [&](uint32_t _nbor, uint32_t _a, uint32_t _b) {
+        if (_nbor == rez::QDT_NONE || _nodes[_nbor].isALeaf())
+            return false;
+        const uint32_t first = _nodes[_nbor].first_child;
+        return !_nodes[first + _a].isALeaf() || !_nodes[first + _b].isALeaf();
+    };
+
+    return split(northNeighbor(_nodes, _node), ISW, ISE)
+           || split(southNeighbor(_nodes, _node), INW, INE)
+           || split(westNeighbor(_nodes, _node), INE, ISE)
+           || split(eastNeighbor(_nodes, _node), INW, ISW);
 }
 
 void rez::QuadTree::BalanceTheTree() {
-    std::vector<rez::QDTNode*> leafNodes;
-    getLeafNodes(root, leafNodes);
+    if (nodes.empty())
+        return;
+    std::vector<uint32_t> leafNodes;
+    getLeafNodes(nodes, 0, leafNodes);
 
     while (!leafNodes.empty()) {
         auto leaf = leafNodes.back();
         leafNodes.pop_back();
 
-        bool hasToSplit = needToSplit(leaf, root);
-        if (hasToSplit) {
-            // Split the this node in to four childs.
-            auto box = leaf->box;
-            float x_mid = (box.x_min + box.x_max) / 2;
-            float y_mid = (box.y_min + box.y_max) / 2;
-
-            rez::AABB boxNW{ box.x_min, x_mid, y_mid, box.y_max };
-            rez::AABB boxNE{ x_mid, box.x_max, y_mid, box.y_max };
-            rez::AABB boxSW{ box.x_min, x_mid, box.y_min, y_mid };
-            rez::AABB boxSE{ x_mid, box.x_max, box.y_min, y_mid };
-
-            // Create 4 childs and set the bounds
-            auto nodeNW = new rez::QDTNode();
-            auto nodeNE = new rez::QDTNode();
-            auto nodeSW = new rez::QDTNode();
-            auto nodeSE = new rez::QDTNode();
-
-            nodeNW->box = boxNW;
-            nodeNE->box = boxNE;
-            nodeSW->box = boxSW;
-            nodeSE->box = boxSE;
-
-            nodeNW->isALeaf = true;
-            nodeNE->isALeaf = true;
-            nodeSW->isALeaf = true;
-            nodeSE->isALeaf = true;
-
-            if (boxNW.isInside(leaf->point))
-                nodeNW->point = leaf->point;
-            else if (boxNE.isInside(leaf->point))
-                nodeNE->point = leaf->point;
-            else if (boxSW.isInside(leaf->point))
-                nodeSW->point = leaf->point;
-            else
-                nodeSE->point = leaf->point;
-
-            leaf->NW = nodeNW;
-            leaf->NE = nodeNE;
-            leaf->SW = nodeSW;
-            leaf->SE = nodeSE;
-            nodeNW->parent = leaf;
-            nodeNE->parent = leaf;
-            nodeSW->parent = leaf;
-            nodeSE->parent = leaf;
-
-            //Leaf is no longer a empty node or a leaf node
-            leaf->isALeaf = false;
-
-            leafNodes.push_back(nodeNW);
-            leafNodes.push_back(nodeNE);
-            leafNodes.push_back(nodeSW);
-            leafNodes.push_back(nodeSE);
-
-            // Check if neighbours have to split or not
-            auto nNbor = northNeighbor(leaf, root);
-            auto sNbor = southNeighbor(leaf, root);
-            auto wNbor = westNeighbor(leaf, root);
-            auto eNbor = eastNeighbor(leaf, root);
-
-            if (isEndNode(nNbor) && needToSplit(nNbor, root))
-                leafNodes.push_back(nNbor);
-
-            if (isEndNode(sNbor) && needToSplit(sNbor, root))
-                leafNodes.push_back(sNbor);
-
-            if (isEndNode(eNbor) && needToSplit(eNbor, root))
-                leafNodes.push_back(eNbor);
-
-            if (isEndNode(wNbor) && needToSplit(wNbor, root))
-                leafNodes.push_back(wNbor);
-        }
+        if (!nodes[leaf].isALeaf() || !needToSplit(nodes, leaf))
+            continue;
+
+        // Split the this node in to four childs, its points go along
+        splitLeaf(leaf);
+        const uint32_t first = nodes[leaf].first_child;
+        for (uint32_t q = 0; q < NUM_POINTS; q++)
+            leafNodes.push_back(first + q);
+
+        // Check if neighbours have to split or not
+        for (auto nbor : { northNeighbor(nodes, leaf), southNeighbor(nodes, leaf),
+                           eastNeighbor(nodes, leaf), westNeighbor(nodes, leaf) })
+            if (isEndNode(nodes, nbor) && needToSplit(nodes, nbor))
+                leafNodes.push_back(nbor);
     }
 }
 
@@ -346,8 +719,8 @@ void rez::QuadTree::GenerateMesh()
 }
 
 void rez::QuadTree::GetUniqueSegmentList(std::vector<Segment2d>& _segList) {
-    if (root) {
-        auto box = root->box;
+    if (!nodes.empty()) {
+        auto box = nodes[0].box;
         Point2d bot_left(box.x_min, box.y_min);
         Point2d bot_right(box.x_max, box.y_min);
         Point2d top_left(box.x_min, box.y_max);
@@ -357,6 +730,6 @@ void rez::QuadTree::GetUniqueSegmentList(std::vector<Segment2d>& _segList) {
         _segList.emplace_back(top_right, top_left);
         _segList.emplace_back(top_left, bot_left);
 
-        addBoundariesToTheList(root, _segList);
+        addBoundariesToTheList(nodes, 0, _segList);
     }
 }
\ No newline at end of file
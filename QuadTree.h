@@ -10,6 +10,7 @@
 #include "Segment.h"
 #include "Boundries.h"
 
+#include <cstdint>
 #include <vector>
 
 namespace rez {
@@ -20,26 +21,122 @@ namespace rez {
 #define ISE 2
 #define ISW 3
 
+    static constexpr uint32_t QDT_NONE = 0xFFFFFFFFu;
 
+    // Node of the quadtree. Nodes live in one pool and refer to each other by
+    // index, the four children of a node are consecutive: first_child + INE .. ISW.
     struct QDTNode {
-        QDTNode* NE = nullptr, * NW = nullptr, * SE = nullptr, * SW = nullptr;
-        QDTNode* parent = nullptr;
         AABB box{};
-        Point2d point = DEFAULT_POINT_2D;
-        bool isALeaf = false;
-        //bool isAEmptyNode = false;
+        uint32_t parent = QDT_NONE;
+        uint32_t first_child = QDT_NONE;   // QDT_NONE for a leaf
+        uint32_t block = QDT_NONE;         // first bucket block of a leaf
+        uint32_t count = 0;                // points in the subtree
+
+        [[nodiscard]] bool isALeaf() const { return first_child == QDT_NONE; }
     };
 
+    /**
+     * @brief bucketed point region quadtree. Leaves hold up to bucket_size points
+     * and split into four equal quadrants when they overflow. Nodes and buckets
+     * come from pools inside the tree, so building, inserting and removing do
+     * not allocate per node.
+     *
+     * Every point gets an id, its index in the input for the bulk constructors and
+     * the return value of Insert afterwards. Ids stay valid across Move and are
+     * not reused after Remove. Queries report ids, GetPoint(id) gives the position.
+     * Points outside the root box grow the tree upwards, so the bounds given at
+     * construction are only a hint.
+     */
     class QuadTree {
+        struct Entry {
+            Point2d point;
+            uint32_t id;
+        };
+
+        // beyond this depth full leaves chain another bucket instead of splitting,
+        // which stops coincident points from splitting forever
+        static constexpr uint32_t MAX_DEPTH = 24;
+
+        std::vector<QDTNode> nodes;          // nodes[0] is the root
+        std::vector<uint32_t> free_quads;    // first index of released child quads
+        std::vector<Entry> entries;          // bucket blocks of bucket_size entries
+        std::vector<uint32_t> block_next;    // next block of an overflowing leaf
+        std::vector<uint32_t> free_blocks;
+        std::vector<Point2d> points;         // by id
+        std::vector<uint32_t> leaf_of;       // leaf holding an id, QDT_NONE once removed
+        uint32_t bucket_size = DEFAULT_BUCKET_SIZE;
+        size_t live = 0;
+
+        std::vector<Entry> scratch;
+
+        uint32_t allocQuad(uint32_t _parent);
+        uint32_t allocBlock();
+        void appendEntry(uint32_t _leaf, const Entry& _entry);
+        void releaseSubtree(uint32_t _node, std::vector<Entry>& _out);
+        void splitLeaf(uint32_t _node);
+        void collapse(uint32_t _node);
+        void grow(const Point2d& _point);
+        void refit(uint32_t _node);
+        void insertEntry(const Entry& _entry);
+        void build(uint32_t _node, size_t _begin, size_t _end, uint32_t _depth);
+        void bulkLoad(const std::vector<Point2d>& _points, const AABB& _bounds);
+        void reportAll(uint32_t _node, std::vector<uint32_t>& _ids) const;
 
-        QDTNode* root = nullptr;
+        struct Neighbour {
+            uint32_t id;
+            float squaredDistance;
+            bool operator<(const Neighbour& _other) const { return squaredDistance < _other.squaredDistance; }
+        };
+
+        void nearest(uint32_t _node, const Point2d& _query, size_t _k, std::vector<Neighbour>& _heap) const;
+
+        // walk the entries of a leaf, following the overflow chain
+        template<typename F>
+        void forEachEntry(uint32_t _leaf, F _f) const
+        {
+            uint32_t remaining = nodes[_leaf].count;
+            for (uint32_t b = nodes[_leaf].block; remaining > 0; b = block_next[b]) {
+                const uint32_t n = remaining < bucket_size ? remaining : bucket_size;
+                const Entry* block = entries.data() + size_t(b) * bucket_size;
+                for (uint32_t i = 0; i < n; i++)
+                    _f(block[i]);
+                remaining -= n;
+            }
+        }
 
     public:
+        static constexpr uint32_t DEFAULT_BUCKET_SIZE = 8;
+
         QuadTree() = default;
 
-        explicit QuadTree(const std::vector<Point2d>& _points);
+        explicit QuadTree(const std::vector<Point2d>& _points, uint32_t _bucket_size = DEFAULT_BUCKET_SIZE);
+
+        QuadTree(const std::vector<Point2d>& _points, AABB& bounds, uint32_t _bucket_size = DEFAULT_BUCKET_SIZE);
+
+        // adds a point and returns its id
+        uint32_t Insert(const Point2d& _point);
+
+        // false if the id is unknown or already removed
+        bool Remove(uint32_t _id);
+
+        // relocates a point in place when it stays in its leaf, otherwise reinserts it
+        bool Move(uint32_t _id, const Point2d& _point);
+
+        [[nodiscard]] const Point2d& GetPoint(uint32_t _id) const { return points[_id]; }
+
+        // number of points currently in the tree
+        [[nodiscard]] size_t size() const { return live; }
+
+        // ids of the points inside the box, boundary included
+        void RangeSearch(const AABB& _range, std::vector<uint32_t>& _ids) const;
+
+        // ids of the points within _radius of _center
+        void RadiusSearch(const Point2d& _center, float _radius, std::vector<uint32_t>& _ids) const;
+
+        bool NearestNeighbour(const Point2d& _query, uint32_t& _id) const;
 
-        QuadTree(const std::vector<Point2d>& _points, AABB& bounds);
+        // ids of the _k closest points, nearest first
+        void KNearest(const Point2d& _query, size_t _k, std::vector<uint32_t>& _ids) const;
 
         void BalanceTheTree();
 
@@ -0,0 +1,474 @@
+#include "SegmentIntersection.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+#include <unordered_set>
+#include "GeoUtils.h"
+#include "Kernel.h"
+#include "ThreadPool.h"
+
+using namespace rez;
+
+// below this many segments the parallel sweep is not worth the strips
+static const size_t PARALLEL_MIN_SEGMENTS = 4096;
+
+namespace {
+    enum EventKind : uint8_t { UPPER, LOWER, CROSSING };
+
+    struct SweepEvent {
+        double x, y;
+        uint32_t a, b;
+        EventKind kind;
+    };
+
+    // A segment as the sweep sees it. Predicates and the sweep line position use
+    // the original endpoints, the events come from the piece inside the strip.
+    struct SweepSegment {
+        double x1, y1, x2, y2;                  // upper endpoint first
+        double top_x, top_y, bot_x, bot_y;      // clipped to the strip
+        double x_min, x_max;                    // of the clipped piece
+        double dxdy;                            // 0 for a horizontal segment
+        double below;                           // order just below the sweep line, +inf if horizontal
+        uint32_t id;
+    };
+
+    // true if _a comes first in the sweep, top to bottom then left to right
+    bool before(double ax, double ay, double bx, double by)
+    {
+        return ay > by || (ay == by && ax < bx);
+    }
+
+    template<class Kernel>
+    class SegmentSweep {
+        static const uint32_t NONE = 0xFFFFFFFFu;
+
+        std::vector<SweepSegment> segs;
+        double lo, hi;          // intersections with lo <= x < hi are reported
+        double eps;             // points closer than this are one point
+        double px = 0, py = 0;  // current event point
+
+        // Event queue: the events live in a pool that recycles its slots, the heap
+        // only moves their indices around.
+        std::vector<SweepEvent> pool;
+        std::vector<uint32_t> free_events;
+        std::vector<uint32_t> heap;
+        std::vector<uint32_t> row;      // events of the current row, left to right
+        std::unordered_set<uint64_t> scheduled;
+
+        struct Probe { double x; };
+
+        // Left to right where the segments cross the sweep line. Segments meeting
+        // at the event point are ordered as they leave it downwards.
+        struct Order {
+            using is_transparent = void;
+            const SegmentSweep* sweep;
+
+            bool operator()(uint32_t a, uint32_t b) const
+            {
+                if (a == b)
+                    return false;
+                const double xa = sweep->xAt(a), xb = sweep->xAt(b);
+                if (std::fabs(xa - xb) > sweep->eps)
+                    return xa < xb;
+                const double ba = sweep->segs[a].below, bb = sweep->segs[b].below;
+                if (ba != bb)
+                    return ba < bb;
+                return a < b;
+            }
+
+            bool operator()(uint32_t a, Probe p) const { return sweep->xAt(a) < p.x; }
+
+            bool operator()(Probe p, uint32_t a) const { return p.x < sweep->xAt(a); }
+        };
+
+        using Status = std::set<uint32_t, Order>;
+        Status status;
+        std::vector<typename Status::iterator> handle;
+        std::vector<char> active;
+        std::vector<uint32_t> ending;   // stamp of the event a segment ends at
+        uint32_t stamp = 0;
+        bool genuine = false;           // the event point is more than where a strip cuts segments
+        std::vector<uint32_t> upper, lower, through, reinsert;
+
+        double xAt(uint32_t _s) const
+        {
+            const SweepSegment& g = segs[_s];
+            const double x = g.y1 == g.y2 ? px : g.x1 + (py - g.y1) * g.dxdy;
+            return std::min(std::max(x, g.x_min), g.x_max);
+        }
+
+        bool ahead(double _x, double _y) const
+        {
+            return _y < py - eps || (_y <= py + eps && _x > px + eps);
+        }
+
+        void push(const SweepEvent& _event)
+        {
+            uint32_t slot;
+            if (!free_events.empty()) {
+                slot = free_events.back();
+                free_events.pop_back();
+                pool[slot] = _event;
+            }
+            else {
+                slot = static_cast<uint32_t>(pool.size());
+                pool.push_back(_event);
+            }
+            heap.push_back(slot);
+            std::push_heap(heap.begin(), heap.end(), [this](uint32_t i, uint32_t j) {
+                return before(pool[j].x, pool[j].y, pool[i].x, pool[i].y);
+            });
+        }
+
+        // heap order of a row, event _i comes after event _j
+        bool rightOf(uint32_t _i, uint32_t _j) const
+        {
+            return pool[_j].x < pool[_i].x || (pool[_j].x == pool[_i].x && pool[_j].y > pool[_i].y);
+        }
+
+        // Events less than eps apart in y make one row, swept left to right. Taken
+        // by y alone, rounding could put a point of the row between two events
+        // that are the same point further left.
+        void pullRow(double _y)
+        {
+            const auto byY = [this](uint32_t i, uint32_t j) {
+                return before(pool[j].x, pool[j].y, pool[i].x, pool[i].y);
+            };
+            const auto byX = [this](uint32_t i, uint32_t j) { return rightOf(i, j); };
+            while (!heap.empty() && _y - pool[heap.front()].y <= eps) {
+                std::pop_heap(heap.begin(), heap.end(), byY);
+                row.push_back(heap.back());
+                heap.pop_back();
+                std::push_heap(row.begin(), row.end(), byX);
+            }
+        }
+
+        uint32_t pop()
+        {
+            std::pop_heap(row.begin(), row.end(), [this](uint32_t i, uint32_t j) { return rightOf(i, j); });
+            const uint32_t slot = row.back();
+            row.pop_back();
+            free_events.push_back(slot);
+            return slot;
+        }
+
+        // schedules the intersection of two neighbours if the sweep has yet to reach it
+        void check(uint32_t _a, uint32_t _b)
+        {
+            const uint64_t key = (uint64_t(std::min(_a, _b)) << 32) | std::max(_a, _b);
+            if (scheduled.count(key))
+                return;
+            const SweepSegment& s = segs[_a];
+            const SweepSegment& t = segs[_b];
+            const int o1 = Kernel::orientation2d(s.x1, s.y1, s.x2, s.y2, t.x1, t.y1);
+            const int o2 = Kernel::orientation2d(s.x1, s.y1, s.x2, s.y2, t.x2, t.y2);
+            // collinear overlaps show up at the end points of the overlap
+            if ((o1 == 0 && o2 == 0) || o1 * o2 > 0)
+                return;
+            const int o3 = Kernel::orientation2d(t.x1, t.y1, t.x2, t.y2, s.x1, s.y1);
+            const int o4 = Kernel::orientation2d(t.x1, t.y1, t.x2, t.y2, s.x2, s.y2);
+            if (o3 * o4 > 0)
+                return;
+
+            double x, y;
+            if (o1 == 0) { x = t.x1; y = t.y1; }
+            else if (o2 == 0) { x = t.x2; y = t.y2; }
+            else if (o3 == 0) { x = s.x1; y = s.y1; }
+            else if (o4 == 0) { x = s.x2; y = s.y2; }
+            else {
+                const double d = (s.x2 - s.x1) * (t.y2 - t.y1) - (s.y2 - s.y1) * (t.x2 - t.x1);
+                const double u = ((t.x1 - s.x1) * (t.y2 - t.y1) - (t.y1 - s.y1) * (t.x2 - t.x1)) / d;
+                x = s.x1 + u * (s.x2 - s.x1);
+                y = s.y1 + u * (s.y2 - s.y1);
+            }
+            if (!ahead(x, y) || x < std::max(s.x_min, t.x_min) - eps || x > std::min(s.x_max, t.x_max) + eps)
+                return;
+            scheduled.insert(key);
+            push(SweepEvent{ x, y, _a, _b, CROSSING });
+        }
+
+        void take(const SweepEvent& _event)
+        {
+            const SweepSegment& g = segs[_event.a];
+            if (_event.kind == CROSSING || (_event.kind == UPPER && g.top_x == g.x1 && g.top_y == g.y1)
+                || (_event.kind == LOWER && g.bot_x == g.x2 && g.bot_y == g.y2))
+                genuine = true;
+            if (_event.kind == UPPER)
+                upper.push_back(_event.a);
+            else if (_event.kind == LOWER) {
+                lower.push_back(_event.a);
+                ending[_event.a] = stamp;
+            }
+        }
+
+        // true if all segments at the event lie on one line, then a strip boundary
+        // through their overlap is no intersection
+        bool collinear() const
+        {
+            const SweepSegment& s = segs[upper.empty() ? through.front() : upper.front()];
+            const auto on = [&](const std::vector<uint32_t>& _segments) {
+                for (uint32_t i : _segments) {
+                    const SweepSegment& t = segs[i];
+                    if (Kernel::orientation2d(s.x1, s.y1, s.x2, s.y2, t.x1, t.y1) != 0
+                        || Kernel::orientation2d(s.x1, s.y1, s.x2, s.y2, t.x2, t.y2) != 0)
+                        return false;
+                }
+                return true;
+            };
+            return on(upper) && on(through);
+        }
+
+        void handleEvent(std::vector<SegmentIntersection2d>& _result)
+        {
+            // every segment in the status through the event point
+            auto first = status.lower_bound(Probe{ px - eps });
+            auto last = first;
+            through.clear();
+            while (last != status.end() && xAt(*last) <= px + eps)
+                through.push_back(*last++);
+
+            for (uint32_t s : through)
+                active[s] = 0;
+            status.erase(first, last);
+
+            // a segment ending here that rounding kept out of the range above
+            for (uint32_t s : lower) {
+                if (!active[s])
+                    continue;
+                auto it = status.erase(handle[s]);
+                active[s] = 0;
+                through.push_back(s);
+                if (it != status.begin() && it != status.end())
+                    check(*std::prev(it), *it);
+            }
+            auto gap = status.lower_bound(Probe{ px - eps });
+            const uint32_t left = gap == status.begin() ? NONE : *std::prev(gap);
+            const uint32_t right = gap == status.end() ? NONE : *gap;
+
+            if (upper.size() + through.size() > 1 && px >= lo && px < hi && (genuine || !collinear())) {
+                SegmentIntersection2d hit;
+                hit.point = Point2d(static_cast<float>(px), static_cast<float>(py));
+                for (uint32_t s : upper)
+                    hit.segments.push_back(segs[s].id);
+                for (uint32_t s : through)
+                    hit.segments.push_back(segs[s].id);
+                std::sort(hit.segments.begin(), hit.segments.end());
+                _result.push_back(std::move(hit));
+            }
+
+            // reinsert what goes on below the event point, in its new order
+            reinsert.clear();
+            for (uint32_t s : through)
+                if (ending[s] != stamp)
+                    reinsert.push_back(s);
+            for (uint32_t s : upper)
+                if (ending[s] != stamp)
+                    reinsert.push_back(s);
+            std::sort(reinsert.begin(), reinsert.end(), status.key_comp());
+            for (uint32_t s : reinsert) {
+                handle[s] = status.insert(s).first;
+                active[s] = 1;
+            }
+
+            if (reinsert.empty()) {
+                if (left != NONE && right != NONE)
+                    check(left, right);
+                return;
+            }
+            auto leftmost = handle[reinsert.front()];
+            if (leftmost != status.begin())
+                check(*std::prev(leftmost), *leftmost);
+            auto next = std::next(handle[reinsert.back()]);
+            if (next != status.end())
+                check(reinsert.back(), *next);
+        }
+
+    public:
+        SegmentSweep(std::vector<SweepSegment>&& _segments, double _lo, double _hi, double _eps)
+                : segs(std::move(_segments)), lo(_lo), hi(_hi), eps(_eps), status(Order{ this })
+        {
+        }
+
+        void run(std::vector<SegmentIntersection2d>& _result)
+        {
+            const auto n = static_cast<uint32_t>(segs.size());
+            handle.resize(n);
+            active.assign(n, 0);
+            ending.assign(n, 0);
+            pool.reserve(2 * size_t(n));
+            heap.reserve(2 * size_t(n));
+            row.reserve(n);
+            for (uint32_t s = 0; s < n; s++) {
+                push(SweepEvent{ segs[s].top_x, segs[s].top_y, s, s, UPPER });
+                push(SweepEvent{ segs[s].bot_x, segs[s].bot_y, s, s, LOWER });
+            }
+
+            while (!heap.empty()) {
+                const double top = pool[heap.front()].y;
+                pullRow(top);
+                while (!row.empty()) {
+                    const SweepEvent first = pool[pop()];
+                    px = first.x;
+                    py = first.y;
+                    stamp++;
+                    genuine = false;
+                    upper.clear();
+                    lower.clear();
+                    take(first);
+                    // events closer than eps are the same point
+                    while (!row.empty() && pool[row.front()].x - px <= eps)
+                        take(pool[pop()]);
+
+                    handleEvent(_result);
+                    // crossings found just now may still belong to the row
+                    pullRow(top);
+                }
+            }
+        }
+    };
+
+    // the segment with its upper endpoint first, clipped to [_lo, _hi] in x
+    bool makeSweepSegment(const Segment2d& _segment, uint32_t _id, double _lo, double _hi, SweepSegment& _out)
+    {
+        double x1 = _segment.p1.coords[X_], y1 = _segment.p1.coords[Y_];
+        double x2 = _segment.p2.coords[X_], y2 = _segment.p2.coords[Y_];
+        if (before(x2, y2, x1, y1)) {
+            std::swap(x1, x2);
+            std::swap(y1, y2);
+        }
+        _out.x1 = x1;
+        _out.y1 = y1;
+        _out.x2 = x2;
+        _out.y2 = y2;
+        _out.id = _id;
+        _out.dxdy = y1 == y2 ? 0.0 : (x2 - x1) / (y2 - y1);
+        _out.below = y1 == y2 ? std::numeric_limits<double>::infinity() : -_out.dxdy;
+
+        _out.x_min = std::max(std::min(x1, x2), _lo);
+        _out.x_max = std::min(std::max(x1, x2), _hi);
+        if (_out.x_min > _out.x_max)
+            return false;
+        auto yAt = [&](double x) {
+            if (x == x1)
+                return y1;
+            if (x == x2)
+                return y2;
+            return y1 + (x - x1) * (y2 - y1) / (x2 - x1);
+        };
+        if (x1 == x2) {
+            _out.top_x = x1;
+            _out.top_y = y1;
+            _out.bot_x = x2;
+            _out.bot_y = y2;
+        }
+        else if (x1 < x2) {
+            _out.top_x = _out.x_min;
+            _out.top_y = yAt(_out.x_min);
+            _out.bot_x = _out.x_max;
+            _out.bot_y = yAt(_out.x_max);
+        }
+        else {
+            _out.top_x = _out.x_max;
+            _out.top_y = yAt(_out.x_max);
+            _out.bot_x = _out.x_min;
+            _out.bot_y = yAt(_out.x_min);
+        }
+        return true;
+    }
+
+    double mergeDistance(const std::vector<Segment2d>& _segments)
+    {
+        double scale = 1;
+        for (const auto& s : _segments)
+            scale = std::max({ scale, std::fabs(double(s.p1.coords[X_])), std::fabs(double(s.p1.coords[Y_])),
+                               std::fabs(double(s.p2.coords[X_])), std::fabs(double(s.p2.coords[Y_])) });
+        return scale * 1e-9;
+    }
+
+    template<class Kernel>
+    void sweepStrip(const std::vector<Segment2d>& _segments, const std::vector<uint32_t>& _ids, double _lo,
+                    double _hi, double _eps, std::vector<SegmentIntersection2d>& _result)
+    {
+        std::vector<SweepSegment> segs;
+        segs.reserve(_ids.size());
+        SweepSegment piece{};
+        for (uint32_t id : _ids)
+            if (makeSweepSegment(_segments[id], id, _lo, _hi, piece))
+                segs.push_back(piece);
+        SegmentSweep<Kernel>(std::move(segs), _lo, _hi, _eps).run(_result);
+    }
+}
+
+template<class Kernel>
+void rez::intersect_segments(const std::vector<Segment2d>& _segments, std::vector<SegmentIntersection2d>& _result)
+{
+    std::vector<uint32_t> ids(_segments.size());
+    for (size_t i = 0; i < ids.size(); i++)
+        ids[i] = static_cast<uint32_t>(i);
+    const double inf = std::numeric_limits<double>::infinity();
+    sweepStrip<Kernel>(_segments, ids, -inf, inf, mergeDistance(_segments), _result);
+}
+
+template<class Kernel>
+void rez::intersect_segments_parallel(const std::vector<Segment2d>& _segments,
+                                      std::vector<SegmentIntersection2d>& _result, unsigned _threads)
+{
+    ThreadPool& pool = ThreadPool::global();
+    const unsigned strips = _threads ? _threads : pool.size();
+    if (strips < 2 || _segments.size() < PARALLEL_MIN_SEGMENTS) {
+        intersect_segments<Kernel>(_segments, _result);
+        return;
+    }
+
+    // cut at quantiles of the segment midpoints so the strips get similar loads
+    std::vector<double> mid(_segments.size());
+    for (size_t i = 0; i < mid.size(); i++)
+        mid[i] = (double(_segments[i].p1.coords[X_]) + _segments[i].p2.coords[X_]) / 2;
+    std::vector<double> cuts;
+    for (unsigned k = 1; k < strips; k++) {
+        auto nth = mid.begin() + mid.size() * k / strips;
+        std::nth_element(mid.begin(), nth, mid.end());
+        if (cuts.empty() || *nth > cuts.back())
+            cuts.push_back(*nth);
+    }
+
+    // a segment goes to every strip its x range touches, boundaries included
+    std::vector<std::vector<uint32_t>> members(cuts.size() + 1);
+    for (size_t i = 0; i < _segments.size(); i++) {
+        const double x_min = std::min(_segments[i].p1.coords[X_], _segments[i].p2.coords[X_]);
+        const double x_max = std::max(_segments[i].p1.coords[X_], _segments[i].p2.coords[X_]);
+        const size_t first = std::lower_bound(cuts.begin(), cuts.end(), x_min) - cuts.begin();
+        const size_t last = std::upper_bound(cuts.begin(), cuts.end(), x_max) - cuts.begin();
+        for (size_t k = first; k <= last; k++)
+            members[k].push_back(static_cast<uint32_t>(i));
+    }
+
+    const double eps = mergeDistance(_segments);
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<std::vector<SegmentIntersection2d>> found(members.size());
+    {
+        TaskGroup group(pool);
+        for (size_t k = 0; k < members.size(); k++)
+            group.run([&, k] {
+                sweepStrip<Kernel>(_segments, members[k], k == 0 ? -inf : cuts[k - 1],
+                           k == cuts.size() ? inf : cuts[k], eps, found[k]);
+            });
+        group.wait();
+    }
+
+    const size_t start = _result.size();
+    for (auto& strip : found)
+        std::move(strip.begin(), strip.end(), std::back_inserter(_result));
+    std::stable_sort(_result.begin() + start, _result.end(),
+                     [](const SegmentIntersection2d& a, const SegmentIntersection2d& b) {
+                         return before(a.point.coords[X_], a.point.coords[Y_], b.point.coords[X_], b.point.coords[Y_]);
+                     });
+}
+
+template void rez::intersect_segments<FilteredKernel>(const std::vector<Segment2d>&, std::vector<SegmentIntersection2d>&);
+template void rez::intersect_segments<InexactKernel>(const std::vector<Segment2d>&, std::vector<SegmentIntersection2d>&);
+template void rez::intersect_segments_parallel<FilteredKernel>(const std::vector<Segment2d>&,
+                                                               std::vector<SegmentIntersection2d>&, unsigned);
+template void rez::intersect_segments_parallel<InexactKernel>(const std::vector<Segment2d>&,
+                                                              std::vector<SegmentIntersection2d>&, unsigned);
@@ -0,0 +1,41 @@
+#ifndef PHYSICSFORMULA_SEGMENTINTERSECTION_H
+#define PHYSICSFORMULA_SEGMENTINTERSECTION_H
+#include <cstdint>
+#include <vector>
+#include "Point.h"
+#include "Segment.h"
+#include "Kernel.h"
+
+namespace rez
+{
+    // A point where two or more of the input segments meet. segments holds the
+    // indices of every segment through the point in ascending order, each pair of
+    // them intersects here.
+    struct SegmentIntersection2d {
+        Point2d point;
+        std::vector<uint32_t> segments;
+    };
+
+    /**
+     * @brief all intersections in a set of segments by the Bentley-Ottmann plane
+     * sweep in O((n + k) log n) for k intersection points. The sweep runs top to
+     * bottom, ties left to right, like the monotone partition. Crossings, touching
+     * endpoints, T junctions and the ends of collinear overlaps are all reported.
+     * Orientation tests come from Kernel, exact with the default FilteredKernel,
+     * the intersection points themselves are computed in double precision.
+     * @param _result the intersections in sweep order, appended
+     */
+    template<class Kernel = FilteredKernel>
+    void intersect_segments(const std::vector<Segment2d>& _segments, std::vector<SegmentIntersection2d>& _result);
+
+    /**
+     * @brief same as intersect_segments, the plane is cut into vertical strips
+     * holding about the same number of segments. Every strip sweeps the segments
+     * clipped to it on its own thread and keeps the intersections it owns.
+     * @param _threads number of strips, 0 uses the size of the global pool
+     */
+    template<class Kernel = FilteredKernel>
+    void intersect_segments_parallel(const std::vector<Segment2d>& _segments,
+                                     std::vector<SegmentIntersection2d>& _result, unsigned _threads = 0);
+}
+#endif //PHYSICSFORMULA_SEGMENTINTERSECTION_H
@@ -0,0 +1,560 @@
+#ifndef PHYSICSFORMULA_SPARSEMATRIX_H
+#define PHYSICSFORMULA_SPARSEMATRIX_H
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "MatrixND.h"
+
+/**
+ * @brief compressed sparse row matrix and the solvers that work on it.
+ * Meant for the very sparse systems produced by circuit and mesh
+ * assembly, where a dense MatrixND would need O(n^2) memory.
+ *  - SparseMatrix<T>     : CSR storage built from (row, col, value) triplets,
+ *                          transpose() gives the CSC view of the same data
+ *  - SparseLU<T>         : row by row LU without pivoting on a reverse
+ *                          Cuthill-McKee ordering (diagonally dominant / SPD)
+ *  - conjugateGradient   : Jacobi preconditioned CG for SPD systems
+ *  - biCGSTAB            : Jacobi preconditioned BiCGSTAB for general systems
+ */
+namespace rez {
+    template<typename T>
+    struct Triplet {
+        int row;
+        int col;
+        T value;
+    };
+
+    template<typename T>
+    class SparseMatrix {
+        int rows_ = 0;
+        int cols_ = 0;
+        std::vector<int> rowStart;  // rows_ + 1 offsets into colIndex / values
+        std::vector<int> colIndex;
+        std::vector<T> values;
+    public:
+        SparseMatrix() : rowStart(1, 0) {}
+
+        // duplicate (row, col) entries are summed, as in finite element or
+        // circuit stamping
+        SparseMatrix(int r, int c, std::vector<Triplet<T>> triplets);
+
+        static SparseMatrix<T> fromDense(const MatrixND<T>& m, T dropTolerance = T(0));
+        static SparseMatrix<T> identity(int n);
+
+        [[nodiscard]] int getRows() const { return rows_; }
+        [[nodiscard]] int getCols() const { return cols_; }
+        [[nodiscard]] std::size_t nonZeros() const { return values.size(); }
+        [[nodiscard]] bool isSquare() const { return rows_ == cols_; }
+
+        // raw CSR arrays
+        [[nodiscard]] const std::vector<int>& rowPointers() const { return rowStart; }
+        [[nodiscard]] const std::vector<int>& columnIndices() const { return colIndex; }
+        [[nodiscard]] const std::vector<T>& nonZeroValues() const { return values; }
+
+        // value at (row, col), zero when the entry is not stored
+        [[nodiscard]] T get(int row, int col) const;
+        [[nodiscard]] std::vector<T> diagonal() const;
+
+        // y = A * x without allocating
+        void multiply(const std::vector<T>& x, std::vector<T>& y) const;
+        std::vector<T> operator*(const std::vector<T>& x) const;
+        SparseMatrix<T> operator*(const T& scalar) const;
+
+        [[nodiscard]] SparseMatrix<T> transpose() const;
+        [[nodiscard]] MatrixND<T> toDense() const;
+        void print() const;
+    };
+
+    // status returned by the iterative solvers
+    template<typename T>
+    struct IterativeResult {
+        int iterations = 0;
+        T residual = T(0);   // ||b - A x|| / ||b|| at exit
+        bool converged = false;
+    };
+
+    // bandwidth reducing ordering, perm[i] is the old index placed at i
+    template<typename T>
+    std::vector<int> reverseCuthillMcKee(const SparseMatrix<T>& A);
+
+    template<typename T>
+    class SparseLU {
+        int n = 0;
+        std::vector<int> perm;       // new index -> old index
+        std::vector<int> inversePerm;
+        // L strictly lower (unit diagonal) and U upper, both row-wise
+        std::vector<int> lStart, lCol, uStart, uCol;
+        std::vector<T> lVal, uVal;
+        bool singular = false;
+    public:
+        explicit SparseLU(const SparseMatrix<T>& A, bool reorder = true);
+
+        [[nodiscard]] bool isSingular() const { return singular; }
+        [[nodiscard]] std::size_t fillIn() const { return lVal.size() + uVal.size(); }
+        [[nodiscard]] std::vector<T> solve(const std::vector<T>& b) const;
+    };
+
+    template<typename T>
+    IterativeResult<T> conjugateGradient(const SparseMatrix<T>& A, const std::vector<T>& b,
+                                         std::vector<T>& x, T tolerance = T(1e-10),
+                                         int maxIterations = 0);
+
+    template<typename T>
+    IterativeResult<T> biCGSTAB(const SparseMatrix<T>& A, const std::vector<T>& b,
+                                std::vector<T>& x, T tolerance = T(1e-10),
+                                int maxIterations = 0);
+
+//*****************************************************************************
+// SparseMatrix
+//*****************************************************************************
+    template<typename T>
+    SparseMatrix<T>::SparseMatrix(int r, int c, std::vector<Triplet<T>> triplets)
+            : rows_(r), cols_(c) {
+        std::sort(triplets.begin(), triplets.end(),
+                  [](const Triplet<T>& a, const Triplet<T>& b) {
+                      return a.row != b.row ? a.row < b.row : a.col < b.col;
+                  });
+        rowStart.assign(r + 1, 0);
+        colIndex.reserve(triplets.size());
+        values.reserve(triplets.size());
+        for (std::size_t i = 0; i < triplets.size(); i++) {
+            const Triplet<T>& t = triplets[i];
+            assert(t.row >= 0 && t.row < r && t.col >= 0 && t.col < c);
+            if (!colIndex.empty() && i > 0 && triplets[i - 1].row == t.row
+                && colIndex.back() == t.col) {
+                values.back() += t.value;
+                continue;
+            }
+            colIndex.push_back(t.col);
+            values.push_back(t.value);
+            rowStart[t.row + 1]++;
+        }
+        for (int i = 0; i < r; i++)
+            rowStart[i + 1] += rowStart[i];
+    }
+
+    template<typename T>
+    SparseMatrix<T> SparseMatrix<T>::fromDense(const MatrixND<T>& m, T dropTolerance) {
+        std::vector<Triplet<T>> triplets;
+        for (int i = 0; i < m.rows; i++)
+            for (int j = 0; j < m.cols; j++) {
+                T v = m.data[i * m.cols + j];
+                if (std::abs(v) > dropTolerance)
+                    triplets.push_back({ i, j, v });
+            }
+        return SparseMatrix<T>(m.rows, m.cols, std::move(triplets));
+    }
+
+    template<typename T>
+    SparseMatrix<T> SparseMatrix<T>::identity(int n) {
+        std::vector<Triplet<T>> triplets(n);
+        for (int i = 0; i < n; i++)
+            triplets[i] = { i, i, T(1) };
+        return SparseMatrix<T>(n, n, std::move(triplets));
+    }
+
+    template<typename T>
+    T SparseMatrix<T>::get(int row, int col) const {
+        auto first = colIndex.begin() + rowStart[row];
+        auto last = colIndex.begin() + rowStart[row + 1];
+        auto it = std::lower_bound(first, last, col);
+        if (it == last || *it != col)
+            return T(0);
+        return values[it - colIndex.begin()];
+    }
+
+    template<typename T>
+    std::vector<T> SparseMatrix<T>::diagonal() const {
+        std::vector<T> d(std::min(rows_, cols_), T(0));
+        for (int i = 0; i < static_cast<int>(d.size()); i++)
+            d[i] = get(i, i);
+        return d;
+    }
+
+    template<typename T>
+    void SparseMatrix<T>::multiply(const std::vector<T>& x, std::vector<T>& y) const {
+        assert(static_cast<int>(x.size()) == cols_);
+        y.resize(rows_);
+        for (int i = 0; i < rows_; i++) {
+            T sum = T(0);
+            for (int k = rowStart[i]; k < rowStart[i + 1]; k++)
+                sum += values[k] * x[colIndex[k]];
+            y[i] = sum;
+        }
+    }
+
+    template<typename T>
+    std::vector<T> SparseMatrix<T>::operator*(const std::vector<T>& x) const {
+        std::vector<T> y;
+        multiply(x, y);
+        return y;
+    }
+
+    template<typename T>
+    SparseMatrix<T> SparseMatrix<T>::operator*(const T& scalar) const {
+        SparseMatrix<T> result = *this;
+        for (auto& v : result.values)
+            v *= scalar;
+        return result;
+    }
+
+    template<typename T>
+    SparseMatrix<T> SparseMatrix<T>::transpose() const {
+        SparseMatrix<T> t;
+        t.rows_ = cols_;
+        t.cols_ = rows_;
+        t.rowStart.assign(cols_ + 1, 0);
+        t.colIndex.resize(values.size());
+        t.values.resize(values.size());
+        for (int c : colIndex)
+            t.rowStart[c + 1]++;
+        for (int i = 0; i < cols_; i++)
+            t.rowStart[i + 1] += t.rowStart[i];
+        std::vector<int> next(t.rowStart.begin(), t.rowStart.end() - 1);
+        for (int i = 0; i < rows_; i++)
+            for (int k = rowStart[i]; k < rowStart[i + 1]; k++) {
+                const int dst = next[colIndex[k]]++;
+                t.colIndex[dst] = i;
+                t.values[dst] = values[k];
+            }
+        return t;
+    }
+
+    template<typename T>
+    MatrixND<T> SparseMatrix<T>::toDense() const {
+        MatrixND<T> m(rows_, cols_);
+        for (int i = 0; i < rows_; i++)
+            for (int k = rowStart[i]; k < rowStart[i + 1]; k++)
+                m.data[i * cols_ + colIndex[k]] = values[k];
+        return m;
+    }
+
+    template<typename T>
+    void SparseMatrix<T>::print() const {
+        std::cout << std::endl << rows_ << " x " << cols_ << " sparse, "
+                  << values.size() << " non zeros" << std::endl;
+        for (int i = 0; i < rows_; i++)
+            for (int k = rowStart[i]; k < rowStart[i + 1]; k++)
+                std::cout << "(" << i << ", " << colIndex[k] << ") "
+                          << std::setprecision(6) << values[k] << std::endl;
+    }
+
+//*****************************************************************************
+// ordering and direct solve
+//*****************************************************************************
+    template<typename T>
+    std::vector<int> reverseCuthillMcKee(const SparseMatrix<T>& A) {
+        const int n = A.getRows();
+        const auto& start = A.rowPointers();
+        const auto& cols = A.columnIndices();
+        std::vector<int> degree(n);
+        for (int i = 0; i < n; i++)
+            degree[i] = start[i + 1] - start[i];
+
+        std::vector<int> order;
+        order.reserve(n);
+        std::vector<char> visited(n, 0);
+        std::vector<int> neighbours;
+        for (int seed = 0; seed < n; seed++) {
+            // start every connected component from a minimum degree node
+            if (visited[seed])
+                continue;
+            int root = seed;
+            for (int i = seed; i < n; i++)
+                if (!visited[i] && degree[i] < degree[root])
+                    root = i;
+            std::size_t head = order.size();
+            order.push_back(root);
+            visited[root] = 1;
+            while (head < order.size()) {
+                const int v = order[head++];
+                neighbours.clear();
+                for (int k = start[v]; k < start[v + 1]; k++)
+                    if (!visited[cols[k]]) {
+                        visited[cols[k]] = 1;
+                        neighbours.push_back(cols[k]);
+                    }
+                std::sort(neighbours.begin(), neighbours.end(),
+                          [&](int a, int b) { return degree[a] < degree[b]; });
+                order.insert(order.end(), neighbours.begin(), neighbours.end());
+            }
+            if (root != seed)
+                seed--;  // seed itself may still be unvisited
+        }
+        std::reverse(order.begin(), order.end());
+        return order;
+    }
+
+    template<typename T>
+    SparseLU<T>::SparseLU(const SparseMatrix<T>& A, bool reorder) {
+        assert(A.isSquare());
+        n = A.getRows();
+        if (reorder)
+            perm = reverseCuthillMcKee(A);
+        else {
+            perm.resize(n);
+            for (int i = 0; i < n; i++)
+                perm[i] = i;
+        }
+        inversePerm.resize(n);
+        for (int i = 0; i < n; i++)
+            inversePerm[perm[i]] = i;
+
+        const auto& start = A.rowPointers();
+        const auto& cols = A.columnIndices();
+        const auto& vals = A.nonZeroValues();
+        lStart.assign(1, 0);
+        uStart.assign(1, 0);
+        std::vector<int> uDiag(n);  // position of U(i,i) in uVal
+
+        // dense work row plus the list of its occupied columns
+        std::vector<T> work(n, T(0));
+        std::vector<char> occupied(n, 0);
+        std::vector<int> pattern;
+        std::priority_queue<int, std::vector<int>, std::greater<>> pending;
+
+        for (int i = 0; i < n; i++) {
+            const int old = perm[i];
+            pattern.clear();
+            for (int k = start[old]; k < start[old + 1]; k++) {
+                const int j = inversePerm[cols[k]];
+                work[j] = vals[k];
+                if (!occupied[j]) {
+                    occupied[j] = 1;
+                    pattern.push_back(j);
+                    if (j < i)
+                        pending.push(j);
+                }
+            }
+            // eliminate with the finished rows k < i in increasing order,
+            // fill entries below i join the queue as they appear
+            while (!pending.empty()) {
+                const int k = pending.top();
+                pending.pop();
+                const T f = work[k] / uVal[uDiag[k]];
+                work[k] = f;
+                if (f == T(0))
+                    continue;
+                for (int p = uDiag[k] + 1; p < uStart[k + 1]; p++) {
+                    const int j = uCol[p];
+                    if (!occupied[j]) {
+                        occupied[j] = 1;
+                        pattern.push_back(j);
+                        if (j < i)
+                            pending.push(j);
+                    }
+                    work[j] -= f * uVal[p];
+                }
+            }
+            std::sort(pattern.begin(), pattern.end());
+            bool diagonalSeen = false;
+            for (int j : pattern) {
+                if (j < i) {
+                    lCol.push_back(j);
+                    lVal.push_back(work[j]);
+                } else {
+                    if (j == i) {
+                        diagonalSeen = true;
+                        uDiag[i] = static_cast<int>(uVal.size());
+                    } else if (!diagonalSeen) {
+                        // keep the diagonal first in the U row
+                        diagonalSeen = true;
+                        uDiag[i] = static_cast<int>(uVal.size());
+                        uCol.push_back(i);
+                        uVal.push_back(T(0));
+                    }
+                    uCol.push_back(j);
+                    uVal.push_back(work[j]);
+                }
+                work[j] = T(0);
+                occupied[j] = 0;
+            }
+            if (!diagonalSeen) {
+                uDiag[i] = static_cast<int>(uVal.size());
+                uCol.push_back(i);
+                uVal.push_back(T(0));
+            }
+            if (uVal[uDiag[i]] == T(0)) {
+                singular = true;
+                uVal[uDiag[i]] = std::numeric_limits<T>::min();
+            }
+            lStart.push_back(static_cast<int>(lVal.size()));
+            uStart.push_back(static_cast<int>(uVal.size()));
+        }
+    }
+
+    template<typename T>
+    std::vector<T> SparseLU<T>::solve(const std::vector<T>& b) const {
+        assert(static_cast<int>(b.size()) == n);
+        std::vector<T> y(n);
+        for (int i = 0; i < n; i++) {
+            T sum = b[perm[i]];
+            for (int p = lStart[i]; p < lStart[i + 1]; p++)
+                sum -= lVal[p] * y[lCol[p]];
+            y[i] = sum;
+        }
+        for (int i = n - 1; i >= 0; i--) {
+            // the diagonal is the first entry of every U row
+            T sum = y[i];
+            for (int p = uStart[i] + 1; p < uStart[i + 1]; p++)
+                sum -= uVal[p] * y[uCol[p]];
+            y[i] = sum / uVal[uStart[i]];
+        }
+        std::vector<T> x(n);
+        for (int i = 0; i < n; i++)
+            x[perm[i]] = y[i];
+        return x;
+    }
+
+//*****************************************************************************
+// iterative solvers
+//*****************************************************************************
+    namespace sparse_detail {
+        template<typename T>
+        T dot(const std::vector<T>& a, const std::vector<T>& b) {
+            T sum = T(0);
+            for (std::size_t i = 0; i < a.size(); i++)
+                sum += a[i] * b[i];
+            return sum;
+        }
+
+        // inverse of the diagonal, zero diagonals are left unscaled
+        template<typename T>
+        std::vector<T> jacobi(const SparseMatrix<T>& A) {
+            std::vector<T> d = A.diagonal();
+            for (auto& v : d)
+                v = (v != T(0)) ? T(1) / v : T(1);
+            return d;
+        }
+    }
+
+    template<typename T>
+    IterativeResult<T> conjugateGradient(const SparseMatrix<T>& A, const std::vector<T>& b,
+                                         std::vector<T>& x, T tolerance, int maxIterations) {
+        using sparse_detail::dot;
+        const int n = A.getRows();
+        if (maxIterations <= 0)
+            maxIterations = 10 * n;
+        x.resize(n, T(0));
+        const std::vector<T> minv = sparse_detail::jacobi(A);
+
+        std::vector<T> r(n), z(n), p(n), q(n);
+        A.multiply(x, q);
+        for (int i = 0; i < n; i++)
+            r[i] = b[i] - q[i];
+        T bNorm = std::sqrt(dot(b, b));
+        if (bNorm == T(0))
+            bNorm = T(1);
+
+        IterativeResult<T> result;
+        result.residual = std::sqrt(dot(r, r)) / bNorm;
+        if (result.residual <= tolerance) {
+            result.converged = true;
+            return result;
+        }
+        for (int i = 0; i < n; i++)
+            p[i] = z[i] = minv[i] * r[i];
+        T rz = dot(r, z);
+
+        for (int it = 1; it <= maxIterations; it++) {
+            A.multiply(p, q);
+            const T alpha = rz / dot(p, q);
+            for (int i = 0; i < n; i++) {
+                x[i] += alpha * p[i];
+                r[i] -= alpha * q[i];
+            }
+            result.iterations = it;
+            result.residual = std::sqrt(dot(r, r)) / bNorm;
+            if (result.residual <= tolerance) {
+                result.converged = true;
+                break;
+            }
+            for (int i = 0; i < n; i++)
+                z[i] = minv[i] * r[i];
+            const T rzNext = dot(r, z);
+            const T beta = rzNext / rz;
+            rz = rzNext;
+            for (int i = 0; i < n; i++)
+                p[i] = z[i] + beta * p[i];
+        }
+        return result;
+    }
+
+    template<typename T>
+    IterativeResult<T> biCGSTAB(const SparseMatrix<T>& A, const std::vector<T>& b,
+                                std::vector<T>& x, T tolerance, int maxIterations) {
+        using sparse_detail::dot;
+        const int n = A.getRows();
+        if (maxIterations <= 0)
+            maxIterations = 10 * n;
+        x.resize(n, T(0));
+        const std::vector<T> minv = sparse_detail::jacobi(A);
+
+        std::vector<T> r(n), rHat(n), p(n, T(0)), v(n, T(0)), s(n), t(n), y(n), z(n);
+        A.multiply(x, v);
+        for (int i = 0; i < n; i++)
+            r[i] = b[i] - v[i];
+        rHat = r;
+        std::fill(v.begin(), v.end(), T(0));
+        T bNorm = std::sqrt(dot(b, b));
+        if (bNorm == T(0))
+            bNorm = T(1);
+
+        IterativeResult<T> result;
+        result.residual = std::sqrt(dot(r, r)) / bNorm;
+        if (result.residual <= tolerance) {
+            result.converged = true;
+            return result;
+        }
+        T rho = T(1), alpha = T(1), omega = T(1);
+        for (int it = 1; it <= maxIterations; it++) {
+            const T rhoNext = dot(rHat, r);
+            if (rhoNext == T(0))
+                break;  // breakdown, rHat orthogonal to r
+            const T beta = (rhoNext / rho) * (alpha / omega);
+            rho = rhoNext;
+            for (int i = 0; i < n; i++)
+                p[i] = r[i] + beta * (p[i] - omega * v[i]);
+            for (int i = 0; i < n; i++)
+                y[i] = minv[i] * p[i];
+            A.multiply(y, v);
+            alpha = rho / dot(rHat, v);
+            for (int i = 0; i < n; i++)
+                s[i] = r[i] - alpha * v[i];
+            result.iterations = it;
+            if (std::sqrt(dot(s, s)) / bNorm <= tolerance) {
+                for (int i = 0; i < n; i++)
+                    x[i] += alpha * y[i];
+                result.residual = std::sqrt(dot(s, s)) / bNorm;
+                result.converged = true;
+                break;
+            }
+            for (int i = 0; i < n; i++)
+                z[i] = minv[i] * s[i];
+            A.multiply(z, t);
+            const T tt = dot(t, t);
+            omega = tt != T(0) ? dot(t, s) / tt : T(0);
+            for (int i = 0; i < n; i++) {
+                x[i] += alpha * y[i] + omega * z[i];
+                r[i] = s[i] - omega * t[i];
+            }
+            result.residual = std::sqrt(dot(r, r)) / bNorm;
+            if (result.residual <= tolerance) {
+                result.converged = true;
+                break;
+            }
+            if (omega == T(0))
+                break;
+        }
+        return result;
+    }
+} // namespace rez
+
+#endif //PHYSICSFORMULA_SPARSEMATRIX_H
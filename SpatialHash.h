@@ -0,0 +1,326 @@
+#ifndef PHYSICSFORMULA_SPATIALHASH_H
+#define PHYSICSFORMULA_SPATIALHASH_H
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "Vector.h"
+#include "ThreadPool.h"
+
+/**
+ * @brief uniform grid (cell list) over rez::Vector<coordinate_type, dim>
+ * points for fixed radius neighbour search.
+ * Space is cut into cubic cells of a given edge length and the cells are
+ * hashed into a power of two number of buckets, about one per point, so the
+ * memory follows the number of points and not the extent of the data. The
+ * points are counting sorted by bucket into one contiguous array, each slot
+ * keeps the packed coordinates of its cell so points of other cells sharing
+ * a bucket are skipped without a distance test.
+ *
+ * A search with radius r visits the cells overlapping the box of half width
+ * r around the query, 3^dim of them when r does not exceed the cell size.
+ * update() moves the points between time steps, only when some point left
+ * its cell are the slots sorted again, starting from the previous order.
+ */
+namespace rez {
+    template<typename coordinate_type, size_t dim = DIM2>
+    class SpatialHash {
+    public:
+        using point_type = Vector<coordinate_type, dim>;
+        using distance_type = std::conditional_t<std::is_floating_point_v<coordinate_type>,
+                                                 coordinate_type, double>;
+
+        // below this many points the passes run on the calling thread
+        static constexpr size_t PARALLEL_MIN = size_t(1) << 16;
+
+    private:
+        // cell coordinates are packed into 64 bits, wrapping beyond this range
+        static constexpr unsigned AXIS_BITS = unsigned(64 / dim);
+        static constexpr uint64_t AXIS_MASK = AXIS_BITS >= 64 ? ~uint64_t(0) : (uint64_t(1) << AXIS_BITS) - 1;
+
+        distance_type cell = 1;
+        distance_type inverse = 1;
+        unsigned shift = 63;                // 64 - log2 of the bucket count
+        std::vector<uint32_t> start;        // first slot of every bucket, one past the last at the end
+        std::vector<point_type> points;     // slot order
+        std::vector<uint32_t> ids;          // input index of every slot
+        std::vector<uint64_t> keys;         // packed cell of every slot
+        unsigned threads = 0;
+
+        int64_t cellCoordinate(distance_type x) const {
+            return static_cast<int64_t>(std::floor(x * inverse));
+        }
+
+        static uint64_t pack(const int64_t* c) {
+            uint64_t key = 0;
+            for (size_t a = 0; a < dim; a++)
+                key |= (uint64_t(c[a]) & AXIS_MASK) << (a * AXIS_BITS);
+            return key;
+        }
+
+        uint64_t keyOf(const point_type& p) const {
+            int64_t c[dim];
+            for (size_t a = 0; a < dim; a++)
+                c[a] = cellCoordinate(distance_type(p.coords[a]));
+            return pack(c);
+        }
+
+        size_t bucketOf(uint64_t key) const {
+            return size_t((key * 0x9E3779B97F4A7C15ull) >> shift);
+        }
+
+        template<typename Body>
+        void parallelFor(size_t count, Body body) const;
+
+        void layout();
+
+        template<typename Visit>
+        void visitCells(const point_type& q, distance_type r, Visit visit) const;
+
+    public:
+        SpatialHash() = default;
+
+        /**
+         * @param cellSize edge length of a cell, best about the search radius
+         * @param threadCount 1 runs on the calling thread, 0 uses the global pool
+         */
+        SpatialHash(const std::vector<point_type>& input, distance_type cellSize, unsigned threadCount = 0) {
+            build(input, cellSize, threadCount);
+        }
+
+        void build(const std::vector<point_type>& input, distance_type cellSize, unsigned threadCount = 0);
+
+        // New positions of the same points in the same order as given to build
+        void update(const std::vector<point_type>& input);
+
+        [[nodiscard]] size_t size() const { return points.size(); }
+        [[nodiscard]] bool empty() const { return points.empty(); }
+        [[nodiscard]] distance_type cellSize() const { return cell; }
+        [[nodiscard]] size_t bucketCount() const { return start.empty() ? 0 : start.size() - 1; }
+
+        // the points in slot order, points of a cell are next to each other
+        [[nodiscard]] const std::vector<point_type>& data() const { return points; }
+        [[nodiscard]] const std::vector<uint32_t>& indices() const { return ids; }
+
+        // calls f(index, squaredDistance) for every point with |p - q| <= r
+        template<typename F>
+        void forEachNeighbour(const point_type& q, distance_type r, F f) const;
+
+        // input indices of the points with |p - q| <= r, unordered
+        std::vector<uint32_t> radiusSearch(const point_type& q, distance_type r) const;
+
+        /**
+         * @brief calls f(i, j, squaredDistance) for every ordered pair of
+         * points i != j with |p_i - p_j| <= r, so every pair is seen from both
+         * sides. The calls for one i all come from the same thread, f may
+         * accumulate into the data of i without locking.
+         */
+        template<typename F>
+        void forEachPair(distance_type r, F f) const;
+    };
+
+//*****************************************************************************
+// construction
+//*****************************************************************************
+    template<typename coordinate_type, size_t dim>
+    template<typename Body>
+    void SpatialHash<coordinate_type, dim>::parallelFor(size_t count, Body body) const {
+        ThreadPool& pool = ThreadPool::global();
+        const size_t tasks = std::min<size_t>(threads ? threads : pool.size(), count / (PARALLEL_MIN / 4) + 1);
+        if (tasks <= 1 || count < PARALLEL_MIN) {
+            body(size_t(0), count);
+            return;
+        }
+        // a few chunks per task evens out the load of uneven cells
+        const size_t chunks = 4 * tasks;
+        std::atomic<size_t> next{ 0 };
+        TaskGroup group(pool);
+        for (size_t t = 0; t < tasks; t++)
+            group.run([&] {
+                for (size_t c = next++; c < chunks; c = next++)
+                    body(count * c / chunks, count * (c + 1) / chunks);
+            });
+        group.wait();
+    }
+
+    template<typename coordinate_type, size_t dim>
+    void SpatialHash<coordinate_type, dim>::build(const std::vector<point_type>& input,
+                                                  distance_type cellSize, unsigned threadCount) {
+        cell = cellSize > 0 ? cellSize : distance_type(1);
+        inverse = distance_type(1) / cell;
+        threads = threadCount;
+        const size_t n = input.size();
+        unsigned bits = 1;
+        while (bits < 31 && (size_t(1) << bits) < n)
+            bits++;
+        shift = 64 - bits;
+
+        points = input;
+        ids.resize(n);
+        keys.resize(n);
+        parallelFor(n, [&](size_t first, size_t last) {
+            for (size_t s = first; s < last; s++) {
+                ids[s] = static_cast<uint32_t>(s);
+                keys[s] = keyOf(points[s]);
+            }
+        });
+        layout();
+    }
+
+    template<typename coordinate_type, size_t dim>
+    void SpatialHash<coordinate_type, dim>::update(const std::vector<point_type>& input) {
+        std::atomic<bool> moved{ false };
+        parallelFor(points.size(), [&](size_t first, size_t last) {
+            bool any = false;
+            for (size_t s = first; s < last; s++) {
+                points[s] = input[ids[s]];
+                const uint64_t key = keyOf(points[s]);
+                any |= key != keys[s];
+                keys[s] = key;
+            }
+            if (any)
+                moved = true;
+        });
+        if (moved)
+            layout();
+    }
+
+    // Counting sort of the slots by bucket. Counts and cursors are bumped
+    // atomically, then every bucket is put back into the previous slot order, so
+    // the result is the same as a sequential stable sort and points that stay in
+    // their cell keep their neighbours in memory.
+    template<typename coordinate_type, size_t dim>
+    void SpatialHash<coordinate_type, dim>::layout() {
+        const size_t n = points.size();
+        const size_t buckets = size_t(1) << (64 - shift);
+        start.assign(buckets + 1, 0);
+        std::vector<uint32_t> bucket(n);
+        parallelFor(n, [&](size_t first, size_t last) {
+            for (size_t s = first; s < last; s++) {
+                bucket[s] = static_cast<uint32_t>(bucketOf(keys[s]));
+                std::atomic_ref<uint32_t>(start[bucket[s] + 1]).fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        for (size_t b = 0; b < buckets; b++)
+            start[b + 1] += start[b];
+
+        std::vector<uint32_t> cursor(start.begin(), start.end() - 1);
+        std::vector<uint32_t> order(n);
+        parallelFor(n, [&](size_t first, size_t last) {
+            for (size_t s = first; s < last; s++)
+                order[std::atomic_ref<uint32_t>(cursor[bucket[s]]).fetch_add(1, std::memory_order_relaxed)] =
+                        static_cast<uint32_t>(s);
+        });
+        parallelFor(buckets, [&](size_t first, size_t last) {
+            for (size_t b = first; b < last; b++)
+                if (start[b + 1] - start[b] > 1)
+                    std::sort(order.begin() + start[b], order.begin() + start[b + 1]);
+        });
+
+        std::vector<point_type> sortedPoints(n);
+        std::vector<uint32_t> sortedIds(n);
+        std::vector<uint64_t> sortedKeys(n);
+        parallelFor(n, [&](size_t first, size_t last) {
+            for (size_t s = first; s < last; s++) {
+                sortedPoints[s] = points[order[s]];
+                sortedIds[s] = ids[order[s]];
+                sortedKeys[s] = keys[order[s]];
+            }
+        });
+        points.swap(sortedPoints);
+        ids.swap(sortedIds);
+        keys.swap(sortedKeys);
+    }
+
+//*****************************************************************************
+// queries
+//*****************************************************************************
+    // Calls visit(first, last, key) with the slot range of the bucket of every
+    // cell overlapping the box around q, or once with every slot and no key
+    // filter when the box spans more cells than the packing can tell apart.
+    template<typename coordinate_type, size_t dim>
+    template<typename Visit>
+    void SpatialHash<coordinate_type, dim>::visitCells(const point_type& q, distance_type r, Visit visit) const {
+        int64_t lo[dim], hi[dim];
+        size_t cells = 1;
+        for (size_t a = 0; a < dim; a++) {
+            lo[a] = cellCoordinate(distance_type(q.coords[a]) - r);
+            hi[a] = cellCoordinate(distance_type(q.coords[a]) + r);
+            const uint64_t span = uint64_t(hi[a] - lo[a]) + 1;
+            if (span > AXIS_MASK || span > points.size()) {
+                cells = points.size() + 1;
+                break;
+            }
+            cells *= size_t(span);
+            if (cells > points.size())
+                break;
+        }
+        if (cells > points.size()) {
+            visit(uint32_t(0), uint32_t(points.size()), uint64_t(0), false);
+            return;
+        }
+
+        int64_t c[dim];
+        std::copy(lo, lo + dim, c);
+        while (true) {
+            const uint64_t key = pack(c);
+            const size_t b = bucketOf(key);
+            visit(start[b], start[b + 1], key, true);
+            size_t a = 0;
+            while (a < dim && c[a] == hi[a]) {
+                c[a] = lo[a];
+                a++;
+            }
+            if (a == dim)
+                return;
+            c[a]++;
+        }
+    }
+
+    template<typename coordinate_type, size_t dim>
+    template<typename F>
+    void SpatialHash<coordinate_type, dim>::forEachNeighbour(const point_type& q, distance_type r, F f) const {
+        if (points.empty() || r < 0)
+            return;
+        const distance_type r2 = r * r;
+        visitCells(q, r, [&](uint32_t first, uint32_t last, uint64_t key, bool filter) {
+            for (uint32_t s = first; s < last; s++) {
+                if (filter && keys[s] != key)
+                    continue;
+                distance_type d = 0;
+                for (size_t a = 0; a < dim; a++) {
+                    const distance_type t = distance_type(points[s].coords[a]) - distance_type(q.coords[a]);
+                    d += t * t;
+                }
+                if (d <= r2)
+                    f(ids[s], d);
+            }
+        });
+    }
+
+    template<typename coordinate_type, size_t dim>
+    std::vector<uint32_t> SpatialHash<coordinate_type, dim>::radiusSearch(const point_type& q,
+                                                                         distance_type r) const {
+        std::vector<uint32_t> out;
+        forEachNeighbour(q, r, [&](uint32_t index, distance_type) { out.push_back(index); });
+        return out;
+    }
+
+    template<typename coordinate_type, size_t dim>
+    template<typename F>
+    void SpatialHash<coordinate_type, dim>::forEachPair(distance_type r, F f) const {
+        parallelFor(points.size(), [&](size_t first, size_t last) {
+            for (size_t s = first; s < last; s++) {
+                const uint32_t i = ids[s];
+                forEachNeighbour(points[s], r, [&](uint32_t j, distance_type d) {
+                    if (j != i)
+                        f(i, j, d);
+                });
+            }
+        });
+    }
+} // namespace rez
+#endif //PHYSICSFORMULA_SPATIALHASH_H
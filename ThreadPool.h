@@ -0,0 +1,170 @@
+#ifndef PHYSICSFORMULA_THREADPOOL_H
+#define PHYSICSFORMULA_THREADPOOL_H
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief small work stealing thread pool for recursive, divide and conquer
+ * style algorithms. Every worker owns a deque: tasks submitted from a worker
+ * go to the back of its own deque and are popped LIFO (depth first, cache
+ * warm), idle workers steal from the front of the others (the oldest and
+ * usually largest pieces of work).
+ *
+ * TaskGroup tracks a set of tasks, wait() runs pending tasks on the calling
+ * thread instead of blocking, so tasks may spawn and wait on nested groups
+ * without starving the pool.
+ */
+namespace rez {
+    class ThreadPool {
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> pending{ 0 };
+        std::atomic<unsigned> nextQueue{ 0 };
+        bool stopping = false;
+        std::mutex sleepMutex;
+        std::condition_variable wake;
+
+        // which pool and queue the current thread works for
+        static inline thread_local const ThreadPool* currentPool = nullptr;
+        static inline thread_local unsigned currentQueue = 0;
+
+        bool popTask(unsigned home, std::function<void()>& task) {
+            {
+                WorkQueue& own = *queues[home];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (!own.tasks.empty()) {
+                    task = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                    return true;
+                }
+            }
+            for (size_t i = 1; i < queues.size(); i++) {
+                WorkQueue& victim = *queues[(home + i) % queues.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty()) {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void workerLoop(unsigned index) {
+            currentPool = this;
+            currentQueue = index;
+            std::function<void()> task;
+            while (true) {
+                if (popTask(index, task)) {
+                    pending--;
+                    task();
+                    task = nullptr;
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                wake.wait(lock, [this] { return stopping || pending > 0; });
+                if (stopping && pending == 0)
+                    return;
+            }
+        }
+
+    public:
+        // threads == 0 uses one worker per hardware thread
+        explicit ThreadPool(unsigned threads = 0) {
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            for (unsigned i = 0; i < threads; i++)
+                queues.push_back(std::make_unique<WorkQueue>());
+            for (unsigned i = 0; i < threads; i++)
+                workers.emplace_back([this, i] { workerLoop(i); });
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& w : workers)
+                w.join();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // process wide pool sized to the machine
+        static ThreadPool& global() {
+            static ThreadPool pool;
+            return pool;
+        }
+
+        [[nodiscard]] unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+        void submit(std::function<void()> task) {
+            const unsigned index = currentPool == this
+                                   ? currentQueue
+                                   : nextQueue++ % static_cast<unsigned>(queues.size());
+            // counted before it is queued, so the worker that pops it can
+            // never take pending below zero
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                pending++;
+            }
+            {
+                std::lock_guard<std::mutex> lock(queues[index]->mutex);
+                queues[index]->tasks.push_back(std::move(task));
+            }
+            wake.notify_one();
+        }
+
+        // run one queued task on the calling thread, false when there was none
+        bool runPendingTask() {
+            std::function<void()> task;
+            const unsigned home = currentPool == this ? currentQueue : 0;
+            if (!popTask(home, task))
+                return false;
+            pending--;
+            task();
+            return true;
+        }
+    };
+
+    class TaskGroup {
+        ThreadPool& pool;
+        std::atomic<size_t> outstanding{ 0 };
+    public:
+        explicit TaskGroup(ThreadPool& _pool = ThreadPool::global()) : pool(_pool) {}
+
+        ~TaskGroup() { wait(); }
+
+        template<typename F>
+        void run(F&& f) {
+            outstanding++;
+            pool.submit([this, task = std::forward<F>(f)]() mutable {
+                task();
+                outstanding--;
+            });
+        }
+
+        // helps with queued work until every task of the group finished
+        void wait() {
+            while (outstanding > 0)
+                if (!pool.runPendingTask())
+                    std::this_thread::yield();
+        }
+    };
+} // namespace rez
+
+#endif //PHYSICSFORMULA_THREADPOOL_H
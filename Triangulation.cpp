@@ -5,7 +5,9 @@
 #include <algorithm>
 #include <stack>
 #include <map>
+#include <set>
 #include "GeoUtils.h"
+#include "Kernel.h"
 
 using namespace rez;
 
@@ -122,53 +124,617 @@ void rez::triangulate_monotone(Polygon2d* poly)
     triangulate(poly, vertices);
 }
 
-static void initialize_ear_status(Polygon2dSimple* polygon)
-{
-    Vertex2dSimple* v0, * v1, * v2;
+//*****************************************************************************
+// Index based triangulation
+//*****************************************************************************
 
-    auto vertices = polygon->getVertcies();
-    v1 = vertices[0];
-    do {
-        v0 = v1->prev;
-        v2 = v1->next;
-        v1->is_ear = isDiagonal(v0, v2);
-        v1 = v1->next;
-    } while (v1 != vertices[0]);
-}
+// polygons up to this size go to the ear clipper in triangulate_polygon
+static const size_t EARCLIP_MAX_VERTICES = 128;
+
+// below this size the ear test scans the ring instead of the z-order list
+static const size_t EARCLIP_ZORDER_MIN_VERTICES = 64;
+
+namespace {
+    // Vertex ring of a polygon prepared for triangulation. Consecutive repeats are
+    // dropped and the ring is counter clockwise, positions map back to the input.
+    template<class Kernel>
+    struct PolygonRing {
+        std::vector<uint32_t> index;
+        std::vector<double> x, y;
+
+        uint32_t size() const { return static_cast<uint32_t>(index.size()); }
+
+        int orient(uint32_t a, uint32_t b, uint32_t c) const
+        {
+            return Kernel::orientation2d(x[a], y[a], x[b], y[b], x[c], y[c]);
+        }
+
+        bool build(const std::vector<Point2d>& _polygon)
+        {
+            for (size_t i = 0; i < _polygon.size(); i++) {
+                const double px = _polygon[i].coords[X_], py = _polygon[i].coords[Y_];
+                if (!x.empty() && x.back() == px && y.back() == py)
+                    continue;
+                index.push_back(static_cast<uint32_t>(i));
+                x.push_back(px);
+                y.push_back(py);
+            }
+            while (index.size() > 1 && x.back() == x.front() && y.back() == y.front()) {
+                index.pop_back();
+                x.pop_back();
+                y.pop_back();
+            }
+            if (index.size() < 3)
+                return false;
+
+            double area = 0;
+            for (size_t i = 1; i + 1 < index.size(); i++)
+                area += (x[i] - x[0]) * (y[i + 1] - y[0]) - (x[i + 1] - x[0]) * (y[i] - y[0]);
+            if (area == 0)
+                return false;
+            if (area < 0) {
+                std::reverse(index.begin(), index.end());
+                std::reverse(x.begin(), x.end());
+                std::reverse(y.begin(), y.end());
+            }
+            return true;
+        }
+    };
 
-void rez::triangulate_earclipping(Polygon2dSimple* poly, std::vector<Edge2dSimple>& edge_list) {
+    // Ear clipping on a linked ring. For larger polygons the vertices are also
+    // linked in z-order, so the points that may lie in a candidate ear are found by
+    // walking the z-order list over the Morton range of the ear's bounding box.
+    template<class Kernel>
+    class EarClipper {
+        static const uint32_t NONE = 0xFFFFFFFFu;
 
-    initialize_ear_status(poly);
+        struct Node {
+            uint32_t prev, next;        // polygon ring
+            uint32_t prev_z, next_z;    // z-order list
+            uint32_t z;
+        };
 
-    auto vertex_list = poly->getVertcies();
-    int no_vertex_to_process = (int)vertex_list.size();
+        const PolygonRing<Kernel>& ring;
+        std::vector<Node> nodes;
+        bool hashed = false;
+        double min_x = 0, min_y = 0, inv_size = 0;
 
-    Vertex2dSimple* v0, * v1, * v2, * v3, * v4;
-    int index = 0;
+        uint32_t zOrder(double _x, double _y) const
+        {
+            auto spread = [](uint32_t v) {
+                v = (v | (v << 8)) & 0x00FF00FFu;
+                v = (v | (v << 4)) & 0x0F0F0F0Fu;
+                v = (v | (v << 2)) & 0x33333333u;
+                v = (v | (v << 1)) & 0x55555555u;
+                return v;
+            };
+            return spread(static_cast<uint32_t>((_x - min_x) * inv_size))
+                   | (spread(static_cast<uint32_t>((_y - min_y) * inv_size)) << 1);
+        }
 
-    while (no_vertex_to_process > 3) {
-        for (auto & i : vertex_list)
+        void buildZOrder()
         {
-            v2 = i;
-            if (v2->is_ear && !v2->is_processed) {
-                v3 = v2->next;
-                v4 = v3->next;
-                v1 = v2->prev;
-                v0 = v1->prev;
+            const uint32_t n = ring.size();
+            double max_x = ring.x[0], max_y = ring.y[0];
+            min_x = ring.x[0];
+            min_y = ring.y[0];
+            for (uint32_t i = 1; i < n; i++) {
+                min_x = std::min(min_x, ring.x[i]);
+                min_y = std::min(min_y, ring.y[i]);
+                max_x = std::max(max_x, ring.x[i]);
+                max_y = std::max(max_y, ring.y[i]);
+            }
+            const double size = std::max(max_x - min_x, max_y - min_y);
+            inv_size = size > 0 ? 32767.0 / size : 0.0;
 
-                edge_list.emplace_back(v1->point, v3->point);
-                v2->is_processed = true;
+            std::vector<uint32_t> order(n);
+            for (uint32_t i = 0; i < n; i++) {
+                nodes[i].z = zOrder(ring.x[i], ring.y[i]);
+                order[i] = i;
+            }
+            std::sort(order.begin(), order.end(),
+                      [this](uint32_t a, uint32_t b) { return nodes[a].z < nodes[b].z; });
+            for (uint32_t i = 0; i < n; i++) {
+                nodes[order[i]].prev_z = i == 0 ? NONE : order[i - 1];
+                nodes[order[i]].next_z = i + 1 == n ? NONE : order[i + 1];
+            }
+            hashed = true;
+        }
 
-                v1->next = v3;
-                v3->prev = v1;
+        // _p keeps [a b c] from being an ear: a reflex or flat vertex inside or on the
+        // triangle. If any vertex lies in an ear, a reflex one does.
+        bool blocks(uint32_t a, uint32_t b, uint32_t c, uint32_t _p) const
+        {
+            const double px = ring.x[_p], py = ring.y[_p];
+            if (px < std::min(ring.x[a], std::min(ring.x[b], ring.x[c]))
+                || px > std::max(ring.x[a], std::max(ring.x[b], ring.x[c]))
+                || py < std::min(ring.y[a], std::min(ring.y[b], ring.y[c]))
+                || py > std::max(ring.y[a], std::max(ring.y[b], ring.y[c])))
+                return false;
+            for (uint32_t corner : { a, b, c })
+                if (ring.x[corner] == px && ring.y[corner] == py)
+                    return false;
+            return ring.orient(a, b, _p) >= 0 && ring.orient(b, c, _p) >= 0 && ring.orient(c, a, _p) >= 0
+                   && ring.orient(nodes[_p].prev, _p, nodes[_p].next) <= 0;
+        }
 
-                v1->is_ear = isDiagonal(v0, v3, nullptr);
-                v3->is_ear = isDiagonal(v1, v4, nullptr);
+        bool isEar(uint32_t _ear) const
+        {
+            const uint32_t a = nodes[_ear].prev, c = nodes[_ear].next;
+            if (ring.orient(a, _ear, c) <= 0)
+                return false;
 
-                no_vertex_to_process--;
-                index++;
-                break;
+            if (!hashed) {
+                for (uint32_t p = nodes[c].next; p != a; p = nodes[p].next)
+                    if (blocks(a, _ear, c, p))
+                        return false;
+                return true;
             }
+
+            const uint32_t min_z = zOrder(std::min(ring.x[a], std::min(ring.x[_ear], ring.x[c])),
+                                          std::min(ring.y[a], std::min(ring.y[_ear], ring.y[c])));
+            const uint32_t max_z = zOrder(std::max(ring.x[a], std::max(ring.x[_ear], ring.x[c])),
+                                          std::max(ring.y[a], std::max(ring.y[_ear], ring.y[c])));
+            for (uint32_t p = nodes[_ear].prev_z; p != NONE && nodes[p].z >= min_z; p = nodes[p].prev_z)
+                if (p != a && p != c && blocks(a, _ear, c, p))
+                    return false;
+            for (uint32_t p = nodes[_ear].next_z; p != NONE && nodes[p].z <= max_z; p = nodes[p].next_z)
+                if (p != a && p != c && blocks(a, _ear, c, p))
+                    return false;
+            return true;
+        }
+
+        void remove(uint32_t _node)
+        {
+            const Node& node = nodes[_node];
+            nodes[node.prev].next = node.next;
+            nodes[node.next].prev = node.prev;
+            if (node.prev_z != NONE)
+                nodes[node.prev_z].next_z = node.next_z;
+            if (node.next_z != NONE)
+                nodes[node.next_z].prev_z = node.prev_z;
+        }
+
+    public:
+        explicit EarClipper(const PolygonRing<Kernel>& _ring) : ring(_ring) {}
+
+        bool run(std::vector<uint32_t>& _triangles)
+        {
+            const uint32_t n = ring.size();
+            nodes.assign(n, Node{ 0, 0, NONE, NONE, 0 });
+            for (uint32_t i = 0; i < n; i++) {
+                nodes[i].prev = i == 0 ? n - 1 : i - 1;
+                nodes[i].next = i + 1 == n ? 0 : i + 1;
+            }
+            if (n >= EARCLIP_ZORDER_MIN_VERTICES)
+                buildZOrder();
+
+            uint32_t ear = 0, stop = 0, remaining = n;
+            while (remaining > 3) {
+                const uint32_t prev = nodes[ear].prev, next = nodes[ear].next;
+                if (isEar(ear)) {
+                    _triangles.push_back(ring.index[prev]);
+                    _triangles.push_back(ring.index[ear]);
+                    _triangles.push_back(ring.index[next]);
+                    remove(ear);
+                    remaining--;
+                    // skipping the next vertex gives fewer slivers
+                    ear = nodes[next].next;
+                    stop = ear;
+                    continue;
+                }
+                ear = next;
+                if (ear == stop)
+                    return false;
+            }
+            const uint32_t prev = nodes[ear].prev, next = nodes[ear].next;
+            if (ring.orient(prev, ear, next) <= 0)
+                return false;
+            _triangles.push_back(ring.index[prev]);
+            _triangles.push_back(ring.index[ear]);
+            _triangles.push_back(ring.index[next]);
+            return true;
+        }
+    };
+
+    // Monotone partition by plane sweep (de Berg et al., chapter 3) followed by the
+    // linear stack triangulation of every y-monotone piece. The sweep runs top to
+    // bottom, ties left to right, so horizontal edges need no special handling.
+    template<class Kernel>
+    class MonotoneTriangulator {
+        enum Kind : uint8_t { START, END, SPLIT, MERGE, REGULAR };
+
+        const PolygonRing<Kernel>& ring;
+        uint32_t n;
+        std::vector<Kind> kind;
+        std::vector<uint32_t> helper;
+        std::vector<uint32_t> diagonals;      // pairs of ring positions
+
+        uint32_t prev(uint32_t v) const { return v == 0 ? n - 1 : v - 1; }
+
+        uint32_t next(uint32_t v) const { return v + 1 == n ? 0 : v + 1; }
+
+        bool above(uint32_t a, uint32_t b) const
+        {
+            return ring.y[a] > ring.y[b] || (ring.y[a] == ring.y[b] && ring.x[a] < ring.x[b]);
+        }
+
+        // Only edges with the interior on their right enter the sweep status. In a
+        // counter clockwise ring those run downward, edge e from vertex e to next(e).
+        bool edgeLeftOf(uint32_t e, uint32_t _p) const
+        {
+            const uint32_t l = next(e);
+            if (ring.y[e] == ring.y[l])
+                return ring.x[l] < ring.x[_p];
+            return ring.orient(e, l, _p) > 0;
+        }
+
+        struct SweepPoint { uint32_t v; };
+
+        struct EdgeOrder {
+            using is_transparent = void;
+            const MonotoneTriangulator* owner;
+
+            // compare where the later of the two upper vertices meets the sweep line
+            bool operator()(uint32_t a, uint32_t b) const
+            {
+                if (a == b)
+                    return false;
+                if (owner->above(b, a))
+                    return !owner->edgeLeftOf(b, a);
+                return owner->edgeLeftOf(a, b);
+            }
+
+            bool operator()(uint32_t e, SweepPoint p) const { return owner->edgeLeftOf(e, p.v); }
+
+            bool operator()(SweepPoint p, uint32_t e) const { return !owner->edgeLeftOf(e, p.v); }
+        };
+
+        void addDiagonal(uint32_t a, uint32_t b)
+        {
+            diagonals.push_back(a);
+            diagonals.push_back(b);
+        }
+
+        bool partition()
+        {
+            kind.resize(n);
+            helper.assign(n, 0);
+            std::vector<uint32_t> order(n);
+            for (uint32_t v = 0; v < n; v++) {
+                order[v] = v;
+                const uint32_t p = prev(v), q = next(v);
+                const bool convex = ring.orient(p, v, q) >= 0;
+                if (above(v, p) && above(v, q))
+                    kind[v] = convex ? START : SPLIT;
+                else if (above(p, v) && above(q, v))
+                    kind[v] = convex ? END : MERGE;
+                else
+                    kind[v] = REGULAR;
+            }
+            std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return above(a, b); });
+
+            std::set<uint32_t, EdgeOrder> status(EdgeOrder{ this });
+            auto leftEdge = [&](uint32_t v, uint32_t& edge) {
+                auto it = status.lower_bound(SweepPoint{ v });
+                if (it == status.begin())
+                    return false;
+                edge = *std::prev(it);
+                return true;
+            };
+            auto closeEdge = [&](uint32_t e, uint32_t v) {
+                if (kind[helper[e]] == MERGE)
+                    addDiagonal(v, helper[e]);
+                status.erase(e);
+            };
+
+            for (uint32_t v : order) {
+                uint32_t left;
+                switch (kind[v]) {
+                    case START:
+                        status.insert(v);
+                        helper[v] = v;
+                        break;
+                    case END:
+                        closeEdge(prev(v), v);
+                        break;
+                    case SPLIT:
+                        if (!leftEdge(v, left))
+                            return false;
+                        addDiagonal(v, helper[left]);
+                        helper[left] = v;
+                        status.insert(v);
+                        helper[v] = v;
+                        break;
+                    case MERGE:
+                        closeEdge(prev(v), v);
+                        if (!leftEdge(v, left))
+                            return false;
+                        if (kind[helper[left]] == MERGE)
+                            addDiagonal(v, helper[left]);
+                        helper[left] = v;
+                        break;
+                    case REGULAR:
+                        if (above(prev(v), v)) {
+                            // on the left boundary, the interior lies to the right
+                            closeEdge(prev(v), v);
+                            status.insert(v);
+                            helper[v] = v;
+                        }
+                        else {
+                            if (!leftEdge(v, left))
+                                return false;
+                            if (kind[helper[left]] == MERGE)
+                                addDiagonal(v, helper[left]);
+                            helper[left] = v;
+                        }
+                        break;
+                }
+            }
+            return true;
+        }
+
+        // Split the polygon along the diagonals. Neighbours of every vertex are kept
+        // in counter clockwise order, a face is walked by turning to the neighbour
+        // clockwise after the one we came from.
+        void collectFaces(std::vector<uint32_t>& _vertices, std::vector<uint32_t>& _face_start) const
+        {
+            std::vector<uint32_t> first(n + 1, 0);
+            for (uint32_t v = 0; v < n; v++)
+                first[v + 1] = 2;
+            for (uint32_t d : diagonals)
+                first[d + 1]++;
+            for (uint32_t v = 0; v < n; v++)
+                first[v + 1] += first[v];
+            std::vector<uint32_t> adjacent(first[n]);
+            std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+            for (uint32_t v = 0; v < n; v++) {
+                adjacent[fill[v]++] = next(v);
+                adjacent[fill[v]++] = prev(v);
+            }
+            for (size_t i = 0; i < diagonals.size(); i += 2) {
+                adjacent[fill[diagonals[i]]++] = diagonals[i + 1];
+                adjacent[fill[diagonals[i + 1]]++] = diagonals[i];
+            }
+
+            auto angleLess = [this](uint32_t v, uint32_t a, uint32_t b) {
+                auto half = [&](uint32_t w) {
+                    const double dx = ring.x[w] - ring.x[v], dy = ring.y[w] - ring.y[v];
+                    return (dy > 0 || (dy == 0 && dx > 0)) ? 0 : 1;
+                };
+                const int ha = half(a), hb = half(b);
+                if (ha != hb)
+                    return ha < hb;
+                return ring.orient(v, a, b) > 0;
+            };
+            for (uint32_t v = 0; v < n; v++)
+                std::sort(adjacent.begin() + first[v], adjacent.begin() + first[v + 1],
+                          [&](uint32_t a, uint32_t b) { return angleLess(v, a, b); });
+
+            // slot of the half edge _to -> _from, found by its angle around _to
+            auto twinSlot = [&](uint32_t _from, uint32_t _to) {
+                auto begin = adjacent.begin() + first[_to], end = adjacent.begin() + first[_to + 1];
+                return static_cast<uint32_t>(
+                    std::lower_bound(begin, end, _from,
+                                     [&](uint32_t a, uint32_t b) { return angleLess(_to, a, b); })
+                    - adjacent.begin());
+            };
+
+            std::vector<char> visited(adjacent.size(), 0);
+            for (uint32_t v = 0; v < n; v++) {
+                for (uint32_t s = first[v]; s < first[v + 1]; s++) {
+                    // the reversed polygon edges face the outside
+                    if (visited[s] || adjacent[s] == prev(v))
+                        continue;
+                    _face_start.push_back(static_cast<uint32_t>(_vertices.size()));
+                    uint32_t from = v, slot = s;
+                    while (!visited[slot]) {
+                        visited[slot] = 1;
+                        _vertices.push_back(from);
+                        const uint32_t to = adjacent[slot];
+                        const uint32_t back = twinSlot(from, to);
+                        slot = back == first[to] ? first[to + 1] - 1 : back - 1;
+                        from = to;
+                    }
+                }
+            }
+            _face_start.push_back(static_cast<uint32_t>(_vertices.size()));
+        }
+
+        void emit(uint32_t a, uint32_t b, uint32_t c, std::vector<uint32_t>& _triangles) const
+        {
+            if (ring.orient(a, b, c) < 0)
+                std::swap(b, c);
+            _triangles.push_back(ring.index[a]);
+            _triangles.push_back(ring.index[b]);
+            _triangles.push_back(ring.index[c]);
+        }
+
+        // Stack triangulation of a y-monotone face given counter clockwise
+        void triangulateMonotone(const uint32_t* _face, uint32_t _size, std::vector<uint32_t>& _triangles) const
+        {
+            if (_size < 3)
+                return;
+            if (_size == 3) {
+                emit(_face[0], _face[1], _face[2], _triangles);
+                return;
+            }
+            uint32_t top = 0, bottom = 0;
+            for (uint32_t i = 1; i < _size; i++) {
+                if (above(_face[i], _face[top]))
+                    top = i;
+                if (above(_face[bottom], _face[i]))
+                    bottom = i;
+            }
+
+            // Going forward from the top walks down the left chain, going backward
+            // the right one. Merge both into sweep order.
+            std::vector<uint32_t> sorted;
+            std::vector<char> on_left;
+            sorted.reserve(_size);
+            on_left.reserve(_size);
+            sorted.push_back(_face[top]);
+            on_left.push_back(1);
+            uint32_t l = (top + 1) % _size, r = (top + _size - 1) % _size;
+            while (sorted.size() < _size) {
+                const bool take_left = r == bottom || (l != bottom && above(_face[l], _face[r]))
+                                       || (l == bottom && r == bottom);
+                if (take_left && l != bottom) {
+                    sorted.push_back(_face[l]);
+                    on_left.push_back(1);
+                    l = (l + 1) % _size;
+                }
+                else if (r != bottom) {
+                    sorted.push_back(_face[r]);
+                    on_left.push_back(0);
+                    r = (r + _size - 1) % _size;
+                }
+                else {
+                    sorted.push_back(_face[bottom]);
+                    on_left.push_back(1);
+                }
+            }
+
+            std::vector<uint32_t> stack = { 0, 1 };
+            for (uint32_t j = 2; j + 1 < _size; j++) {
+                const uint32_t u = sorted[j];
+                if (on_left[j] != on_left[stack.back()]) {
+                    while (stack.size() > 1) {
+                        const uint32_t v = stack.back();
+                        stack.pop_back();
+                        emit(u, sorted[v], sorted[stack.back()], _triangles);
+                    }
+                    stack.clear();
+                    stack.push_back(j - 1);
+                    stack.push_back(j);
+                }
+                else {
+                    uint32_t last = stack.back();
+                    stack.pop_back();
+                    while (!stack.empty()) {
+                        const uint32_t w = sorted[stack.back()];
+                        const int turn = on_left[j] ? ring.orient(w, sorted[last], u)
+                                                    : ring.orient(u, sorted[last], w);
+                        if (turn <= 0)
+                            break;
+                        emit(u, sorted[last], w, _triangles);
+                        last = stack.back();
+                        stack.pop_back();
+                    }
+                    stack.push_back(last);
+                    stack.push_back(j);
+                }
+            }
+            const uint32_t u = sorted[_size - 1];
+            uint32_t last = stack.back();
+            stack.pop_back();
+            while (!stack.empty()) {
+                emit(u, sorted[last], sorted[stack.back()], _triangles);
+                last = stack.back();
+                stack.pop_back();
+            }
+        }
+
+    public:
+        explicit MonotoneTriangulator(const PolygonRing<Kernel>& _ring) : ring(_ring), n(_ring.size()) {}
+
+        bool run(std::vector<uint32_t>& _triangles)
+        {
+            if (!partition())
+                return false;
+            std::vector<uint32_t> vertices, face_start;
+            vertices.reserve(n + diagonals.size());
+            collectFaces(vertices, face_start);
+            const size_t before = _triangles.size();
+            _triangles.reserve(before + 3 * (n - 2));
+            for (size_t f = 0; f + 1 < face_start.size(); f++)
+                triangulateMonotone(vertices.data() + face_start[f], face_start[f + 1] - face_start[f], _triangles);
+            return _triangles.size() - before == 3 * static_cast<size_t>(n - 2);
+        }
+    };
+}
+
+template<class Kernel>
+bool rez::triangulate_earclipping(const std::vector<Point2d>& _polygon, std::vector<uint32_t>& _triangles)
+{
+    PolygonRing<Kernel> ring;
+    if (!ring.build(_polygon))
+        return false;
+    return EarClipper<Kernel>(ring).run(_triangles);
+}
+
+template<class Kernel>
+bool rez::triangulate_polygon(const std::vector<Point2d>& _polygon, std::vector<uint32_t>& _triangles)
+{
+    _triangles.clear();
+    PolygonRing<Kernel> ring;
+    if (!ring.build(_polygon))
+        return false;
+    if (ring.size() <= EARCLIP_MAX_VERTICES) {
+        if (EarClipper<Kernel>(ring).run(_triangles))
+            return true;
+        _triangles.clear();
+    }
+    if (MonotoneTriangulator<Kernel>(ring).run(_triangles))
+        return true;
+    _triangles.clear();
+    return false;
+}
+
+template bool rez::triangulate_earclipping<FilteredKernel>(const std::vector<Point2d>&, std::vector<uint32_t>&);
+template bool rez::triangulate_earclipping<InexactKernel>(const std::vector<Point2d>&, std::vector<uint32_t>&);
+template bool rez::triangulate_polygon<FilteredKernel>(const std::vector<Point2d>&, std::vector<uint32_t>&);
+template bool rez::triangulate_polygon<InexactKernel>(const std::vector<Point2d>&, std::vector<uint32_t>&);
+
+// Ring of points of a simple polygon in link order
+static std::vector<Point2d> linked_points(Polygon2dSimple* poly)
+{
+    std::vector<Point2d> points;
+    auto vertices = poly->getVertcies();
+    if (vertices.empty())
+        return points;
+    const Vertex2dSimple* vertex = vertices[0];
+    do {
+        points.push_back(vertex->point);
+        vertex = vertex->next;
+    } while (vertex && vertex != vertices[0]);
+    return points;
+}
+
+void rez::triangulate_earclipping(Polygon2dSimple* poly, std::vector<Edge2dSimple>& edge_list)
+{
+    const std::vector<Point2d> points = linked_points(poly);
+    std::vector<uint32_t> triangles;
+    triangulate_earclipping(points, triangles);
+
+    // every diagonal is shared by two triangles, take it in one direction only
+    const auto n = static_cast<uint32_t>(points.size());
+    for (size_t t = 0; t < triangles.size(); t += 3) {
+        for (int k = 0; k < 3; k++) {
+            const uint32_t a = triangles[t + k], b = triangles[t + (k + 1) % 3];
+            if (a < b && b - a != 1 && b - a != n - 1)
+                edge_list.emplace_back(points[a], points[b]);
+        }
+    }
+}
+
+void rez::triangulate_general(Polygon2d* poly)
+{
+    std::vector<Vertex2dDCEL*> vertices = poly->getVertexList();
+    std::vector<Point2d> points;
+    points.reserve(vertices.size());
+    for (auto* vertex : vertices)
+        points.push_back(vertex->point);
+
+    std::vector<uint32_t> triangles;
+    if (!triangulate_polygon(points, triangles))
+        return;
+    const auto n = static_cast<uint32_t>(points.size());
+    for (size_t t = 0; t < triangles.size(); t += 3) {
+        for (int k = 0; k < 3; k++) {
+            const uint32_t a = triangles[t + k], b = triangles[t + (k + 1) % 3];
+            if (a < b && b - a != 1 && b - a != n - 1)
+                poly->split(vertices[a], vertices[b]);
         }
     }
 }
@@ -4,23 +4,52 @@
 
 #ifndef PHYSICSFORMULA_TRIANGULATION_H
 #define PHYSICSFORMULA_TRIANGULATION_H
+#include <cstdint>
 #include <vector>
 #include <iostream>
 
 #include "Point.h"
+#include "Kernel.h"
 #include "PolygonDCEL.h"
 #include "MonotonePartition.h"
 
 namespace rez {
 
-    // triangulate the given polygon using ear clipping method
+    // triangulate the given polygon using ear clipping method. The diagonals of the
+    // triangulation are appended to edge_list, the polygon itself is left untouched.
     void triangulate_earclipping(Polygon2dSimple* poly, std::vector<Edge2dSimple>& edge_list);
 
     // Triangulate the given monotone polygon. Result is undefined if the polygon is not monotone
     void triangulate_monotone(Polygon2d* poly);
 
-    //// Triangulate the general polygon.
-    //// Internally first we partition the polygon in to monotone peices and then call the triangulate_monotone
-    //void triangulate_general(Polygon2d* poly);
+    // Triangulate the general polygon by inserting the diagonals of triangulate_polygon
+    // into its DCEL, every bounded face ends up a triangle.
+    void triangulate_general(Polygon2d* poly);
+
+    /**
+     * @brief ear clipping over a simple polygon given as its vertex ring, either
+     * orientation. On larger polygons a candidate ear is only checked against the
+     * vertices whose z-order (Morton) code falls in the ear's bounding box.
+     * @param _triangles receives three indices into _polygon per triangle, counter
+     * clockwise
+     * @return false when no ear is left before the polygon is used up, which only
+     * happens for polygons that are not simple
+     * @tparam Kernel the predicates, FilteredKernel or InexactKernel from Kernel.h
+     */
+    template<class Kernel = FilteredKernel>
+    bool triangulate_earclipping(const std::vector<Point2d>& _polygon, std::vector<uint32_t>& _triangles);
+
+    /**
+     * @brief O(n log n) triangulation of a simple polygon given as its vertex ring,
+     * either orientation. The polygon is split into y-monotone pieces by a plane
+     * sweep and every piece is triangulated in linear time. Small polygons go to
+     * the ear clipper, which is faster for them.
+     * @param _triangles receives three indices into _polygon per triangle, counter
+     * clockwise. Repeated consecutive vertices are skipped.
+     * @return false, with _triangles left empty, when the polygon is degenerate or
+     * not simple
+     */
+    template<class Kernel = FilteredKernel>
+    bool triangulate_polygon(const std::vector<Point2d>& _polygon, std::vector<uint32_t>& _triangles);
 }
 #endif //PHYSICSFORMULA_TRIANGULATION_H
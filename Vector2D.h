@@ -268,7 +268,7 @@ inline void Vector2D::display(const std::string& label)const
     }
 }
 
-void Vector2D::showUnitVector(const std::string& label)const {
+inline void Vector2D::showUnitVector(const std::string& label)const {
     // display as a unit vector with ihat and jhat
     std::cout << ((label.empty()) ? ID : label) << ":";
     std::cout << 1.0/magnitude << "*"  << "<" << x << "i ," << y << "j>";
@@ -479,7 +479,7 @@ inline Vector2D Vector2D::normalize2D()
     return *this;
 }
 
-Vector2D Vector2D::getUnitVector() const {
+inline Vector2D Vector2D::getUnitVector() const {
     Vector2D unitVector(this->x, this->y);
     unitVector.normalize2D();
     return unitVector;
@@ -758,7 +758,7 @@ inline void Vector2D::typeOfAngleBetween(const Vector2D& v)const
     }
 }
 
-std::string Vector2D::getID() const
+inline std::string Vector2D::getID() const
 {
     return ID;
 }
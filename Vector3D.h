@@ -14,6 +14,7 @@
  */
 #ifndef VECTOR3D_H
 #define VECTOR3D_H
+#include <tuple>
 #include "Vector2D.h"
 static int vec3d_objectCount = 0;
 
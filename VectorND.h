@@ -20,6 +20,7 @@
 #include <iostream>
 #include <vector>
 #include "Vector3D.h"
+#include "MatrixExpressions.h"
 using namespace std;
 #define ull unsigned long long
 #define lld  long double
@@ -81,6 +82,10 @@ public:
     template<typename ... Args>
     explicit VectorND(const T& first, const Args&... args);
 
+    // evaluate a lazy element-wise expression into a new vector
+    template<typename E>
+    VectorND(const rez::MatrixExpression<E>& expr);
+
     // Function that returns the number of
     // elements in array after pushing the data
     ull push_back(T);
@@ -158,11 +163,18 @@ public:
     bool operator>=(const VectorND& v)const;
     bool operator<(const VectorND& v)const;
     bool operator<=(const VectorND& v)const;
-    VectorND<T> operator+(const VectorND &vec)const;    //addition
-    VectorND<T> operator+(VectorND &vec)const;
+    // element-wise expression types built by the arithmetic operators
+    using Leaf = rez::ExpressionLeaf<T>;
+    using SumExpression = rez::BinaryExpression<Leaf, Leaf, rez::OpAdd>;
+    using DifferenceExpression = rez::BinaryExpression<Leaf, Leaf, rez::OpSub>;
+    using ProductExpression = rez::BinaryExpression<Leaf, Leaf, rez::OpMul>;
+    using ScaledExpression = rez::ScalarExpression<Leaf, T, rez::OpMul, false>;
+    using ShiftedExpression = rez::ScalarExpression<Leaf, T, rez::OpSub, false>;
+
+    SumExpression operator+(const VectorND &vec)const;    //addition
     VectorND<T> &operator+=(const VectorND &vec);  ////assigning new result to the vector
-    VectorND<T> operator-(const VectorND &vec);    //subtraction
-    VectorND<T> operator-(const T number)const;
+    DifferenceExpression operator-(const VectorND &vec)const;    //subtraction
+    ShiftedExpression operator-(const T number)const;
     VectorND<T> operator-()const;
     VectorND<T> operator--();
     VectorND<T> operator--(int);
@@ -172,24 +184,24 @@ public:
     VectorND<T> &operator=(const VectorND<T> &vec);
     VectorND<T> &operator=(const VectorND<T> *v);
     VectorND<T> &operator=(VectorND<T>&& right)noexcept;
-    VectorND<T> operator*(T);
+    // assign an expression, reusing the storage when it is large enough
+    template<typename E>
+    VectorND<T> &operator=(const rez::MatrixExpression<E>& expr);
+    ScaledExpression operator*(T)const;
 
-    friend VectorND<T> operator*(T s, VectorND& v)
+    friend ScaledExpression operator*(T s, const VectorND& v)
     {
         return v*s;
     }
-    friend VectorND<T> operator*(VectorND& v, VectorND& s)
+    friend ProductExpression operator*(const VectorND& v, const VectorND& s)
     {
-        VectorND<T> temp(v.length);
-        temp.vec = v.vec;
-        temp.length = 0;
-        for (int i = 0; i < v.length; i++)
-        {
-            temp.push_back(v.arr[i] * s.arr[i]);
-        }
-        return temp;
+        return ProductExpression(Leaf(v.arr, v.length, 1),
+                                 Leaf(s.arr, s.length, 1));
     }
 
+    // pointer to the contiguous elements
+    [[nodiscard]] const T* data() const { return arr; }
+
     [[nodiscard]] double dot(const VectorND& v)const;
     [[nodiscard]] VectorND<T> cross(const VectorND& v)const;
     [[nodiscard]] double distance(const VectorND& v)const;
@@ -451,27 +463,10 @@ bool VectorND<T>::operator<=(const VectorND& v) const
 }
 
 template<typename T>
-VectorND<T> VectorND<T>::operator+(const VectorND& vec) const
-{
-    VectorND<T> temp;
-    for (size_t i = 0; i < vec.length; i++)
-    {
-        temp.push_back(this->arr[i] + vec.arr[i]);
-    }
-    magnitude = calculateMagnitude();
-    return temp;
-}
-
-template <typename T>
-VectorND<T> VectorND<T>::operator+(VectorND& vec) const
+typename VectorND<T>::SumExpression
+VectorND<T>::operator+(const VectorND& vec) const
 {
-    VectorND<T> temp;
-    for (size_t i = 0; i < vec.length; i++)
-    {
-        temp.push_back(this->arr[i] + vec.arr[i]);
-    }
-    magnitude = calculateMagnitude();
-    return temp;
+    return SumExpression(Leaf(arr, length, 1), Leaf(vec.arr, vec.length, 1));
 }
 
 template<typename T>
@@ -486,27 +481,17 @@ VectorND<T>& VectorND<T>::operator+=(const VectorND& vec)
 }
 
 template<typename T>
-VectorND<T> VectorND<T>::operator-(const VectorND& vec)
+typename VectorND<T>::DifferenceExpression
+VectorND<T>::operator-(const VectorND& vec) const
 {
-    VectorND<T> temp;
-    for (size_t i = 0; i < length; i++)
-    {
-        temp.arr[i] = this->arr[i] - vec.arr[i];
-    }
-    magnitude = calculateMagnitude();
-    return temp;
+    return DifferenceExpression(Leaf(arr, length, 1), Leaf(vec.arr, vec.length, 1));
 }
 
 template<typename T>
-VectorND<T> VectorND<T>::operator-(const T number) const
+typename VectorND<T>::ShiftedExpression
+VectorND<T>::operator-(const T number) const
 {
-    VectorND<T> temp;
-    for (size_t i = 0; i < length; i++)
-    {
-        temp = this->arr[i] - number;
-    }
-    magnitude = calculateMagnitude();
-    return temp;
+    return ShiftedExpression(Leaf(arr, length, 1), number);
 }
 
 template<typename T>
@@ -607,15 +592,45 @@ VectorND<T>& VectorND<T>::operator=(VectorND<T>&& right) noexcept
 }
 
 template<typename T>
-VectorND<T> VectorND<T>::operator*(T s)
+typename VectorND<T>::ScaledExpression VectorND<T>::operator*(T s) const
 {
-    VectorND<T> temp;
-    for (auto i = 0; i < length; i++)
+    return ScaledExpression(Leaf(arr, length, 1), s);
+}
+
+template<typename T>
+template<typename E>
+VectorND<T>::VectorND(const rez::MatrixExpression<E>& expr)
+{
+    countIncrease();
+    ID = "vecNd_" + std::to_string(vecNd_objCounter);
+    length = expr.size();
+    capacity = length > 0 ? length : 1;
+    arr = new T[capacity];
+    rez::evaluateInto(arr, expr);
+    magnitude = calculateMagnitude();
+}
+
+template<typename T>
+template<typename E>
+VectorND<T>& VectorND<T>::operator=(const rez::MatrixExpression<E>& expr)
+{
+    const ull n = expr.size();
+    if (n > capacity)
     {
-        temp.push_back(arr[i] * s);
+        // evaluate before releasing the old buffer, expr may read from it
+        T* fresh = new T[n];
+        rez::evaluateInto(fresh, expr);
+        delete[] arr;
+        arr = fresh;
+        capacity = n;
     }
+    else
+    {
+        rez::evaluateInto(arr, expr);
+    }
+    length = n;
     magnitude = calculateMagnitude();
-    return	temp;
+    return *this;
 }
 
 template<typename T>
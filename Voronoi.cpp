@@ -5,549 +5,413 @@
 #include "Voronoi.h"
 
 #include <algorithm>
-#include <queue>
-#include <list>
-#include <iterator>
-#include "Line.h"
-#include "Segment.h"
-#include "Intersection.h"
-#include "Distance.h"
+#include <cmath>
+#include <limits>
+#include "GeoUtils.h"
 
 using namespace rez;
 
-enum class EVENT_TYPE {
-    SITE,
-    CIRCLE
-};
-
-enum class BEACH_ITEM_TYPE {
-    ARC,
-    EDGE
-};
-
-struct Event;
-
-typedef Line2d EdgeItem;
-
-struct BeachLineItem {
-    std::vector<Event*> events;
-    Point2d site;
-    BEACH_ITEM_TYPE type;
-
-    BeachLineItem* next_arc = nullptr;
-    BeachLineItem* prev_arc = nullptr;
-    BeachLineItem* next_edge = nullptr;
-    BeachLineItem* prev_edge = nullptr;
-
-    EdgeItem edge;			 // For edge items
-    bool is_completed_edge = false;
-};
-
-struct Event {
-    EVENT_TYPE type;
-    Point2d site;
-    Point2d* intersetion_point; // For circle events
-    BeachLineItem* arc;
-    bool valid = true;
-};
-
-struct EventComparator {
-    bool operator()(const Event* e1, const Event* e2)
-    {
-        Point2d point = e1->site;
-        Point2d other = e2->site;
-
-        if (point[Y_] < other[Y_])
-            return true;
-        else if (isEqualD(point[Y_], other[Y_]) && point[X_] < other[X_])
-        {
-            return true;
-        }
-
-        return false;
-    }
-};
-
-std::priority_queue< Event*, std::vector<Event*>, EventComparator> p_queue;
-
-std::vector<Segment> segments;
-std::list<BeachLineItem*> beach_line;
-typedef std::list<BeachLineItem*>::iterator BeachLineItr;
+//*****************************************************************************
+// Arc pool
+//*****************************************************************************
 
-void add_outer_edge(BeachLineItem* item, BoundRectangle& bound, std::vector<Edge2dSimple>& _edges)
+template<class Kernel>
+typename BasicFortuneVoronoi<Kernel>::Arc* BasicFortuneVoronoi<Kernel>::newArc(uint32_t _site)
 {
-    EdgeItem edge = item->edge;
-    Point2d p_start = edge.point();
-    Vector2f dir = edge.direction();
-
-    Point2d p_end;
-
-    //Check edge start with in bounds
-    if (p_start[X_] >= bound.left_x && p_start[X_] <= bound.right_x &&
-        p_start[Y_] >= bound.bot_y && p_start[Y_] <= bound.top_y)
-    {
-        if (dir[X_] > 0 && dir[Y_] > 0)
-        {
-            //Direction vector is point in first quadrant
-            auto t = (bound.right_x - p_start[X_]) / dir[X_];
-            auto y = p_start[Y_] + t * dir[Y_];
-
-            if (y <= bound.top_y)
-            {
-                p_end.assign(X_, bound.right_x);
-                p_end.assign(Y_, y);
-            }
-            else
-            {
-                auto s = (bound.top_y - p_start[Y_]) / dir[Y_];
-                auto x = p_start[X_] + s * dir[X_];
-                p_end.assign(X_, x);
-                p_end.assign(Y_, bound.top_y);
-            }
-        }
-        else if (dir[X_] < 0 && dir[Y_] > 0)
-        {
-            auto t = (bound.left_x - p_start[X_]) / dir[X_];
-            auto y = p_start[Y_] + t * dir[Y_];
-
-            if (y <= bound.top_y)
-            {
-                p_end.assign(X_, bound.left_x);
-                p_end.assign(Y_, y);
-            }
-            else
-            {
-                auto s = (bound.top_y - p_start[Y_]) / dir[Y_];
-                auto x = p_start[X_] + s * dir[X_];
-                p_end.assign(X_, x);
-                p_end.assign(Y_, bound.top_y);
-            }
-        }
-        else if (dir[X_] < 0 && dir[Y_] < 0)
-        {
-            //Direction vector is point in third quadrant
-            auto t = (bound.left_x - p_start[X_]) / dir[X_];
-            auto y = p_start[Y_] + t * dir[Y_];
-
-            if (y >= bound.bot_y)
-            {
-                p_end.assign(X_, bound.left_x);
-                p_end.assign(Y_, y);
-            }
-            else
-            {
-                auto s = (bound.bot_y - p_start[Y_]) / dir[Y_];
-                auto x = p_start[X_] + s * dir[X_];
-                p_end.assign(X_, x);
-                p_end.assign(Y_, bound.bot_y);
-            }
-        }
-        else
-        {
-            //Direction vector is point in furth quadrant
-            auto t = (bound.right_x - p_start[X_]) / dir[X_];
-            auto y = p_start[Y_] + t * dir[Y_];
-
-            if (y >= bound.bot_y)
-            {
-                p_end.assign(X_, bound.right_x);
-                p_end.assign(Y_, y);
-            }
-            else
-            {
-                auto s = (bound.bot_y - p_start[Y_]) / dir[Y_];
-                auto x = p_start[X_] + s * dir[X_];
-                p_end.assign(X_, x);
-                p_end.assign(Y_, bound.bot_y);
-            }
+    Arc* arc;
+    if (!free_arcs.empty()) {
+        arc = free_arcs.back();
+        free_arcs.pop_back();
+    }
+    else {
+        if (blocks.empty() || used_in_block == BLOCK_SIZE) {
+            blocks.push_back(std::make_unique<Arc[]>(BLOCK_SIZE));
+            used_in_block = 0;
         }
-
-        Edge2dSimple new_edge(p_start, p_end);
-        new_edge.fp1 = DEFAULT_POINT_2D;
-        new_edge.fp2 = DEFAULT_POINT_2D;
-
-        _edges.push_back(new_edge);
+        arc = &blocks.back()[used_in_block++];
     }
+    // the stamp survives reuse so events of a previous owner stay stale
+    const uint32_t stamp = arc->stamp + 1;
+    *arc = Arc();
+    arc->stamp = stamp;
+    arc->site = _site;
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    arc->priority = random_state;
+    return arc;
 }
 
-double computeArcY(Point2d& _arc_site, Point2d& _current_point)
+template<class Kernel>
+void BasicFortuneVoronoi<Kernel>::freeArc(Arc* _arc)
 {
-    double yf = _arc_site[Y_];
-    double yd = _current_point[Y_];
-    double xf = _arc_site[X_];
-    double xd = _current_point[X_];
-
-    if (isEqualD(yf, yd))
-        return 0.0;
-
-    if (isEqualD(xf, xd))
-        return (yf + yd) / 2;
-
-    ////return the y value of arc at this point
-    //auto s1 = (xd - xf) * (xd - xf);
-    //auto d1 = 1 / (2 * (yf - yd));
-    //auto s2 = yf + yd;
-    //
-    //return s1 / d1 + s2 / 2;
-
-    double dp = 2 * (yf - yd);
-    double a1 = 1 / dp;
-    double b1 = -2 * xf / dp;
-    double c1 = yd + dp / 4 + xf * xf / dp;
-
-    return(a1 * xd * xd + b1 * xd + c1);
+    _arc->stamp++;
+    free_arcs.push_back(_arc);
 }
 
-BeachLineItr getArcAbove(Point2d& _point)
+template<class Kernel>
+void BasicFortuneVoronoi<Kernel>::resetPool()
 {
-    // Segments of same arc can repeat in the beach line. We need to  consider this as well.
-    BeachLineItr current_arc_itr = beach_line.begin();
-    double current_arc_y = DBL_MAX;
-    BeachLineItr itr = current_arc_itr;
-    bool found_arc_with_greater_x = false;
-
-    while (itr != beach_line.end())
-    {
-        if ((*itr)->type == BEACH_ITEM_TYPE::ARC)
-        {
-            // TODO There is a fault in this implementation when two different arcs have almost same distance
-            // This fault is due to part of computeArcY implementation and other part due to precision.
-            double arc_y = computeArcY((*itr)->site, _point);
-            bool condition = arc_y < current_arc_y;
-            if (condition
-                || (isEqualD(arc_y, current_arc_y) &&
-                    (!found_arc_with_greater_x)))
-            {
-                current_arc_itr = itr;
-                current_arc_y = arc_y;
-                found_arc_with_greater_x = false;
-            }
-            else
-            {
-                if ((*itr)->site[X_] > _point[X_])
-                    found_arc_with_greater_x = true;
-            }
+    free_arcs.clear();
+    for (size_t b = 0; b < blocks.size(); b++) {
+        const size_t count = (b + 1 == blocks.size()) ? used_in_block : BLOCK_SIZE;
+        for (size_t i = 0; i < count; i++) {
+            blocks[b][i].stamp++;
+            free_arcs.push_back(&blocks[b][i]);
         }
-        itr++;
     }
-
-    return current_arc_itr;
 }
 
-BeachLineItr addNewArc(BeachLineItr& itr, Point2d& site)
-{
-    BeachLineItem* arc_to_replace = *itr;
-    BeachLineItem* prev_left_arc = arc_to_replace->prev_arc;
-    BeachLineItem* prev_right_arc = arc_to_replace->next_arc;
-
-    //afl,el,an,er,afr
-    BeachLineItem* left_arc = new BeachLineItem();
-    left_arc->type = BEACH_ITEM_TYPE::ARC;
-    left_arc->site = arc_to_replace->site;
-
-    BeachLineItem* new_arc = new BeachLineItem();
-    new_arc->type = BEACH_ITEM_TYPE::ARC;
-    new_arc->site = site;
-
-    BeachLineItem* right_arc = new BeachLineItem();
-    right_arc->type = BEACH_ITEM_TYPE::ARC;
-    right_arc->site = arc_to_replace->site;
-
-    //Start point of the edges is
-    auto arc_y = computeArcY((*itr)->site, site);
-    Point2d start_point(site[X_], arc_y);
-
-    // Direction vectors for the two edges are prependicular to the vector between the two focuses
-    // - focus of new_arc and arc_to_replace
-    Vector2f fnfo = new_arc->site - arc_to_replace->site;	 // Direction vector from new site to arc_to_replace->site
-    Vector2f dir = prependicluar(fnfo);						 // Prependicular vector to fnfo
-    Vector2f neg_dir(-dir[X_], -dir[Y_]);
-    EdgeItem l_edge(start_point, dir);
-    EdgeItem r_edge(start_point, neg_dir);
-
-    BeachLineItem* left_edge = new BeachLineItem();
-    left_edge->type = BEACH_ITEM_TYPE::EDGE;
-    left_edge->edge = l_edge;
-
-    BeachLineItem* right_edge = new BeachLineItem();
-    right_edge->type = BEACH_ITEM_TYPE::EDGE;
-    right_edge->edge = r_edge;
-
-    left_arc->prev_arc = arc_to_replace->prev_arc;
-    left_arc->next_arc = new_arc;
-    right_arc->prev_arc = new_arc;
-    right_arc->next_arc = arc_to_replace->next_arc;
-    new_arc->prev_arc = left_arc;
-    new_arc->next_arc = right_arc;
-
-    left_arc->next_edge = left_edge;
-    left_arc->prev_edge = arc_to_replace->prev_edge;
-    new_arc->prev_edge = left_edge;
-    new_arc->next_edge = right_edge;
-    right_arc->prev_edge = right_edge;
-    right_arc->next_edge = arc_to_replace->next_edge;
-
-    if (prev_left_arc)
-        prev_left_arc->next_arc = left_arc;
-
-    if (prev_right_arc)
-        prev_right_arc->prev_arc = right_arc;
-
-    // Add the new itms in order. Add the last one first, then the second to last and so on
-    // -as list::insert add element before the position.
-    beach_line.insert(itr, left_arc);
-    beach_line.insert(itr, left_edge);
-    beach_line.insert(itr, new_arc);
-    beach_line.insert(itr, right_edge);
-    beach_line.insert(itr, right_arc);
-
-    // delete the original arc finally. We do it finally here to take care the degenerate case of
-    // having only one arc. If we delete it first then the iterator is going to invalid
-    // As we add 5 new elements, we need to delete the element 5 position higher than the initial iterator.
-
-    BeachLineItr new_Itr = itr;
-    std::advance(new_Itr, -3);
-
-    //if ((*itr)->events && (*itr)->event->type == EVENT_TYPE::CIRCLE)
-    //	(*itr)->event->valid = false;
-    for (auto event : (*itr)->events)
-    {
-        if (event->type == EVENT_TYPE::CIRCLE)
-            event->valid = false;
-    }
-
-    beach_line.erase(itr);
+//*****************************************************************************
+// Beach line
+//*****************************************************************************
 
-    //decrement the iterator 3 position to point to the newly added arc.
-    return new_Itr;
+// x of the breakpoint between the arc of _left and the arc of _right (left to
+// right on the beach line) when the sweep line is at y = _sweep.
+template<class Kernel>
+double BasicFortuneVoronoi<Kernel>::breakpoint(uint32_t _left, uint32_t _right, double _sweep) const
+{
+    const double px = sx[_left], py = sy[_left];
+    const double qx = sx[_right], qy = sy[_right];
+    if (py == qy)
+        return (px + qx) / 2;
+    if (py == _sweep)
+        return px;
+    if (qy == _sweep)
+        return qx;
+    const double dp = 2 * (py - _sweep);
+    const double dq = 2 * (qy - _sweep);
+    const double a = 1 / dp - 1 / dq;
+    const double b = -2 * (px / dp - qx / dq);
+    const double c = (px * px + py * py - _sweep * _sweep) / dp
+                     - (qx * qx + qy * qy - _sweep * _sweep) / dq;
+    // the left arc is lower on the left of the breakpoint, that is always the
+    // (-b + sqrt) / 2a root, written to avoid cancellation
+    const double s = std::sqrt(std::max(0.0, b * b - 4 * a * c));
+    if (b < 0)
+        return (-b + s) / (2 * a);
+    return (2 * c) / (-b - s);
 }
 
-BeachLineItr getItr(BeachLineItem* item)
+template<class Kernel>
+typename BasicFortuneVoronoi<Kernel>::Arc* BasicFortuneVoronoi<Kernel>::arcAbove(double _x, double _sweep) const
 {
-    BeachLineItr itr = beach_line.begin();
-    while (itr != beach_line.end() && *itr != item)
-    {
-        itr++;
+    Arc* node = root;
+    while (node) {
+        if (node->prev && _x < breakpoint(node->prev->site, node->site, _sweep))
+            node = node->left;
+        else if (node->next && _x > breakpoint(node->site, node->next->site, _sweep))
+            node = node->right;
+        else
+            return node;
     }
-    return itr;
+    return nullptr;
 }
 
-void addCircleEvents(BeachLineItem* middle_arc)
+template<class Kernel>
+void BasicFortuneVoronoi<Kernel>::rotateUp(Arc* _node)
 {
-    // Check 3 arcs sequence ending current arc circle event
-    if (middle_arc != nullptr && middle_arc->prev_arc != nullptr && middle_arc->next_arc != nullptr)
-    {
-        // Check the intersection of 2 edges separating above arcs
-        BeachLineItem* edg1 = middle_arc->prev_edge;
-        BeachLineItem* edg2 = middle_arc->next_edge;
-        Point2d* intersection_point = new Point2d();
-
-        bool is_intersect = intersect(edg1->edge, edg2->edge, *intersection_point);
-        bool has_higher_cycle_events = false;
-
-        if (is_intersect)
-        {
-            //Finding the circle event Y_. which is (intersection.y - circle.radius)
-            float circle_radius = distance(*intersection_point, middle_arc->site);
-            float circle_event_y = (*intersection_point)[Y_] - circle_radius;
-
-            // If there is already a circle event for this arc, check the y coordinates.
-            // If already exsisting event's y coordinate is lower we can replace the circle event with the new one
-
-            //if (middle_arc->event)
-            //{
-            //	// Make previous circle event invalid one from queue
-            //	if (middle_arc->event->site[Y_] > circle_event_y)
-            //		middle_arc->event->valid = false;
-            //	else
-            //		return; // If the previous circle event's y coordinate is higher we keep that event
-            //}
-
-            for (auto event : middle_arc->events)
-            {
-                if (event->site[Y_] < circle_event_y)
-                    event->valid = false;
-                else
-                    has_higher_cycle_events = true;
-            }
-
-            if (!has_higher_cycle_events)
-            {
-                Event* circle_event = new Event();
-                circle_event->type = EVENT_TYPE::CIRCLE;
-                circle_event->arc = middle_arc;
-                circle_event->site = Point2d((*intersection_point)[X_], circle_event_y);
-                circle_event->intersetion_point = intersection_point;
-                p_queue.push(circle_event);
-
-                middle_arc->events.push_back(circle_event);
-            }
-        }
+    Arc* parent = _node->parent;
+    Arc* grand = parent->parent;
+    if (parent->left == _node) {
+        parent->left = _node->right;
+        if (_node->right) _node->right->parent = parent;
+        _node->right = parent;
     }
+    else {
+        parent->right = _node->left;
+        if (_node->left) _node->left->parent = parent;
+        _node->left = parent;
+    }
+    parent->parent = _node;
+    _node->parent = grand;
+    if (!grand)
+        root = _node;
+    else if (grand->left == parent)
+        grand->left = _node;
+    else
+        grand->right = _node;
 }
 
-void handleSiteEvent(Event* event)
+// Insert _node directly after _at in beach line order (at the front when _at is null)
+template<class Kernel>
+void BasicFortuneVoronoi<Kernel>::insertAfter(Arc* _at, Arc* _node)
 {
-    // In site events new arcs is going to form
-    if (beach_line.empty())
-    {
-        // Beach line is emptry. So add the item(Arc) and return
-        BeachLineItem* item = new BeachLineItem();
-        item->type = BEACH_ITEM_TYPE::ARC;
-        item->site = event->site;
-        beach_line.push_back(item);
+    if (!root) {
+        root = _node;
         return;
     }
-    else
-    {
-        // Need to find the Arc directly above this site
-        BeachLineItr arc_above_itr = getArcAbove(event->site);
-        BeachLineItr new_arc_itr = addNewArc(arc_above_itr, event->site);
-
-        addCircleEvents((*new_arc_itr)->prev_arc);
-        addCircleEvents((*new_arc_itr)->next_arc);
+    if (!_at) {
+        Arc* first = root;
+        while (first->left) first = first->left;
+        first->left = _node;
+        _node->parent = first;
+        _node->next = first;
+        first->prev = _node;
     }
+    else {
+        if (!_at->right) {
+            _at->right = _node;
+            _node->parent = _at;
+        }
+        else {
+            Arc* succ = _at->right;
+            while (succ->left) succ = succ->left;
+            succ->left = _node;
+            _node->parent = succ;
+        }
+        _node->prev = _at;
+        _node->next = _at->next;
+        if (_at->next) _at->next->prev = _node;
+        _at->next = _node;
+    }
+    while (_node->parent && _node->parent->priority < _node->priority)
+        rotateUp(_node);
 }
 
-void handleCircleEvent(Event* event, std::vector<Edge2dSimple>& _edges)
+template<class Kernel>
+void BasicFortuneVoronoi<Kernel>::erase(Arc* _node)
 {
-    // In circle events, exsisting arcs are going to shrink to a point
-    // Delete el,an,er related to current circle event
-    BeachLineItem* arc_to_remove = event->arc;
-    BeachLineItr itr = getItr(arc_to_remove);
-
-    Point2d left_point = arc_to_remove->prev_edge->edge.point();
-    Point2d right_point = arc_to_remove->next_edge->edge.point();
-    arc_to_remove->prev_edge->is_completed_edge = true;
-    arc_to_remove->next_edge->is_completed_edge = true;
-
-    Edge2dSimple edg1(left_point, *event->intersetion_point);
-    Edge2dSimple edg2(right_point, *event->intersetion_point);
-    edg1.fp1 = arc_to_remove->prev_arc->site;
-    edg1.fp2 = arc_to_remove->site;
-    edg2.fp1 = arc_to_remove->site;
-    edg2.fp2 = arc_to_remove->next_arc->site;
-
-    // Add two completed edges
-    _edges.push_back(edg1);
-    _edges.push_back(edg2);
-
-    // Remove the arc and add new edge for arc left and right to circle event arc.
-    Point2d* start_point = event->intersetion_point;
-
-    float dir_x = 0.0;
-    float dir_y = 0.0;
-
-    BeachLineItem* left_arc = arc_to_remove->prev_arc;
-    BeachLineItem* right_arc = arc_to_remove->next_arc;
-
-    if (left_arc && right_arc)
-    {
-        Vector2f fnfo = right_arc->site - left_arc->site;	 // Direction vector from new site to arc_to_replace->site
-        dir_x = fnfo[Y_];
-        dir_y = -fnfo[X_];
+    while (_node->left || _node->right) {
+        Arc* child = !_node->left ? _node->right
+                     : !_node->right ? _node->left
+                     : (_node->left->priority > _node->right->priority ? _node->left : _node->right);
+        rotateUp(child);
     }
+    if (!_node->parent)
+        root = nullptr;
+    else if (_node->parent->left == _node)
+        _node->parent->left = nullptr;
     else
-    {
-        dir_y = -1;
-    }
+        _node->parent->right = nullptr;
+    if (_node->prev) _node->prev->next = _node->next;
+    if (_node->next) _node->next->prev = _node->prev;
+    freeArc(_node);
+}
 
-    Vector2f dir(dir_x, dir_y);								// Prependicular vector to fnfo
-    EdgeItem edge(*start_point, dir);
+//*****************************************************************************
+// Events
+//*****************************************************************************
 
-    BeachLineItem* new_edge = new BeachLineItem();
-    new_edge->type = BEACH_ITEM_TYPE::EDGE;
-    new_edge->edge = edge;
+template<class Kernel>
+int BasicFortuneVoronoi<Kernel>::newEdge(uint32_t _a, uint32_t _b)
+{
+    VoronoiEdge e;
+    e.site[0] = _a;
+    e.site[1] = _b;
+    edges.push_back(e);
+    return static_cast<int>(edges.size()) - 1;
+}
 
-    if (left_arc)
-    {
-        left_arc->next_arc = right_arc;
-        left_arc->next_edge = new_edge;
-    }
+// The breakpoint between _left and _right moves along the bisector, away from
+// the swept region, in direction perp(_right - _left).
+template<class Kernel>
+void BasicFortuneVoronoi<Kernel>::openEnd(int _edge, int _end, uint32_t _left, uint32_t _right)
+{
+    edges[_edge].dx[_end] = sy[_right] - sy[_left];
+    edges[_edge].dy[_end] = -(sx[_right] - sx[_left]);
+}
 
-    if (right_arc)
-    {
-        right_arc->prev_arc = left_arc;
-        right_arc->prev_edge = new_edge;
-    }
+template<class Kernel>
+void BasicFortuneVoronoi<Kernel>::closeEnd(int _edge, int _end, double _x, double _y)
+{
+    edges[_edge].closed[_end] = true;
+    edges[_edge].x[_end] = _x;
+    edges[_edge].y[_end] = _y;
+}
 
-    itr--; // go to the previous edge itr
-    BeachLineItr itr3 = itr;
-    std::advance(itr3, 3);
+template<class Kernel>
+void BasicFortuneVoronoi<Kernel>::checkCircle(Arc* _arc, double _sweep)
+{
+    _arc->stamp++;   // drops any event already queued for this arc
+    Arc* a = _arc->prev;
+    Arc* c = _arc->next;
+    if (!a || !c || a->site == c->site)
+        return;
+    const uint32_t i = a->site, j = _arc->site, k = c->site;
+    // with the sweep moving down the middle arc only shrinks on a clockwise turn
+    if (Kernel::orientation2d(sx[i], sy[i], sx[j], sy[j], sx[k], sy[k]) >= 0)
+        return;
 
-    BeachLineItr itr1 = itr;
-    itr1++;
-    //if ((*itr1)->event && (*itr1)->event->type == EVENT_TYPE::CIRCLE)
-    //	(*itr1)->event->valid = false;
+    const double bx = sx[j] - sx[i], by = sy[j] - sy[i];
+    const double cx = sx[k] - sx[i], cy = sy[k] - sy[i];
+    const double d = 2 * (bx * cy - by * cx);
+    const double b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+    const double ux = (cy * b2 - by * c2) / d;
+    const double uy = (bx * c2 - cx * b2) / d;
+    const double radius = std::sqrt(ux * ux + uy * uy);
+    CircleEvent event;
+    event.cx = sx[i] + ux;
+    event.cy = sy[i] + uy;
+    event.x = event.cx;
+    event.y = std::min(event.cy - radius, _sweep);
+    event.arc = _arc;
+    event.stamp = _arc->stamp;
+    circles.push(event);
+}
 
-    for (auto event : (*itr1)->events)
-    {
-        if (event->type == EVENT_TYPE::CIRCLE)
-            event->valid = false;
+template<class Kernel>
+void BasicFortuneVoronoi<Kernel>::siteEvent(uint32_t _site)
+{
+    const double sweep = sy[_site];
+    if (!root) {
+        insertAfter(nullptr, newArc(_site));
+        return;
+    }
+    Arc* above = arcAbove(sx[_site], sweep);
+
+    if (sy[above->site] == sweep) {
+        // only happens for the first row of sites sharing the top y, they come
+        // left to right so the new arc goes at the end with a vertical edge
+        Arc* arc = newArc(_site);
+        insertAfter(above, arc);
+        above->edge = newEdge(above->site, _site);
+        above->end = 1;
+        edges[above->edge].dx[0] = 0;
+        edges[above->edge].dy[0] = 1;
+        openEnd(above->edge, 1, above->site, _site);
+        return;
     }
 
-    beach_line.erase(itr, itr3);
-    beach_line.insert(itr3, new_edge);
-
-    // Clean up the memory
-    //if(arc_to_remove->prev_edge)
-    //	delete arc_to_remove->prev_edge;
-    //if (arc_to_remove->next_edge)
-    //	delete arc_to_remove->next_edge;
-    //delete arc_to_remove;
-
-    // Need to check for circle event due to this change in beach line
-    // two checks, one as left arc as middle and second as right arc as circle event
-    addCircleEvents(left_arc);
-    addCircleEvents(right_arc);
+    // split the arc above into above | new | copy of above
+    Arc* middle = newArc(_site);
+    Arc* right = newArc(above->site);
+    right->edge = above->edge;
+    right->end = above->end;
+    insertAfter(above, middle);
+    insertAfter(middle, right);
+
+    const int e = newEdge(above->site, _site);
+    above->edge = e;
+    above->end = 0;
+    middle->edge = e;
+    middle->end = 1;
+    openEnd(e, 0, above->site, _site);
+    openEnd(e, 1, _site, above->site);
+
+    checkCircle(above, sweep);
+    checkCircle(right, sweep);
 }
 
-void rez::constructVoronoiDiagram_fortunes(std::vector<rez::Point2d>& _points_list, std::vector<rez::Edge2dSimple>& _edges,
-                                           BoundRectangle& rect)
+template<class Kernel>
+void BasicFortuneVoronoi<Kernel>::circleEvent(const CircleEvent& _event)
 {
-    // We need a unique list of points.
-    std::sort(_points_list.begin(), _points_list.end(), sort2DTBLR);
-    std::unique(_points_list.begin(), _points_list.end());
-
-    for (Point2d& point : _points_list)
-    {
-        Event* event = new Event();
-        event->site = point;
-        p_queue.push(event);
-    }
+    Arc* arc = _event.arc;
+    Arc* a = arc->prev;
+    Arc* c = arc->next;
+    vertex_count++;
+
+    closeEnd(a->edge, a->end, _event.cx, _event.cy);
+    closeEnd(arc->edge, arc->end, _event.cx, _event.cy);
+
+    const int e = newEdge(a->site, c->site);
+    closeEnd(e, 0, _event.cx, _event.cy);
+    openEnd(e, 1, a->site, c->site);
+    a->edge = e;
+    a->end = 1;
+
+    erase(arc);
+    checkCircle(a, _event.y);
+    checkCircle(c, _event.y);
+}
 
-    int count = 0;
+//*****************************************************************************
+// Driver
+//*****************************************************************************
 
-    while (!p_queue.empty())
-    {
-        Event* event = p_queue.top();
-        p_queue.pop();
+bool rez::clipLineToRect(double px, double py, double dx, double dy, double& t0, double& t1,
+                         const BoundRectangle& rect)
+{
+    const double p[4] = { -dx, dx, -dy, dy };
+    const double q[4] = { px - rect.left_x, rect.right_x - px, py - rect.bot_y, rect.top_y - py };
+    for (int i = 0; i < 4; i++) {
+        if (p[i] == 0) {
+            if (q[i] < 0)
+                return false;
+            continue;
+        }
+        const double r = q[i] / p[i];
+        if (p[i] < 0)
+            t0 = std::max(t0, r);
+        else
+            t1 = std::min(t1, r);
+    }
+    return t0 <= t1;
+}
 
-        //std::cout << "iteration " << ++count << " Queue size " << p_queue.size() << std::endl;
+template<class Kernel>
+void BasicFortuneVoronoi<Kernel>::compute(const std::vector<Point2d>& _sites, const BoundRectangle& _rect,
+                             std::vector<Edge2dSimple>& _edges)
+{
+    // Sweep from top to bottom, left to right on ties. Duplicates are dropped.
+    std::vector<Point2d> sorted(_sites);
+    std::sort(sorted.begin(), sorted.end(), sort2DTBLR);
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    sx.resize(sorted.size());
+    sy.resize(sorted.size());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        sx[i] = sorted[i][X_];
+        sy[i] = sorted[i][Y_];
+    }
+    edges.clear();
+    _edges.clear();
+    circles = std::priority_queue<CircleEvent>();
+    root = nullptr;
+    vertex_count = 0;
+    resetPool();
+
+    size_t next_site = 0;
+    while (next_site < sorted.size() || !circles.empty()) {
+        if (!circles.empty() && (next_site == sorted.size() || circles.top().y >= sy[next_site])) {
+            const CircleEvent event = circles.top();
+            circles.pop();
+            if (event.stamp == event.arc->stamp)
+                circleEvent(event);
+        }
+        else {
+            siteEvent(static_cast<uint32_t>(next_site++));
+        }
+    }
 
-        if (event->valid)
-        {
-            if (event->type == EVENT_TYPE::SITE)
-                handleSiteEvent(event);
+    // Every edge lies on the bisector of its sites, parametrize it as m + t * u
+    // and turn the closed / open ends into a range of t before clipping.
+    const double inf = std::numeric_limits<double>::infinity();
+    for (const VoronoiEdge& e : edges) {
+        const uint32_t a = e.site[0], b = e.site[1];
+        const double mx = (sx[a] + sx[b]) / 2, my = (sy[a] + sy[b]) / 2;
+        const double ux = sy[b] - sy[a], uy = -(sx[b] - sx[a]);
+        const double uu = ux * ux + uy * uy;
+        double t[2];
+        for (int k = 0; k < 2; k++) {
+            if (e.closed[k])
+                t[k] = ((e.x[k] - mx) * ux + (e.y[k] - my) * uy) / uu;
             else
-                handleCircleEvent(event, _edges);
+                t[k] = (e.dx[k] * ux + e.dy[k] * uy) > 0 ? inf : -inf;
         }
+        double t0 = std::min(t[0], t[1]), t1 = std::max(t[0], t[1]);
+        if (!clipLineToRect(mx, my, ux, uy, t0, t1, _rect))
+            continue;
+        Edge2dSimple edge(Point2d(static_cast<float>(mx + t0 * ux), static_cast<float>(my + t0 * uy)),
+                          Point2d(static_cast<float>(mx + t1 * ux), static_cast<float>(my + t1 * uy)));
+        edge.fp1 = sorted[a];
+        edge.fp2 = sorted[b];
+        _edges.push_back(edge);
     }
+}
 
-    // Need to process the remaining edges in beach line inorder to construct edges extending outwards
-    // the center of points
-
-    int x = 0;
+template<class Kernel>
+size_t BasicFortuneVoronoi<Kernel>::vertexCount() const
+{
+    return vertex_count;
+}
 
-    for (BeachLineItem* item : beach_line)
-    {
-        if (item->type == BEACH_ITEM_TYPE::EDGE)
-        {
-            x++;
-            add_outer_edge(item, rect, _edges);
+template class rez::BasicFortuneVoronoi<FilteredKernel>;
+template class rez::BasicFortuneVoronoi<InexactKernel>;
 
-            //if(x==2)
-            //	break;
-        }
-    }
-}
\ No newline at end of file
+void rez::constructVoronoiDiagram_fortunes(std::vector<rez::Point2d>& _points_list, std::vector<rez::Edge2dSimple>& _edges,
+                                           BoundRectangle& rect)
+{
+    FortuneVoronoi voronoi;
+    voronoi.compute(_points_list, rect, _edges);
+}
@@ -4,10 +4,14 @@
 
 #ifndef PHYSICSFORMULA_VORONOI_H
 #define PHYSICSFORMULA_VORONOI_H
+#include <cstdint>
+#include <memory>
+#include <queue>
 #include <vector>
 #include "Point.h"
 #include "Polygon.h"
 #include "Bounds.h"
+#include "Kernel.h"
 
 // Implementation of Voronoi diagram calculation and related utility functions.
 namespace rez
@@ -17,5 +21,96 @@ namespace rez
 
     // Compute the voronoi diagram using fortune's algorithm
     void constructVoronoiDiagram_fortunes(std::vector<Point2d>&, std::vector<Edge2dSimple>&, BoundRectangle& rect);
+
+    // Clip the parametric range [t0, t1] of p + t * d to the rectangle (Liang-Barsky),
+    // false when nothing of it is left
+    bool clipLineToRect(double px, double py, double dx, double dy, double& t0, double& t1,
+                        const BoundRectangle& rect);
+
+    // Self contained Fortune's sweep. All state lives in the object, so separate
+    // instances can run on different threads. The beach line is a treap keyed by
+    // position (O(log n) arc lookup), arcs come from a pool that is kept between
+    // runs and circle events are plain values invalidated lazily by a stamp. The
+    // turn deciding whether three arcs meet comes from Kernel.
+    template<class Kernel>
+    class BasicFortuneVoronoi {
+        struct Arc {
+            Arc* left = nullptr;     // treap links
+            Arc* right = nullptr;
+            Arc* parent = nullptr;
+            Arc* prev = nullptr;     // beach line neighbours
+            Arc* next = nullptr;
+            uint32_t priority = 0;
+            uint32_t site = 0;
+            uint32_t stamp = 0;      // circle events carrying an older stamp are stale
+            int edge = -1;           // edge traced by the breakpoint with next
+            int end = 0;             // which end of that edge the breakpoint traces
+        };
+
+        struct CircleEvent {
+            double y, x;             // bottom of the circle, the event position
+            double cx, cy;           // Voronoi vertex
+            Arc* arc;
+            uint32_t stamp;
+
+            bool operator<(const CircleEvent& _other) const
+            {
+                return y < _other.y || (y == _other.y && x > _other.x);
+            }
+        };
+
+        struct VoronoiEdge {
+            uint32_t site[2];
+            bool closed[2] = { false, false };
+            double x[2] = { 0, 0 }, y[2] = { 0, 0 };     // vertex of a closed end
+            double dx[2] = { 0, 0 }, dy[2] = { 0, 0 };   // direction of an open end
+        };
+
+        std::vector<double> sx, sy;
+        std::vector<VoronoiEdge> edges;
+        std::priority_queue<CircleEvent> circles;
+        Arc* root = nullptr;
+        size_t vertex_count = 0;
+        uint32_t random_state = 0x9E3779B9u;
+
+        // pooled arc storage, blocks are kept between runs
+        std::vector<std::unique_ptr<Arc[]>> blocks;
+        std::vector<Arc*> free_arcs;
+        size_t used_in_block = 0;
+        static const size_t BLOCK_SIZE = 1024;
+
+        Arc* newArc(uint32_t _site);
+        void freeArc(Arc* _arc);
+        void resetPool();
+
+        double breakpoint(uint32_t _left, uint32_t _right, double _sweep) const;
+        Arc* arcAbove(double _x, double _sweep) const;
+        void rotateUp(Arc* _node);
+        void insertAfter(Arc* _at, Arc* _node);
+        void erase(Arc* _node);
+
+        int newEdge(uint32_t _a, uint32_t _b);
+        void openEnd(int _edge, int _end, uint32_t _left, uint32_t _right);
+        void closeEnd(int _edge, int _end, double _x, double _y);
+        void checkCircle(Arc* _arc, double _sweep);
+        void siteEvent(uint32_t _site);
+        void circleEvent(const CircleEvent& _event);
+
+    public:
+        /**
+         * @brief computes the diagram of _sites clipped to _rect
+         * @param _sites input sites, duplicates are ignored
+         * @param _rect clipping rectangle for the unbounded edges
+         * @param _edges cleared, then receives one segment per Voronoi edge,
+         * fp1 / fp2 are the two sites the edge separates
+         */
+        void compute(const std::vector<Point2d>& _sites, const BoundRectangle& _rect,
+                     std::vector<Edge2dSimple>& _edges);
+
+        // number of Voronoi vertices found by the last compute
+        size_t vertexCount() const;
+    };
+
+    typedef BasicFortuneVoronoi<FilteredKernel> FortuneVoronoi;
 }
 #endif //PHYSICSFORMULA_VORONOI_H
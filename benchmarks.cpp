@@ -0,0 +1,591 @@
+// Timings of the optimized algorithms against the code they replaced or a
+// reference implementation, one function per module. Not run by ctest, the
+// sections take minutes. Name sections on the command line to run only
+// those, e.g. "benchmarks gemm".
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+#include <Eigen/Dense>
+#include "GeoUtils.h"
+#include "KDTree.h"
+#include "KDTreeND.h"
+#include "MatrixEigen.h"
+#include "MatrixND.h"
+#include "ModelTrainer.h"
+#include "NBody.h"
+#include "ParticleSystem.h"
+#include "QuadTree.h"
+
+namespace {
+    // every timing repeats its body for at least this long
+    constexpr double MIN_SECONDS = 0.2;
+
+    std::vector<const char*> sections;
+
+    bool wanted(const char* _name)
+    {
+        if (sections.empty())
+            return true;
+        for (const char* section : sections)
+            if (std::strcmp(section, _name) == 0)
+                return true;
+        return false;
+    }
+
+    // mean milliseconds per call of _body
+    template<typename F>
+    double milliseconds(F&& _body)
+    {
+        using clock = std::chrono::steady_clock;
+        const auto start = clock::now();
+        int calls = 0;
+        double elapsed = 0;
+        do {
+            _body();
+            calls++;
+            elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        } while (elapsed < MIN_SECONDS);
+        return 1000.0 * elapsed / calls;
+    }
+
+    void title(const char* _name, const char* _columns)
+    {
+        std::printf("\n%s\n%s\n", _name, _columns);
+    }
+}
+
+//*****************************************************************************
+// MatrixMultiply.h
+//*****************************************************************************
+// the triple loop MatrixND::mult used before the packed kernels
+static void loopProduct(const MatrixND<double>& _a, const MatrixND<double>& _b, MatrixND<double>& _c)
+{
+    for (int i = 0; i < _a.rows; i++)
+        for (int j = 0; j < _b.cols; j++) {
+            double sum = 0;
+            for (int k = 0; k < _a.cols; k++)
+                sum += _a.data[i * _a.cols + k] * _b.data[k * _b.cols + j];
+            _c.data[i * _b.cols + j] = sum;
+        }
+}
+
+static void benchGemm()
+{
+    using EigenMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+    // the loop takes minutes past this size
+    constexpr int LOOP_MAX = 1024;
+
+    title("gemm: n x n double products, ms per product",
+          "     n         loop         gemm        Eigen   gemm GFLOP/s");
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    for (int n = 8; n <= 4096; n *= 2) {
+        MatrixND<double> a(n, n), b(n, n), c(n, n);
+        for (auto& v : a.data)
+            v = value(random);
+        for (auto& v : b.data)
+            v = value(random);
+        const EigenMatrix ea = Eigen::Map<EigenMatrix>(a.data.data(), n, n);
+        const EigenMatrix eb = Eigen::Map<EigenMatrix>(b.data.data(), n, n);
+        EigenMatrix ec(n, n);
+
+        const double loop = n <= LOOP_MAX ? milliseconds([&] { loopProduct(a, b, c); }) : 0;
+        const double gemm = milliseconds([&] { c = a * b; });
+        const double eigen = milliseconds([&] { ec.noalias() = ea * eb; });
+        const double gflops = 2.0 * n * n * n / (gemm * 1e6);
+        if (n <= LOOP_MAX)
+            std::printf("%6d %12.3f %12.3f %12.3f %14.1f\n", n, loop, gemm, eigen, gflops);
+        else
+            std::printf("%6d %12s %12.3f %12.3f %14.1f\n", n, "-", gemm, eigen, gflops);
+    }
+}
+
+//*****************************************************************************
+// MatrixExpressions.h
+//*****************************************************************************
+// every allocation of the program, read around the expression timings
+static std::atomic<size_t> allocations{ 0 };
+
+// malloc and free do pair up, GCC takes the inlined free for a new/free mismatch
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(std::size_t _bytes)
+{
+    allocations++;
+    if (void* memory = std::malloc(_bytes ? _bytes : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* _memory) noexcept
+{
+    std::free(_memory);
+}
+
+void operator delete(void* _memory, std::size_t) noexcept
+{
+    std::free(_memory);
+}
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+// allocations per call of _body, after a first call that sizes the outputs
+template<typename F>
+static double allocationsPerCall(F&& _body)
+{
+    constexpr int CALLS = 10;
+    _body();
+    const size_t before = allocations;
+    for (int i = 0; i < CALLS; i++)
+        _body();
+    return double(allocations - before) / CALLS;
+}
+
+static void benchExpressions()
+{
+    title("expressions: eager temporaries against one fused loop, n x n doubles",
+          "     n  chain                    eager ms   allocs     fused ms   allocs");
+    std::mt19937 random(3);
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    const double alpha = 0.01;
+    for (int n : { 64, 256, 1024, 2048 }) {
+        MatrixND<double> a(n, n), b(n, n), c(n, n), out(n, n);
+        for (auto* m : { &a, &b, &c })
+            for (auto& v : m->data)
+                v = value(random);
+
+        // the gradient step of LinearRegression, theta - gradient * alpha
+        auto eagerStep = [&] {
+            MatrixND<double> scaled = b * alpha;
+            MatrixND<double> step = a - scaled;
+            out = std::move(step);
+        };
+        auto fusedStep = [&] { out = a - b * alpha; };
+        std::printf("%6d  %-22s %10.3f %8.1f %12.3f %8.1f\n", n, "a - b * alpha",
+                    milliseconds(eagerStep), allocationsPerCall(eagerStep),
+                    milliseconds(fusedStep), allocationsPerCall(fusedStep));
+
+        auto eagerChain = [&] {
+            MatrixND<double> scaled = a * alpha;
+            MatrixND<double> sum = scaled + b;
+            MatrixND<double> difference = sum - c;
+            out = std::move(difference);
+        };
+        auto fusedChain = [&] { out = a * alpha + b - c; };
+        std::printf("%6d  %-22s %10.3f %8.1f %12.3f %8.1f\n", n, "a * alpha + b - c",
+                    milliseconds(eagerChain), allocationsPerCall(eagerChain),
+                    milliseconds(fusedChain), allocationsPerCall(fusedChain));
+    }
+}
+
+//*****************************************************************************
+// KDTreeND.h
+//*****************************************************************************
+static void benchKDTree()
+{
+    constexpr size_t POINTS = 10000000;
+    constexpr size_t QUERIES = 100000;
+    constexpr size_t SCANNED = 20;
+    constexpr size_t K = 8;
+    // about 16 points inside at this density
+    constexpr float RADIUS = 7.1e-4f;
+    using Tree = rez::KDTreeND<float, DIM2>;
+
+    title("kdtree: 10M uniform points in the unit square",
+          "operation                      ms   queries/s");
+    std::mt19937 random(4);
+    std::uniform_real_distribution<float> coordinate(0.0f, 1.0f);
+    std::vector<Tree::point_type> points(POINTS), queries(QUERIES);
+    for (auto& p : points)
+        p = Tree::point_type(coordinate(random), coordinate(random));
+    for (auto& q : queries)
+        q = Tree::point_type(coordinate(random), coordinate(random));
+    auto report = [](const char* _operation, double _ms, size_t _queries) {
+        std::printf("%-24s %10.1f %11.0f\n", _operation, _ms, _queries * 1000.0 / _ms);
+    };
+
+    Tree tree;
+    std::printf("%-24s %10.1f %11s\n", "build", milliseconds([&] { tree = Tree(points); }), "-");
+
+    // the k nearest by a linear scan, for scale
+    const double scan = milliseconds([&] {
+        std::vector<Tree::Neighbour> best;
+        for (size_t i = 0; i < SCANNED; i++) {
+            best.clear();
+            for (size_t j = 0; j < POINTS; j++) {
+                const float dx = points[j][X_] - queries[i][X_], dy = points[j][Y_] - queries[i][Y_];
+                const float d2 = dx * dx + dy * dy;
+                if (best.size() == K && d2 >= best.front().squaredDistance)
+                    continue;
+                if (best.size() == K) {
+                    std::pop_heap(best.begin(), best.end());
+                    best.pop_back();
+                }
+                best.push_back({ j, d2 });
+                std::push_heap(best.begin(), best.end());
+            }
+        }
+    });
+    report("8 nearest, linear scan", scan, SCANNED);
+
+    report("8 nearest", milliseconds([&] {
+        for (const auto& q : queries)
+            tree.kNearest(q, K);
+    }), QUERIES);
+    report("8 nearest, batched", milliseconds([&] { tree.kNearest(queries, K); }), QUERIES);
+    report("radius", milliseconds([&] {
+        for (const auto& q : queries)
+            tree.radiusSearch(q, RADIUS);
+    }), QUERIES);
+    report("radius, batched", milliseconds([&] { tree.radiusSearch(queries, RADIUS); }), QUERIES);
+}
+
+//*****************************************************************************
+// MatrixEigen.h
+//*****************************************************************************
+static void benchEigen()
+{
+    using EigenMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+    title("eigen: symmetric n x n, ms per decomposition, values only and with vectors",
+          "     n     rez values    Eigen values    rez vectors   Eigen vectors   max value error");
+    std::mt19937 random(8);
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    for (int n : { 64, 128, 256, 512, 1024 }) {
+        MatrixND<double> a(n, n);
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j <= i; j++)
+                a.data[i * n + j] = a.data[j * n + i] = value(random);
+        const EigenMatrix ea = Eigen::Map<EigenMatrix>(a.data.data(), n, n);
+
+        const double values = milliseconds([&] { rez::SymmetricEigenSolver<double> solver(a, false); });
+        const double eigenValues = milliseconds([&] {
+            Eigen::SelfAdjointEigenSolver<EigenMatrix> solver(ea, Eigen::EigenvaluesOnly);
+        });
+        const double vectors = milliseconds([&] { rez::SymmetricEigenSolver<double> solver(a); });
+        const double eigenVectors = milliseconds([&] { Eigen::SelfAdjointEigenSolver<EigenMatrix> solver(ea); });
+
+        // both sort the eigenvalues ascending
+        const rez::SymmetricEigenSolver<double> solver(a, false);
+        const Eigen::SelfAdjointEigenSolver<EigenMatrix> reference(ea, Eigen::EigenvaluesOnly);
+        double error = 0;
+        for (int k = 0; k < n; k++)
+            error = std::max(error, std::abs(solver.eigenvalues()[k] - reference.eigenvalues()[k]));
+        std::printf("%6d %14.3f %15.3f %14.3f %15.3f %17.2e\n", n, values, eigenValues, vectors, eigenVectors,
+                    error);
+    }
+
+    title("eigen: general n x n, ms per decomposition with vectors",
+          "     n            rez           Eigen");
+    for (int n : { 64, 128, 256, 512 }) {
+        MatrixND<double> a(n, n);
+        for (auto& v : a.data)
+            v = value(random);
+        const EigenMatrix ea = Eigen::Map<EigenMatrix>(a.data.data(), n, n);
+        const double general = milliseconds([&] { rez::EigenSolver<double> solver(a); });
+        const double eigenGeneral = milliseconds([&] { Eigen::EigenSolver<EigenMatrix> solver(ea); });
+        std::printf("%6d %14.3f %15.3f\n", n, general, eigenGeneral);
+    }
+}
+
+//*****************************************************************************
+// GeoUtils.h
+//*****************************************************************************
+static void benchPredicates()
+{
+    constexpr size_t POINTS = 10000000;
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    title("predicates: orientation of 10M points against one edge, millions per second",
+          "points      orientation2d   exact loop   batch 1 thread   batch all threads");
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+    const rez::Point2d a(-1.0f, -1.0f), b(1.0f, 1.0f);
+    for (bool degenerate : { false, true }) {
+        // points on the line through [a b] are beyond the filter, the exact
+        // arithmetic decides every one of them
+        std::vector<rez::Point2d> points(POINTS);
+        for (auto& p : points) {
+            const float t = coordinate(random);
+            p = degenerate ? rez::Point2d(t, t) : rez::Point2d(t, coordinate(random));
+        }
+        const rez::Points2dSoA soa(points);
+        std::vector<int8_t> signs(POINTS);
+        long sink = 0;
+
+        const double scalar = milliseconds([&] {
+            for (const rez::Point2d& p : points)
+                sink += rez::orientation2d(a, b, p);
+        });
+        const double exact = milliseconds([&] {
+            for (const rez::Point2d& p : points)
+                sink += rez::orientation2dExact(a, b, p);
+        });
+        const double batch = milliseconds([&] { rez::orientation2dBatch(a, b, soa, signs, 1); });
+        const double parallel = milliseconds([&] { rez::orientation2dBatch(a, b, soa, signs, threads); });
+        const double millions = POINTS / 1000.0;
+        std::printf("%-11s %13.1f %12.1f %16.1f %19.1f\n", degenerate ? "collinear" : "uniform",
+                    millions / scalar, millions / exact, millions / batch, millions / parallel);
+        if (sink == 42)
+            std::printf(" ");
+    }
+}
+
+//*****************************************************************************
+// ModelTrainer.h
+//*****************************************************************************
+static void benchTrainer()
+{
+    constexpr int ROWS = 10000000;
+    constexpr int FEATURES = 8;
+    constexpr int EPOCHS = 3;
+
+    title("trainer: 10M rows of 8 features, epochs per second",
+          "loss        optimizer               threads   epochs/s");
+    std::mt19937 random(9);
+    std::normal_distribution<double> value(0.0, 1.0);
+    MatrixND<double> x(ROWS, FEATURES), squared(ROWS, 1), labels(ROWS, 1);
+    for (int i = 0; i < ROWS; i++) {
+        double z = 0.5;
+        for (int j = 0; j < FEATURES; j++) {
+            const double v = value(random);
+            x.data[size_t(i) * FEATURES + j] = v;
+            z += (j + 1) * 0.1 * v;
+        }
+        squared.data[i] = z + 0.1 * value(random);
+        labels.data[i] = z + value(random) > 0 ? 1.0 : 0.0;
+    }
+
+    const std::pair<rez::TrainingOptimizer, const char*> optimizers[] = {
+        { rez::TrainingOptimizer::SGD, "gradient descent" },
+        { rez::TrainingOptimizer::Adam, "adam, 65536 rows" },
+        { rez::TrainingOptimizer::LBFGS, "lbfgs" } };
+    for (rez::TrainingLoss loss : { rez::TrainingLoss::Squared, rez::TrainingLoss::Logistic }) {
+        const bool logistic = loss == rez::TrainingLoss::Logistic;
+        rez::LinearModelTrainer<double> trainer(x, logistic ? labels : squared, loss);
+        for (const auto& [optimizer, name] : optimizers)
+            for (size_t threads : { size_t(1), size_t(0) }) {
+                rez::TrainingOptions options;
+                options.optimizer = optimizer;
+                options.epochs = EPOCHS;
+                options.batchSize = optimizer == rez::TrainingOptimizer::Adam ? 65536 : 0;
+                options.learningRate = 0.1;
+                options.threads = threads;
+                const double ms = milliseconds([&] { trainer.fit(options); });
+                std::printf("%-11s %-22s %8s %10.2f\n", logistic ? "logistic" : "squared", name,
+                            threads == 1 ? "1" : "all", EPOCHS * 1000.0 / ms);
+            }
+    }
+    const double normal = milliseconds([&] { rez::solveNormalEquation(x, squared); });
+    std::printf("%-11s %-22s %8s %10.2f\n", "squared", "normal equation", "all", 1000.0 / normal);
+}
+
+//*****************************************************************************
+// NBody.h
+//*****************************************************************************
+static void benchNBody()
+{
+    constexpr size_t BODIES = 50000;
+
+    title("nbody: gravity of 50k masses in a unit ball, error against the direct sum",
+          "method      theta         ms   relative rms error");
+    std::mt19937 random(6);
+    std::uniform_real_distribution<double> coordinate(-1.0, 1.0), mass(1.0, 10.0);
+    rez::NBodyParticles<double> bodies;
+    bodies.reserve(BODIES);
+    while (bodies.size() < BODIES) {
+        const double x = coordinate(random), y = coordinate(random), z = coordinate(random);
+        if (x * x + y * y + z * z <= 1.0)
+            bodies.add(x, y, z, mass(random));
+    }
+
+    rez::NBodyField<double> exact, field;
+    const double direct = milliseconds([&] {
+        rez::NBody<double> nbody(bodies, rez::NBodyInteraction::Gravity, rez::NBodyMethod::Direct);
+        nbody.field(exact);
+    });
+    std::printf("%-11s %5s %10.1f %20s\n", "direct", "-", direct, "-");
+
+    for (rez::NBodyMethod method : { rez::NBodyMethod::BarnesHut, rez::NBodyMethod::FMM })
+        for (double theta : { 0.3, 0.5, 0.8 }) {
+            const double ms = milliseconds([&] {
+                rez::NBody<double> nbody(bodies, rez::NBodyInteraction::Gravity, method, theta);
+                nbody.field(field);
+            });
+            double error = 0, norm = 0;
+            for (size_t i = 0; i < BODIES; i++) {
+                const double dx = field.x[i] - exact.x[i], dy = field.y[i] - exact.y[i], dz = field.z[i] - exact.z[i];
+                error += dx * dx + dy * dy + dz * dz;
+                norm += exact.x[i] * exact.x[i] + exact.y[i] * exact.y[i] + exact.z[i] * exact.z[i];
+            }
+            std::printf("%-11s %5.1f %10.1f %20.2e\n", method == rez::NBodyMethod::FMM ? "fmm" : "barnes-hut",
+                        theta, ms, std::sqrt(error / norm));
+        }
+}
+
+//*****************************************************************************
+// ParticleSystem.h
+//*****************************************************************************
+static void benchParticles()
+{
+    constexpr size_t PARTICLES = 1000000;
+
+    title("particles: 1M particles under gravity and drag above a floor",
+          "integrator       threads   ms per step   particle steps/s");
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> position(0.0, 100.0), speed(-5.0, 5.0), mass(0.1, 2.0);
+    rez::ParticleState<double> start;
+    start.reserve(PARTICLES);
+    for (size_t i = 0; i < PARTICLES; i++)
+        start.add(position(random), position(random), position(random), speed(random), speed(random),
+                  speed(random), mass(random));
+
+    const std::pair<rez::Integrator, const char*> integrators[] = {
+        { rez::Integrator::VelocityVerlet, "velocity verlet" },
+        { rez::Integrator::Leapfrog, "leapfrog" },
+        { rez::Integrator::RK4, "rk4" } };
+    for (const auto& [integrator, name] : integrators)
+        for (unsigned threads : { 1u, 0u }) {
+            rez::ParticleSystem<double> system(integrator, threads);
+            system.state() = start;
+            system.addForce<rez::UniformGravity<double>>();
+            system.addForce<rez::QuadraticDrag<double>>(0.47, 0.01, 1.225);
+            system.setGround(0.0, 0.5);
+            const double ms = milliseconds([&] { system.step(1e-3); });
+            std::printf("%-16s %7s %13.2f %18.3g\n", name, threads == 1 ? "1" : "all", ms,
+                        PARTICLES * 1000.0 / ms);
+        }
+}
+
+//*****************************************************************************
+// QuadTree.h
+//*****************************************************************************
+// _count points in a 1000 x 1000 square, uniform or in gaussian clusters
+static std::vector<rez::Point2d> spatialData(size_t _count, bool _clustered, std::mt19937& _random)
+{
+    std::uniform_real_distribution<float> coordinate(0.0f, 1000.0f);
+    std::normal_distribution<float> spread(0.0f, 5.0f);
+    std::vector<rez::Point2d> centers(64);
+    for (auto& center : centers)
+        center = rez::Point2d(coordinate(_random), coordinate(_random));
+    std::vector<rez::Point2d> points(_count);
+    for (size_t i = 0; i < _count; i++) {
+        if (!_clustered) {
+            points[i] = rez::Point2d(coordinate(_random), coordinate(_random));
+            continue;
+        }
+        const rez::Point2d& center = centers[i % centers.size()];
+        points[i] = rez::Point2d(std::clamp(center[X_] + spread(_random), 0.0f, 1000.0f),
+                                 std::clamp(center[Y_] + spread(_random), 0.0f, 1000.0f));
+    }
+    return points;
+}
+
+static void benchQuadTree()
+{
+    constexpr size_t POINTS = 1000000;
+    constexpr size_t QUERIES = 10000;
+    constexpr size_t K = 8;
+    // one point in ten moves by up to a unit per update
+    constexpr size_t MOVED = POINTS / 10;
+
+    title("quadtree: 1M points, 10k queries, 100k moves, ms per batch",
+          "data        operation          QuadTree       KDTree");
+    std::mt19937 random(2);
+    for (bool clustered : { false, true }) {
+        const std::vector<rez::Point2d> points = spatialData(POINTS, clustered, random);
+        // queries at data points, so they fall inside the clusters too
+        std::vector<rez::Point2d> queries(QUERIES);
+        for (size_t i = 0; i < QUERIES; i++)
+            queries[i] = points[i * (POINTS / QUERIES)];
+        const char* data = clustered ? "clustered" : "uniform";
+
+        rez::QuadTree quadtree;
+        rez::KDTree kdtree;
+        const double quadBuild = milliseconds([&] { quadtree = rez::QuadTree(points); });
+        const double kdBuild = milliseconds([&] { kdtree = rez::KDTree(points); });
+        std::printf("%-11s %-12s %14.3f %12.3f\n", data, "build", quadBuild, kdBuild);
+
+        // 10 x 10 boxes around the queries
+        std::vector<uint32_t> ids;
+        std::list<rez::Vector2f> found;
+        const double quadRange = milliseconds([&] {
+            for (const rez::Point2d& q : queries) {
+                ids.clear();
+                quadtree.RangeSearch(rez::AABB{ q[X_] - 5, q[X_] + 5, q[Y_] - 5, q[Y_] + 5 }, ids);
+            }
+        });
+        const double kdRange = milliseconds([&] {
+            for (const rez::Point2d& q : queries) {
+                found.clear();
+                kdtree.Search(q[X_] - 5, q[X_] + 5, q[Y_] - 5, q[Y_] + 5, found);
+            }
+        });
+        std::printf("%-11s %-12s %14.3f %12.3f\n", data, "range", quadRange, kdRange);
+
+        std::vector<rez::Vector2f> neighbours;
+        const double quadNearest = milliseconds([&] {
+            for (const rez::Point2d& q : queries)
+                quadtree.KNearest(q, K, ids);
+        });
+        const double kdNearest = milliseconds([&] {
+            for (const rez::Point2d& q : queries)
+                kdtree.KNearest(q, K, neighbours);
+        });
+        std::printf("%-11s %-12s %14.3f %12.3f\n", data, "8 nearest", quadNearest, kdNearest);
+
+        // the quadtree moves the points in place, the kd-tree has to be rebuilt.
+        // Every call flips the moved points between their two positions.
+        std::uniform_real_distribution<float> jitter(-1.0f, 1.0f);
+        std::vector<rez::Point2d> moved[2] = { points, points };
+        for (size_t i = 0; i < MOVED; i++)
+            moved[1][i] = rez::Point2d(moved[1][i][X_] + jitter(random), moved[1][i][Y_] + jitter(random));
+        int side = 0;
+        const double quadMove = milliseconds([&] {
+            side ^= 1;
+            for (uint32_t i = 0; i < MOVED; i++)
+                quadtree.Move(i, moved[side][i]);
+        });
+        const double kdMove = milliseconds([&] {
+            side ^= 1;
+            kdtree = rez::KDTree(moved[side]);
+        });
+        std::printf("%-11s %-12s %14.3f %12.3f\n", data, "update", quadMove, kdMove);
+    }
+}
+
+int main(int _argc, char** _argv)
+{
+    sections.assign(_argv + 1, _argv + _argc);
+    if (wanted("gemm"))
+        benchGemm();
+    if (wanted("expressions"))
+        benchExpressions();
+    if (wanted("eigen"))
+        benchEigen();
+    if (wanted("predicates"))
+        benchPredicates();
+    if (wanted("kdtree"))
+        benchKDTree();
+    if (wanted("trainer"))
+        benchTrainer();
+    if (wanted("nbody"))
+        benchNBody();
+    if (wanted("particles"))
+        benchParticles();
+    if (wanted("quadtree"))
+        benchQuadTree();
+    return 0;
+}
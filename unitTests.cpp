@@ -0,0 +1,538 @@
+// Checks of the numerical and geometric algorithms, one function per module.
+// Prints every failed check and returns the number of failures, so ctest
+// reports the executable as failed when any check does.
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <set>
+#include <vector>
+#include "ColumnarFile.h"
+#include "Convexhull.h"
+#include "CsvReader.h"
+#include "GeoUtils.h"
+#include "Kirschoff.h"
+#include "MatrixDecomposition.h"
+#include "MatrixEigen.h"
+#include "MatrixFixed.h"
+#include "MatrixND.h"
+#include "MatrixReduction.h"
+#include "Polygon.h"
+#include "SparseMatrix.h"
+#include "Triangulation.h"
+#include "Voronoi.h"
+
+namespace {
+    int failures = 0;
+
+    void check(bool _condition, const char* _what, int _line)
+    {
+        if (_condition)
+            return;
+        std::printf("unitTests.cpp:%d: check failed: %s\n", _line, _what);
+        failures++;
+    }
+}
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+// unitTestsMatrixND.cpp, returns its number of failed checks
+int testMatrixNDAlone();
+
+//*****************************************************************************
+// MatrixDecomposition.h
+//*****************************************************************************
+static void testDecomposition()
+{
+    // rank 2, elimination leaves a last pivot of about 1e-16 instead of 0
+    MatrixND<double> singular({ { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 } });
+    rez::LUDecomposition<double> lu(singular);
+    CHECK(lu.isSingular());
+    CHECK(lu.determinant() == 0.0);
+    CHECK(singular.rank() == 2);
+    CHECK(lu.isSingular() == (rez::QRDecomposition<double>(singular).rank() < 3));
+
+    MatrixND<double> regular({ { 4, -2, 1 }, { -2, 4, -2 }, { 1, -2, 4 } });
+    rez::LUDecomposition<double> regularLu(regular);
+    CHECK(!regularLu.isSingular());
+    CHECK(std::abs(regularLu.determinant() - 36.0) < 1e-12);
+    const MatrixND<double> identity = regular * regularLu.inverse();
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            CHECK(std::abs(identity.data[i * 3 + j] - (i == j ? 1.0 : 0.0)) < 1e-12);
+}
+
+//*****************************************************************************
+// MatrixEigen.h
+//*****************************************************************************
+static void testEigen()
+{
+    // second difference matrix, eigenvalues 2 - sqrt(2), 2, 2 + sqrt(2)
+    MatrixND<double> laplacian({ { 2, -1, 0 }, { -1, 2, -1 }, { 0, -1, 2 } });
+    rez::SymmetricEigenSolver<double> symmetric(laplacian);
+    CHECK(symmetric.isConverged());
+    const std::vector<double> expected = { 2 - std::sqrt(2.0), 2, 2 + std::sqrt(2.0) };
+    const std::vector<double> values = laplacian.eigenvalues();
+    CHECK(values.size() == 3);
+    for (int k = 0; k < 3 && k < int(values.size()); k++) {
+        CHECK(std::abs(symmetric.eigenvalues()[k] - expected[k]) < 1e-12);
+        CHECK(std::abs(values[k] - expected[k]) < 1e-12);
+    }
+    // A V = V diag(lambda) with orthonormal columns
+    const MatrixND<double> v = symmetric.eigenvectors();
+    for (int k = 0; k < 3; k++)
+        for (int i = 0; i < 3; i++) {
+            double av = 0, dot = 0;
+            for (int j = 0; j < 3; j++) {
+                av += laplacian.get(i, j) * v.get(j, k);
+                dot += v.get(j, i) * v.get(j, k);
+            }
+            CHECK(std::abs(av - expected[k] * v.get(i, k)) < 1e-12);
+            CHECK(std::abs(dot - (i == k ? 1.0 : 0.0)) < 1e-12);
+        }
+    const std::vector<double> poly = laplacian.characteristicPolynomial();
+    CHECK(poly.size() == 4);
+    const double laplacianPoly[] = { 1, -6, 10, -4 };
+    for (size_t i = 0; i < 4 && i < poly.size(); i++)
+        CHECK(std::abs(poly[i] - laplacianPoly[i]) < 1e-10);
+
+    // companion matrix of (x - 2)(x^2 + 1), eigenvalues i, -i and 2
+    MatrixND<double> companion({ { 2, -1, 2 }, { 1, 0, 0 }, { 0, 1, 0 } });
+    rez::EigenSolver<double> general(companion);
+    CHECK(general.isConverged());
+    const auto lambda = general.eigenvalues();
+    CHECK(lambda.size() == 3);
+    int real = 0, pair = 0;
+    for (size_t k = 0; k < lambda.size(); k++) {
+        if (std::abs(lambda[k] - std::complex<double>(2, 0)) < 1e-10)
+            real++;
+        // the conjugate with the positive imaginary part comes first
+        if (std::abs(lambda[k] - std::complex<double>(0, 1)) < 1e-10 && k + 1 < lambda.size()
+            && std::abs(lambda[k + 1] - std::complex<double>(0, -1)) < 1e-10)
+            pair++;
+        const auto x = general.eigenvector(int(k));
+        for (int i = 0; i < 3; i++) {
+            std::complex<double> ax = 0;
+            for (int j = 0; j < 3; j++)
+                ax += companion.get(i, j) * x[j];
+            CHECK(std::abs(ax - lambda[k] * x[i]) < 1e-10);
+        }
+    }
+    CHECK(real == 1 && pair == 1);
+    const std::vector<double> companionPoly = companion.characteristicPolynomial();
+    const double expectedPoly[] = { 1, -2, 1, -2 };
+    CHECK(companionPoly.size() == 4);
+    for (size_t i = 0; i < 4 && i < companionPoly.size(); i++)
+        CHECK(std::abs(companionPoly[i] - expectedPoly[i]) < 1e-10);
+}
+
+//*****************************************************************************
+// MatrixExpressions.h
+//*****************************************************************************
+static MatrixND<double> filled(int _rows, int _cols, double _value)
+{
+    MatrixND<double> m(_rows, _cols);
+    for (auto& v : m.data)
+        v = _value;
+    return m;
+}
+
+static void testExpressions()
+{
+    const MatrixND<double> q = filled(3, 3, 2.0);
+    // the temporaries are moved into the expressions, which outlive them
+    auto sum = filled(3, 3, 1.0) + q;
+    auto scaled = filled(3, 3, 4.0) * 0.5;
+    auto chained = (q - filled(3, 3, 5.0)) + filled(3, 3, 1.0);
+    const MatrixND<double> a = sum, b = scaled, c = chained;
+    CHECK(a.rows == 3 && a.cols == 3 && a.data[8] == 3.0);
+    CHECK(b.data[4] == 2.0);
+    CHECK(c.data[0] == -2.0);
+
+    // operands of different shapes give an empty matrix, as add() does
+    const MatrixND<double> mismatch = q + filled(2, 3, 1.0);
+    CHECK(mismatch.rows == 0 && mismatch.cols == 0);
+    MatrixND<double> unchanged = q;
+    unchanged += filled(3, 2, 1.0);
+    CHECK(unchanged.data[0] == 2.0);
+}
+
+//*****************************************************************************
+// MatrixFixed.h
+//*****************************************************************************
+static void testFixed()
+{
+    // 5 x 5 takes the elimination path, which has to work in double for int
+    rez::MatrixFixed<int, 5, 5> tridiagonal;
+    for (std::size_t i = 0; i < 5; i++) {
+        for (std::size_t j = 0; j < 5; j++)
+            tridiagonal(i, j) = 0;
+        tridiagonal(i, i) = 3;
+        if (i > 0)
+            tridiagonal(i, i - 1) = tridiagonal(i - 1, i) = 1;
+    }
+    CHECK(rez::determinant(tridiagonal) == 144);
+
+    rez::MatrixFixed<int, 5, 5> diagonal;
+    for (std::size_t i = 0; i < 5; i++)
+        for (std::size_t j = 0; j < 5; j++)
+            diagonal(i, j) = i == j ? 1 : 0;
+    diagonal(2, 0) = 2;
+    const auto inverse = rez::inverse(diagonal);
+    CHECK(inverse(2, 0) == -2 && inverse(2, 2) == 1 && inverse(0, 0) == 1);
+
+    // the adjugate inverses divide in double, 1/det is not truncated to 0
+    const auto small = rez::inverse(rez::MatrixFixed<int, 2, 2>(1, 2, 3, 4));
+    CHECK(small(0, 0) == -2 && small(0, 1) == 1 && small(1, 0) == 2 && small(1, 1) == -1);
+    rez::MatrixFixed<int, 4, 4> block;
+    for (std::size_t i = 0; i < 4; i++)
+        for (std::size_t j = 0; j < 4; j++)
+            block(i, j) = i == j ? 1 : 0;
+    block(0, 0) = 2;
+    block(3, 0) = 4;
+    const auto blockInverse = rez::inverse(block);
+    CHECK(blockInverse(0, 0) == 1 && blockInverse(3, 0) == -2 && blockInverse(3, 3) == 1);
+}
+
+//*****************************************************************************
+// MatrixReduction.h
+//*****************************************************************************
+static void testColumnStatistics()
+{
+    // enough rows for several blocks and threads, offset by 1e6 so a one pass
+    // sum of squares would lose most digits of the variance
+    const int rows = 5000, cols = 5;
+    std::mt19937 generator(7);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    MatrixND<double> m(rows, cols);
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < cols; j++)
+            m(i, j) = 1e6 * (j + 1) + (j + 1) * noise(generator);
+
+    // naive two-pass reference
+    std::vector<double> mean(cols, 0.0), variance(cols, 0.0), cov(cols * cols, 0.0);
+    for (int j = 0; j < cols; j++) {
+        for (int i = 0; i < rows; i++)
+            mean[j] += m.get(i, j);
+        mean[j] /= rows;
+    }
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < cols; j++)
+            for (int k = 0; k < cols; k++)
+                cov[j * cols + k] += (m.get(i, j) - mean[j]) * (m.get(i, k) - mean[k]);
+    for (int j = 0; j < cols; j++)
+        variance[j] = cov[j * cols + j] / (rows - 1);
+
+    for (size_t threads : { size_t(1), size_t(0) }) {
+        const auto stats = rez::columnStatistics(m, true, threads);
+        CHECK(stats.count == rows && stats.cols == cols);
+        const auto var = stats.variance();
+        const MatrixND<double> covariance = stats.covariance();
+        for (int j = 0; j < cols; j++) {
+            CHECK(std::abs(stats.mean[j] - mean[j]) < 1e-9 * std::abs(mean[j]));
+            CHECK(std::abs(var[j] - variance[j]) < 1e-9 * variance[j]);
+            for (int k = 0; k < cols; k++)
+                CHECK(std::abs(covariance.get(j, k) - cov[j * cols + k] / (rows - 1))
+                      < 1e-9 * std::sqrt(variance[j] * variance[k]));
+        }
+    }
+
+    // an expression operand, and the min and max
+    const auto scaled = rez::columnStatistics(m * 2.0);
+    for (int j = 0; j < cols; j++) {
+        double lo = m.get(0, j), hi = m.get(0, j);
+        for (int i = 1; i < rows; i++) {
+            lo = std::min(lo, m.get(i, j));
+            hi = std::max(hi, m.get(i, j));
+        }
+        CHECK(scaled.minimum[j] == 2 * lo && scaled.maximum[j] == 2 * hi);
+        CHECK(std::abs(scaled.variance()[j] - 4 * variance[j]) < 1e-9 * variance[j]);
+    }
+}
+
+//*****************************************************************************
+// SparseMatrix.h
+//*****************************************************************************
+static void testSparse()
+{
+    // 6 x 6 resistor grid of unequal resistors, one corner at 5 V, the
+    // opposite one grounded, 10 mA drawn from the middle
+    const int side = 6;
+    Kirschoff mesh;
+    for (int r = 0; r < side; r++)
+        for (int c = 0; c < side; c++) {
+            const int node = r * side + c;
+            if (c + 1 < side)
+                mesh.addBranch(node, node + 1, 1.0L + 0.1L * ((r + 2 * c) % 5));
+            if (r + 1 < side)
+                mesh.addBranch(node, node + side, 2.0L - 0.2L * ((3 * r + c) % 4));
+        }
+    mesh.fixNodeVoltage(0, 5.0L);
+    mesh.setGround(side * side - 1);
+    mesh.addCurrentSource(2 * side + 3, -0.01L);
+    const auto cg = mesh.solveNodeVoltages(KirschoffSolver::CONJUGATE_GRADIENT);
+    const auto bicg = mesh.solveNodeVoltages(KirschoffSolver::BICGSTAB);
+    const auto lu = mesh.solveNodeVoltages(KirschoffSolver::SPARSE_LU);
+    CHECK(cg.size() == size_t(side * side) && bicg.size() == cg.size() && lu.size() == cg.size());
+    for (size_t i = 0; i < cg.size() && i < bicg.size() && i < lu.size(); i++) {
+        CHECK(std::abs(cg[i] - lu[i]) < 1e-9L);
+        CHECK(std::abs(bicg[i] - lu[i]) < 1e-9L);
+        CHECK(lu[i] > -1.0L && lu[i] <= 5.0L);
+    }
+
+    // nonsymmetric and diagonally dominant, b built from a known x
+    const int n = 40;
+    std::vector<rez::Triplet<double>> triplets;
+    for (int i = 0; i < n; i++) {
+        triplets.push_back({ i, i, 10.0 + i % 7 });
+        if (i + 1 < n)
+            triplets.push_back({ i, i + 1, -1.5 });
+        if (i >= 3)
+            triplets.push_back({ i, i - 3, 2.0 });
+        if (i + 11 < n)
+            triplets.push_back({ i + 11, i, -0.5 + 0.1 * (i % 3) });
+    }
+    const rez::SparseMatrix<double> a(n, n, triplets);
+    std::vector<double> x(n);
+    for (int i = 0; i < n; i++)
+        x[i] = std::sin(double(i)) + 0.5;
+    const std::vector<double> b = a * x;
+    const rez::SparseLU<double> factors(a);
+    CHECK(!factors.isSingular());
+    const std::vector<double> solved = factors.solve(b);
+    CHECK(solved.size() == size_t(n));
+    for (int i = 0; i < n && i < int(solved.size()); i++)
+        CHECK(std::abs(solved[i] - x[i]) < 1e-12);
+    std::vector<double> iterated(n, 0.0);
+    CHECK(rez::biCGSTAB(a, b, iterated).converged);
+    for (int i = 0; i < n; i++)
+        CHECK(std::abs(iterated[i] - x[i]) < 1e-8);
+}
+
+//*****************************************************************************
+// GeoUtils.h
+//*****************************************************************************
+static void testLeftOfBatch()
+{
+    // (1, 2) and (3, 2) are equally far from [a b], the tie goes to (3, 2),
+    // farther along it, whichever comes first
+    const rez::Point2d a(0.0f, 0.0f), b(4.0f, 0.0f);
+    const rez::Points2dSoA points({ rez::Point2d(1.0f, 2.0f), rez::Point2d(2.0f, 1.0f),
+                                    rez::Point2d(3.0f, 2.0f), rez::Point2d(5.0f, -1.0f) });
+    std::vector<uint32_t> left;
+    CHECK(rez::leftOfBatch(a, b, points, left) == 2);
+    CHECK(left.size() == 3);
+    const std::vector<uint32_t> candidates = { 3, 0, 1, 2 };
+    CHECK(rez::leftOfBatch(a, b, points, candidates, left) == 2);
+    CHECK(left.size() == 3);
+    // from b to a, (1, -2) is the farther along
+    const rez::Points2dSoA below({ rez::Point2d(3.0f, -2.0f), rez::Point2d(1.0f, -2.0f) });
+    CHECK(rez::leftOfBatch(b, a, below, left) == 1);
+    CHECK(rez::leftOfBatch(b, a, below, { 0, 1 }, left) == 1);
+    CHECK(rez::leftOfBatch(a, b, below, left) == -1 && left.empty());
+}
+
+//*****************************************************************************
+// Convexhull.h
+//*****************************************************************************
+static void testConvexhull()
+{
+    // a 41 x 41 grid, every boundary point but the corners lies on a hull edge
+    std::vector<rez::Point2d> grid;
+    for (int i = 0; i <= 40; i++)
+        for (int j = 0; j <= 40; j++)
+            grid.emplace_back(float(i), float(j));
+    std::vector<rez::Point2d> hull;
+    rez::convexhull2DQuickhullParallel(grid, hull);
+    CHECK(hull.size() == 4);
+
+    // points on a segment only give its two ends
+    std::vector<rez::Point2d> line;
+    for (int i = 0; i < 100; i++)
+        line.emplace_back(float(i), float(2 * i));
+    rez::convexhull2DQuickhullParallel(line, hull);
+    CHECK(hull.size() == 2);
+
+    // the unit circle in float, where rounding makes many near collinear triples
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> angle(0.0, 6.283185307179586);
+    std::vector<rez::Point2d> circle;
+    for (int i = 0; i < 200000; i++) {
+        const double t = angle(random);
+        circle.emplace_back(float(std::cos(t)), float(std::sin(t)));
+    }
+    rez::convexhull2DQuickhullParallel(circle, hull);
+    bool strictlyConvex = hull.size() >= 3;
+    for (size_t i = 0; i < hull.size(); i++)
+        strictlyConvex = strictlyConvex && rez::orientation2dExact(hull[i], hull[(i + 1) % hull.size()],
+                                                                   hull[(i + 2) % hull.size()]) > 0;
+    CHECK(strictlyConvex);
+
+    // divide and conquer merges the hulls of the two halves
+    std::vector<rez::Point3d> square;
+    for (int i = 0; i <= 10; i++)
+        for (int j = 0; j <= 10; j++)
+            square.emplace_back(float(i), float(j), 0.0f);
+    rez::Polygon squareHull;
+    rez::convexhull2DDivideAndConquer(square, squareHull);
+    CHECK(squareHull.getPoints().size() == 4);
+
+    // enough points for the 3D outside sets to be assigned on the pool
+    std::uniform_real_distribution<double> coordinate(-1.0, 1.0);
+    std::vector<rez::Point3d> cloud;
+    for (int i = 0; i < 200000; i++)
+        cloud.emplace_back(float(coordinate(random)), float(coordinate(random)), float(coordinate(random)));
+    std::vector<rez::Face*> faces;
+    CHECK(rez::convexhull3DQuickhull(cloud, faces));
+    std::set<rez::Vertex3d*> vertices;
+    std::set<rez::Edge3d*> edges;
+    bool enclosed = true;
+    for (rez::Face* face : faces) {
+        vertices.insert(face->vertices.begin(), face->vertices.end());
+        edges.insert(face->edges.begin(), face->edges.end());
+        for (const rez::Point3d& point : cloud)
+            enclosed = enclosed && rez::orientation3dExact(*face->vertices[0]->point, *face->vertices[1]->point,
+                                                           *face->vertices[2]->point, point) <= 0;
+    }
+    CHECK(enclosed);
+    CHECK(vertices.size() - edges.size() + faces.size() == 2);
+    for (rez::Face* face : faces)
+        delete face;
+    for (rez::Edge3d* edge : edges)
+        delete edge;
+    for (rez::Vertex3d* vertex : vertices)
+        delete vertex;
+}
+
+//*****************************************************************************
+// Polygon.h
+//*****************************************************************************
+static double signedArea(const std::vector<rez::Point3d>& _points)
+{
+    double area = 0;
+    for (size_t i = 0; i < _points.size(); i++) {
+        const rez::Point3d& a = _points[i];
+        const rez::Point3d& b = _points[(i + 1) % _points.size()];
+        area += double(a[X_]) * b[Y_] - double(b[X_]) * a[Y_];
+    }
+    return area / 2;
+}
+
+static void testPolygonMerge()
+{
+    // two overlapping squares, the second one clockwise
+    rez::Polygon first(std::vector<rez::Point3d>{ { 0, 0, 0 }, { 2, 0, 0 }, { 2, 2, 0 }, { 0, 2, 0 } });
+    rez::Polygon second(std::vector<rez::Point3d>{ { 1, 1, 0 }, { 1, 3, 0 }, { 3, 3, 0 }, { 3, 1, 0 } });
+    rez::Polygon merged;
+    CHECK(rez::merge(first, second, merged));
+    CHECK(merged.getPoints().size() == 8);
+    CHECK(std::abs(signedArea(merged.getPoints()) - 7.0) < 1e-6);
+
+    // disjoint squares have no single outline
+    rez::Polygon apart(std::vector<rez::Point3d>{ { 5, 5, 0 }, { 6, 5, 0 }, { 6, 6, 0 }, { 5, 6, 0 } });
+    CHECK(!rez::merge(first, apart, merged));
+    CHECK(merged.getPoints().empty());
+}
+
+//*****************************************************************************
+// Triangulation.h
+//*****************************************************************************
+static void testTriangulation()
+{
+    std::vector<uint32_t> triangles{ 7, 7, 7 };
+    const std::vector<rez::Point2d> square{ { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+    CHECK(rez::triangulate_polygon(square, triangles));
+    CHECK(triangles.size() == 6);
+
+    // a failure leaves no triangles of an earlier call behind
+    const std::vector<rez::Point2d> segment{ { 0, 0 }, { 1, 1 }, { 0, 0 } };
+    CHECK(!rez::triangulate_polygon(segment, triangles));
+    CHECK(triangles.empty());
+}
+
+//*****************************************************************************
+// ColumnarFile.h
+//*****************************************************************************
+static void testColumnarFile()
+{
+    const char* path = "unitTests.columnar";
+    MatrixND<double> values(3, 2);
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 2; j++)
+            values(i, j) = i * 2 + j;
+    CHECK(rez::writeColumnar(path, values, { "a", "b" }, rez::ColumnCompression::ShuffleRle));
+    rez::ColumnarFile file(path);
+    CHECK(file.isOpen() && file.rows() == 3 && file.cols() == 2 && file.columnIndex("b") == 1);
+    const MatrixND<double> read = file.toMatrix<double>();
+    CHECK(read.rows == 3 && read.cols == 2 && read.get(2, 1) == 5);
+
+    // a file without columns has an empty directory
+    CHECK(rez::writeColumnar(path, values.data.data(), 3, 0));
+    CHECK(file.open(path) && file.cols() == 0);
+    file.close();
+    std::remove(path);
+}
+
+//*****************************************************************************
+// CsvReader.h
+//*****************************************************************************
+static void testCsvReader()
+{
+    const char* path = "unitTests.csv";
+    std::ofstream(path) << "a,b,c\n";
+    rez::CsvReader<double> headerOnly(path, ',', true);
+    MatrixND<double> values;
+    CHECK(headerOnly.read(values));
+    CHECK(values.rows == 0 && values.cols == 3);
+
+    // extra fields are dropped and counted once per row, missing ones per field
+    std::ofstream(path) << "1,2\n3,4,5\n6,7,\n8,\n";
+    rez::CsvReader<double> ragged(path);
+    CHECK(ragged.read(values));
+    CHECK(values.rows == 4 && values.cols == 2 && values.get(1, 1) == 4);
+    CHECK(ragged.invalidFields() == 3);
+    std::remove(path);
+}
+
+//*****************************************************************************
+// Voronoi.h
+//*****************************************************************************
+static void testVoronoi()
+{
+    // four sites on a square meet in one vertex, with one edge per side pair
+    const std::vector<rez::Point2d> sites{ { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+    rez::BoundRectangle rect{ -10.0f, 10.0f, 10.0f, -10.0f };
+    rez::FortuneVoronoi voronoi;
+    std::vector<rez::Edge2dSimple> edges;
+    voronoi.compute(sites, rect, edges);
+    const size_t first = edges.size();
+    CHECK(first >= 4);
+
+    // a second run on the same output replaces the edges
+    voronoi.compute(sites, rect, edges);
+    CHECK(edges.size() == first);
+}
+
+int main()
+{
+    testDecomposition();
+    failures += testMatrixNDAlone();
+    testEigen();
+    testExpressions();
+    testFixed();
+    testColumnStatistics();
+    testSparse();
+    testLeftOfBatch();
+    testConvexhull();
+    testPolygonMerge();
+    testTriangulation();
+    testColumnarFile();
+    testCsvReader();
+    testVoronoi();
+    if (failures == 0)
+        std::printf("all checks passed\n");
+    return failures;
+}
@@ -0,0 +1,35 @@
+// Checks the MatrixND members that are defined in the solver and reduction
+// headers from a translation unit that includes MatrixND.h alone, so that
+// MatrixND.h keeps pulling those headers in. Run from unitTests.cpp.
+#include <cmath>
+#include <cstdio>
+#include "MatrixND.h"
+
+int testMatrixNDAlone()
+{
+    int failed = 0;
+    const auto check = [&failed](bool _condition, const char* _what, int _line) {
+        if (_condition)
+            return;
+        std::printf("unitTestsMatrixND.cpp:%d: check failed: %s\n", _line, _what);
+        failed++;
+    };
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+    MatrixND<double> a({ { 4, -2, 1 }, { -2, 4, -2 }, { 1, -2, 4 } });
+    CHECK(std::abs(a.determinant() - 36.0) < 1e-12);
+    CHECK(a.rank() == 3);
+    const MatrixND<double> identity = a * a.inverse();
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            CHECK(std::abs(identity.get(i, j) - (i == j ? 1.0 : 0.0)) < 1e-12);
+
+    MatrixND<double> singular({ { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 } });
+    CHECK(singular.rank() == 2);
+    CHECK(singular.determinant() == 0.0);
+    const MatrixND<double> means = singular.colwise().mean();
+    CHECK(means.get(0, 0) == 4.0 && means.get(0, 2) == 6.0);
+
+#undef CHECK
+    return failed;
+}